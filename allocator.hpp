@@ -0,0 +1,164 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#ifndef __ALLOCATOR_H
+#define __ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+
+// The allocator of the large per-process arrays (the CSR of the
+// local graph, the community and degree vectors, ...), chosen at
+// compile time:
+// - on KNL with USE_AUTOHBW_MEMALLOC, in high-bandwidth memory
+// - with USE_NUMA_FIRST_TOUCH, the pages of every allocation of at 
+//   least NUMA_MIN_BYTES are touched by the threads with a static
+//   schedule (contiguous blocks of pages, like a static schedule of
+//   the elements) before the vector initializes them, so that they 
+//   are placed on the NUMA node of the thread that will compute on 
+//   them (with bound threads, e.g. OMP_PROC_BIND=close)
+// - with USE_NUMA_INTERLEAVE, the same allocations are interleaved
+//   across the NUMA nodes with libnuma (link with -lnuma)
+// - otherwise, std::allocator
+#if defined(__CRAY_MIC_KNL) && defined(USE_AUTOHBW_MEMALLOC)
+#include <hbw_allocator.h>
+
+template<class T> using DataAllocator = hbw::allocator<T>;
+#elif defined(USE_NUMA_FIRST_TOUCH) || defined(USE_NUMA_INTERLEAVE)
+#if defined(USE_NUMA_FIRST_TOUCH) && defined(USE_NUMA_INTERLEAVE)
+#error "USE_NUMA_FIRST_TOUCH cannot be combined with USE_NUMA_INTERLEAVE"
+#endif
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <omp.h>
+
+#if defined(USE_NUMA_INTERLEAVE)
+#include <numa.h>
+#endif
+
+// smaller allocations (e.g. map nodes) use operator new
+#define NUMA_MIN_BYTES (1 << 20)
+
+template<class T>
+class NumaAllocator
+{
+    public:
+        typedef T value_type;
+
+        NumaAllocator() {}
+        template<class U> NumaAllocator(const NumaAllocator<U> &) {}
+
+        T *allocate(const std::size_t n)
+        {
+            const std::size_t bytes = n*sizeof(T);
+
+            if (bytes < NUMA_MIN_BYTES)
+                return static_cast<T*>(::operator new(bytes));
+
+#if defined(USE_NUMA_INTERLEAVE)
+            void *p = numa_alloc_interleaved(bytes);
+
+            if (!p)
+                throw std::bad_alloc();
+#else
+            void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, 
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (p == MAP_FAILED)
+                throw std::bad_alloc();
+
+            firstTouch(static_cast<char*>(p), bytes);
+#endif
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T *p, const std::size_t n)
+        {
+            const std::size_t bytes = n*sizeof(T);
+
+            if (bytes < NUMA_MIN_BYTES)
+                ::operator delete(p);
+            else
+#if defined(USE_NUMA_INTERLEAVE)
+                numa_free(p, bytes);
+#else
+                munmap(p, bytes);
+#endif
+        }
+
+    private:
+        // within a parallel region (e.g. a per-thread 
+        // container), the calling thread touches them all
+        static void firstTouch(char *p, const std::size_t bytes)
+        {
+            const long page = sysconf(_SC_PAGESIZE);
+            const long npages = (bytes + page - 1) / page;
+
+#pragma omp parallel for schedule(static) if (!omp_in_parallel())
+            for (long k = 0; k < npages; k++)
+                p[k*page] = 0;
+        }
+};
+
+template<class T, class U>
+inline bool operator==(const NumaAllocator<T> &, const NumaAllocator<U> &) { return true; }
+template<class T, class U>
+inline bool operator!=(const NumaAllocator<T> &, const NumaAllocator<U> &) { return false; }
+
+template<class T> using DataAllocator = NumaAllocator<T>;
+#else
+#include <memory>
+
+template<class T> using DataAllocator = std::allocator<T>;
+#endif
+
+#endif // __ALLOCATOR_H
@@ -0,0 +1,143 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#include "arena.hpp"
+
+PhaseArena phaseArena;
+
+PhaseArena::PhaseArena(): slots_(omp_get_max_threads() + 1)
+{
+  omp_init_lock(&lock_);
+} // PhaseArena
+
+PhaseArena::~PhaseArena()
+{
+  for (size_t t = 0; t < slots_.size(); t++) {
+      for (size_t c = 0; c < slots_[t].chunks.size(); c++)
+          ::operator delete(slots_[t].chunks[c]);
+  }
+
+  omp_destroy_lock(&lock_);
+} // ~PhaseArena
+
+int PhaseArena::slotIndex() const
+{
+  const int shared = slots_.size() - 1;
+  const int t = omp_get_thread_num();
+
+  if ((omp_get_active_level() > 1) || (t >= shared))
+      return shared;
+
+  return t;
+} // slotIndex
+
+void *PhaseArena::allocate(size_t bytes)
+{
+  const int t = slotIndex();
+  const bool shared = (t == static_cast<int>(slots_.size() - 1));
+
+  bytes = (bytes + ARENA_ALIGN - 1) & ~static_cast<size_t>(ARENA_ALIGN - 1);
+
+  if (shared)
+      omp_set_lock(&lock_);
+
+  Slot &s = slots_[t];
+
+  if ((s.used + bytes) > ARENA_CHUNK_BYTES) {
+      s.chunk++;
+      s.used = 0;
+
+      if (s.chunk == static_cast<long>(s.chunks.size()))
+          s.chunks.push_back(static_cast<char*>(::operator new(ARENA_CHUNK_BYTES)));
+  }
+
+  void *p = s.chunks[s.chunk] + s.used;
+  s.used += bytes;
+
+  if (shared)
+      omp_unset_lock(&lock_);
+
+  return p;
+} // allocate
+
+void PhaseArena::reset()
+{
+  for (size_t t = 0; t < slots_.size(); t++) {
+      Slot &s = slots_[t];
+
+      for (size_t c = 1; c < s.chunks.size(); c++)
+          ::operator delete(s.chunks[c]);
+
+      if (s.chunks.size() > 1)
+          s.chunks.resize(1);
+
+      s.chunk = -1;
+      s.used = ARENA_CHUNK_BYTES;
+  }
+} // reset
+
+ArenaMark PhaseArena::mark()
+{
+  const Slot &s = slots_[slotIndex()];
+  ArenaMark m;
+
+  m.chunk = s.chunk;
+  m.used = s.used;
+
+  return m;
+} // mark
+
+void PhaseArena::release(const ArenaMark &m)
+{
+  Slot &s = slots_[slotIndex()];
+
+  s.chunk = m.chunk;
+  s.used = m.used;
+} // release
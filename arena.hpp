@@ -0,0 +1,169 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <omp.h>
+
+// A monotonic allocator for the temporary containers of a phase
+// (e.g. the node-based sets of the remote communities, or of the
+// ghost vertices in the coloring), which are otherwise allocated 
+// and freed element by element, from all the threads, phase after
+// phase. Every thread bump-allocates from its own chunks (threads of
+// nested parallel regions share a locked one); freeing is a no-op, 
+// and the memory is reclaimed by reset(), which the main loop calls
+// before every phase (all the chunks but the first of every thread
+// are freed then), or by an ArenaScope on the calling thread.
+// Allocations larger than a quarter of a chunk (e.g. the growth of
+// a large vector) bypass the arena.
+// The containers using the arena must not outlive the phase.
+#define ARENA_CHUNK_BYTES (1 << 20)
+#define ARENA_ALIGN 16
+
+// position of a thread in the arena
+struct ArenaMark
+{
+    long chunk;
+    size_t used;
+};
+
+class PhaseArena
+{
+    public:
+        PhaseArena();
+        ~PhaseArena();
+
+        void *allocate(size_t bytes);
+        static bool isLarge(const size_t bytes) { return (bytes > ARENA_CHUNK_BYTES/4); }
+
+        void reset();
+
+        // the calling thread only
+        ArenaMark mark();
+        void release(const ArenaMark &m);
+
+    private:
+        struct Slot
+        {
+            std::vector<char*> chunks;
+            long chunk; // current chunk, -1 before the first allocation
+            size_t used;
+            char pad[64];
+
+            Slot(): chunk(-1), used(ARENA_CHUNK_BYTES) {}
+        };
+
+        int slotIndex() const;
+
+        std::vector<Slot> slots_; // the last is shared
+        omp_lock_t lock_;
+};
+
+extern PhaseArena phaseArena;
+
+template<class T>
+class ArenaAllocator
+{
+    public:
+        typedef T value_type;
+
+        ArenaAllocator() {}
+        template<class U> ArenaAllocator(const ArenaAllocator<U> &) {}
+
+        T *allocate(const std::size_t n)
+        {
+            const std::size_t bytes = n*sizeof(T);
+
+            if (PhaseArena::isLarge(bytes))
+                return static_cast<T*>(::operator new(bytes));
+
+            return static_cast<T*>(phaseArena.allocate(bytes));
+        }
+
+        void deallocate(T *p, const std::size_t n)
+        {
+            if (PhaseArena::isLarge(n*sizeof(T)))
+                ::operator delete(p);
+        }
+};
+
+template<class T, class U>
+inline bool operator==(const ArenaAllocator<T> &, const ArenaAllocator<U> &) { return true; }
+template<class T, class U>
+inline bool operator!=(const ArenaAllocator<T> &, const ArenaAllocator<U> &) { return false; }
+
+// releases, when it goes out of scope, what the calling thread
+// allocated from the arena since it was created (declare it before
+// the containers, which must only be filled by the calling thread)
+class ArenaScope
+{
+    public:
+        ArenaScope(): mark_(phaseArena.mark()) {}
+        ~ArenaScope() { phaseArena.release(mark_); }
+
+    private:
+        ArenaMark mark_;
+};
+
+// the allocator of the temporary containers of a 
+// phase: the arena with USE_PHASE_ARENA
+#if defined(USE_PHASE_ARENA)
+template<class T> using TempAllocator = ArenaAllocator<T>;
+#else
+template<class T> using TempAllocator = std::allocator<T>;
+#endif
+
+#endif // __ARENA_H
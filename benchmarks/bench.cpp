@@ -0,0 +1,416 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering
+//                  using MPI+OpenMP
+//
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <omp.h>
+#include <mpi.h>
+
+#include "../distgraph.hpp"
+#include "../louvain.hpp"
+#include "../rebuild.hpp"
+#include "../utils.hpp"
+
+// microbenchmarks of the kernels of a phase, on a generated graph,
+// every kernel is timed reps times (the time of a repetition is the
+// maximum over the processes), and a CSV line per kernel is written
+
+static int me, nprocs;
+
+static GraphElem numVertices = 0;
+static int genType = RGG_GENERATOR;
+static std::string genName("rgg");
+static std::vector<GraphWeight> genArgs;
+static std::string kernelArgs("localmap vertexreqs fillremote rebuild load louvain");
+static std::string csvFileName, graphFileName("bench-graph.bin");
+static int reps = 5;
+
+static void parseCommandLine(const int argc, char * const argv[]);
+
+// the times of the repetitions of a kernel (at the root)
+class KernelTimer
+{
+    public:
+        KernelTimer(): t0_(0.0) {}
+
+        void start()
+        {
+          MPI_Barrier(MPI_COMM_WORLD);
+          t0_ = MPI_Wtime();
+        }
+
+        void stop()
+        {
+          double t = MPI_Wtime() - t0_, tmax = 0.0;
+          MPI_Reduce(&t, &tmax, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+          times_.push_back(tmax);
+        }
+
+        const std::vector<double> &times() const { return times_; }
+
+    private:
+        double t0_;
+        std::vector<double> times_;
+};
+
+static void generate(DistGraph *&dg, const std::string &fileOut)
+{
+  generateInMemGraph(me, nprocs, dg, numVertices, 0.0, fileOut, false, genType, genArgs);
+}
+
+// the phase state up to the visit of the vertices (singleton communities)
+struct KernelState
+{
+    size_t ssz, rsz;
+    std::vector<GraphElem> ssizes, rsizes, svdata, rvdata;
+    LocalElemVector localTails;
+    CommunityVector pastComm, currComm, remoteComm;
+    GraphWeightVector vDegree;
+    CommVector localCinfo, remoteCinfo, remoteCupdate;
+    GraphElemVector remoteCids;
+    GraphWeight constantForSecondTerm;
+
+    KernelState(): ssz(0), rsz(0), constantForSecondTerm(0.0) {}
+};
+
+static void initKernelState(const DistGraph &dg, KernelState &ks)
+{
+  const GraphElem nv = dg.getLocalGraph().getNumVertices();
+
+  ks.vDegree.resize(nv);
+  ks.pastComm.resize(nv);
+  ks.currComm.resize(nv);
+  ks.localCinfo.resize(nv);
+
+  distSumVertexDegree(dg.getLocalGraph(), ks.vDegree, ks.localCinfo);
+  ks.constantForSecondTerm = distCalcConstantForSecondTerm(ks.vDegree);
+  distInitComm(ks.pastComm, ks.currComm, dg.getBase(me));
+}
+
+// the vertex visits of an iteration, without the moves
+static GraphElem visitVertices(const DistGraph &dg, const KernelState &ks,
+        ClusterLocalAccumulatorVector &claccs)
+{
+  const Graph &g = dg.getLocalGraph();
+  const GraphElem nv = g.getNumVertices();
+  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
+  GraphElem moves = 0;
+
+#pragma omp parallel reduction(+: moves)
+  {
+      ClusterLocalAccumulator &clacc = claccs[omp_get_thread_num()];
+
+#pragma omp for schedule(guided)
+      for (GraphElem i = 0; i < nv; i++) {
+          GraphElem e0, e1;
+          const GraphElem cc = ks.currComm[i];
+
+          g.getEdgeRangeForVertex(i, e0, e1);
+          if (e0 == e1)
+              continue;
+
+          clacc.clear();
+          clacc.reserve(e1 - e0 + 1);
+          clacc.add(cc, 0.0);
+
+          const GraphWeight selfLoop = distBuildLocalMapCounter(e0, e1, clacc,
+                  ks.localTails, g, ks.currComm, ks.remoteComm, i);
+          const Comm &info = (cc >= base && cc < bound) ? ks.localCinfo[cc - base]
+              : ks.remoteCinfo[distGetRemoteCommIndex(ks.remoteCids, cc)];
+          const GraphElem target = distGetMaxIndex(clacc, selfLoop, ks.localCinfo,
+                  ks.remoteCids, ks.remoteCinfo, ks.vDegree[i], info.size, info.degree,
+                  cc, base, bound, ks.constantForSecondTerm);
+
+          if (target != cc)
+              moves++;
+      }
+  }
+
+  return moves;
+}
+
+static void writeCSV(std::ostream &os, const std::string &kernel,
+        const GraphElem nv, const GraphElem ne, const std::vector<double> &times)
+{
+  const double tmin = *std::min_element(times.begin(), times.end());
+  const double tmax = *std::max_element(times.begin(), times.end());
+  double tavg = 0.0;
+
+  for (double t: times)
+      tavg += t;
+  tavg /= times.size();
+
+  os << kernel << "," << genName << "," << nv << "," << ne << "," << nprocs << ","
+      << omp_get_max_threads() << "," << times.size() << "," << tmin << ","
+      << tavg << "," << tmax << "," << (tmin > 0.0 ? ne / tmin : 0.0) << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  MPI_Init(&argc, &argv);
+
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &me);
+
+  parseCommandLine(argc, argv);
+
+  createCommunityMPIType();
+  createEdgeMPIType();
+
+  // the kernels are separated by spaces or commas
+  std::vector<std::string> kernels;
+  std::replace(kernelArgs.begin(), kernelArgs.end(), ',', ' ');
+  std::stringstream ss(kernelArgs);
+  std::string s;
+  while (ss >> s)
+      kernels.push_back(s);
+
+  const bool loadKernel = std::find(kernels.begin(), kernels.end(), "load") != kernels.end();
+  DistGraph *dg = NULL;
+  generate(dg, loadKernel ? graphFileName : std::string());
+
+  const GraphElem nv = dg->getTotalNumVertices(), ne = dg->getTotalNumEdges();
+
+  std::ofstream csv;
+  std::ostream *os = &std::cout;
+  if (me == 0) {
+      bool header = true;
+
+      if (!csvFileName.empty()) {
+          std::ifstream ifs(csvFileName.c_str());
+          header = !ifs.good() || ifs.peek() == std::ifstream::traits_type::eof();
+          csv.open(csvFileName.c_str(), std::ios::app);
+          os = &csv;
+      }
+      if (header)
+          *os << "kernel,generator,nv,ne,nprocs,threads,reps,min,avg,max,edges_per_s" << std::endl;
+  }
+
+  for (const std::string &kernel: kernels) {
+      KernelTimer timer;
+
+      if (kernel == "localmap") {
+          KernelState ks;
+          ClusterLocalAccumulatorVector claccs(omp_get_max_threads());
+          GraphElem moves = 0;
+
+          initKernelState(*dg, ks);
+          exchangeVertexReqs(*dg, ks.ssz, ks.rsz, ks.ssizes, ks.rsizes, ks.svdata,
+                  ks.rvdata, ks.localTails, me, nprocs);
+          fillRemoteCommunities(*dg, me, nprocs, ks.ssz, ks.rsz, ks.ssizes, ks.rsizes,
+                  ks.svdata, ks.rvdata, ks.currComm, ks.localCinfo, ks.remoteCids,
+                  ks.remoteCinfo, ks.remoteComm, ks.remoteCupdate);
+          for (int r = 0; r < reps; r++) {
+              timer.start();
+              moves += visitVertices(*dg, ks, claccs);
+              timer.stop();
+          }
+          if (moves < 0)
+              std::cout << moves << std::endl;
+      }
+      else if (kernel == "vertexreqs") {
+          KernelState ks;
+
+          for (int r = 0; r < reps; r++) {
+              timer.start();
+              exchangeVertexReqs(*dg, ks.ssz, ks.rsz, ks.ssizes, ks.rsizes, ks.svdata,
+                      ks.rvdata, ks.localTails, me, nprocs);
+              timer.stop();
+          }
+      }
+      else if (kernel == "fillremote") {
+          KernelState ks;
+
+          initKernelState(*dg, ks);
+          exchangeVertexReqs(*dg, ks.ssz, ks.rsz, ks.ssizes, ks.rsizes, ks.svdata,
+                  ks.rvdata, ks.localTails, me, nprocs);
+          for (int r = 0; r < reps; r++) {
+              timer.start();
+              fillRemoteCommunities(*dg, me, nprocs, ks.ssz, ks.rsz, ks.ssizes, ks.rsizes,
+                      ks.svdata, ks.rvdata, ks.currComm, ks.localCinfo, ks.remoteCids,
+                      ks.remoteCinfo, ks.remoteComm, ks.remoteCupdate);
+              timer.stop();
+          }
+      }
+      else if (kernel == "rebuild") {
+          // the communities of a first phase are coarsened
+          // by every repetition, on a new copy of the graph
+          std::vector<GraphElem> ssizes, rsizes, svdata, rvdata;
+          size_t ssz = 0, rsz = 0;
+          CommunityVector cvect;
+          int iters = 0;
+
+          distLouvainMethod(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, svdata, rvdata,
+                  cvect, -1.0, 1.0E-6, iters);
+          for (int r = 0; r < reps; r++) {
+              DistGraph *copy = NULL;
+              CommunityVector comm(cvect);
+
+              generate(copy, std::string());
+              timer.start();
+              distbuildNextLevelGraph(nprocs, me, copy, ssz, rsz, ssizes, rsizes,
+                      svdata, rvdata, comm);
+              timer.stop();
+              delete copy;
+          }
+      }
+      else if (kernel == "load") {
+          std::string fileName(graphFileName);
+
+          for (int r = 0; r < reps; r++) {
+              DistGraph *loaded = NULL;
+
+              timer.start();
+              loadDistGraphMPIIO(me, nprocs, 1, loaded, fileName);
+              timer.stop();
+              delete loaded;
+          }
+      }
+      else if (kernel == "louvain") {
+          for (int r = 0; r < reps; r++) {
+              std::vector<GraphElem> ssizes, rsizes, svdata, rvdata;
+              size_t ssz = 0, rsz = 0;
+              CommunityVector cvect;
+              int iters = 0;
+
+              timer.start();
+              distLouvainMethod(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, svdata, rvdata,
+                      cvect, -1.0, 1.0E-6, iters);
+              timer.stop();
+          }
+      }
+      else {
+          if (me == 0)
+              std::cerr << "Unknown kernel: " << kernel << ", skipped." << std::endl;
+          continue;
+      }
+
+      if (me == 0)
+          writeCSV(*os, kernel, nv, ne, timer.times());
+  }
+
+  if (loadKernel && me == 0)
+      std::remove(graphFileName.c_str());
+
+  delete dg;
+
+  destroyCommunityMPIType();
+  destroyEdgeMPIType();
+
+  MPI_Finalize();
+  return 0;
+} // main
+
+void parseCommandLine(const int argc, char * const argv[])
+{
+  int ret;
+
+  while ((ret = getopt(argc, argv, "n:T:k:r:o:f:")) != -1) {
+    switch (ret) {
+    case 'n':
+      numVertices = atol(optarg);
+      break;
+    case 'T':
+      {
+          std::stringstream ss(optarg);
+          std::string s;
+          std::vector<std::string> args;
+          while (std::getline(ss, s, ' ')) {
+              if (!s.empty())
+                  args.push_back(s);
+          }
+          if (args.size() > 0) {
+              genName = args[0];
+              std::transform(genName.begin(), genName.end(), genName.begin(), ::tolower);
+              if (genName == "rmat")
+                  genType = RMAT_GENERATOR;
+              else if (genName == "rgg")
+                  genType = RGG_GENERATOR;
+              else
+                  genType = -1;
+              for (size_t i = 1; i < args.size(); i++)
+                  genArgs.push_back(std::stod(args[i]));
+          }
+      }
+      break;
+    case 'k':
+      kernelArgs.assign(optarg);
+      break;
+    case 'r':
+      reps = atoi(optarg);
+      break;
+    case 'o':
+      csvFileName.assign(optarg);
+      break;
+    case 'f':
+      graphFileName.assign(optarg);
+      break;
+    default:
+      if (me == 0)
+          std::cerr << "Bad option: " << (char)optopt << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+  }
+
+  if (numVertices <= 0 || genType < 0 || reps <= 0) {
+      if (me == 0)
+          std::cerr << "Usage: " << argv[0] << " -n <vertices> [-T \"<rgg|rmat> [args]\"] "
+              << "[-k \"<kernels>\"] [-r <reps>] [-o <csv file>] [-f <graph file>]" << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, -99);
+  }
+} // parseCommandLine
@@ -0,0 +1,42 @@
+#!/bin/sh
+# strong or weak scaling sweep of the microbenchmarks over the
+# process and thread counts, the CSV lines of every run are
+# appended to the output file (see benchmarks/bench.cpp)
+#
+# usage: scaling.sh <strong|weak> <vertices> <csv file> [graphBenchmark options]
+#
+# with weak scaling, <vertices> is per process, the sweep is set
+# by the environment: PROCS (default "1 2 4 8"), THREADS (default
+# "1 2 4"), MPIRUN (default "mpirun") and BENCH (default
+# bin/graphBenchmark, built with make bench)
+
+if [ $# -lt 3 ]; then
+    echo "usage: $0 <strong|weak> <vertices> <csv file> [graphBenchmark options]" >&2
+    exit 1
+fi
+
+mode=$1
+vertices=$2
+csv=$3
+shift 3
+
+case $mode in
+    strong|weak) ;;
+    *) echo "$0: unknown scaling mode $mode" >&2; exit 1 ;;
+esac
+
+PROCS=${PROCS:-"1 2 4 8"}
+THREADS=${THREADS:-"1 2 4"}
+MPIRUN=${MPIRUN:-mpirun}
+BENCH=${BENCH:-bin/graphBenchmark}
+
+for p in $PROCS; do
+    for t in $THREADS; do
+        n=$vertices
+        if [ "$mode" = weak ]; then
+            n=$((vertices * p))
+        fi
+        echo "$mode: $p processes, $t threads, $n vertices" >&2
+        OMP_NUM_THREADS=$t $MPIRUN -np $p $BENCH -n $n -o "$csv" "$@" > /dev/null || exit 1
+    done
+done
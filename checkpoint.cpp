@@ -0,0 +1,198 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include <mpi.h>
+
+#include "checkpoint.hpp"
+#include "louvain.hpp"
+
+#define CHECKPOINT_VERSION          (1)
+
+static void renameCheckpointFile(const std::string &fileName)
+{
+    const std::string tmpFileName = fileName + ".tmp";
+    
+    if (std::rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+        std::cerr << "Error renaming checkpoint file: " << tmpFileName << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+} // renameCheckpointFile
+
+void writeCheckpoint(int me, int nprocs, const std::string &prefix, DistGraph *&dg, 
+        const std::vector<GraphElem> &membership, GraphElem membershipBase, 
+        const CheckpointState &state)
+{
+    const Graph &g = dg->getLocalGraph();
+    const GraphElem lnv = g.getNumVertices(), base = dg->getBase(me);
+    std::string graphFileName = prefix + ".graph.tmp";
+
+    std::vector<GraphElem> edgeCount(state.coarseNv + 1, 0);
+    for (GraphElem i = 0; i < lnv; i++) {
+        GraphElem e0, e1;
+        g.getEdgeRangeForVertex(i, e0, e1);
+        edgeCount[base + i + 1] = e1 - e0;
+    }
+
+    writeGraph(me, nprocs, dg, edgeCount, graphFileName, false);
+    writeCommunities(me, nprocs, prefix + ".membership.tmp", membership, membershipBase, 
+            state.nv, false);
+
+    if (me == 0) {
+        std::ofstream ofs((prefix + ".state.tmp").c_str());
+
+        ofs << std::setprecision(17);
+        ofs << "version " << CHECKPOINT_VERSION << std::endl;
+        ofs << "nv " << state.nv << std::endl;
+        ofs << "coarse_nv " << state.coarseNv << std::endl;
+        ofs << "phase " << state.phase << std::endl;
+        ofs << "short_phase " << state.shortPhase << std::endl;
+        ofs << "iterations " << state.totIters << std::endl;
+        ofs << "modularity " << state.modularity << std::endl;
+        ofs << "colors " << state.numColors << std::endl;
+        ofs << "teps " << state.teps << std::endl;
+        ofs << "total_time " << state.total << std::endl;
+        ofs << "clustering_time " << state.ctime << std::endl;
+
+        if (!ofs) {
+            std::cerr << "Error writing checkpoint file: " << prefix << ".state.tmp" << std::endl;
+            MPI_Abort(MPI_COMM_WORLD, -99);
+        }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    if (me == 0) {
+        renameCheckpointFile(prefix + ".graph");
+        renameCheckpointFile(prefix + ".membership");
+        renameCheckpointFile(prefix + ".state");
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+} // writeCheckpoint
+
+static void readCheckpointState(int me, const std::string &fileName, CheckpointState &state)
+{
+    int ok = 1;
+
+    if (me == 0) {
+        std::ifstream ifs(fileName.c_str());
+        std::string key;
+        int version = 0;
+
+        ifs >> key >> version;
+        if (!ifs || key != "version" || version != CHECKPOINT_VERSION)
+            ok = 0;
+
+        while (ok && (ifs >> key)) {
+            if (key == "nv")
+                ifs >> state.nv;
+            else if (key == "coarse_nv")
+                ifs >> state.coarseNv;
+            else if (key == "phase")
+                ifs >> state.phase;
+            else if (key == "short_phase")
+                ifs >> state.shortPhase;
+            else if (key == "iterations")
+                ifs >> state.totIters;
+            else if (key == "modularity")
+                ifs >> state.modularity;
+            else if (key == "colors")
+                ifs >> state.numColors;
+            else if (key == "teps")
+                ifs >> state.teps;
+            else if (key == "total_time")
+                ifs >> state.total;
+            else if (key == "clustering_time")
+                ifs >> state.ctime;
+            else
+                ok = 0;
+        }
+    }
+
+    MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (!ok) {
+        if (me == 0)
+            std::cerr << "Error reading checkpoint file: " << fileName << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    MPI_Bcast(&state, sizeof(CheckpointState), MPI_BYTE, 0, MPI_COMM_WORLD);
+} // readCheckpointState
+
+void readCheckpoint(int me, int nprocs, int ranksPerNode, const std::string &prefix, 
+        DistGraph *&dg, std::vector<GraphElem> &membership, GraphElem &membershipBase, 
+        CheckpointState &state)
+{
+    std::string graphFileName = prefix + ".graph";
+
+    readCheckpointState(me, prefix + ".state", state);
+    loadDistGraphMPIIO(me, nprocs, ranksPerNode, dg, graphFileName);
+
+    if (dg->getTotalNumVertices() != state.coarseNv) {
+        if (me == 0)
+            std::cerr << "The checkpoint files do not match: " << graphFileName << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    const std::string membershipFileName = prefix + ".membership";
+
+    membershipBase = (state.nv * me) / nprocs;
+    if (readCommunities(me, nprocs, membershipFileName, membershipBase, 
+                ((state.nv * (me + 1)) / nprocs) - membershipBase, membership) != state.nv) {
+        if (me == 0)
+            std::cerr << "The checkpoint files do not match: " << membershipFileName << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+} // readCheckpoint
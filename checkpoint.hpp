@@ -0,0 +1,88 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <string>
+#include <vector>
+
+#include "distgraph.hpp"
+
+// the state of the phases at a phase boundary
+struct CheckpointState
+{
+    GraphElem nv;               // #vertices of the input graph
+    GraphElem coarseNv;         // #vertices of the graph of the next phase
+    int phase, shortPhase, totIters;
+    GraphWeight modularity;     // of the last phase
+    GraphElem numColors;
+    GraphElem teps;
+    double total, ctime;        // average (over the processes) times
+};
+
+// collective write of a checkpoint: the graph of the next phase
+// (<prefix>.graph, in the binary format of -f), the communities of 
+// the input vertices (<prefix>.membership, as the binary files of -o,
+// numbered as the vertices of that graph) and the state of the phases
+// (<prefix>.state, text); the files are written with a .tmp suffix and 
+// renamed when complete, the state file last
+void writeCheckpoint(int me, int nprocs, const std::string &prefix, DistGraph *&dg, 
+        const std::vector<GraphElem> &membership, GraphElem membershipBase, 
+        const CheckpointState &state);
+
+// load a checkpoint with any number of processes: the graph is 
+// distributed as by loadDistGraphMPIIO, and a process gets the 
+// communities of the input vertices [(nv*me)/nprocs, (nv*(me+1))/nprocs)
+void readCheckpoint(int me, int nprocs, int ranksPerNode, const std::string &prefix, 
+        DistGraph *&dg, std::vector<GraphElem> &membership, GraphElem &membershipBase, 
+        CheckpointState &state);
+
+#endif
@@ -49,13 +49,22 @@
 // ************************************************************************
 #include "coloring.hpp"
 
+// the coloring proceeds in rounds of 2*nHash colors, every round only 
+// visits the vertices that are still uncolored (the worklist), and a
+// remote neighbor is only ignored once it is colored in a previous 
+// round, which its owner then sends to the processes where it is a
+// ghost (only the vertices colored in that round)
 ColorElem distColoringMultiHashMinMax(const int me, const int nprocs, const DistGraph &dg, ColorVector &vertexColor, const ColorElem nHash, const int target_percent, const bool singleIteration)
 {
 
  std::vector<GraphElem> ghostVertices;
  std::vector<GraphElem> ghostSizes(nprocs);
 
- ColoredVertexSet remoteColoredVertices; 
+ // the ghosts of this process (sorted), the renumbered 
+ // tails, and a bit per ghost once it is colored
+ std::vector<GraphElem> ghosts, ghostOwnerSizes(nprocs);
+ std::vector<LocalElem> tails;
+ ColoredGhostBitset remoteColoredVertices; 
 
  unsigned int seed = 1012;
  ColorElem nextColor=0; 
@@ -74,26 +83,32 @@ ColorElem distColoringMultiHashMinMax(const int me, const int nprocs, const Dist
  bool finished = false;
 
  // resize and initialize
- vertexColor.resize(lnv);
+ vertexColor.assign(lnv, -1);
+
+ std::vector<GraphElem> worklist(lnv);
+ std::vector<ColorElem> newColor(lnv);
 
  for (GraphElem i=0; i<lnv; i++)
-	vertexColor[i]=-1;
+	worklist[i]=i;
+
+ distColoringGhosts(me, nprocs, dg, ghosts, ghostOwnerSizes, tails);
+ remoteColoredVertices.assign((ghosts.size() + 63) / 64, 0);
 
  // if it is not a single iteration, set up the list of ghost vertices
  if (!singleIteration) 
-	setUpGhostVertices( me, nprocs, dg, ghostVertices, ghostSizes);
+	setUpGhostVertices( me, nprocs, dg, ghosts, ghostOwnerSizes, ghostVertices, ghostSizes);
 
 
   // cycle until target not meet
   while (!finished) {
 		
-        distColoringIteration(me, dg, vertexColor, remoteColoredVertices, nHash, nextColor, seed);
+        distColoringIteration(me, dg, tails, vertexColor, remoteColoredVertices, worklist, newColor, nHash, nextColor, seed);
 
         if (!singleIteration) {
-	        sendColoredRemoteVertices(me, nprocs, dg, remoteColoredVertices, vertexColor, ghostVertices, ghostSizes); 
+	        sendColoredRemoteVertices(me, nprocs, dg, remoteColoredVertices, ghosts, vertexColor, nextColor, ghostVertices, ghostSizes); 
 	}  
 
-	 totalUnassigned = countUnassigned(vertexColor);
+	 totalUnassigned = countUnassigned(worklist.size());
 	 currentCount = tnv - totalUnassigned;       
 
 	finished = singleIteration == true || currentCount >= targetCount || lastCount==currentCount; 
@@ -104,7 +119,7 @@ ColorElem distColoringMultiHashMinMax(const int me, const int nprocs, const Dist
   }
 
   if (singleIteration)
-      setUpGhostVertices(me,nprocs,dg,ghostVertices, ghostSizes);
+      setUpGhostVertices(me,nprocs,dg,ghosts,ghostOwnerSizes,ghostVertices, ghostSizes);
 
 #if defined(CHECK_COLORING_CONFLICTS)
         GraphElem conflicts;
@@ -117,6 +132,46 @@ return nextColor;
 
 }
 
+// the remote tails of the local edges, sorted and without duplicates
+// (hence grouped by owner, with ghostOwnerSizes of every owner), and 
+// the tails renumbered as [0, nv) for the local vertices and nv + k 
+// for ghosts[k]
+void distColoringGhosts(const int me, const int nprocs, const DistGraph &dg, std::vector<GraphElem> &ghosts, std::vector<GraphElem> &ghostOwnerSizes, std::vector<LocalElem> &tails)
+{
+	const Graph &g = dg.getLocalGraph();
+	const GraphElem base = dg.getBase(me); 
+	const GraphElem bound = dg.getBound(me);
+        const GraphElem nv = g.getNumVertices();
+        const GraphElem ne = g.getNumEdges();
+
+	ghosts.clear();
+	for (GraphElem j = 0; j < ne; j++) {
+		const GraphElem tail = g.getEdgeTail(j);
+
+		if (tail < base || tail >= bound)
+			ghosts.push_back(tail);
+	}
+
+	std::sort(ghosts.begin(), ghosts.end());
+	ghosts.erase(std::unique(ghosts.begin(), ghosts.end()), ghosts.end());
+
+	std::fill(ghostOwnerSizes.begin(), ghostOwnerSizes.end(), 0);
+	for (size_t k = 0; k < ghosts.size(); k++)
+		ghostOwnerSizes[dg.getOwner(ghosts[k])]++;
+
+	tails.resize(ne);
+
+#pragma omp parallel for schedule(static)
+	for (GraphElem j = 0; j < ne; j++) {
+		const GraphElem tail = g.getEdgeTail(j);
+
+		if (tail >= base && tail < bound)
+			tails[j] = tail - base;
+		else
+			tails[j] = nv + (std::lower_bound(ghosts.begin(), ghosts.end(), tail) - ghosts.begin());
+	}
+}
+
 unsigned int hash(unsigned int a, unsigned int seed)
 {
   a ^= seed;
@@ -130,23 +185,30 @@ unsigned int hash(unsigned int a, unsigned int seed)
   return a;
 }
 
-void distColoringIteration(const int me, const DistGraph &dg, ColorVector &vertexColor, ColoredVertexSet &remoteColoredVertices, const ColorElem nHash, const ColorElem nextColor, const unsigned int seed)
+// a round only depends on the colors of the previous rounds (a neighbor
+// colored in this round is not ignored), so the vertices of the worklist
+// are visited in parallel, and their colors are set after the round; the 
+// worklist then keeps the vertices that remain uncolored
+void distColoringIteration(const int me, const DistGraph &dg, const std::vector<LocalElem> &tails, ColorVector &vertexColor, const ColoredGhostBitset &remoteColoredVertices, std::vector<GraphElem> &worklist, std::vector<ColorElem> &newColor, const ColorElem nHash, const ColorElem nextColor, const unsigned int seed)
 {
 	const Graph &g = dg.getLocalGraph();
 	const GraphElem base = dg.getBase(me); 
-	const GraphElem bound = dg.getBound(me);
         
          const GraphElem nv = g.getNumVertices();
-         const GraphElem ne = g.getNumEdges();
+         const GraphElem nw = worklist.size();
   	
-	
-       	for (GraphElem v=0; v < nv; v++) {
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for schedule(runtime)
+#else
+#pragma omp parallel for schedule(guided)
+#endif
+       	for (GraphElem w=0; w < nw; w++) {
+		const GraphElem v = worklist[w];
 	
   	        ColorElem possible_colors = 2 * nHash;
 	        unsigned int vHash[nHash];
 
-		if(vertexColor[v] != -1)
-				continue;
+		newColor[w] = -1;
 	
 		int not_min = 0, not_max=0;
 
@@ -161,39 +223,29 @@ void distColoringIteration(const int me, const DistGraph &dg, ColorVector &verte
 		
 		g.getEdgeRangeForVertex(v, e0, e1);
 
-		for(long k = e0; k < e1; k++ ){
+		for(GraphElem k = e0; k < e1; k++ ){
 		
- 			const Edge &edge = g.getEdge(k);
+ 			const GraphElem tail = tails[k];
 			
-			if(v+base == edge.tail ) //Ignore Self-loops
+			if(v == tail ) //Ignore Self-loops
 				continue;
 						
 			// neighbor is local
-			if (edge.tail>=base && edge.tail < bound) {
-				if ((vertexColor[edge.tail-base]) != -1 && (vertexColor[edge.tail-base] < nextColor)) {
-#ifdef DEBUG_COLORING
-					std::cout << "Did you skip ??? BaseColor this iteration is: " << nextColor << std::endl; 
-#endif					
+			if (tail < nv) {
+				if ((vertexColor[tail]) != -1 && (vertexColor[tail] < nextColor)) 
                                         continue;
-
-				}
 		 	}
 			else { // is remote, check if it has been colored
-			  ColoredVertexSet::const_iterator it = remoteColoredVertices.find(edge.tail);
-			  // if it is in the colored set, we ignore.
-			  if (it!=remoteColoredVertices.end()) {
-#ifdef DEBUG_COLORING
-                              std::cout << "Did you skip ??? BaseColor this iteration is: " << nextColor << std::endl; 
-                              std::cout << " Colored " << edge.tail << " BaseColor this iteration is: " << nextColor << std::endl;
-#endif					
+			  if (isColoredGhost(remoteColoredVertices, tail - nv))
 				continue;
-				}
 			}	
 
+			const GraphElem gtail = g.getEdgeTail(k);
+
 			// for each hash
 			for (ColorElem t=0; t<nHash; t++)
 			{
-				unsigned int jHash = hash(edge.tail, seed+1043*t);
+				unsigned int jHash = hash(gtail, seed+1043*t);
 				
 				if (vHash[t] <= jHash && !(not_max & (0x1 << t))) {
 					not_max |= (0x1 << t);
@@ -223,80 +275,53 @@ void distColoringIteration(const int me, const DistGraph &dg, ColorVector &verte
 			for (ColorElem t=0; t <nHash; t++)
 			{
 				if (!(not_min & (0x1 << t)) && col_id == this_col_id) {
-					vertexColor[v]= 2 * t + nextColor;
-		//			std::cout << "not min - me " << me << " vertex: " << v+base << " VertexColor: " << vertexColor[v] << std::endl;
+					newColor[w]= 2 * t + nextColor;
 					break;
 				}
 			
 				this_col_id += !(not_min & (0x1 << t));
 				
 				if (!(not_max & (0x1 << t)) && col_id == this_col_id) {
-					vertexColor[v]=2*t+1+nextColor;
-		//			std::cout << "not max - me " << me << " vertex: " << v+base << " VertexColor: " << vertexColor[v] << std::endl;
-	
+					newColor[w]=2*t+1+nextColor;
 					break;
 				}	
 
 				this_col_id += !(not_max & (0x1 << t)); 
-//				std::cout << "Proc " << me << " Vertex " << v << "this col id " << this_col_id << std::endl;
 			}//End of for(ihash)
 		}	
 
 	}
 
+	GraphElem left = 0;
+
+	for (GraphElem w=0; w < nw; w++) {
+		if (newColor[w] != -1)
+			vertexColor[worklist[w]] = newColor[w];
+		else
+			worklist[left++] = worklist[w];
+	}
+
+	worklist.resize(left);
 }
 
-// Exchange ghost vertices requests
-void setUpGhostVertices(const int me, const int nprocs, const DistGraph &dg, std::vector<GraphElem> &ghostVertices, std::vector<GraphElem> &ghostSizes)
+// Exchange ghost vertices requests: every owner gets the sorted
+// segment of its vertices in ghosts
+void setUpGhostVertices(const int me, const int nprocs, const DistGraph &dg, const std::vector<GraphElem> &ghosts, const std::vector<GraphElem> &ghostOwnerSizes, std::vector<GraphElem> &ghostVertices, std::vector<GraphElem> &ghostSizes)
 {
-	std::vector<std::unordered_set<GraphElem>> sendRemoteVertices(nprocs);
-	std::vector<GraphElem> sRemoteVertices;
-
-	const Graph &g = dg.getLocalGraph();
 	const GraphElem tnv = dg.getTotalNumVertices();
-	const GraphElem base = dg.getBase(me); 
-	const GraphElem bound = dg.getBound(me);
-        const GraphElem nv = g.getNumVertices();
-        const GraphElem ne = g.getNumEdges();
 
- 	GraphElem rsz = 0, ssz = 0;
-
-
-        for (GraphElem i=0; i<nv; i++)
-	{
-		GraphElem e0, e1;
-
-		g.getEdgeRangeForVertex(i, e0, e1);
-	
-		//For every remote neighbors
-		//Find owner of remote neighbors, record a messages of that id
-		
-		for(GraphElem j = e0; j < e1; j++)
-		{
-			const Edge &edge = g.getEdge(j);
-		
-			const int owner = dg.getOwner(edge.tail);
-			
-				if (owner != me) {
-				sendRemoteVertices[owner].insert(edge.tail);
-
-					
-			}
-		}
-	}
+ 	GraphElem rsz = 0;
 
 	//MPI Sending size of updates
-	std::vector<GraphElem> ssizes(nprocs);
   	std::vector<MPI_Request> sreqs(nprocs), rreqs(nprocs);
 
   	for (int i = 0; i < nprocs; i++) {
-		     	ssizes[i] = sendRemoteVertices[i].size();
-	//		std::cout << " Me " << me << " Sending to " << i << " Size " << ssizes[i] << std::endl; 
 		if (i != me){
       			MPI_Irecv(&ghostSizes[i], 1, MPI_GRAPH_TYPE, i, ColoringSizeTag, MPI_COMM_WORLD, &rreqs[i]);
-	  		MPI_Isend(&ssizes[i], 1, MPI_GRAPH_TYPE, i, ColoringSizeTag, MPI_COMM_WORLD, &sreqs[i]);
+	  		MPI_Isend(&ghostOwnerSizes[i], 1, MPI_GRAPH_TYPE, i, ColoringSizeTag, MPI_COMM_WORLD, &sreqs[i]);
     		}	
 		else 	{
+			ghostSizes[i] = 0;
       			rreqs[i] = MPI_REQUEST_NULL;
       			sreqs[i] = MPI_REQUEST_NULL;
   		}
@@ -305,33 +330,18 @@ void setUpGhostVertices(const int me, const int nprocs, const DistGraph &dg, std
   	MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
   	MPI_Waitall(nprocs, rreqs.data(), MPI_STATUSES_IGNORE);
 
-	int rpos=0;
-        int spos=0;
-
-	for (int i=0; i<nprocs; i++) {
-	//	std::cout << " Me " << me << " receiving from " << i << " Size " << ghostSizes[i] << std::endl;
+	GraphElem rpos=0;
+        GraphElem spos=0;
 
+	for (int i=0; i<nprocs; i++)
 		rsz+=ghostSizes[i];
-		ssz+=ssizes[i];
-	}
-
-
-
 
         ghostVertices.resize(rsz);
-	sRemoteVertices.resize(ssz);
 
   	for (int i = 0; i < nprocs; i++) {
 		if (i != me){
-#ifdef DEBUG_COLORING
-			std::cout << " me: " << me << " from " << i << " size: " << ghostSizes[i] << std::endl;		
-#endif      			
                         MPI_Irecv(ghostVertices.data()+rpos, ghostSizes[i], MPI_GRAPH_TYPE, i, ColoringDataTag, MPI_COMM_WORLD, &rreqs[i]);
-#ifdef DEBUG_COLORING
-			std::cout << " me: " << me << " to " << i << " size: " << ssizes[i] << std::endl;		
-#endif      			
-			std::copy(sendRemoteVertices[i].begin(), sendRemoteVertices[i].end(), sRemoteVertices.data()+spos);
-      			MPI_Isend(sRemoteVertices.data()+spos, ssizes[i], MPI_GRAPH_TYPE, i, ColoringDataTag, MPI_COMM_WORLD, &sreqs[i]);
+      			MPI_Isend(ghosts.data()+spos, ghostOwnerSizes[i], MPI_GRAPH_TYPE, i, ColoringDataTag, MPI_COMM_WORLD, &sreqs[i]);
 		}
 		else {
       			rreqs[i] = MPI_REQUEST_NULL;
@@ -339,18 +349,13 @@ void setUpGhostVertices(const int me, const int nprocs, const DistGraph &dg, std
   			}
 		
 	rpos+=ghostSizes[i];
-	spos+=ssizes[i];
+	spos+=ghostOwnerSizes[i];
 	}        
 
   	MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
   	MPI_Waitall(nprocs, rreqs.data(), MPI_STATUSES_IGNORE);
 
-// exit(1);
-#ifdef DEBUG_COLORING
-        std::cout << " Me " << me << " All vector size " << ghostVertices.size() << std::endl;
-#endif
-
-			for (int j=0; j<ghostVertices.size(); j++) {
+			for (GraphElem j=0; j<rsz; j++) {
 
 				if (ghostVertices[j] >=tnv){
 #ifdef DEBUG_COLORING
@@ -363,43 +368,33 @@ void setUpGhostVertices(const int me, const int nprocs, const DistGraph &dg, std
 			}
 }
 
-void sendColoredRemoteVertices(const int me, const int nprocs, const DistGraph &dg, ColoredVertexSet &remoteColoredVertices, const ColorVector &vertexColor, const std::vector<GraphElem> &ghostVertices, const std::vector<GraphElem> &ghostSizes)
+// send the vertices colored in the round of nextColor to the processes
+// where they are ghosts, and set the bits of the received ones
+void sendColoredRemoteVertices(const int me, const int nprocs, const DistGraph &dg, ColoredGhostBitset &remoteColoredVertices, const std::vector<GraphElem> &ghosts, const ColorVector &vertexColor, const ColorElem nextColor, const std::vector<GraphElem> &ghostVertices, const std::vector<GraphElem> &ghostSizes)
 {
-        const Graph &g = dg.getLocalGraph();
 	const GraphElem base = dg.getBase(me); 
-	const GraphElem bound = dg.getBound(me);
-        const GraphElem nv = g.getNumVertices();
-        const GraphElem ne = g.getNumEdges();
 
 	std::vector<GraphElem> sendColoredRemoteVertices; 
 	std::vector<GraphElem> receiveColoredRemoteVertices;
-	std::vector<std::vector<GraphElem>> coloredVertexArray(nprocs);
+	std::vector<GraphElem> ssizes(nprocs), rsizes(nprocs);
 
-	int pos=0;
+	GraphElem pos=0;
 
 	for (int i=0; i<nprocs; i++) {
-		for (int v=0; v<ghostSizes[i]; v++) {
-			GraphElem vertex=ghostVertices[pos+v]-base;
-			if (vertexColor[vertex]!=-1){
-				coloredVertexArray[i].push_back(vertex+base);
-#ifdef DEBUG_COLORING
-				std::cout << " me " << me << " to " << i << " Vertex " << vertex+base << std::endl;
-#endif				
+		for (GraphElem v=0; v<ghostSizes[i]; v++) {
+			const GraphElem vertex=ghostVertices[pos+v];
+			if (vertexColor[vertex-base] >= nextColor){
+				sendColoredRemoteVertices.push_back(vertex);
+				ssizes[i]++;
                         }
 			}
 		pos+=ghostSizes[i];
 	}
 
-
    	//MPI Sending size of updates
-	std::vector<GraphElem> ssizes(nprocs), rsizes(nprocs);
   	std::vector<MPI_Request> sreqs(nprocs), rreqs(nprocs);
 
   	for (int i = 0; i < nprocs; i++) {
-    		ssizes[i] = coloredVertexArray[i].size();
-#ifdef DEBUG_COLORING
-    		std::cout << " Me " << me << " Size " << ssizes[i] << std::endl;			
-#endif
                 if (i != me) {
       			MPI_Irecv(&rsizes[i], 1, MPI_GRAPH_TYPE, i, ColoringSizeTag, MPI_COMM_WORLD, &rreqs[i]);
 			MPI_Isend(&ssizes[i], 1, MPI_GRAPH_TYPE, i, ColoringSizeTag, MPI_COMM_WORLD, &sreqs[i]);
@@ -415,34 +410,21 @@ void sendColoredRemoteVertices(const int me, const int nprocs, const DistGraph &
   	MPI_Waitall(nprocs, rreqs.data(), MPI_STATUSES_IGNORE);
 
 	GraphElem spos=0, rpos=0;
-	int rsz=0, ssz=0;
+	GraphElem rsz=0;
 
-	for (int i = 0; i < nprocs; i++) {
-		ssz+=ssizes[i];
+	for (int i = 0; i < nprocs; i++)
 		rsz+=rsizes[i];
-	}		
 
 	receiveColoredRemoteVertices.resize(rsz);
-        sendColoredRemoteVertices.resize(ssz);
 	
-#ifdef DEBUG_COLORING
-	std::cout << "Receive size " << rsz << " Send size " << ssz << std::endl;
-#endif
   	for (int i = 0; i < nprocs; i++) {
 		if (i != me){
       			MPI_Irecv(receiveColoredRemoteVertices.data()+rpos, rsizes[i], MPI_GRAPH_TYPE, i, ColoringDataTag, MPI_COMM_WORLD, &rreqs[i]);
-			
-			std::copy(coloredVertexArray[i].begin(), coloredVertexArray[i].end(), sendColoredRemoteVertices.data()+spos);	
-#ifdef DEBUG_COLORING
-			std::cout << " Me " << me << " spos " << spos << " rpos " << rpos << std::endl;
-#endif			
                         MPI_Isend(sendColoredRemoteVertices.data()+spos, ssizes[i], MPI_GRAPH_TYPE, i, ColoringDataTag, MPI_COMM_WORLD, &sreqs[i]);
-	
 		}else
 		{
       			rreqs[i] = MPI_REQUEST_NULL;
   			sreqs[i] = MPI_REQUEST_NULL;
-  
 		}
   		rpos+=rsizes[i];
 		spos+=ssizes[i];
@@ -451,36 +433,18 @@ void sendColoredRemoteVertices(const int me, const int nprocs, const DistGraph &
 
   	MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
   	MPI_Waitall(nprocs, rreqs.data(), MPI_STATUSES_IGNORE);
-#ifdef DEBUG_COLORING
-	std::cout << " receiveColoredRemoteVertices : size " << receiveColoredRemoteVertices.size() << std::endl;
-#endif
 
- 	for (int i=0; i< receiveColoredRemoteVertices.size(); i++) {
-			remoteColoredVertices.insert(receiveColoredRemoteVertices[i]);
+ 	for (GraphElem i=0; i<rsz; i++) {
+		const GraphElem k = std::lower_bound(ghosts.begin(), ghosts.end(), 
+				receiveColoredRemoteVertices[i]) - ghosts.begin();
+		setColoredGhost(remoteColoredVertices, k);
 	}
-
-#ifdef DEBUG_COLORING
-	std::cout << " DEAD send " << std::endl;
-#endif
-				
 }
 
-GraphElem countUnassigned(const ColorVector &vertexColor)
+GraphElem countUnassigned(const GraphElem localUnassigned)
 {
-      
-#ifdef DEBUG_COLORING
-	std::cout << " entered count unassigned. Size: " << vertexColor.size() << std::endl;    
-#endif
-
-	GraphElem localUnassigned=0;
 	GraphElem globalUnassigned=0;
 
-	for (int i=0; i<vertexColor.size(); i++){
-		if (vertexColor[i]==-1)
-			localUnassigned++; 
-		
-	}
-
 	MPI_Allreduce(&localUnassigned, &globalUnassigned, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
 
 #ifdef DEBUG_COLORING
@@ -502,7 +466,8 @@ GraphElem distCheckColoring(const int me, const int nprocs, const DistGraph &dg,
 	std::vector<ColorElem> sendRemoteColors;
 	std::vector<ColorElem> receiveRemoteColors;
 	std::vector<GraphElem> receiveRemoteVertices;
-	std::map<GraphElem, ColorElem> remoteVertexColor; 
+	std::map<GraphElem, ColorElem, std::less<GraphElem>, 
+		TempAllocator<std::pair<const GraphElem, ColorElem> > > remoteVertexColor;
 
 	GraphElem localConflicts=0, globalConflicts=0;	
 
@@ -603,24 +568,24 @@ GraphElem distCheckColoring(const int me, const int nprocs, const DistGraph &dg,
 
 		for(GraphElem k = e0; k < e1; k++ ){
 		
- 			const Edge &edge = g.getEdge(k);
+ 			const GraphElem tail = g.getEdgeTail(k);
 			
-			if(v+base == edge.tail ) //Ignore Self-loops
+			if(v+base == tail ) //Ignore Self-loops
 				continue;
 
-			if (edge.tail>=base && edge.tail < bound) {
+			if (tail>=base && tail < bound) {
 #ifdef DEBUG_COLORING
-				std::cout << " Vertex " << v + base << " Color " << vertexColor[v] <<  " Local neighbor: " << edge.tail <<  " Color " << vertexColor[edge.tail-base] << std::endl; 
+				std::cout << " Vertex " << v + base << " Color " << vertexColor[v] <<  " Local neighbor: " << tail <<  " Color " << vertexColor[tail-base] << std::endl; 
 #endif
-				if (vertexColor[edge.tail-base]==-1)
+				if (vertexColor[tail-base]==-1)
 					continue;
-				if (vertexColor[v]==vertexColor[edge.tail-base])
+				if (vertexColor[v]==vertexColor[tail-base])
 					localConflicts++;
 		}
 			else {
-				ColorElem neighborColor=remoteVertexColor.find(edge.tail)->second;
+				ColorElem neighborColor=remoteVertexColor.find(tail)->second;
 #ifdef DEBUG_COLORING
-				std::cout << " Vertex " << v + base << " Color " << vertexColor[v] <<  " Remote neighbor: " << edge.tail << " Color " << neighborColor << std::endl;
+				std::cout << " Vertex " << v + base << " Color " << vertexColor[v] <<  " Remote neighbor: " << tail << " Color " << neighborColor << std::endl;
 #endif
 				if (neighborColor==-1)
 					continue;
@@ -637,3 +602,133 @@ GraphElem distCheckColoring(const int me, const int nprocs, const DistGraph &dg,
 	
         return globalConflicts;
 }
+
+// colors of the ghosts (in the order of ghosts): every process sends the 
+// colors of its vertices in ghostVertices, the sizes are known both ways
+void exchangeGhostColors(const int me, const int nprocs, const DistGraph &dg, const ColorVector &vertexColor, const std::vector<GraphElem> &ghostOwnerSizes, const std::vector<GraphElem> &ghostVertices, const std::vector<GraphElem> &ghostSizes, ColorVector &ghostColors)
+{
+	const GraphElem base = dg.getBase(me); 
+
+	ColorVector sendColors(ghostVertices.size());
+	GraphElem rsz=0;
+
+	for (size_t v=0; v<ghostVertices.size(); v++)
+		sendColors[v] = vertexColor[ghostVertices[v]-base];
+
+	for (int i=0; i<nprocs; i++)
+		rsz+=ghostOwnerSizes[i];
+
+	ghostColors.resize(rsz);
+
+  	std::vector<MPI_Request> sreqs(nprocs), rreqs(nprocs);
+	GraphElem rpos=0, spos=0;
+
+  	for (int i = 0; i < nprocs; i++) {
+		if (i != me){
+      			MPI_Irecv(ghostColors.data()+rpos, ghostOwnerSizes[i], MPI_GRAPH_TYPE, i, ColoringDataTag, MPI_COMM_WORLD, &rreqs[i]);
+			MPI_Isend(sendColors.data()+spos, ghostSizes[i], MPI_GRAPH_TYPE, i, ColoringDataTag, MPI_COMM_WORLD, &sreqs[i]);
+		}
+		else {
+      			rreqs[i] = MPI_REQUEST_NULL;
+     			sreqs[i] = MPI_REQUEST_NULL;
+  		}
+		rpos+=ghostOwnerSizes[i];
+		spos+=ghostSizes[i];
+	}
+
+  	MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
+  	MPI_Waitall(nprocs, rreqs.data(), MPI_STATUSES_IGNORE);
+}
+
+// the coloring projected on the coarse graph (a coarse vertex has the 
+// color of the vertex that names its community) has conflicts where two
+// communities are adjacent: of two adjacent vertices with the same color,
+// the one with the larger id, and every uncolored vertex, picks the 
+// smallest color in [0, numColors) that no neighbor has (or stays 
+// uncolored); two such vertices of different processes may still pick 
+// the same color, so the coloring is only near-valid across processes;
+// returns the global number of recolored vertices
+GraphElem distRepairColoring(const int me, const int nprocs, const DistGraph &dg, ColorVector &vertexColor, const ColorElem numColors)
+{
+	const Graph &g = dg.getLocalGraph();
+	const GraphElem base = dg.getBase(me); 
+        const GraphElem nv = g.getNumVertices();
+
+	std::vector<GraphElem> ghosts, ghostOwnerSizes(nprocs);
+	std::vector<GraphElem> ghostVertices, ghostSizes(nprocs);
+	std::vector<LocalElem> tails;
+	ColorVector ghostColors;
+
+	distColoringGhosts(me, nprocs, dg, ghosts, ghostOwnerSizes, tails);
+	setUpGhostVertices(me, nprocs, dg, ghosts, ghostOwnerSizes, ghostVertices, ghostSizes);
+	exchangeGhostColors(me, nprocs, dg, vertexColor, ghostOwnerSizes, ghostVertices, ghostSizes, ghostColors);
+
+	std::vector<char> conflict(nv, 0);
+
+#pragma omp parallel for schedule(guided)
+	for (GraphElem v=0; v<nv; v++) {
+		if (vertexColor[v] == -1) {
+			conflict[v] = 1;
+			continue;
+		}
+
+		GraphElem e0, e1;
+		g.getEdgeRangeForVertex(v, e0, e1);
+
+		for (GraphElem k = e0; k < e1; k++) {
+			const GraphElem tail = tails[k];
+
+			if (v == tail) //Ignore Self-loops
+				continue;
+
+			const ColorElem color = (tail < nv) ? vertexColor[tail] : ghostColors[tail-nv];
+
+			if (color == vertexColor[v] && g.getEdgeTail(k) < v+base) {
+				conflict[v] = 1;
+				break;
+			}
+		}
+	}
+
+	// the neighbors of a recolored vertex are marked with its id
+	std::vector<GraphElem> mark(numColors, -1);
+	GraphElem localRecolored=0, globalRecolored=0;
+
+	for (GraphElem v=0; v<nv; v++) {
+		if (!conflict[v])
+			continue;
+
+		GraphElem e0, e1;
+		g.getEdgeRangeForVertex(v, e0, e1);
+
+		for (GraphElem k = e0; k < e1; k++) {
+			const GraphElem tail = tails[k];
+
+			if (v == tail)
+				continue;
+
+			const ColorElem color = (tail < nv) ? vertexColor[tail] : ghostColors[tail-nv];
+
+			if (color >= 0 && color < numColors)
+				mark[color] = v;
+		}
+
+		ColorElem c=0;
+		while (c < numColors && mark[c] == v)
+			c++;
+
+		vertexColor[v] = (c < numColors) ? c : -1;
+		localRecolored++;
+	}
+
+	MPI_Allreduce(&localRecolored, &globalRecolored, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+
+#if defined(CHECK_COLORING_CONFLICTS)
+        GraphElem conflicts;
+        conflicts = distCheckColoring(me, nprocs, dg, vertexColor, ghostVertices, ghostSizes);
+        if (conflicts>0 && me == 0) 
+            std::cout << " Projected coloring has " << conflicts << " conflicts" << std::endl;	
+#endif
+
+	return globalRecolored;
+}
@@ -65,6 +65,7 @@
 
 #include "graph.hpp"
 #include "distgraph.hpp"
+#include "arena.hpp"
 
 #ifndef MAX_COVG
 #define MAX_COVG    (70)
@@ -80,21 +81,36 @@ typedef int64_t ColorElem;
 const int ColoringSizeTag = 6;
 const int ColoringDataTag = 7;
 
-typedef std::unordered_set<GraphElem> ColoredVertexSet; 
 typedef std::vector<ColorElem> ColorVector;
 
+// a bit per ghost vertex (indexed as the sorted ghosts of a process),
+// set once the ghost is colored
+typedef std::vector<uint64_t> ColoredGhostBitset;
+
+inline bool isColoredGhost(const ColoredGhostBitset &bits, const GraphElem k)
+{ return (bits[k >> 6] >> (k & 63)) & 1; }
+
+inline void setColoredGhost(ColoredGhostBitset &bits, const GraphElem k)
+{ bits[k >> 6] |= (uint64_t(1) << (k & 63)); }
+
 ColorElem distColoringMultiHashMinMax(const int me, const int nprocs, const DistGraph &dg, ColorVector &vertexColor, const ColorElem nHash, const int target_percent, const bool singleIteration);
 
+void distColoringGhosts(const int me, const int nprocs, const DistGraph &dg, std::vector<GraphElem> &ghosts, std::vector<GraphElem> &ghostOwnerSizes, std::vector<LocalElem> &tails);
+
 static unsigned int hash(unsigned int a, unsigned int seed);
 
-void distColoringIteration(const int me, const DistGraph &dg, ColorVector &vertexColor, ColoredVertexSet &remoteColoredVertices, const ColorElem nHash, const ColorElem nextColor, const unsigned int seed);
+void distColoringIteration(const int me, const DistGraph &dg, const std::vector<LocalElem> &tails, ColorVector &vertexColor, const ColoredGhostBitset &remoteColoredVertices, std::vector<GraphElem> &worklist, std::vector<ColorElem> &newColor, const ColorElem nHash, const ColorElem nextColor, const unsigned int seed);
 
-void setUpGhostVertices(const int me, const int nprocs, const DistGraph &dg, std::vector<GraphElem> &ghostVertices, std::vector<GraphElem> &ghostSizes);
+void setUpGhostVertices(const int me, const int nprocs, const DistGraph &dg, const std::vector<GraphElem> &ghosts, const std::vector<GraphElem> &ghostOwnerSizes, std::vector<GraphElem> &ghostVertices, std::vector<GraphElem> &ghostSizes);
 
-void sendColoredRemoteVertices(const int me, const int nprocs, const DistGraph &dg, ColoredVertexSet &remoteColoredVertices, const ColorVector &vertexColor, const std::vector<GraphElem> &ghostVertices, const std::vector<GraphElem> &ghostSizes);
+void sendColoredRemoteVertices(const int me, const int nprocs, const DistGraph &dg, ColoredGhostBitset &remoteColoredVertices, const std::vector<GraphElem> &ghosts, const ColorVector &vertexColor, const ColorElem nextColor, const std::vector<GraphElem> &ghostVertices, const std::vector<GraphElem> &ghostSizes);
 
-GraphElem countUnassigned(const ColorVector &vertexColor);
+GraphElem countUnassigned(const GraphElem localUnassigned);
 
 GraphElem distCheckColoring(const int me, const int nprocs, const DistGraph &dg, const ColorVector &vertexColor, const std::vector<GraphElem> &ghostVertices, const std::vector<GraphElem> &ghostSizes);	
 
+void exchangeGhostColors(const int me, const int nprocs, const DistGraph &dg, const ColorVector &vertexColor, const std::vector<GraphElem> &ghostOwnerSizes, const std::vector<GraphElem> &ghostVertices, const std::vector<GraphElem> &ghostSizes, ColorVector &ghostColors);
+
+GraphElem distRepairColoring(const int me, const int nprocs, const DistGraph &dg, ColorVector &vertexColor, const ColorElem numColors);
+
 #endif 
@@ -48,6 +48,14 @@
 //
 // ************************************************************************
 
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <map>
+#include <unordered_map>
+
 #include "compare.hpp"
 
 extern std::ofstream ofs;
@@ -335,3 +343,346 @@ double compute_gini_coeff(GraphElem *colorSize, int numColors) {
     return giniCoeff; //Return the Gini coefficient
 }//End of compute_gini_coeff(...)
 
+
+// bucket p goes to process p, the received data 
+// is ordered by source process
+static void exchangeBuckets(std::vector<std::vector<GraphElem> >& buckets, 
+        std::vector<GraphElem>& rdata) {
+
+    const int nprocs = buckets.size();
+    std::vector<int> scounts(nprocs), rcounts(nprocs), sdispls(nprocs, 0), rdispls(nprocs, 0);
+    std::vector<GraphElem> sdata;
+
+    for (int p = 0; p < nprocs; p++) {
+        scounts[p] = buckets[p].size();
+        sdata.insert(sdata.end(), buckets[p].begin(), buckets[p].end());
+        std::vector<GraphElem>().swap(buckets[p]);
+    }
+
+    MPI_Alltoall(scounts.data(), 1, MPI_INT, rcounts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+    for (int p = 1; p < nprocs; p++) {
+        sdispls[p] = sdispls[p-1] + scounts[p-1];
+        rdispls[p] = rdispls[p-1] + rcounts[p-1];
+    }
+
+    rdata.resize(rdispls[nprocs-1] + rcounts[nprocs-1]);
+
+    MPI_Alltoallv(sdata.data(), scounts.data(), sdispls.data(), MPI_GRAPH_TYPE, 
+            rdata.data(), rcounts.data(), rdispls.data(), MPI_GRAPH_TYPE, MPI_COMM_WORLD);
+} // exchangeBuckets
+
+void load_ground_truth_dist(int me, int nprocs, std::string const& groundTruthFileName, 
+        bool isGroundTruthZeroBased, std::vector<GraphElem> const& parts, 
+        std::vector<GraphElem>& localC1) {
+
+    MPI_File fh;
+    MPI_Offset fileSize;
+
+    if (MPI_File_open(MPI_COMM_WORLD, groundTruthFileName.c_str(), MPI_MODE_RDONLY, 
+                MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        std::cout << " Error opening ground truth file: " << groundTruthFileName << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    MPI_File_get_size(fh, &fileSize);
+
+    // the lines starting in [lo, hi) are mine: read from the byte 
+    // before lo to the newline ending the last of them
+    const MPI_Offset lo = (fileSize * me) / nprocs, hi = (fileSize * (me + 1)) / nprocs;
+    const MPI_Offset first = (lo > 0) ? (lo - 1) : 0;
+    MPI_Offset last = hi;
+
+    if (hi > lo) {
+        std::vector<char> block(1 << 16);
+        MPI_Offset pos = hi - 1;
+
+        last = fileSize;
+        while (pos < fileSize) {
+            const int count = std::min<MPI_Offset>(block.size(), fileSize - pos);
+            MPI_File_read_at(fh, pos, block.data(), count, MPI_BYTE, MPI_STATUS_IGNORE);
+
+            const char *eol = static_cast<const char*>(std::memchr(block.data(), '\n', count));
+            if (eol) {
+                last = pos + (eol - block.data()) + 1;
+                break;
+            }
+            pos += count;
+        }
+    }
+
+    std::vector<char> buffer(last - first + 1);
+    for (MPI_Offset done = 0; done < (last - first); ) {
+        const int count = std::min<MPI_Offset>(INT_MAX, (last - first) - done);
+        MPI_File_read_at(fh, first + done, buffer.data() + done, count, MPI_BYTE, MPI_STATUS_IGNORE);
+        done += count;
+    }
+    buffer[last - first] = '\0';
+
+    MPI_File_close(&fh);
+
+    const char *p = buffer.data(), *end = buffer.data() + (last - first);
+
+    if (hi == lo)
+        p = end;
+    else if (first != lo) {
+        const char *eol = static_cast<const char*>(std::memchr(p, '\n', hi - first - 1));
+        p = eol ? (eol + 1) : end;
+    }
+
+    // every line is a vertex (the vertex id is not used, as 
+    // in loadGroundTruthFile), with -1 if it cannot be parsed
+    std::vector<GraphElem> comms;
+
+    while (p < end) {
+        const char *eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol)
+            eol = end;
+
+        char *next;
+        GraphElem comm_id = -1;
+        
+        std::strtoll(p, &next, 10);
+        if (next != p && next <= eol) {
+            const char *q = next;
+            const GraphElem c = std::strtoll(q, &next, 10);
+            if (next != q && next <= eol)
+                comm_id = c;
+        }
+
+        if (!isGroundTruthZeroBased)
+            comm_id--;
+
+        comms.push_back(comm_id);
+        p = eol + 1;
+    }
+
+    std::vector<char>().swap(buffer);
+
+    const GraphElem nlines = comms.size();
+    GraphElem firstLine = 0, totalLines = 0;
+
+    MPI_Exscan(&nlines, &firstLine, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&nlines, &totalLines, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+    if (me == 0)
+        firstLine = 0;
+
+    if (totalLines != parts[nprocs]) {
+        if (me == 0)
+            std::cout << "Error: the ground truth file " << groundTruthFileName << " contains " 
+                << totalLines << " vertices instead of " << parts[nprocs] << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    // send {vertex, community} to the owners
+    std::vector<std::vector<GraphElem> > buckets(nprocs);
+    std::vector<GraphElem> rdata;
+    int owner = 0;
+
+    for (GraphElem i = 0; i < nlines; i++) {
+        const GraphElem v = firstLine + i;
+        while (v >= parts[owner+1])
+            owner++;
+        buckets[owner].push_back(v);
+        buckets[owner].push_back(comms[i]);
+    }
+
+    exchangeBuckets(buckets, rdata);
+
+    localC1.resize(parts[me+1] - parts[me]);
+    for (size_t k = 0; k < rdata.size(); k += 2)
+        localC1[rdata[k] - parts[me]] = rdata[k+1];
+
+    if (me == 0)
+        std::cout << "Loaded ground-truth file: " << groundTruthFileName 
+            << ", containing community information for " 
+            << totalLines << " vertices." << std::endl;
+} // load_ground_truth_dist
+
+// Gini coefficient of numColors sizes, given as the (merged) 
+// histogram of the nonzero ones, as compute_gini_coeff
+static double gini_coeff_of_histogram(std::map<GraphElem, GraphElem> const& sizeCounts, 
+        GraphElem numColors) {
+
+    double numFunc=0.0, denFunc=0.0;
+    GraphElem pos = numColors;
+
+    for (auto const& sc : sizeCounts)
+        pos -= sc.second;
+
+    // the positions pos to pos + count - 1 (after the zeros) 
+    // contribute (i+1)*size each
+    for (auto const& sc : sizeCounts) {
+        const double size = sc.first, count = sc.second;
+        numFunc += size * (count * pos + (count * (count + 1)) / 2);
+        denFunc += size * count;
+        pos += sc.second;
+    }
+
+    return ((2*numFunc)/(numColors*denFunc)) - ((double)(numColors+1)/(double)numColors);
+} // gini_coeff_of_histogram
+
+// community sizes reduced at their owners, returns the number 
+// of pairs of vertices in the same community, the histogram of 
+// the sizes is merged on the root
+static uint64_t reduce_community_sizes(int me, int nprocs, std::vector<GraphElem> const& C, 
+        std::map<GraphElem, GraphElem>& sizeCounts) {
+
+    std::unordered_map<GraphElem, GraphElem> localSizes, sizes;
+    std::vector<std::vector<GraphElem> > buckets(nprocs);
+    std::vector<GraphElem> rdata;
+
+    for (GraphElem c : C)
+        localSizes[c]++;
+
+    for (auto const& cs : localSizes) {
+        const int owner = cs.first % nprocs;
+        buckets[owner].push_back(cs.first);
+        buckets[owner].push_back(cs.second);
+    }
+
+    exchangeBuckets(buckets, rdata);
+
+    for (size_t k = 0; k < rdata.size(); k += 2)
+        sizes[rdata[k]] += rdata[k+1];
+
+    uint64_t samePairs = 0;
+    std::map<GraphElem, GraphElem> localCounts;
+
+    for (auto const& cs : sizes) {
+        samePairs += ((uint64_t)cs.second * (cs.second - 1)) / 2;
+        localCounts[cs.second]++;
+    }
+
+    // gather the {size, #communities} pairs on the root
+    std::vector<GraphElem> sdata, gathered;
+    for (auto const& sc : localCounts) {
+        sdata.push_back(sc.first);
+        sdata.push_back(sc.second);
+    }
+
+    const int scount = sdata.size();
+    std::vector<int> rcounts(nprocs), rdispls(nprocs, 0);
+
+    MPI_Gather(&scount, 1, MPI_INT, rcounts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (me == 0) {
+        for (int p = 1; p < nprocs; p++)
+            rdispls[p] = rdispls[p-1] + rcounts[p-1];
+        gathered.resize(rdispls[nprocs-1] + rcounts[nprocs-1]);
+    }
+
+    MPI_Gatherv(sdata.data(), scount, MPI_GRAPH_TYPE, gathered.data(), rcounts.data(), 
+            rdispls.data(), MPI_GRAPH_TYPE, 0, MPI_COMM_WORLD);
+
+    sizeCounts.clear();
+    for (size_t k = 0; k < gathered.size(); k += 2)
+        sizeCounts[gathered[k]] += gathered[k+1];
+
+    return samePairs;
+} // reduce_community_sizes
+
+//Assume that C1 is the truth data
+void compare_communities_dist(int me, int nprocs, std::vector<GraphElem> const& C1, 
+        std::vector<GraphElem> const& C2) {
+
+    assert(C1.size() == C2.size());
+
+    const GraphElem n = C1.size();
+    GraphElem counts[3] = {n, -1, -1}, gcounts[3]; // N, nC1, nC2
+
+#pragma omp parallel for reduction(max: counts[1:2])
+    for(GraphElem i = 0; i < n; i++) {
+        counts[1] = std::max(counts[1], C1[i]);
+        counts[2] = std::max(counts[2], C2[i]);
+    }
+
+    MPI_Allreduce(counts, gcounts, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(counts + 1, gcounts + 1, 2, MPI_GRAPH_TYPE, MPI_MAX, MPI_COMM_WORLD);
+
+    const GraphElem N = gcounts[0], nC1 = gcounts[1] + 1, nC2 = gcounts[2] + 1;
+
+    if (me == 0) {
+#if defined(DONT_CREATE_DIAG_FILES)
+        std::cout << "Number of unique communities in C1 = " << nC1 << 
+            ", and C2 = " << nC2 << std::endl;
+#else
+        ofs << "Number of unique communities in C1 = " << nC1 << 
+            ", and C2 = " << nC2 << std::endl;
+#endif
+    }
+
+    //////////STEP 1: Contingency table, the intersections of the 
+    //communities of C1 and C2 are reduced at their owners
+    std::unordered_map<uint64_t, GraphElem> localPairs, pairs;
+    std::vector<std::vector<GraphElem> > buckets(nprocs);
+    std::vector<GraphElem> rdata;
+
+    for(GraphElem i = 0; i < n; i++)
+        localPairs[(uint64_t)C1[i] * nC2 + C2[i]]++;
+
+    for (auto const& pc : localPairs) {
+        const int owner = pc.first % nprocs;
+        buckets[owner].push_back(pc.first / nC2);
+        buckets[owner].push_back(pc.first % nC2);
+        buckets[owner].push_back(pc.second);
+    }
+
+    localPairs.clear();
+    exchangeBuckets(buckets, rdata);
+
+    for (size_t k = 0; k < rdata.size(); k += 3)
+        pairs[(uint64_t)rdata[k] * nC2 + rdata[k+1]] += rdata[k+2];
+
+    //////////STEP 2: Compute statistics, pairs of vertices in the same 
+    //community of C1 and C2 (Same-Same), of C1 and of C2
+    uint64_t same[3] = {0, 0, 0}, gsame[3];
+
+    for (auto const& pc : pairs)
+        same[0] += ((uint64_t)pc.second * (pc.second - 1)) / 2;
+    pairs.clear();
+
+    std::map<GraphElem, GraphElem> sizeCounts1, sizeCounts2;
+    same[1] = reduce_community_sizes(me, nprocs, C1, sizeCounts1);
+    same[2] = reduce_community_sizes(me, nprocs, C2, sizeCounts2);
+
+    MPI_Reduce(same, gsame, 3, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (me != 0)
+        return;
+
+    const uint64_t SameSame = gsame[0];
+    const uint64_t SameDiff = gsame[1] - SameSame;
+    const uint64_t DiffSame = gsame[2] - SameSame;
+
+    double precision = (double)SameSame / (double)(SameSame + DiffSame);
+    double recall    = (double)SameSame / (double)(SameSame + SameDiff);
+    
+    //F-score (F1 score) is the harmonic mean of precision and recall --
+    //multiplying the constant of 2 scales the score to 1 when both recall and precision are 1
+    double fScore = 2.0*((precision * recall) / (precision + recall));
+    
+    //Compute Gini coefficient for each cluster:
+    double Gini1 = gini_coeff_of_histogram(sizeCounts1, nC1);
+    double Gini2 = gini_coeff_of_histogram(sizeCounts2, nC2);
+
+    std::cout << "*******************************************" << std::endl;
+    std::cout << "Communities comparison statistics:" << std::endl;
+    std::cout << "*******************************************" << std::endl;
+    std::cout << "|C1| (truth)       : " << N << std::endl;
+    std::cout << "#communities in C1 : " << nC1 << std::endl;
+    std::cout << "|C2| (output)      : " << N << std::endl;
+    std::cout << "#communities in C2 : " << nC2 << std::endl;
+    std::cout << "-------------------------------------------" << std::endl;
+    std::cout << "Same-Same (True positive)  : " << SameSame << std::endl;
+    std::cout << "Same-Diff (False negative) : " << SameDiff << std::endl;
+    std::cout << "Diff-Same (False positive) : " << DiffSame << std::endl;
+    std::cout << "-------------------------------------------" << std::endl;
+    std::cout << "Precision :  " << precision << " (" << (precision*100) << ")" << std::endl;
+    std::cout << "Recall    :  " << recall << " (" << (recall*100) << ")" << std::endl;
+    std::cout << "F-score   :  " << fScore << std::endl;
+    std::cout << "-------------------------------------------" << std::endl;
+    std::cout << "Gini coefficient, C1  :  " << Gini1 << std::endl;
+    std::cout << "Gini coefficient, C2  :  " << Gini2 << std::endl;
+    std::cout << "*******************************************" << std::endl;
+} // compare_communities_dist
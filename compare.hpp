@@ -56,4 +56,18 @@
 void compare_communities(std::vector<GraphElem> const& C1, std::vector<GraphElem> const& C2);
 double compute_gini_coeff(GraphElem *colorSize, int numColors);
 
+// distributed versions: the vertices [parts[p], parts[p+1]) belong to 
+// process p, which reads a byte range of the ground truth file and 
+// sends the community of every line (line i is vertex i) to its owner
+void load_ground_truth_dist(int me, int nprocs, std::string const& groundTruthFileName, 
+        bool isGroundTruthZeroBased, std::vector<GraphElem> const& parts, 
+        std::vector<GraphElem>& localC1);
+
+// C1/C2 are the communities of the vertices of the process; the 
+// contingency table (intersection sizes of the communities of C1 and 
+// C2) and the community sizes are reduced at owner processes (by hash), 
+// and the size histograms are merged on the root for the Gini coefficients
+void compare_communities_dist(int me, int nprocs, std::vector<GraphElem> const& C1, 
+        std::vector<GraphElem> const& C2);
+
 #endif
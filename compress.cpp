@@ -0,0 +1,269 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "compress.hpp"
+
+static inline GraphWeight getWeight(const uint8_t *p, const uint32_t weightBytes)
+{
+    if (weightBytes == sizeof(float)) {
+        float w;
+        std::memcpy(&w, p, sizeof(float));
+        return static_cast<GraphWeight>(w);
+    }
+    
+    double w;
+    std::memcpy(&w, p, sizeof(double));
+    return static_cast<GraphWeight>(w);
+} // getWeight
+
+void compressGraphChunks(const Graph &g, const GraphElem base, const bool weighted, 
+        const GraphElem chunkVertices, std::vector<CompressedGraphChunk> &chunks, 
+        std::vector<ByteBuffer> &blocks)
+{
+    const GraphElem nv = g.getNumVertices();
+    const GraphElem nchunks = (nv + chunkVertices - 1) / chunkVertices;
+
+    chunks.resize(nchunks);
+    blocks.resize(nchunks);
+
+#pragma omp parallel for schedule(dynamic)
+    for (GraphElem c = 0; c < nchunks; c++) {
+        const GraphElem v0 = c*chunkVertices, v1 = std::min(nv, v0 + chunkVertices);
+        ByteBuffer &block = blocks[c];
+        GraphElem e0, e1;
+
+        for (GraphElem v = v0; v < v1; v++) {
+            g.getEdgeRangeForVertex(v, e0, e1);
+            putVarint(block, e1 - e0);
+        }
+
+        const size_t degreeBytes = block.size();
+
+        g.getEdgeRangeForVertex(v0, e0, e1);
+        const GraphElem first = e0;
+        g.getEdgeRangeForVertex(v1 - 1, e0, e1);
+        const GraphElem last = e1;
+
+        if (weighted) {
+            block.resize(degreeBytes + (last - first)*sizeof(GraphWeight));
+            uint8_t *p = block.data() + degreeBytes;
+
+            for (GraphElem e = first; e < last; e++, p += sizeof(GraphWeight)) {
+                const GraphWeight w = g.getEdgeWeight(e);
+                std::memcpy(p, &w, sizeof(GraphWeight));
+            }
+        }
+        
+        for (GraphElem v = v0; v < v1; v++) {
+            GraphElem prev = base + v;
+
+            g.getEdgeRangeForVertex(v, e0, e1);
+            for (GraphElem e = e0; e < e1; e++) {
+                const GraphElem tail = g.getEdgeTail(e);
+                putVarint(block, zigzagEncode(static_cast<int64_t>(tail) - prev));
+                prev = tail;
+            }
+        }
+
+        chunks[c].vertex = base + v0;
+        chunks[c].edge = first;
+        chunks[c].offset = 0;
+        chunks[c].degreeBytes = degreeBytes;
+        chunks[c].checksum = checksumBytes(block.data(), block.size());
+    }
+} // compressGraphChunks
+
+void decompressChunkOffsets(const CompressedGraphChunk &chunk, const GraphElem numChunkVertices,
+        const uint8_t *block, const GraphElem lo, const GraphElem hi, GraphElem *offsets)
+{
+    const uint8_t *p = block;
+    GraphElem e = chunk.edge;
+
+    for (GraphElem i = 0; i < numChunkVertices; i++) {
+        const GraphElem v = chunk.vertex + i;
+
+        if (v > hi)
+            break;
+        if (v >= lo)
+            offsets[v - lo] = e;
+        
+        e += getVarint(p);
+    }
+} // decompressChunkOffsets
+
+void decompressChunkEdges(const CompressedGraphHeader &header, const CompressedGraphChunk &chunk, 
+        const GraphElem numChunkVertices, const uint8_t *block, const GraphElem lo, 
+        const GraphElem hi, const GraphElem edgeBase, Graph &g)
+{
+    const bool weighted = (header.flags & COMPRESSED_GRAPH_WEIGHTED);
+    std::vector<GraphElem> degrees(numChunkVertices);
+    const uint8_t *p = block;
+    GraphElem chunkEdges = 0;
+
+    for (GraphElem i = 0; i < numChunkVertices; i++) {
+        degrees[i] = getVarint(p);
+        chunkEdges += degrees[i];
+    }
+
+    const uint8_t *weights = block + chunk.degreeBytes;
+    p = weights + (weighted ? chunkEdges*header.weightBytes : 0);
+
+    GraphElem e = chunk.edge;
+    
+    for (GraphElem i = 0; i < numChunkVertices; i++) {
+        const GraphElem v = chunk.vertex + i;
+
+        if (v >= hi)
+            break;
+
+        GraphElem prev = v;
+        
+        for (GraphElem k = 0; k < degrees[i]; k++, e++) {
+            const GraphElem tail = prev + zigzagDecode(getVarint(p));
+
+            if (v >= lo)
+                g.setEdge(e - edgeBase, tail, weighted ? 
+                        getWeight(weights + (e - chunk.edge)*header.weightBytes, 
+                            header.weightBytes) : 1.0);
+            prev = tail;
+        }
+    }
+} // decompressChunkEdges
+
+const char *compressedHeaderError(const CompressedGraphHeader &header)
+{
+    if (header.magic != COMPRESSED_GRAPH_MAGIC)
+        return "not a compressed graph file";
+    if (header.version > COMPRESSED_GRAPH_VERSION)
+        return "unsupported version of the compressed format";
+    if ((header.flags & COMPRESSED_GRAPH_WEIGHTED) 
+            && (header.weightBytes != sizeof(float)) && (header.weightBytes != sizeof(double)))
+        return "unsupported width of the edge weights";
+    if ((header.nv > static_cast<uint64_t>(std::numeric_limits<GraphElem>::max()))
+            || (header.ne > static_cast<uint64_t>(std::numeric_limits<GraphElem>::max())))
+        return "the graph exceeds the range of the vertex ids (build without -DUSE_32_BIT_GRAPH)";
+    
+    return NULL;
+} // compressedHeaderError
+
+bool hasUnitEdgeWeights(const Graph &g)
+{
+    const GraphElem ne = g.getNumEdges();
+    bool unit = true;
+
+    if (!g.isWeighted())
+        return true;
+
+#pragma omp parallel for reduction(&&: unit) schedule(static)
+    for (GraphElem e = 0; e < ne; e++)
+        unit = unit && (g.getEdgeWeight(e) == 1.0);
+
+    return unit;
+} // hasUnitEdgeWeights
+
+void writeCompressedGraph(const Graph &g, const std::string &fileName)
+{
+    std::vector<CompressedGraphChunk> chunks;
+    std::vector<ByteBuffer> blocks;
+    CompressedGraphHeader header;
+    const bool weighted = !hasUnitEdgeWeights(g);
+
+    compressGraphChunks(g, 0, weighted, COMPRESSED_CHUNK_VERTICES, chunks, blocks);
+
+    header.magic = COMPRESSED_GRAPH_MAGIC;
+    header.version = COMPRESSED_GRAPH_VERSION;
+    header.elemBytes = sizeof(GraphElem);
+    header.weightBytes = sizeof(GraphWeight);
+    header.flags = (weighted ? COMPRESSED_GRAPH_WEIGHTED : 0);
+    header.nv = g.getNumVertices();
+    header.ne = g.getNumEdges();
+    header.nchunks = chunks.size();
+
+    // blocks follow the index
+    uint64_t offset = sizeof(CompressedGraphHeader) 
+        + (header.nchunks + 1)*sizeof(CompressedGraphChunk);
+
+    for (size_t c = 0; c < chunks.size(); c++) {
+        chunks[c].offset = offset;
+        offset += blocks[c].size();
+    }
+    
+    CompressedGraphChunk sentinel = {header.nv, header.ne, offset, 0, 0};
+    chunks.push_back(sentinel);
+    
+    header.checksum = checksumBytes(reinterpret_cast<const uint8_t*>(chunks.data()), 
+            chunks.size()*sizeof(CompressedGraphChunk));
+
+    std::ofstream ofs(fileName.c_str(), std::ofstream::out | std::ofstream::binary |
+		    std::ofstream::trunc);
+    if (!ofs) {
+        std::cerr << "Error opening output file: " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(CompressedGraphHeader));
+    ofs.write(reinterpret_cast<const char *>(chunks.data()), 
+            chunks.size()*sizeof(CompressedGraphChunk));
+
+    for (size_t c = 0; c < blocks.size(); c++)
+        ofs.write(reinterpret_cast<const char *>(blocks[c].data()), blocks[c].size());
+
+    ofs.close();
+    
+    std::cout << "Compressed " << header.ne << " edges into " 
+        << (offset - chunks[0].offset) << " bytes (" << blocks.size() 
+        << " chunks)." << std::endl;
+} // writeCompressedGraph
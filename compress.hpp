@@ -0,0 +1,183 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#ifndef __COMPRESS_H
+#define __COMPRESS_H
+
+#include "graph.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compressed (version 2) binary file format:
+//
+// header | chunk index (nchunks + 1 entries) | chunk blocks
+//
+// The header does not depend on the build (fixed-width fields), 
+// it records the width of the writer (elemBytes), whether the 
+// graph is weighted (and the width of the weights), and a checksum 
+// of the chunk index. Every chunk covers a range of vertices, and 
+// its index entry stores its first vertex, the global offset of its 
+// first edge, the file offset of its block and a checksum of the 
+// block; the last (sentinel) entry stores {nv, ne, end of file}. 
+// A block stores, for the vertices of the chunk:
+// 1. the degrees (varints), which take degreeBytes bytes,
+// 2. the weights as is (weightBytes each), if the graph is weighted,
+// 3. the tails (zigzag varints of the difference to the previous 
+//    tail of the vertex, or to the vertex itself for the first tail).
+// Hence a process only reads and decompresses the chunks that 
+// overlap its vertex range, and the degrees (which give the 
+// edge offsets) can be read without the adjacency.
+// The raw format (nv, ne, offsets, edges) has no header, and is 
+// detected by the absence of the magic number.
+#define COMPRESSED_GRAPH_MAGIC      (0x3247524745544956ULL) // "VITEGRG2"
+#define COMPRESSED_GRAPH_VERSION    (2)
+#define COMPRESSED_GRAPH_WEIGHTED   (1U)
+
+#ifndef COMPRESSED_CHUNK_VERTICES
+#define COMPRESSED_CHUNK_VERTICES   (1 << 16)
+#endif
+
+struct CompressedGraphHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t elemBytes;   // sizeof(GraphElem) of the writer
+    uint32_t weightBytes; // sizeof(GraphWeight) of the writer
+    uint32_t flags;       // COMPRESSED_GRAPH_WEIGHTED
+    uint64_t nv, ne;
+    uint64_t nchunks;
+    uint64_t checksum;    // of the chunk index
+};
+
+struct CompressedGraphChunk
+{
+    uint64_t vertex;      // first vertex
+    uint64_t edge;        // global offset of the first edge
+    uint64_t offset;      // file offset of the block
+    uint64_t degreeBytes; // size of the degrees section
+    uint64_t checksum;    // of the block
+};
+
+typedef std::vector<uint8_t> ByteBuffer;
+
+// FNV-1a
+inline uint64_t checksumBytes(const uint8_t *data, const size_t length, 
+        uint64_t hash = 0xcbf29ce484222325ULL)
+{
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+} // checksumBytes
+
+inline void putVarint(ByteBuffer &buf, uint64_t value)
+{
+    while (value >= 0x80) {
+        buf.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    buf.push_back(static_cast<uint8_t>(value));
+} // putVarint
+
+inline uint64_t getVarint(const uint8_t *&p)
+{
+    uint64_t value = 0;
+    int shift = 0;
+
+    while (*p & 0x80) {
+        value |= static_cast<uint64_t>(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint64_t>(*p++) << shift;
+
+    return value;
+} // getVarint
+
+inline uint64_t zigzagEncode(const int64_t value)
+{ return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+
+inline int64_t zigzagDecode(const uint64_t value)
+{ return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+// encode the vertices [lo, hi) of g in chunks of (at most) 
+// chunkVertices vertices, where base is the global id of the 
+// first vertex of g; sets {vertex, degreeBytes, checksum} of 
+// the chunks, edge and offset are relative to the first chunk
+void compressGraphChunks(const Graph &g, const GraphElem base, const bool weighted, 
+        const GraphElem chunkVertices, std::vector<CompressedGraphChunk> &chunks, 
+        std::vector<ByteBuffer> &blocks);
+
+// global offsets of the edges of the vertices of a chunk that are 
+// in [lo, hi]: offsets[v - lo] for v in [max(lo, first), min(hi, last)]
+void decompressChunkOffsets(const CompressedGraphChunk &chunk, const GraphElem numChunkVertices,
+        const uint8_t *block, const GraphElem lo, const GraphElem hi, GraphElem *offsets);
+
+// decompress the edges of the vertices of a chunk that are in 
+// [lo, hi) into g, where g stores the vertices [lo, hi) and its 
+// first edge is the global edge edgeBase
+void decompressChunkEdges(const CompressedGraphHeader &header, const CompressedGraphChunk &chunk, 
+        const GraphElem numChunkVertices, const uint8_t *block, const GraphElem lo, 
+        const GraphElem hi, const GraphElem edgeBase, Graph &g);
+
+// returns NULL if the header is of a supported compressed 
+// file that fits the build, or else the reason
+const char *compressedHeaderError(const CompressedGraphHeader &header);
+
+// true if every edge weight of g is 1.0
+bool hasUnitEdgeWeights(const Graph &g);
+
+// write the compressed format from a single process
+void writeCompressedGraph(const Graph &g, const std::string &fileName);
+
+#endif // __COMPRESS_H
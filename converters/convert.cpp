@@ -62,6 +62,8 @@
 
 #include "../graph.hpp"
 #include "../utils.hpp"
+#include "../compress.hpp"
+#include "../reorder.hpp"
 
 #include "dimacs.hpp"
 #include "matrix-market.hpp"
@@ -84,6 +86,7 @@ static bool snapFormat = false;
 static bool shardedFormat = false;
 
 static bool output = false;
+static bool compressOutput = false;
 static bool indexOneBased = false;
 
 // this option will override whatever 
@@ -93,6 +96,9 @@ static bool makeWeightsOne = false;
 static bool randomEdgeWeight = false;
 static bool origEdgeWeight = false;
 
+// relabel the vertices before writing
+static int reorderType = NO_REORDER;
+
 static void parseCommandLine(const int argc, char * const argv[]);
 
 int main(int argc, char *argv[])
@@ -165,13 +171,13 @@ int main(int argc, char *argv[])
   }
   else if (simpleFormat2) {
       if (randomEdgeWeight)
-          loadSimpleFileUn(g, inputFileName, RND_WEIGHT);
+          loadSimpleFileUn(g, inputFileName, indexOneBased, RND_WEIGHT);
       else if (makeWeightsOne)
-          loadSimpleFileUn(g, inputFileName, ONE_WEIGHT);
+          loadSimpleFileUn(g, inputFileName, indexOneBased, ONE_WEIGHT);
       else if (origEdgeWeight) 
-          loadSimpleFileUn(g, inputFileName, ORG_WEIGHT);
+          loadSimpleFileUn(g, inputFileName, indexOneBased, ORG_WEIGHT);
       else
-          loadSimpleFileUn(g, inputFileName, ABS_WEIGHT);
+          loadSimpleFileUn(g, inputFileName, indexOneBased, ABS_WEIGHT);
   }
   else if (snapFormat) {
       // For SNAP format files, weights are not read
@@ -230,8 +236,29 @@ int main(int argc, char *argv[])
 
   double t0, t1;
 
+  if (reorderType != NO_REORDER) {
+      std::vector<GraphElem> perm;
+
+      t0 = mytimer();
+      reorderGraph(*g, static_cast<ReorderType>(reorderType), perm);
+      t1 = mytimer();
+
+      std::cout << "Time to reorder the graph: " << (t1 - t0) << std::endl;
+  }
+
   t0 = mytimer();
 
+  if (compressOutput) {
+      writeCompressedGraph(*g, outputFileName);
+      delete g;
+
+      t1 = mytimer();
+
+      std::cout << "Time writing compressed binary file: " << (t1 - t0) << std::endl;
+
+      return 0;
+  }
+
   std::ofstream ofs(outputFileName.c_str(), std::ofstream::out | std::ofstream::binary |
 		    std::ofstream::trunc);
   if (!ofs) {
@@ -247,7 +274,15 @@ int main(int argc, char *argv[])
   ofs.write(reinterpret_cast<char *>(&nv), sizeof(GraphElem));
   ofs.write(reinterpret_cast<char *>(&ne), sizeof(GraphElem));
 
+#if defined(USE_32_BIT_LOCAL_INDEX)
+  // the file format stores the offsets as GraphElem
+  for (GraphElem v = 0; v <= nv; v++) {
+      const GraphElem idx = g->edgeListIndexes[v];
+      ofs.write(reinterpret_cast<const char *>(&idx), sizeof(GraphElem));
+  }
+#else
   ofs.write(reinterpret_cast<char *>(&g->edgeListIndexes[0]), (nv+1)*sizeof(GraphElem));
+#endif
 
   for (GraphElem v = 0; v < nv; v++) {
       GraphElem e0, e1;
@@ -274,7 +309,7 @@ void parseCommandLine(const int argc, char * const argv[])
 {
   int ret;
 
-  while ((ret = getopt(argc, argv, "f:o:md:uesnrix:zw")) != -1) {
+  while ((ret = getopt(argc, argv, "f:o:md:uesnrix:zwcq:")) != -1) {
     switch (ret) {
     case 'f':
       inputFileName.assign(optarg);
@@ -317,6 +352,12 @@ void parseCommandLine(const int argc, char * const argv[])
     case 'w':
       makeWeightsOne = true;
       break;
+    case 'c':
+      compressOutput = true;
+      break;
+    case 'q':
+      reorderType = atoi(optarg);
+      break;
     default:
       assert(0 && "Should not reach here!!");
       break;
@@ -346,6 +387,11 @@ void parseCommandLine(const int argc, char * const argv[])
     exit(EXIT_FAILURE);
   }
 
+  if (reorderType < NO_REORDER || reorderType > RCM_REORDER) {
+    std::cerr << "Reorder type must be 1 (degree) or 2 (RCM) with -q" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
   if (outputFileName.empty()) {
     std::cerr << "Must specify an output file name with -o" << std::endl;
     exit(EXIT_FAILURE);
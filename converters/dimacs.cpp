@@ -53,12 +53,47 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
-#include <set>
 
 #include "dimacs.hpp"
+#include "parse.hpp"
 
 /* Assuming `a u v w` format for both directed/undirected */
 
+// parse the arc lines after the first begin bytes
+static void parseDimacsArcs(const std::string &fileName, const size_t begin, 
+        Weight_t wtype, EdgeTupleList &edgeList)
+{
+  TextFile file(fileName);
+
+  auto parseArc = [&] (const GraphElem, const char *p, const char *eol, EdgeTupleList &edges)
+  {
+    GraphElem source, dest;
+    GraphWeight weight;
+
+    p = skipBlanks(p, eol);
+    if (p == eol || *p != 'a')
+      return true;
+    p++;
+
+    if (!parseElem(p, eol, source) || !parseElem(p, eol, dest) || !parseWeight(p, eol, weight))
+      return false;
+
+    if (wtype == ONE_WEIGHT)
+        weight = 1.0;
+    
+    if (wtype == ABS_WEIGHT)
+        weight = std::fabs(weight);
+
+    edges.emplace_back(source-1, dest-1, weight);
+    return true;
+  };
+
+  parseLines(file, begin, parseArc, edgeList);
+  
+  if (wtype == RND_WEIGHT)
+      setRandomWeights(edgeList);
+} // parseDimacsArcs
+
 // reading directed files, edges stored twice
 void loadDimacsFile(Graph *&g, const std::string &fileName, Weight_t wtype)
 {
@@ -96,55 +131,24 @@ void loadDimacsFile(Graph *&g, const std::string &fileName, Weight_t wtype)
   std::cout << "Loading (undirected) DIMACS file: " << fileName << ", initial numvertices: " << numVertices <<
     ", numEdges: " << numEdges << std::endl;
 
-  double t0 = mytimer();
-
-  std::vector<GraphElem> edgeCount(numVertices + 1);
-  std::set<GraphElemTuple> edgeSets;
- 
-  // populate edge set
-  for (GraphElem i = 0; i < numEdges; i++) {
-    
-    std::string label;
-    GraphElem source, dest;
-    GraphWeight weight;
-
-    ifs >> label >> source >> dest >> weight;
-
-    if (wtype == ONE_WEIGHT)
-        weight = 1.0;
-
-    if (wtype == RND_WEIGHT)
-        weight = genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
-    
-    if (wtype == ABS_WEIGHT)
-        weight = std::fabs(weight);
-
-    if (!ifs || ifs.fail()) {
-      std::cerr << "Error parsing DIMACS edge" << std::endl;
-      exit(EXIT_FAILURE);
-    }
+  const size_t dataBegin = ifs.tellg();
+  ifs.close();
 
-    edgeSets.insert({source-1, dest-1, weight});
-    edgeSets.insert({dest-1, source-1, weight});
-  }
+  double t0 = mytimer();
 
-  ifs.close();
+  EdgeTupleList edgeList;
+  parseDimacsArcs(fileName, dataBegin, wtype, edgeList);
   
   double t1 = mytimer();
   std::cout << "Time taken to read the file: " << (t1-t0) << " secs." << std::endl;
 
-  for (auto it = edgeSets.begin(); it != edgeSets.end(); ++it)
-      edgeCount[it->i_+1]++;
+  // create graph data structure, edges are stored twice and the 
+  // first of the duplicate edges is kept
+  buildGraphCSR(g, numVertices, edgeList, CSR_SYMMETRIC | CSR_UNIQUE);
 
-  std::vector<GraphElemTuple> edgeList(edgeSets.begin(), edgeSets.end());
-
-  // adjust numEdges and edgeList size
-  numEdges = edgeSets.size();
+  // adjust numEdges
+  numEdges = g->getNumEdges();
   std::cout << "Adjusted numEdges after removing duplicates: " << numEdges << std::endl; 
- 
-  // create graph data structure
-  g = new Graph(numVertices, numEdges);
-  processGraphData(*g, edgeCount, edgeList, numVertices, numEdges);
 } // loadDimacsFile
 
 // reading undirected files
@@ -184,51 +188,22 @@ void loadDimacsFileUn(Graph *&g, const std::string &fileName, Weight_t wtype)
   std::cout << "Loading (undirected) DIMACS file: " << fileName << ", initial numvertices: " << numVertices <<
     ", numEdges: " << numEdges << std::endl;
 
-  double t0 = mytimer();
-
-  std::vector<GraphElem> edgeCount(numVertices + 1);
-  std::set<GraphElemTuple> edgeSets;
- 
-  // populate edge  set
-  for (GraphElem i = 0; i < numEdges; i++) {
-    std::string label;
-    GraphElem source, dest;
-    GraphWeight weight;
-
-    ifs >> label >> source >> dest >> weight;
-
-    if (!ifs || ifs.fail()) {
-      std::cerr << "Error parsing DIMACS edge" << std::endl;
-      exit(EXIT_FAILURE);
-    }
-    
-    if (wtype == ONE_WEIGHT)
-        weight = 1.0;
-
-    if (wtype == RND_WEIGHT)
-        weight = genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
-    
-    if (wtype == ABS_WEIGHT)
-        weight = std::fabs(weight);
+  const size_t dataBegin = ifs.tellg();
+  ifs.close();
 
-    edgeSets.insert({source-1, dest-1, weight});
-  }
+  double t0 = mytimer();
 
-  ifs.close();
+  EdgeTupleList edgeList;
+  parseDimacsArcs(fileName, dataBegin, wtype, edgeList);
   
   double t1 = mytimer();
   std::cout << "Time taken to read the file: " << (t1-t0) << " secs." << std::endl;
 
-  for (auto it = edgeSets.begin(); it != edgeSets.end(); ++it)
-      edgeCount[it->i_+1]++;
-
-  std::vector<GraphElemTuple> edgeList(edgeSets.begin(), edgeSets.end());
+  // create graph data structure, the 
+  // first of the duplicate edges is kept
+  buildGraphCSR(g, numVertices, edgeList, CSR_UNIQUE);
 
-  // adjust numEdges and edgeList size
-  numEdges = edgeSets.size();
+  // adjust numEdges
+  numEdges = g->getNumEdges();
   std::cout << "Adjusted numEdges after removing duplicates: " << numEdges << std::endl; 
- 
-  // create graph data structure
-  g = new Graph(numVertices, numEdges);
-  processGraphData(*g, edgeCount, edgeList, numVertices, numEdges);
 } // loadDimacsFileUn
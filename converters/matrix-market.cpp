@@ -57,12 +57,13 @@
 #include <vector>
 
 #include "matrix-market.hpp"
+#include "parse.hpp"
 
 /// Note: Trying out the new random number generator with static seed generator,
 //  instead of first generating the seed (based on input filename) and then passing
 //  it to the random number generator...
 
-void loadMatrixMarketFile(Graph *&g, const std::string &fileName, Weight_t wtype)
+void readMatrixMarketHeader(const std::string &fileName, MatrixMarketHeader &header)
 {
   std::ifstream ifs;
 
@@ -154,88 +155,39 @@ void loadMatrixMarketFile(Graph *&g, const std::string &fileName, Weight_t wtype
   std::cout << "Loading Matrix Market file: " << fileName << ", numvertices: " << numVertices <<
       ", numEdges: " << numEdges << std::endl;
   
-  std::string crd;
-  GraphElem source, dest;
-  GraphWeight weight = 1.0;
-  std::vector<GraphElem> edgeCount(numVertices+1);
-  std::vector<GraphElemTuple> edgeList;
-
-  // weights will be converted to positive numbers
-  if (isSymmetric) {
-
-      for (GraphElem i = 0; i < numEdges; i++) {
-
-          std::getline(ifs, crd);
-          std::istringstream iss(crd);
-
-          if (isPattern)
-              iss >> source >> dest;
-          else {
-              iss >> source >> dest >> weight;
-              if (wtype == ABS_WEIGHT)
-                  weight = std::fabs(weight);
-          }
-
-          source--; // Matrix market has 1-based indexing
-          dest--;
-
-          assert((source >= 0) && (source < numVertices));
-          assert((dest >= 0) && (dest < numVertices));
-
-          if (wtype == ONE_WEIGHT)
-              weight = 1.0;
-
-          if (wtype == RND_WEIGHT)
-              weight = genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
-
-          if (source != dest) {
-              edgeList.emplace_back(source, dest, weight);
-              edgeList.emplace_back(dest, source, weight);
-              edgeCount[source+1]++;
-              edgeCount[dest+1]++;
-          }
-          else {
-              edgeList.emplace_back(source, dest, weight);
-              edgeCount[source+1]++;
-          }
-      }
-  }
-  else { // if General type (directed)
-      
-      for (GraphElem i = 0; i < numEdges; i++) {
-
-          std::getline(ifs, crd);
-          std::istringstream iss(crd);
-
-          if (isPattern)
-              iss >> source >> dest;
-          else {
-              iss >> source >> dest >> weight;
-              if (wtype == ABS_WEIGHT)
-                  weight = std::fabs(weight);
-          }
-
-          source--; // Matrix market has 1-based indexing
-          dest--;
+  header.isPattern = isPattern;
+  header.isSymmetric = isSymmetric;
+  header.numVertices = numVertices;
+  header.numEdges = numEdges;
+  header.dataBegin = ifs.tellg();
+  
+  ifs.close();
+} // readMatrixMarketHeader
 
-          assert((source >= 0) && (source < numVertices));
-          assert((dest >= 0) && (dest < numVertices));
+void loadMatrixMarketFile(Graph *&g, const std::string &fileName, Weight_t wtype)
+{
+  MatrixMarketHeader header;
+  readMatrixMarketHeader(fileName, header);
 
-          if (wtype == ONE_WEIGHT)
-              weight = 1.0;
+  const bool isPattern = header.isPattern, isSymmetric = header.isSymmetric;
+  const GraphElem numVertices = header.numVertices, numEdges = header.numEdges;
+  const size_t dataBegin = header.dataBegin;
 
-          if (wtype == RND_WEIGHT)
-              weight = genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
+  TextFile file(fileName);
+  std::vector<GraphElemTuple> edgeList;
 
-          edgeList.emplace_back(source, dest, weight);
-          edgeCount[source+1]++;
-      }
-  }
+  // Matrix market has 1-based indexing, weights 
+  // will be converted to positive numbers
+  parseEdgeLines(file, dataBegin, 1, !isPattern && (wtype == ORG_WEIGHT || wtype == ABS_WEIGHT), 
+          (wtype == ABS_WEIGHT), edgeList);
 
-  ifs.close();
+  if (wtype == RND_WEIGHT)
+      setRandomWeights(edgeList);
 
-  numEdges = edgeList.size();
+  if ((GraphElem)edgeList.size() != numEdges)
+      std::cout << "Found " << edgeList.size() << " entries instead." << std::endl;
 
-  g = new Graph(numVertices, numEdges);
-  processGraphData(*g, edgeCount, edgeList, numVertices, numEdges);
+  // a symmetric matrix stores the lower (or upper) triangle
+  buildGraphCSR(g, numVertices, edgeList, 
+          isSymmetric ? (CSR_SYMMETRIC | CSR_SELF_LOOPS_ONCE) : 0);
 } // loadMatrixMarketFile
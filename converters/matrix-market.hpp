@@ -55,6 +55,17 @@
 #include "../utils.hpp"
 #include "../graph.hpp"
 
+// banner and size line of a coordinate matrix, 
+// the entries start at dataBegin
+struct MatrixMarketHeader
+{
+    bool isPattern, isSymmetric;
+    GraphElem numVertices, numEdges;
+    size_t dataBegin;
+};
+
+void readMatrixMarketHeader(const std::string &fileName, MatrixMarketHeader &header);
+
 void loadMatrixMarketFile(Graph *&g, const std::string &fileName, Weight_t wtype = ABS_WEIGHT);
 
 #endif // __MATRIX_MARKET_H
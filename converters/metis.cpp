@@ -47,11 +47,13 @@
 // POSSIBILITY OF SUCH DAMAGE.
 //
 // ************************************************************************
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
 #include "metis.hpp"
+#include "parse.hpp"
 
 // This function will most likely be purged from future versions of Vite
 
@@ -87,83 +89,56 @@ void loadMetisFile(Graph *&g, const std::string &fileName, Weight_t wtype)
   std::cout << "Loading Metis file: " << fileName << ", numvertices: " << numVertices <<
     ", numEdges: " << numEdges << std::endl;
 
-  g = new Graph(numVertices, numEdges);
-
-  GraphElem edgePos = 0;
-
-  g->setEdgeStartForVertex(0, 0);
-
-  switch (value) {
-  case 10:
-    std::cout << "Metis format vertex weights ignored" << std::endl;
-  case 0: // No weights in Metis file
-    for (GraphElem i = 0; i < numVertices; i++) {
-      GraphElem j = 0L, neighbor, oldNeighbor=-1;
-
-      std::getline(ifs, line);
-      std::istringstream iss(line);
-
-      while (!iss.eof()) {
-        iss >> neighbor;
-      	if (!iss || iss.eof())
-//          if((oldNeighbor == neighbor))
-	        break;
-        GraphWeight weight;
-        oldNeighbor = neighbor;
-      	j++;
-      	Edge &edge = g->getEdge(edgePos);
-        edge.tail = neighbor - 1;
-
-        if (wtype == ONE_WEIGHT)
-            weight = 1.0;
-
-        if (wtype == RND_WEIGHT)
-            weight = genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
-
-        edge.weight = weight;
-	edgePos++;
-      }
-      g->setEdgeStartForVertex(i + 1L, edgePos);
-    }
-    break;
-  case 11:
-    std::cout << "Metis format vertex weights ignored" << std::endl;
-  case 1:
-    for (GraphElem i = 0; i < numVertices; i++) {
-      GraphElem j = 0, neighbor;
-      GraphWeight weight;
-
-      std::getline(ifs, line);
-      std::istringstream iss(line);
-
-      while (!iss.eof()) {
-	iss >> neighbor >> weight;
-	if (!iss || iss.eof())
-	  break;
-        
-        if (wtype == ONE_WEIGHT)
-            weight = 1.0;
-
-        if (wtype == RND_WEIGHT)
-            weight = genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
-
-        if (wtype == ABS_WEIGHT)
-            weight = std::fabs(weight);
-
-	j++;
-	Edge &edge = g->getEdge(edgePos);
-	edge.tail = neighbor - 1;
-	edge.weight = weight;
-	edgePos++;
-      }
-
-      g->setEdgeStartForVertex(i + 1, edgePos);
-    }
-    break;
-  default:
+  if (value != 0 && value != 1 && value != 10 && value != 11) {
     std::cerr << "Inconsistent value for weight flag in Metis format: " << value << std::endl;
     exit(EXIT_FAILURE);
   }
+  if (value >= 10)
+    std::cout << "Metis format vertex weights ignored" << std::endl;
 
+  const bool edgeWeights = (value == 1 || value == 11);
+  const size_t dataBegin = ifs.tellg();
   ifs.close();
+
+  // line i lists the neighbors of vertex i (1-based), 
+  // preceded by the vertex weight if value >= 10
+  TextFile file(fileName);
+  EdgeTupleList edgeList;
+
+  auto parseAdjacency = [&] (const GraphElem i, const char *p, const char *eol, EdgeTupleList &edges)
+  {
+    GraphElem neighbor, vertexWeight;
+    GraphWeight weight = 1.0;
+
+    if (i >= numVertices)
+      return isBlankLine(p, eol);
+    if (value >= 10 && !parseElem(p, eol, vertexWeight))
+      return isBlankLine(p, eol);
+
+    while (parseElem(p, eol, neighbor)) {
+      if (edgeWeights && !parseWeight(p, eol, weight))
+        return false;
+
+      if (wtype == ONE_WEIGHT)
+        weight = 1.0;
+
+      if (wtype == ABS_WEIGHT)
+        weight = std::fabs(weight);
+
+      edges.emplace_back(i, neighbor - 1, weight);
+    }
+
+    return isBlankLine(p, eol);
+  };
+
+  parseLines(file, dataBegin, parseAdjacency, edgeList);
+
+  if (wtype == RND_WEIGHT)
+    setRandomWeights(edgeList);
+
+  if ((GraphElem)edgeList.size() != numEdges)
+    std::cout << "Found " << edgeList.size() << " edges instead." << std::endl;
+
+  // the neighbors are kept in the order of the file
+  buildGraphCSR(g, numVertices, edgeList, CSR_KEEP_ORDER);
 } // loadMetisFile
@@ -0,0 +1,273 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+
+#include "parse.hpp"
+
+TextFile::TextFile(const std::string &fileName)
+  : data_(NULL), size_(0), mapped_(false)
+{
+  const int fd = open(fileName.c_str(), O_RDONLY);
+  struct stat st;
+
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    std::cerr << "Error opening file: " << fileName << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  size_ = st.st_size;
+
+  if (size_ > 0) {
+    void *addr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (addr != MAP_FAILED) {
+      madvise(addr, size_, MADV_SEQUENTIAL);
+      data_ = static_cast<char*>(addr);
+      mapped_ = true;
+    }
+    else { // e.g., the file system does not support mmap
+      data_ = new char[size_];
+      
+      size_t nread = 0;
+      while (nread < size_) {
+        const ssize_t n = read(fd, data_ + nread, size_ - nread);
+        if (n <= 0) {
+          std::cerr << "Error reading file: " << fileName << std::endl;
+          exit(EXIT_FAILURE);
+        }
+        nread += n;
+      }
+    }
+  }
+  
+  close(fd);
+} // TextFile
+
+TextFile::~TextFile()
+{
+  if (mapped_)
+    munmap(data_, size_);
+  else
+    delete []data_;
+} // ~TextFile
+
+void splitLines(const TextFile &file, const size_t begin, const int nparts, 
+        std::vector<size_t> &bounds)
+{
+  const size_t size = file.size();
+  const size_t length = (begin < size) ? (size - begin) : 0;
+
+  bounds.clear();
+  bounds.push_back(std::min(begin, size));
+
+  // every part begins after the first newline past its even split
+  for (int k = 1; k < nparts; k++) {
+    size_t pos = begin + (length * k) / nparts;
+    
+    if (pos <= bounds.back())
+      continue;
+
+    const char *eol = static_cast<const char*>(std::memchr(file.data() + pos - 1, '\n', size - pos + 1));
+    pos = eol ? (eol - file.data() + 1) : size;
+
+    if (pos > bounds.back() && pos < size)
+      bounds.push_back(pos);
+  }
+
+  bounds.push_back(size);
+} // splitLines
+
+void parseEdgeLines(const TextFile &file, const size_t begin, const GraphElem shift, 
+        const bool readWeights, const bool absWeights, EdgeTupleList &edges)
+{
+  auto parseLine = [&] (const GraphElem, const char *p, const char *eol, EdgeTupleList &lineEdges) 
+  {
+    GraphElem v0, v1;
+    GraphWeight w = (readWeights ? 0.0 : 1.0);
+
+    if (p == eol || *p == '#' || *p == '%' || isBlankLine(p, eol))
+      return true;
+
+    if (!parseElem(p, eol, v0) || !parseElem(p, eol, v1))
+      return false;
+    if (readWeights && !isBlankLine(p, eol) && !parseWeight(p, eol, w))
+      return false;
+    
+    if (absWeights)
+      w = std::fabs(w);
+
+    lineEdges.emplace_back(v0 - shift, v1 - shift, w);
+    return true;
+  };
+
+  parseLines(file, begin, parseLine, edges);
+} // parseEdgeLines
+
+void setRandomWeights(EdgeTupleList &edges)
+{
+  for (size_t e = 0; e < edges.size(); e++)
+    edges[e].w_ = genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
+} // setRandomWeights
+
+GraphElem maxVertexOfTuples(const EdgeTupleList &edges)
+{
+  const GraphElem ne = edges.size();
+  GraphElem maxVertex = -1;
+
+#pragma omp parallel for reduction(max: maxVertex) schedule(static)
+  for (GraphElem e = 0; e < ne; e++)
+    maxVertex = std::max(maxVertex, std::max(edges[e].i_, edges[e].j_));
+
+  return maxVertex;
+} // maxVertexOfTuples
+
+// the directed edges are keys, 2e for (i, j) of tuple e and 
+// 2e + 1 for its mirror (j, i)
+void buildGraphCSR(Graph *&g, const GraphElem nv, const EdgeTupleList &edges, 
+        const unsigned options)
+{
+  const GraphElem ne = edges.size();
+  const bool symmetric = (options & CSR_SYMMETRIC);
+  const bool selfLoopsOnce = (options & CSR_SELF_LOOPS_ONCE);
+  
+  auto hasMirror = [&] (const GraphElemTuple &t) 
+  { return symmetric && !(selfLoopsOnce && (t.i_ == t.j_)); };
+  auto tailOf = [&] (const GraphElem key) 
+  { return (key & 1) ? edges[key >> 1].i_ : edges[key >> 1].j_; };
+
+  GraphElem badEdge = ne;
+
+#pragma omp parallel for reduction(min: badEdge) schedule(static)
+  for (GraphElem e = 0; e < ne; e++) {
+    if ((edges[e].i_ < 0 || edges[e].i_ >= nv || edges[e].j_ < 0 || edges[e].j_ >= nv) 
+            && (e < badEdge))
+      badEdge = e;
+  }
+
+  if (badEdge < ne) {
+    std::cerr << "Edge (" << edges[badEdge].i_ << ", " << edges[badEdge].j_ 
+      << ") is out of the range of " << nv << " vertices." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<GraphElem> offsets(nv + 1, 0);
+
+#pragma omp parallel for schedule(static)
+  for (GraphElem e = 0; e < ne; e++) {
+#pragma omp atomic update
+    offsets[edges[e].i_ + 1]++;
+    if (hasMirror(edges[e])) {
+#pragma omp atomic update
+      offsets[edges[e].j_ + 1]++;
+    }
+  }
+
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  
+  std::vector<GraphElem> pos(offsets.begin(), offsets.end() - 1);
+  std::vector<GraphElem> keys(offsets[nv]);
+
+#pragma omp parallel for schedule(static)
+  for (GraphElem e = 0; e < ne; e++) {
+    GraphElem p;
+#pragma omp atomic capture
+    p = pos[edges[e].i_]++;
+    keys[p] = 2*e;
+
+    if (hasMirror(edges[e])) {
+#pragma omp atomic capture
+      p = pos[edges[e].j_]++;
+      keys[p] = 2*e + 1;
+    }
+  }
+
+  std::vector<GraphElem>().swap(pos);
+  
+  // degrees after removing duplicates
+  std::vector<GraphElem> degrees(nv + 1, 0);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+  for (GraphElem v = 0; v < nv; v++) {
+    auto first = keys.begin() + offsets[v], last = keys.begin() + offsets[v+1];
+
+    if (options & CSR_KEEP_ORDER)
+      std::sort(first, last);
+    else
+      std::sort(first, last, [&] (const GraphElem k0, const GraphElem k1) 
+              { return (tailOf(k0) < tailOf(k1)) || ((tailOf(k0) == tailOf(k1)) && (k0 < k1)); });
+
+    if (options & CSR_UNIQUE)
+      last = std::unique(first, last, [&] (const GraphElem k0, const GraphElem k1) 
+              { return (tailOf(k0) == tailOf(k1)); });
+
+    degrees[v+1] = last - first;
+  }
+
+  std::partial_sum(degrees.begin(), degrees.end(), degrees.begin());
+
+  g = new Graph(nv, degrees[nv]);
+
+  for (GraphElem v = 0; v <= nv; v++)
+    g->setEdgeStartForVertex(v, degrees[v]);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+  for (GraphElem v = 0; v < nv; v++) {
+    for (GraphElem k = 0; k < degrees[v+1] - degrees[v]; k++) {
+      const GraphElem key = keys[offsets[v] + k];
+      g->setEdge(degrees[v] + k, tailOf(key), edges[key >> 1].w_);
+    }
+  }
+} // buildGraphCSR
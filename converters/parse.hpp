@@ -0,0 +1,242 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#ifndef __PARSE_H
+#define __PARSE_H
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "../utils.hpp"
+#include "../graph.hpp"
+
+// Parsing engine shared by the text format converters: the input 
+// file is memory-mapped (or read in one block if it cannot be 
+// mapped), the data (after the header, which the formats parse 
+// themselves) is split at line boundaries across the threads, and 
+// every thread parses its lines into edge tuples with the integer 
+// parser below. The CSR of the graph is then built with a parallel 
+// counting sort of the tuples by source vertex (see buildGraphCSR).
+
+typedef std::vector<GraphElemTuple> EdgeTupleList;
+
+class TextFile
+{
+    public:
+        TextFile(const std::string &fileName);
+        // takes over a block allocated with new[] (e.g., the 
+        // byte range of a file read by a process)
+        TextFile(char *buffer, const size_t size)
+            : data_(buffer), size_(size), mapped_(false)
+        {}
+        ~TextFile();
+
+        const char *data() const { return data_; }
+        size_t size() const { return size_; }
+
+    private:
+        char *data_;
+        size_t size_;
+        bool mapped_;
+        
+        TextFile(const TextFile &);
+        TextFile &operator = (const TextFile &);
+};
+
+// separators: blanks (and commas, for CSV files)
+inline const char *skipBlanks(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r'))
+        p++;
+    return p;
+} // skipBlanks
+
+inline bool parseElem(const char *&p, const char *end, GraphElem &value)
+{
+    p = skipBlanks(p, end);
+    
+    const bool negative = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+'))
+        p++;
+    if (p == end || static_cast<unsigned>(*p - '0') > 9)
+        return false;
+
+    GraphElem v = 0;
+    while (p < end && static_cast<unsigned>(*p - '0') <= 9) {
+        v = v*10 + (*p - '0');
+        p++;
+    }
+
+    value = (negative ? -v : v);
+    return true;
+} // parseElem
+
+// weights go through strtod (correctly rounded, as the 
+// stream extraction it replaces)
+inline bool parseWeight(const char *&p, const char *end, GraphWeight &value)
+{
+    char token[64];
+    size_t n = 0;
+
+    p = skipBlanks(p, end);
+    while (p < end && n < sizeof(token) - 1 && *p != ' ' && *p != '\t' 
+            && *p != ',' && *p != '\r')
+        token[n++] = *p++;
+    token[n] = '\0';
+    
+    char *last;
+    value = static_cast<GraphWeight>(std::strtod(token, &last));
+    
+    return (n > 0 && last == token + n);
+} // parseWeight
+
+inline bool isBlankLine(const char *p, const char *end)
+{ return (skipBlanks(p, end) == end); }
+
+// split [begin, size) of the file into (at most) nparts ranges that 
+// start at line boundaries: bounds[k], bounds[k+1] delimit part k
+void splitLines(const TextFile &file, const size_t begin, const int nparts, 
+        std::vector<size_t> &bounds);
+
+// calls parseLine(lineNumber, first, eol, edges) for every line of the 
+// file in [begin, size), where lineNumber counts from begin (0-based), 
+// and [first, eol) is the line without the newline; the tuples come 
+// out in the order of the lines, and parseLine returns false if the 
+// line is malformed (the first such line is reported)
+template<typename LineParser>
+void parseLines(const TextFile &file, const size_t begin, LineParser parseLine, 
+        EdgeTupleList &edges)
+{
+    std::vector<size_t> bounds;
+    splitLines(file, begin, 4*omp_get_max_threads(), bounds);
+    
+    const int nparts = bounds.size() - 1;
+    std::vector<GraphElem> firstLine(nparts + 1, 0);
+    std::vector<EdgeTupleList> parts(nparts);
+    GraphElem badLine = std::numeric_limits<GraphElem>::max();
+
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < nparts; k++)
+        firstLine[k+1] = std::count(file.data() + bounds[k], file.data() + bounds[k+1], '\n');
+
+    std::partial_sum(firstLine.begin(), firstLine.end(), firstLine.begin());
+
+#pragma omp parallel for reduction(min: badLine) schedule(dynamic)
+    for (int k = 0; k < nparts; k++) {
+        const char *p = file.data() + bounds[k], *end = file.data() + bounds[k+1];
+        GraphElem line = firstLine[k];
+        
+        while (p < end) {
+            const char *eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!eol)
+                eol = end;
+
+            if (!parseLine(line, p, eol, parts[k]) && line < badLine)
+                badLine = line;
+
+            p = eol + 1;
+            line++;
+        }
+    }
+
+    if (badLine != std::numeric_limits<GraphElem>::max()) {
+        std::cerr << "Error parsing line " << (badLine + 1) << " of the data." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<size_t> offsets(nparts + 1, 0);
+    for (int k = 0; k < nparts; k++)
+        offsets[k+1] = offsets[k] + parts[k].size();
+
+    edges.resize(offsets[nparts]);
+
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < nparts; k++) {
+        std::copy(parts[k].begin(), parts[k].end(), edges.begin() + offsets[k]);
+        EdgeTupleList().swap(parts[k]);
+    }
+} // parseLines
+
+// parse "u v [w]" lines (after the first begin bytes), skipping 
+// blank lines and the comments (starting with '#' or '%'); the ids are 
+// shifted down by shift (1 for 1-based inputs), and the weights are 
+// read if readWeights is true (0.0 if missing, as before), or else 
+// set to 1.0; absWeights takes their absolute value
+void parseEdgeLines(const TextFile &file, const size_t begin, const GraphElem shift, 
+        const bool readWeights, const bool absWeights, EdgeTupleList &edges);
+
+// random weights are drawn in the order of the tuples (i.e., of 
+// the file), so they do not depend on the number of threads
+void setRandomWeights(EdgeTupleList &edges);
+
+// largest vertex id of the tuples
+GraphElem maxVertexOfTuples(const EdgeTupleList &edges);
+
+// options of buildGraphCSR
+#define CSR_SYMMETRIC       (1U)      // every tuple (i, j) also adds (j, i)
+#define CSR_SELF_LOOPS_ONCE (1U << 1) // except self loops
+#define CSR_UNIQUE          (1U << 2) // keep the first of duplicate (i, j)
+#define CSR_KEEP_ORDER      (1U << 3) // do not sort the tails of a vertex 
+
+// build the CSR of the tuples with a parallel counting sort on the 
+// source vertices, the edges of a vertex are then sorted by tail (and 
+// by the order of the tuples for equal tails), as processGraphData does
+void buildGraphCSR(Graph *&g, const GraphElem nv, const EdgeTupleList &edges, 
+        const unsigned options);
+
+#endif // __PARSE_H
@@ -57,6 +57,7 @@
 #include <map>
 
 #include "shards.hpp"
+#include "parse.hpp"
 
 /// Pairwise read files between fileStartIndex and fileEndIndex and store 
 /// it into a single file, also selectively convert to binary
@@ -105,23 +106,28 @@ void loadFileShards(Graph *&g, const std::string &fileInShardsPath,
 		  std::cout << "File processing: " << fileNameShard << "; Ranges: " << v_lo  << ", " << v_hi << std::endl;
 		  numFiles++;
 
-		  // start reading shard
-		  std::string line, dummyline;
+		  // start reading shard, after the first line
+		  std::string dummyline;
 		  std::getline(ifs, dummyline);
+		  const size_t dataBegin = ifs.tellg();
+		  ifs.close();
 
-		  while(std::getline(ifs, line)) {
+		  TextFile file(fileName);
+		  const size_t shardBegin = edgeList.size();
 
+		  auto parseLine = [&] (const GraphElem, const char *p, const char *eol, EdgeTupleList &edges)
+		  {
 			  GraphElem v0, v1, info;
-			  GraphWeight w;
-			  char ch;
+			  GraphWeight w = 1.0;
 
-			  std::istringstream iss(line);
+			  if (isBlankLine(p, eol))
+				  return true;
 
 			  // read from current shard 
-			  if (wtype == ORG_WEIGHT || wtype == ABS_WEIGHT)
-				  iss >> v0 >> ch >> v1 >> ch >> info >> ch >> w;
-			  else
-				  iss >> v0 >> ch >> v1 >> ch >> info;
+			  if (!parseElem(p, eol, v0) || !parseElem(p, eol, v1) || !parseElem(p, eol, info))
+				  return false;
+			  if ((wtype == ORG_WEIGHT || wtype == ABS_WEIGHT) && !parseWeight(p, eol, w))
+				  return false;
 
 			  if (indexOneBased) {
 				  v0--; 
@@ -129,55 +135,40 @@ void loadFileShards(Graph *&g, const std::string &fileInShardsPath,
 			  }
 
 			  // normalize v0/v1 by adding lo/hi shard ID
-			  v0 += v_lo;
-			  v1 += v_hi;
-
-                          if (v0 > maxVertex)
-				  maxVertex = v0;
-			  if (v1 > maxVertex)
-				  maxVertex = v1;
-	  
-			  if (wtype == ONE_WEIGHT)
-				  w = 1.0;
-
-			  if (wtype == RND_WEIGHT)
-				  w = (GraphWeight)genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
-
-			  if (wtype == ABS_WEIGHT)
-				  w = std::fabs(w);
+			  edges.emplace_back(v0 + v_lo, v1 + v_hi, 
+					  (wtype == ABS_WEIGHT) ? std::fabs(w) : w);
+			  return true;
+		  };
 
-			  if (v0 != v1) {
-				  edgeList.emplace_back(v0, v1, w);
-				  edgeList.emplace_back(v1, v0, w);
-			  }
-			  else 
-				  edgeList.emplace_back(v0, v1, w);
+		  EdgeTupleList shardEdges;
+		  parseLines(file, dataBegin, parseLine, shardEdges);
+		  
+		  edgeList.insert(edgeList.end(), shardEdges.begin(), shardEdges.end());
+		  
+		  if (wtype == RND_WEIGHT) {
+			  for (size_t e = shardBegin; e < edgeList.size(); e++)
+				  edgeList[e].w_ = (GraphWeight)genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
 		  }
-
-		  // close current shard
-		  ifs.close();
 	  }
   }
 
   numEdges = edgeList.size();
+  maxVertex = maxVertexOfTuples(edgeList);
   numVertices = maxVertex + 1;
   double t2 = mytimer();  
   
   std::cout << "Read " << numFiles << " file shards (undirected data)." << std::endl;
   std::cout << "Unadjusted #vertices: " << numVertices << " and #edges: " << numEdges << std::endl;
-  std::cout << "Time taken for serial file I/O: " << (t2 - t0) << " secs." << std::endl;
+  std::cout << "Time taken for file I/O: " << (t2 - t0) << " secs." << std::endl;
 
   /// Part 1.5: remap vertex IDs   
   /// edgelist is unsorted, so two loops needed
   std::vector< GraphElem > vertexMap(numVertices, -1);
-  for (GraphElem i = 0; i < numEdges; i++) {
 
-	  if (vertexMap[edgeList[i].i_] == -1) {
-              vertexMap[edgeList[i].i_] = 1; 
-          }
-	  if (vertexMap[edgeList[i].j_] == -1) {
-              vertexMap[edgeList[i].j_] = 1; 
-          }
+#pragma omp parallel for schedule(static)
+  for (GraphElem i = 0; i < numEdges; i++) {
+	  vertexMap[edgeList[i].i_] = 1; 
+	  vertexMap[edgeList[i].j_] = 1; 
   }
 
   for (GraphElem i = 0; i < numVertices; i++) {
@@ -219,21 +210,15 @@ void loadFileShards(Graph *&g, const std::string &fileInShardsPath,
   numVertices = v_idx;
   std::cout << "Updated #vertices, after renumbering the indices consecutively to handle gaps: " << numVertices << std::endl;
 
-  std::vector< GraphElem > edgeCount(numVertices + 1, 0);
+#pragma omp parallel for schedule(static)
   for (GraphElem i = 0; i < numEdges; i++) {
-          
           edgeList[i].i_ = vertexMap[edgeList[i].i_];
           edgeList[i].j_ = vertexMap[edgeList[i].j_];
-
-	  assert(edgeList[i].i_ >= 0 && edgeList[i].i_ < numVertices);	  
-	  assert(edgeList[i].j_ >= 0 && edgeList[i].j_ < numVertices);	  
-
-	  edgeCount[edgeList[i].i_+1]++;
-	  //edgeCount[edgeList[i].j_+1]++;
   }
-  std::cout << "Stored graph data as edgelist and counted number of edges per vertex for graph CSR preparation." << std::endl;
-  g = new Graph(numVertices, numEdges);
-  processGraphData(*g, edgeCount, edgeList, numVertices, numEdges);
+
+  // we consider the data to be an undirected graph
+  buildGraphCSR(g, numVertices, edgeList, CSR_SYMMETRIC | CSR_SELF_LOOPS_ONCE);
+  std::cout << "Stored graph data as edgelist and built the graph CSR." << std::endl;
 
   t1 = mytimer();  
 
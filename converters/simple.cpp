@@ -48,120 +48,37 @@
 //
 // ************************************************************************
 
-#include <fstream>
 #include <iostream>
-#include <numeric>
-#include <sstream>
 #include <vector>
-#include <utility>
 
 #include "simple.hpp"
+#include "parse.hpp"
 
 /// Assuming a file with just an edge list (directed)
 void loadSimpleFile(Graph *&g, const std::string &fileName, 
         bool indexOneBased, Weight_t wtype)
 {
-  std::ifstream ifs;
-
   double t0, t1;
   t0 = mytimer();
 
-  ifs.open(fileName.c_str(), std::ifstream::in);
-  if (!ifs) {
-    std::cerr << "Error opening Simple format file: " << fileName << std::endl;
-    exit(EXIT_FAILURE);
-  }
-
-  std::string line;
-  GraphElem maxVertex = -1, numEdges = 0, numVertices, skipLines = 0;
-
-  do {
-      GraphElem v0, v1;
-      GraphWeight w = 0.0;
-
-      std::getline(ifs, line);
-      if(line[0] == '#' || line[0] == '%') {
-          skipLines++;
-          continue;
-      }
+  TextFile file(fileName);
+  EdgeTupleList edgeList;
 
-      std::istringstream iss(line);
-      if (wtype == ORG_WEIGHT || wtype == ABS_WEIGHT)
-          iss >> v0 >> v1 >> w;
-      else
-          iss >> v0 >> v1;
-
-      if (indexOneBased) {
-          v0--; 
-          v1--;
-      }
-      
-      if (v0 > maxVertex)
-          maxVertex = v0;
-      if (v1 > maxVertex)
-          maxVertex = v1;
-
-      numEdges++;
-
-  } while (!ifs.eof());
+  parseEdgeLines(file, 0, indexOneBased ? 1 : 0, (wtype == ORG_WEIGHT || wtype == ABS_WEIGHT), 
+          (wtype == ABS_WEIGHT), edgeList);
+  
+  if (wtype == RND_WEIGHT)
+      setRandomWeights(edgeList);
 
-  numVertices = maxVertex + 1;
-  numEdges -= 1; // last line
+  const GraphElem numVertices = maxVertexOfTuples(edgeList) + 1;
   
   std::cout << "Loading simple format file (directed edge-list): " 
       << fileName << ", numvertices: " << numVertices << std::endl;
 
-  ifs.close();
-   
-  // read the data
-  ifs.open(fileName.c_str(), std::ifstream::in);
-
-  std::vector<GraphElem> edgeCount(numVertices + 1);
-  std::vector<GraphElemTuple> edgeList;
+  // every edge is stored in both directions  
+  buildGraphCSR(g, numVertices, edgeList, CSR_SYMMETRIC);
   
-  for (GraphElem i = 0; i < numEdges+skipLines; i++) {
-    
-    GraphElem v0, v1;
-    GraphWeight w = 0.0;
-
-    std::getline(ifs, line);
-          
-    if(line[0] == '#' || line[0] == '%') 
-        continue;
-
-    std::istringstream iss(line);
-    if (wtype == ORG_WEIGHT || wtype == ABS_WEIGHT)
-        iss >> v0 >> v1 >> w;
-    else
-        iss >> v0 >> v1;
-          
-    if (indexOneBased) {
-        v0--; 
-        v1--;
-    }
-    
-    if (wtype == ONE_WEIGHT)
-        w = 1.0;
-
-    if (wtype == RND_WEIGHT)
-        w = genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
-    
-    if (wtype == ABS_WEIGHT)
-        w = std::fabs(w);
-
-    edgeList.push_back({v0, v1, w});
-    edgeList.push_back({v1, v0, w});
-    edgeCount[v0+1]++;
-    edgeCount[v1+1]++;
-  }
-
-  numEdges = edgeList.size();
-
-  ifs.close();
-  std::cout << "Number of edges: " << numEdges << std::endl;
-
-  g = new Graph(numVertices, numEdges);
-  processGraphData(*g, edgeCount, edgeList, numVertices, numEdges);
+  std::cout << "Number of edges: " << g->getNumEdges() << std::endl;
 
   t1 = mytimer();  
 
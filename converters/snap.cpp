@@ -55,22 +55,19 @@
 #include <vector>
 #include <utility>
 #include <limits>
-#include <map>
+#include <unordered_map>
 #include <cmath>
 
 #include "snap.hpp"
+#include "parse.hpp"
 
 // Nodes have explicit (and arbitrary) node ids. There is no restriction for node 
 // ids to be contiguous integers starting at 0. In TUNGraph and TNGraph edges have no 
 // explicit ids -- edges are identified by a pair node ids.
-void loadSNAPFile(Graph *&g, const std::string &fileName, Weight_t wtype)
+size_t readSNAPHeader(const std::string &fileName, GraphElem &numVertices, GraphElem &numEdges)
 {
   std::ifstream ifs;
 
-  double t0, t1, t2, t3;
-
-  t0 = mytimer();
-
   ifs.open(fileName.c_str(), std::ifstream::in);
   if (!ifs) {
     std::cerr << "Error opening SNAP format file: " << fileName << std::endl;
@@ -78,12 +75,12 @@ void loadSNAPFile(Graph *&g, const std::string &fileName, Weight_t wtype)
   }
 
   std::string line;
-  GraphElem numEdges = 0, numVertices;
+  numEdges = 0;
+  numVertices = -1;
 
   //Parse the comment lines for problem size
   size_t place = 0;
-  while(1) { 
-      std::getline(ifs, line);
+  while(std::getline(ifs, line)) { 
       //Check if this line has problem sizes
       if (line[0] == '#')  { 
           std::size_t found_nodes = line.find("Nodes");
@@ -102,11 +99,23 @@ void loadSNAPFile(Graph *&g, const std::string &fileName, Weight_t wtype)
           }
           place = ifs.tellg();
       }
-      else {
-          ifs.seekg(place); // move back
+      else
           break;
-      }
   }
+  
+  ifs.close();
+
+  return place;
+} // readSNAPHeader
+
+void loadSNAPFile(Graph *&g, const std::string &fileName, Weight_t wtype)
+{
+  double t0, t1, t2, t3;
+
+  t0 = mytimer();
+
+  GraphElem numEdges, numVertices;
+  const size_t place = readSNAPHeader(fileName, numVertices, numEdges);
 
   t1 = mytimer();
 
@@ -118,77 +127,48 @@ void loadSNAPFile(Graph *&g, const std::string &fileName, Weight_t wtype)
   // start parsing the data in file
   t2 = mytimer();
 
-  std::vector<GraphElem> edgeCount(numVertices+1);   
-  std::vector<GraphElemTuple> edgeList(numEdges*2);  // each edge stored twice
+  TextFile file(fileName);
+  EdgeTupleList edgeList;
 
-  // complete reading the file 
-  // compute the node renumbering by pushing nodeid on 
-  // a map and updating a temp edgeList
-  std::map<GraphElem, GraphElem> clusterLocalMap; //Renumber vertices contiguously from zero
-  std::map<GraphElem, GraphElem>::iterator storedAlready;
+  // weights are not read
+  parseEdgeLines(file, place, 0, false, false, edgeList);
+  
+  // Renumber vertices contiguously from zero, in 
+  // the order of their first appearance
+  std::unordered_map<GraphElem, GraphElem> clusterLocalMap;
   GraphElem numUniqueVertices = 0;
 
-  // update numEdges, as the input graph is
-  // assumed to be undirected and weights are 1
-  GraphElem nnz = 0;
-  for (GraphElem i = 0L; i < numEdges; i++) {
-      GraphWeight weight;
-      GraphElem v0, v1;
-      ifs >> v0 >> v1;
-
-      if (!ifs || ifs.fail()) {
-          std::cerr << "Error parsing SNAP edge" << std::endl;
-          exit(EXIT_FAILURE);
-      }
-
-      // for node_0
-      storedAlready = clusterLocalMap.find(v0);      //Check if it already exists
-      if( storedAlready != clusterLocalMap.end() ) { //Already exists
-          v0 = storedAlready->second; //Renumber the cluster id
-      } else {
-          clusterLocalMap[v0] = numUniqueVertices; //Does not exist, add to the map
-          v0 = numUniqueVertices; //Renumber the vertex id
-          numUniqueVertices++;    //Increment the number
-      }
-
-      // for node_1
-      storedAlready = clusterLocalMap.find(v1);         //Check if it already exists
-      if( storedAlready != clusterLocalMap.end() ) {	//Already exists
-          v1 = storedAlready->second; //Renumber the cluster id
-      } else {
-          clusterLocalMap[v1] = numUniqueVertices; //Does not exist, add to the map
-          v1 = numUniqueVertices; //Renumber the vertex id
-          numUniqueVertices++; //Increment the number
-      }
+  for (size_t i = 0; i < edgeList.size(); i++) {
+      auto stored = clusterLocalMap.emplace(edgeList[i].i_, numUniqueVertices);
+      if (stored.second)
+          numUniqueVertices++;
+      edgeList[i].i_ = stored.first->second;
       
-      if (wtype == RND_WEIGHT)
-          weight = genRandom(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
-
-      if (wtype == ONE_WEIGHT)
-          weight = 1.0;
-
-      edgeList.emplace_back(v0, v1, weight);
-      edgeList.emplace_back(v1, v0, weight);
-
-      // edge counts
-      edgeCount[v0 + 1]++;
-      edgeCount[v1 + 1]++;
-      nnz += 2;
+      stored = clusterLocalMap.emplace(edgeList[i].j_, numUniqueVertices);
+      if (stored.second)
+          numUniqueVertices++;
+      edgeList[i].j_ = stored.first->second;
   }
   
-  ifs.close();
- 
-  assert((numEdges * 2) == nnz);
+  if (wtype == RND_WEIGHT)
+      setRandomWeights(edgeList);
+
+  if (numVertices < numUniqueVertices) {
+      if (numVertices >= 0)
+          std::cout << "Found " << numUniqueVertices << " vertices instead." << std::endl;
+      numVertices = numUniqueVertices;
+  }
+  if ((GraphElem)edgeList.size() != numEdges)
+      std::cout << "Found " << edgeList.size() << " edges instead." << std::endl;
 
   t3 = mytimer();
   std::cout << "Time taken to allocate edgeList/edgeCount and read from file: " 
       << (t3 - t2) << std::endl;
    
-  numEdges = nnz;
- 
   t2 = mytimer();
-  g = new Graph(numVertices, numEdges);
-  processGraphData(*g, edgeCount, edgeList, numVertices, numEdges);
+
+  // the input graph is assumed to be undirected
+  buildGraphCSR(g, numVertices, edgeList, CSR_SYMMETRIC);
 
   t3 = mytimer();  
 
@@ -56,6 +56,10 @@
 #include "../utils.hpp"
 #include "../graph.hpp"
 
+// sizes from the "# Nodes: <nv> Edges: <ne>" comment (-1/0 if absent),
+// returns the offset of the first line after the comments
+size_t readSNAPHeader(const std::string &fileName, GraphElem &numVertices, GraphElem &numEdges);
+
 void loadSNAPFile(Graph *&g, const std::string &fileName, Weight_t wtype = ONE_WEIGHT);
 
 #endif // __SNAP_H
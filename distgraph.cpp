@@ -57,67 +57,168 @@
 #include <sstream>
 #include <iostream>
 #include <mpi.h>
+#include <omp.h>
 #include <climits>
+#include <limits>
 #include <cstdio>
 #include <array>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 
 #include "distgraph.hpp"
+#include "compress.hpp"
 #include "utils.hpp"
 
 extern std::ofstream ofs;
+
+#if defined(USE_SOA_EDGE_LIST)
+// the binary file stores {tail, weight} records, so with the 
+// SoA edge layout the records are staged through a bounded 
+// buffer and scattered into (or gathered from) the tails and 
+// weights arrays of the local graph
+#define EDGE_IO_CHUNK (1 << 20)
+
+static void readEdgeRecords(MPI_File fh, MPI_Offset offset, Graph &g)
+{
+    MPI_Status status;
+    const GraphElem ne = g.getNumEdges();
+    std::vector<Edge> buf(std::min<GraphElem>(ne, EDGE_IO_CHUNK));
+
+    for (GraphElem e = 0; e < ne; e += EDGE_IO_CHUNK) {
+        const GraphElem n = std::min<GraphElem>(ne - e, EDGE_IO_CHUNK);
+
+        MPI_File_read_at(fh, offset + e*sizeof(Edge), buf.data(), 
+                n*sizeof(Edge), MPI_BYTE, &status);
         
-// find a distribution such that every 
-// process own equal number of edges (serial)
-void balanceEdges(int nprocs, std::string& fileName, std::vector<GraphElem>& mbins)
+        for (GraphElem k = 0; k < n; k++)
+            g.setEdge(e + k, buf[k].tail, buf[k].weight);
+    }
+} // readEdgeRecords
+
+static void writeEdgeRecords(MPI_File fh, MPI_Offset offset, const Graph &g)
 {
-    FILE *fp;
-    GraphElem nv, ne; // #vertices, #edges
-    std::vector<GraphElem> nbins(nprocs,0);
+    MPI_Status status;
+    const GraphElem ne = g.getNumEdges();
+    std::vector<Edge> buf(std::min<GraphElem>(ne, EDGE_IO_CHUNK));
 
-    fp = fopen(fileName.c_str(), "rb");
-    if (fp == NULL) {
-        std::cout<< " Error opening file! " << std::endl;
-        MPI_Abort(MPI_COMM_WORLD, -99);
+    for (GraphElem e = 0; e < ne; e += EDGE_IO_CHUNK) {
+        const GraphElem n = std::min<GraphElem>(ne - e, EDGE_IO_CHUNK);
+        
+        for (GraphElem k = 0; k < n; k++)
+            buf[k] = g.getEdge(e + k);
+
+        MPI_File_write_at(fh, offset + e*sizeof(Edge), buf.data(), 
+                n*sizeof(Edge), MPI_BYTE, &status);
     }
+} // writeEdgeRecords
+#endif
+        
+// idx holds the global edge offsets of the vertices [lo, hi] 
+// (the block of this process), sets the bins such that every 
+// process owns roughly equal cost (see balanceEdges)
+static void findBalancedBins(int me, int nprocs, const GraphElem nv, const GraphElem ne, 
+        const GraphElem lo, const GraphElem hi, const std::vector<GraphElem> &idx, 
+        const GraphWeight vertexCost, std::vector<GraphElem>& mbins)
+{
+    // cost of [0, m) is idx[m] + vertexCost*m, which is 
+    // nondecreasing, so bin k starts at the first vertex 
+    // whose cost prefix reaches k*(totalCost/nprocs)
+    const GraphWeight totalCost = (GraphWeight)ne + vertexCost*nv;
+    std::vector<GraphElem> lbins(nprocs+1, nv);
+
+#pragma omp parallel for schedule(static)
+    for (int k = 1; k < nprocs; k++) {
+        const GraphWeight target = (totalCost * k) / nprocs;
+        GraphElem l = 0, h = hi - lo;
+
+        // first m in [lo, hi] with cost(m) >= target
+        while (l < h) {
+            const GraphElem mid = l + (h - l) / 2;
+            if (((GraphWeight)idx[mid] + vertexCost*(lo + mid)) < target)
+                l = mid + 1;
+            else
+                h = mid;
+        }
 
-    // read nv and ne
-    fread(&nv, sizeof(GraphElem), 1, fp);
-    fread(&ne, sizeof(GraphElem), 1, fp);
+        // the boundary belongs to the first block that contains it
+        if (l < (hi - lo) || (me == (nprocs - 1)))
+            lbins[k] = lo + l;
+    }
 
-    // bin capacity
-    GraphElem nbcap = (ne / nprocs), ecount_idx, past_ecount_idx = 0;
-    int p = 0;
+    MPI_Allreduce(lbins.data(), mbins.data(), nprocs+1, MPI_GRAPH_TYPE, 
+            MPI_MIN, MPI_COMM_WORLD);
+
+    mbins[0] = 0;
+    mbins[nprocs] = nv;
+} // findBalancedBins
+
+// find a distribution such that every process owns 
+// roughly equal cost, where a vertex costs its #edges 
+// plus vertexCost; the global edge offsets stored in the 
+// file are already a prefix sum of the edge counts, so 
+// every process reads the offsets of a block of vertices 
+// and searches its block for the bin boundaries
+void balanceEdges(int me, int nprocs, int ranks_per_node, std::string& fileName, 
+        std::vector<GraphElem>& mbins, const GraphWeight vertexCost)
+{
+    GraphElem header[2]; // #vertices, #edges
+    int file_open_error;
+    MPI_File fh;
+    MPI_Status status;
 
-    for (GraphElem m = 0; m < nv; m++)
-    {
-        fread(&ecount_idx, sizeof(GraphElem), 1, fp);
+    MPI_Info info;
+    MPI_Info_create(&info);
+    int naggr = (ranks_per_node > 1) ? (nprocs/ranks_per_node) : ranks_per_node;
+    if (naggr >= nprocs)
+        naggr = 1;
+    std::stringstream tmp_str;
+    tmp_str << naggr;
+    std::string str = tmp_str.str();
+    MPI_Info_set(info, "cb_nodes", str.c_str());
 
-        // bins[p] >= capacity only for the last process
-        if ((nbins[p] < nbcap) || (p == (nprocs - 1)))
-            nbins[p] += (ecount_idx - past_ecount_idx);
+    file_open_error = MPI_File_open(MPI_COMM_WORLD, fileName.c_str(), MPI_MODE_RDONLY, info, &fh); 
 
-        // increment p as long as p is not the last process
-        // worst case: excess edges piled up on (p-1)
-        if ((nbins[p] >= nbcap) && (p < (nprocs - 1)))
-            p++;
+    MPI_Info_free(&info);
 
-        mbins[p+1]++;
-        past_ecount_idx = ecount_idx;
+    if (file_open_error != MPI_SUCCESS) {
+        std::cout<< " Error opening file! " << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
     }
 
-    fclose(fp);
+    MPI_File_read_all(fh, header, 2*sizeof(GraphElem), MPI_BYTE, &status);
+    
+    const GraphElem nv = header[0], ne = header[1];
+    const GraphElem lo = (nv * me) / nprocs, hi = (nv * (me + 1)) / nprocs;
+
+    // offsets of vertices [lo, hi], the last process also 
+    // reads the final offset (== ne)
+    std::vector<GraphElem> idx(hi - lo + 1);
+    uint64_t tot_bytes = (hi - lo + 1)*sizeof(GraphElem);
+    MPI_Offset offset = 2*sizeof(GraphElem) + lo*sizeof(GraphElem);
+    uint8_t *curr_pointer = (uint8_t*)idx.data();
+    
+    while (tot_bytes > 0) {
+        const int chunk_bytes = (tot_bytes < INT_MAX) ? tot_bytes : INT_MAX;
+        MPI_File_read_at(fh, offset, curr_pointer, chunk_bytes, MPI_BYTE, &status);
+        tot_bytes -= chunk_bytes;
+        offset += chunk_bytes;
+        curr_pointer += chunk_bytes;
+    }
 
-    // prefix sum to store indices 
-    for (int k = 1; k < nprocs+1; k++)
-        mbins[k] += mbins[k-1]; 
+    MPI_File_close(&fh);
 
-    nbins.clear();
-}
+    findBalancedBins(me, nprocs, nv, ne, lo, hi, idx, vertexCost, mbins);
+} // balanceEdges
 
 // MPI parallel-I/O read binary file
 void loadDistGraphMPIIO(int me, int nprocs, int ranks_per_node, DistGraph *&dg, std::string &fileName)
 {
+    if (isCompressedGraphFile(me, fileName)) {
+        loadDistGraphCompressed(me, nprocs, ranks_per_node, dg, fileName, false);
+        return;
+    }
+
     GraphElem globalNumEdges;
     GraphElem globalNumVertices;
 
@@ -180,14 +281,23 @@ void loadDistGraphMPIIO(int me, int nprocs, int ranks_per_node, DistGraph *&dg,
     uint64_t tot_bytes=(localNumVertices+1)*sizeof(GraphElem);
     MPI_Offset offset = 2*sizeof(GraphElem) + ((globalNumVertices * me) / nprocs)*sizeof(GraphElem);
 
+    // the file stores global edge offsets, which are
+    // staged when the local offsets are narrower
+#if defined(USE_32_BIT_LOCAL_INDEX)
+    std::vector<GraphElem> stagedIndexes(localNumVertices+1);
+    GraphElem *fileIndexes = stagedIndexes.data();
+#else
+    GraphElem *fileIndexes = g.edgeListIndexes.data();
+#endif
+
 //    if (me == 0)
 //	    printf("Process: %d, Edge-list size: %d, elements: %d offset: %ld, offset elements: %d\n", me, g.edgeListIndexes.size(),  tot_bytes/sizeof(GraphElem), offset, offset/sizeof(GraphElem) - 2); 
 
     if (tot_bytes<INT_MAX)
-        MPI_File_read_at(fh, offset, &g.edgeListIndexes[0], tot_bytes, MPI_BYTE, &status);
+        MPI_File_read_at(fh, offset, fileIndexes, tot_bytes, MPI_BYTE, &status);
     else {
         int chunk_bytes=INT_MAX;
-        uint8_t *curr_pointer = (uint8_t*) &g.edgeListIndexes[0];
+        uint8_t *curr_pointer = (uint8_t*) fileIndexes;
         //GraphElem *curr_pointer = (GraphElem*) &g.edgeListIndexes[0];
         uint64_t transf_bytes=0;
 
@@ -207,18 +317,29 @@ void loadDistGraphMPIIO(int me, int nprocs, int ranks_per_node, DistGraph *&dg,
     if (me == 0)
 	    std::cout << "Read edgeListIndexes of size: " << g.edgeListIndexes.size() << std::endl;
 #endif
-    localNumEdges = g.edgeListIndexes[localNumVertices]-g.edgeListIndexes[0];
+    const GraphElem edgeBase = fileIndexes[0];
+    localNumEdges = fileIndexes[localNumVertices]-edgeBase;
 #if defined(DEBUG_PRINTF)
     if (me == 0)
 	    std::cout << "Local number of edges: " << localNumEdges << std::endl;
 #endif
 
+#if defined(USE_32_BIT_LOCAL_INDEX)
+    if (localNumEdges > std::numeric_limits<LocalElem>::max()) {
+        std::cout << "Process " << me << " owns " << localNumEdges << " edges, which exceeds "
+            "the range of 32-bit local indices (build without -DUSE_32_BIT_LOCAL_INDEX)." << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+#endif
     g.setNumEdges(localNumEdges);
 
     tot_bytes=localNumEdges*(sizeof(Edge));
 
-    offset = 2*sizeof(GraphElem) + (globalNumVertices+1)*sizeof(GraphElem) + g.edgeListIndexes[0]*(sizeof(Edge));
+    offset = 2*sizeof(GraphElem) + (globalNumVertices+1)*sizeof(GraphElem) + edgeBase*(sizeof(Edge));
 
+#if defined(USE_SOA_EDGE_LIST)
+    readEdgeRecords(fh, offset, g);
+#else
     if (tot_bytes<INT_MAX)
         MPI_File_read_at(fh, offset, &g.edgeList[0], tot_bytes, MPI_BYTE, &status);
     else {
@@ -237,24 +358,32 @@ void loadDistGraphMPIIO(int me, int nprocs, int ranks_per_node, DistGraph *&dg,
             if (tot_bytes-transf_bytes<INT_MAX)
                 chunk_bytes=tot_bytes-transf_bytes;
         } 
-    }    
+    }
+#endif    
 
     MPI_File_close(&fh);
 
-    for(GraphElem i=1;  i < localNumVertices+1; i++)
-        g.edgeListIndexes[i]-=g.edgeListIndexes[0];   
-
-    g.edgeListIndexes[0]=0;
+    for(GraphElem i=0;  i < localNumVertices+1; i++)
+        g.edgeListIndexes[i]=fileIndexes[i]-edgeBase;   
 
     // TODO FIXME create a runtime option for setting edge weights to 1.0
 #if defined(SET_EDGE_WEIGHTS_TO_ONE)
     g.setEdgeWeightstoOne();
+#elif defined(USE_SOA_EDGE_LIST)
+    // run unweighted graphs without a weights array
+    g.dropUnitEdgeWeights();
 #endif
 }
 
 // MPI parallel-I/O read binary file and make a balanced edge distribution
-void loadDistGraphMPIIOBalanced(int me, int nprocs, int ranks_per_node, DistGraph *&dg, std::string &fileName)
+void loadDistGraphMPIIOBalanced(int me, int nprocs, int ranks_per_node, DistGraph *&dg, 
+        std::string &fileName, const GraphWeight vertexCost)
 {
+    if (isCompressedGraphFile(me, fileName)) {
+        loadDistGraphCompressed(me, nprocs, ranks_per_node, dg, fileName, true, vertexCost);
+        return;
+    }
+
     GraphElem globalNumEdges;
     GraphElem globalNumVertices;
 
@@ -265,13 +394,9 @@ void loadDistGraphMPIIOBalanced(int me, int nprocs, int ranks_per_node, DistGrap
 
     // find #vertices per process such that 
     // each process roughly owns equal #edges
+    balanceEdges(me, nprocs, ranks_per_node, fileName, mbins, vertexCost);
     if (me == 0)
-    {
-        balanceEdges(nprocs, fileName, mbins);
         std::cout << "Trying to achieve equal edge distribution across processes." << std::endl;
-    }
-    MPI_Barrier(MPI_COMM_WORLD);
-    MPI_Bcast(mbins.data(), nprocs+1, MPI_GRAPH_TYPE, 0, MPI_COMM_WORLD);
 
     // specify the number of aggregates
     // nprocs / ranks_per_node 
@@ -323,13 +448,22 @@ void loadDistGraphMPIIOBalanced(int me, int nprocs, int ranks_per_node, DistGrap
     uint64_t tot_bytes=(localNumVertices+1)*sizeof(GraphElem);
     MPI_Offset offset = 2*sizeof(GraphElem) + mbins[me]*sizeof(GraphElem);
 
+    // the file stores global edge offsets, which are
+    // staged when the local offsets are narrower
+#if defined(USE_32_BIT_LOCAL_INDEX)
+    std::vector<GraphElem> stagedIndexes(localNumVertices+1);
+    GraphElem *fileIndexes = stagedIndexes.data();
+#else
+    GraphElem *fileIndexes = g.edgeListIndexes.data();
+#endif
+
     // printf("Process: %d, Edge-list size: %d, elements: %d offset: %ld, offset elements: %d\n", me, g.edgeListIndexes.size(),  tot_bytes/sizeof(GraphElem), offset, offset/sizeof(GraphElem) - 2); 
 
     if (tot_bytes<INT_MAX)
-        MPI_File_read_at(fh, offset, &g.edgeListIndexes[0], tot_bytes, MPI_BYTE, &status);
+        MPI_File_read_at(fh, offset, fileIndexes, tot_bytes, MPI_BYTE, &status);
     else {
         int chunk_bytes=INT_MAX;
-        uint8_t *curr_pointer = (uint8_t*) &g.edgeListIndexes[0];
+        uint8_t *curr_pointer = (uint8_t*) fileIndexes;
         //GraphElem *curr_pointer = (GraphElem*) &g.edgeListIndexes[0];
         uint64_t transf_bytes=0;
 
@@ -345,14 +479,25 @@ void loadDistGraphMPIIOBalanced(int me, int nprocs, int ranks_per_node, DistGrap
         } 
     }    
 
-    localNumEdges = g.edgeListIndexes[localNumVertices]-g.edgeListIndexes[0];
+    const GraphElem edgeBase = fileIndexes[0];
+    localNumEdges = fileIndexes[localNumVertices]-edgeBase;
 
+#if defined(USE_32_BIT_LOCAL_INDEX)
+    if (localNumEdges > std::numeric_limits<LocalElem>::max()) {
+        std::cout << "Process " << me << " owns " << localNumEdges << " edges, which exceeds "
+            "the range of 32-bit local indices (build without -DUSE_32_BIT_LOCAL_INDEX)." << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+#endif
     g.setNumEdges(localNumEdges);
 
     tot_bytes=localNumEdges*(sizeof(Edge));
 
-    offset = 2*sizeof(GraphElem) + (globalNumVertices+1)*sizeof(GraphElem) + g.edgeListIndexes[0]*(sizeof(Edge));
+    offset = 2*sizeof(GraphElem) + (globalNumVertices+1)*sizeof(GraphElem) + edgeBase*(sizeof(Edge));
 
+#if defined(USE_SOA_EDGE_LIST)
+    readEdgeRecords(fh, offset, g);
+#else
     if (tot_bytes<INT_MAX)
         MPI_File_read_at(fh, offset, &g.edgeList[0], tot_bytes, MPI_BYTE, &status);
     else {
@@ -370,27 +515,392 @@ void loadDistGraphMPIIOBalanced(int me, int nprocs, int ranks_per_node, DistGrap
             if (tot_bytes-transf_bytes<INT_MAX)
                 chunk_bytes=tot_bytes-transf_bytes;
         } 
-    }    
+    }
+#endif    
 
     MPI_File_close(&fh);
 
-    for(GraphElem i=1;  i < localNumVertices+1; i++)
-        g.edgeListIndexes[i]-=g.edgeListIndexes[0];   
-
-    g.edgeListIndexes[0]=0;
+    for(GraphElem i=0;  i < localNumVertices+1; i++)
+        g.edgeListIndexes[i]=fileIndexes[i]-edgeBase;   
     mbins.clear();
 
     // TODO FIXME create a runtime option for setting edge weights to 1.0
 #if defined(SET_EDGE_WEIGHTS_TO_ONE)
     g.setEdgeWeightstoOne();
+#elif defined(USE_SOA_EDGE_LIST)
+    // run unweighted graphs without a weights array
+    g.dropUnitEdgeWeights();
 #endif
 }
 
+// map [offset, offset + length) of a file read-only (private, so 
+// that writes such as setEdgeWeightstoOne copy the touched pages), 
+// returns the mapping and sets *first to the byte at offset
+static void *mapFileRange(int fd, off_t offset, size_t length, int advice, 
+        uint8_t **first, size_t &mappedLength)
+{
+    const off_t page = sysconf(_SC_PAGESIZE);
+    const off_t aligned = (offset / page) * page;
+    
+    mappedLength = length + (offset - aligned);
+    void *addr = mmap(NULL, mappedLength, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, aligned);
+
+    if (addr == MAP_FAILED) {
+        std::cout<< " Error mapping file! " << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+    
+    if (advice > 0)
+        madvise(addr, mappedLength, MADV_WILLNEED);
+#if defined(MADV_HUGEPAGE)
+    if (advice > 1)
+        madvise(addr, mappedLength, MADV_HUGEPAGE);
+#endif
+
+    *first = static_cast<uint8_t*>(addr) + (offset - aligned);
+
+    return addr;
+} // mapFileRange
+
+// memory-mapped read of the binary file, the local edges are a 
+// view of the file, which is shared by the processes of a node 
+// through the page cache (with the SoA layout, the edges are 
+// copied from the mapping); advice: 0 (none), 1 (MADV_WILLNEED), 
+// 2 (MADV_WILLNEED and MADV_HUGEPAGE)
+void loadDistGraphMmap(int me, int nprocs, int ranks_per_node, DistGraph *&dg, 
+        std::string &fileName, int advice, bool balanced, const GraphWeight vertexCost)
+{
+    // the compressed format cannot be a view of the file
+    if (isCompressedGraphFile(me, fileName)) {
+        loadDistGraphCompressed(me, nprocs, ranks_per_node, dg, fileName, balanced, vertexCost);
+        return;
+    }
+
+    GraphElem header[2]; // #vertices, #edges
+    std::vector<GraphElem> mbins(nprocs+1,0);
+
+    if (balanced) {
+        balanceEdges(me, nprocs, ranks_per_node, fileName, mbins, vertexCost);
+        if (me == 0)
+            std::cout << "Trying to achieve equal edge distribution across processes." << std::endl;
+    }
+
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    
+    if (fd < 0 || pread(fd, header, 2*sizeof(GraphElem), 0) != (ssize_t)(2*sizeof(GraphElem))) {
+        std::cout<< " Error opening file! " << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    const GraphElem globalNumVertices = header[0], globalNumEdges = header[1];
+
+    if (!balanced) {
+        for (int i = 1; i < nprocs+1; i++)
+            mbins[i] = ((globalNumVertices * i) / nprocs);
+    }
+
+    const GraphElem localNumVertices = mbins[me+1] - mbins[me];
+
+    dg = new DistGraph(globalNumVertices, globalNumEdges);
+    dg->createLocalGraph(localNumVertices, 0, &mbins);
+    Graph &g = dg->getLocalGraph(); 
+
+    // the offsets are rebased into the local graph
+    uint8_t *first;
+    size_t mappedLength;
+    void *addr = mapFileRange(fd, 2*sizeof(GraphElem) + mbins[me]*sizeof(GraphElem), 
+            (localNumVertices+1)*sizeof(GraphElem), 0, &first, mappedLength);
+    const GraphElem *fileIndexes = reinterpret_cast<const GraphElem*>(first);
+    
+    const GraphElem edgeBase = fileIndexes[0];
+    const GraphElem localNumEdges = fileIndexes[localNumVertices]-edgeBase;
+
+#if defined(USE_32_BIT_LOCAL_INDEX)
+    if (localNumEdges > std::numeric_limits<LocalElem>::max()) {
+        std::cout << "Process " << me << " owns " << localNumEdges << " edges, which exceeds "
+            "the range of 32-bit local indices (build without -DUSE_32_BIT_LOCAL_INDEX)." << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+#endif
+
+#pragma omp parallel for schedule(static)
+    for (GraphElem i = 0; i < localNumVertices+1; i++)
+        g.edgeListIndexes[i] = fileIndexes[i]-edgeBase;
+
+    munmap(addr, mappedLength);
+
+    const off_t offset = 2*sizeof(GraphElem) + (globalNumVertices+1)*sizeof(GraphElem) 
+        + edgeBase*sizeof(Edge);
+
+#if defined(USE_SOA_EDGE_LIST)
+    g.setNumEdges(localNumEdges);
+
+    if (localNumEdges > 0) {
+        addr = mapFileRange(fd, offset, localNumEdges*sizeof(Edge), advice, &first, mappedLength);
+        const Edge *fileEdges = reinterpret_cast<const Edge*>(first);
+
+#pragma omp parallel for schedule(static)
+        for (GraphElem e = 0; e < localNumEdges; e++)
+            g.setEdge(e, fileEdges[e].tail, fileEdges[e].weight);
+        
+        munmap(addr, mappedLength);
+    }
+#else
+    g.setNumEdges(localNumEdges);
+
+    if (localNumEdges > 0) {
+        addr = mapFileRange(fd, offset, localNumEdges*sizeof(Edge), advice, &first, mappedLength);
+        g.mapEdges(addr, mappedLength, reinterpret_cast<Edge*>(first));
+    }
+#endif
+    
+    close(fd);
+
+#if defined(SET_EDGE_WEIGHTS_TO_ONE)
+    g.setEdgeWeightstoOne();
+#elif defined(USE_SOA_EDGE_LIST)
+    // run unweighted graphs without a weights array
+    g.dropUnitEdgeWeights();
+#endif
+} // loadDistGraphMmap
+
+// true if the file starts with the magic number of the 
+// compressed format (see compress.hpp)
+bool isCompressedGraphFile(int me, std::string &fileName)
+{
+    uint64_t magic = 0;
+
+    if (me == 0) {
+        std::ifstream ifs(fileName.c_str(), std::ifstream::in | std::ifstream::binary);
+        ifs.read(reinterpret_cast<char*>(&magic), sizeof(uint64_t));
+    }
+
+    MPI_Bcast(&magic, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    return (magic == COMPRESSED_GRAPH_MAGIC);
+} // isCompressedGraphFile
+
+static void readFileRange(MPI_File fh, MPI_Offset offset, void *buf, uint64_t tot_bytes)
+{
+    MPI_Status status;
+    uint8_t *curr_pointer = (uint8_t*)buf;
+    
+    while (tot_bytes > 0) {
+        const int chunk_bytes = (tot_bytes < INT_MAX) ? tot_bytes : INT_MAX;
+        MPI_File_read_at(fh, offset, curr_pointer, chunk_bytes, MPI_BYTE, &status);
+        tot_bytes -= chunk_bytes;
+        offset += chunk_bytes;
+        curr_pointer += chunk_bytes;
+    }
+} // readFileRange
+
+// chunks [cfirst, clast) overlap the vertices [lo, hi)
+static void findChunks(const std::vector<CompressedGraphChunk> &index, 
+        const GraphElem lo, const GraphElem hi, GraphElem &cfirst, GraphElem &clast)
+{
+    const GraphElem nchunks = index.size() - 1;
+    auto vertexLess = [] (const CompressedGraphChunk &c, const GraphElem v) 
+    { return (GraphElem)c.vertex < v; };
+
+    // first chunk that starts after lo, less one
+    cfirst = std::lower_bound(index.begin(), index.begin() + nchunks, lo + 1, vertexLess) 
+        - index.begin() - 1;
+    clast = std::lower_bound(index.begin(), index.begin() + nchunks, hi, vertexLess) 
+        - index.begin();
+    
+    if (lo >= hi)
+        clast = cfirst = std::max<GraphElem>(cfirst, 0);
+} // findChunks
+
+// global edge offsets of the vertices [lo, hi], only 
+// the degrees sections of the chunks are read
+static void readCompressedOffsets(MPI_File fh, const std::vector<CompressedGraphChunk> &index, 
+        const GraphElem lo, const GraphElem hi, std::vector<GraphElem> &idx)
+{
+    GraphElem cfirst, clast;
+    findChunks(index, lo, hi + 1, cfirst, clast);
+    
+    std::vector<size_t> pos(clast - cfirst + 1, 0);
+    for (GraphElem c = cfirst; c < clast; c++)
+        pos[c - cfirst + 1] = pos[c - cfirst] + index[c].degreeBytes;
+
+    ByteBuffer buf(pos.back());
+    for (GraphElem c = cfirst; c < clast; c++)
+        readFileRange(fh, index[c].offset, buf.data() + pos[c - cfirst], index[c].degreeBytes);
+    
+    idx.resize(hi - lo + 1);
+    if (hi == (GraphElem)index[clast].vertex)
+        idx[hi - lo] = index[clast].edge;
+
+#pragma omp parallel for schedule(dynamic)
+    for (GraphElem c = cfirst; c < clast; c++)
+        decompressChunkOffsets(index[c], index[c+1].vertex - index[c].vertex, 
+                buf.data() + pos[c - cfirst], lo, hi, idx.data());
+} // readCompressedOffsets
+
+// MPI parallel-I/O read of the compressed binary file, every 
+// process reads and decompresses (in parallel) the chunks that 
+// overlap its vertices, with balanced == true the distribution 
+// is the one of loadDistGraphMPIIOBalanced
+void loadDistGraphCompressed(int me, int nprocs, int ranks_per_node, DistGraph *&dg, 
+        std::string &fileName, bool balanced, const GraphWeight vertexCost)
+{
+    CompressedGraphHeader header;
+    MPI_File fh;
+    MPI_Status status;
+
+    MPI_Info info;
+    MPI_Info_create(&info);
+    int naggr = (ranks_per_node > 1) ? (nprocs/ranks_per_node) : ranks_per_node;
+    if (naggr >= nprocs)
+        naggr = 1;
+    std::stringstream tmp_str;
+    tmp_str << naggr;
+    std::string str = tmp_str.str();
+    MPI_Info_set(info, "cb_nodes", str.c_str());
+
+    const int file_open_error = MPI_File_open(MPI_COMM_WORLD, fileName.c_str(), 
+            MPI_MODE_RDONLY, info, &fh); 
+
+    MPI_Info_free(&info);
+
+    if (file_open_error != MPI_SUCCESS) {
+        std::cout<< " Error opening file! " << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    MPI_File_read_all(fh, &header, sizeof(CompressedGraphHeader), MPI_BYTE, &status);
+
+    const char *error = compressedHeaderError(header);
+    if (error) {
+        std::cout << "Error reading " << fileName << ": " << error << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    std::vector<CompressedGraphChunk> index(header.nchunks + 1);
+    MPI_File_read_all(fh, index.data(), index.size()*sizeof(CompressedGraphChunk), 
+            MPI_BYTE, &status);
+
+    if (checksumBytes(reinterpret_cast<const uint8_t*>(index.data()), 
+                index.size()*sizeof(CompressedGraphChunk)) != header.checksum) {
+        std::cout << "Error reading " << fileName << ": corrupt chunk index" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    const GraphElem globalNumVertices = header.nv, globalNumEdges = header.ne;
+    std::vector<GraphElem> mbins(nprocs+1, 0);
+    std::vector<GraphElem> idx;
+
+    if (me == 0)
+	    std::cout << "Reading compressed file of " << globalNumVertices 
+		    << " vertices and " << globalNumEdges << " edges." << std::endl;
+
+    if (balanced) {
+        const GraphElem lo = (globalNumVertices * me) / nprocs;
+        const GraphElem hi = (globalNumVertices * (me + 1)) / nprocs;
+        
+        readCompressedOffsets(fh, index, lo, hi, idx);
+        findBalancedBins(me, nprocs, globalNumVertices, globalNumEdges, 
+                lo, hi, idx, vertexCost, mbins);
+        
+        if (me == 0)
+            std::cout << "Trying to achieve equal edge distribution across processes." << std::endl;
+    }
+    else {
+        for (int i = 1; i < nprocs+1; i++)
+            mbins[i] = ((globalNumVertices * i) / nprocs);
+    }
+
+    const GraphElem lo = mbins[me], hi = mbins[me+1];
+    
+    dg = new DistGraph(globalNumVertices, globalNumEdges);
+    dg->createLocalGraph(hi - lo, 0, &mbins);
+    Graph &g = dg->getLocalGraph(); 
+
+    // read the blocks of the chunks that overlap [lo, hi)
+    GraphElem cfirst, clast;
+    findChunks(index, lo, hi, cfirst, clast);
+    
+    const uint64_t blockBase = index[cfirst].offset;
+    ByteBuffer buf(index[clast].offset - blockBase);
+    readFileRange(fh, blockBase, buf.data(), buf.size());
+    
+    MPI_File_close(&fh);
+
+    idx.resize(hi - lo + 1);
+    if (hi == (GraphElem)index[clast].vertex)
+        idx[hi - lo] = index[clast].edge;
+
+    bool corrupt = false;
+#pragma omp parallel for reduction(||: corrupt) schedule(dynamic)
+    for (GraphElem c = cfirst; c < clast; c++) {
+        const uint8_t *block = buf.data() + (index[c].offset - blockBase);
+        
+        corrupt = corrupt || (checksumBytes(block, index[c+1].offset - index[c].offset) 
+                != index[c].checksum);
+        decompressChunkOffsets(index[c], index[c+1].vertex - index[c].vertex, 
+                block, lo, hi, idx.data());
+    }
+
+    if (corrupt) {
+        std::cout << "Error reading " << fileName << ": corrupt chunk on process " 
+            << me << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+    
+    const GraphElem edgeBase = idx[0];
+    const GraphElem localNumEdges = idx[hi - lo] - edgeBase;
+
+#if defined(USE_32_BIT_LOCAL_INDEX)
+    if (localNumEdges > std::numeric_limits<LocalElem>::max()) {
+        std::cout << "Process " << me << " owns " << localNumEdges << " edges, which exceeds "
+            "the range of 32-bit local indices (build without -DUSE_32_BIT_LOCAL_INDEX)." << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+#endif
+    g.setNumEdges(localNumEdges);
+
+#pragma omp parallel for schedule(static)
+    for (GraphElem i = 0; i < hi - lo + 1; i++)
+        g.edgeListIndexes[i] = idx[i] - edgeBase;
+
+#pragma omp parallel for schedule(dynamic)
+    for (GraphElem c = cfirst; c < clast; c++)
+        decompressChunkEdges(header, index[c], index[c+1].vertex - index[c].vertex, 
+                buf.data() + (index[c].offset - blockBase), lo, hi, edgeBase, g);
+
+#if defined(SET_EDGE_WEIGHTS_TO_ONE)
+    g.setEdgeWeightstoOne();
+#elif defined(USE_SOA_EDGE_LIST)
+    // run unweighted graphs without a weights array
+    g.dropUnitEdgeWeights();
+#endif
+} // loadDistGraphCompressed
+
 // generate graph
 // 1D vertex distribution
 void generateInMemGraph(int rank, int nprocs, DistGraph *&dg, GraphElem nv, 
-        GraphWeight randomEdgePercent, std::string fileOut="")
+        GraphWeight randomEdgePercent, std::string fileOut, bool compressOut, 
+        int genType, const std::vector<GraphWeight> &genArgs, std::vector<GraphElem> *groundTruth)
 {
+    if (genType == RMAT_GENERATOR) {
+        const GraphElem edgeFactor = (genArgs.size() > 0) ? (GraphElem)genArgs[0] : RMAT_EDGE_FACTOR;
+        dg = generateRMAT(rank, nprocs, nv, edgeFactor, fileOut, compressOut);
+        MPI_Barrier(MPI_COMM_WORLD);
+        return;
+    }
+
+    if (genType == PLANTED_GENERATOR) {
+        const GraphWeight avgDegree = (genArgs.size() > 0) ? genArgs[0] : PLANTED_AVG_DEGREE;
+        const GraphWeight mixing = (genArgs.size() > 1) ? genArgs[1] : PLANTED_MIXING;
+        std::vector<GraphElem> planted;
+
+        dg = generatePlanted(rank, nprocs, nv, avgDegree, mixing, 
+                (groundTruth ? *groundTruth : planted), fileOut, compressOut);
+        MPI_Barrier(MPI_COMM_WORLD);
+        return;
+    }
+
     GraphWeight rn;
 
     // calculate r(n)
@@ -398,303 +908,348 @@ void generateInMemGraph(int rank, int nprocs, DistGraph *&dg, GraphElem nv,
     GraphWeight rt = sqrt((GraphWeight)2.0736/(GraphWeight)nv);
     rn = (rc + rt)/(GraphWeight)2.0;
 
-    assert(((GraphWeight)1.0/(GraphWeight)nprocs) > rn);
-
     // generate distributed RGG in memory
-    dg = generateRGG(rank, nprocs, nv, rn, randomEdgePercent, fileOut);
+    dg = generateRGG(rank, nprocs, nv, rn, randomEdgePercent, fileOut, compressOut);
 
     MPI_Barrier(MPI_COMM_WORLD);
 }
 
-// create RGG and returns Graph
-// TODO FIXME use OpenMP wherever possible
-// use Euclidean distance as edge weight
-DistGraph* generateRGG(int rank, int nprocs, GraphElem nv, GraphWeight rn, 
-        GraphWeight randomEdgePercent, std::string fileOut="")
+// counter-based random numbers (splitmix64), so any process computes the
+// same points, edges or degrees of the generators from the ids without
+// communication
+static inline uint64_t genHash(uint64_t x)
 {
-    int up, down;
-
-    // neighbors
-    up = down = MPI_PROC_NULL;
-    if (nprocs > 1) {
-        if (rank > 0 && rank < (nprocs - 1)) {
-            up = rank - 1;
-            down = rank + 1;
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+} // genHash
+
+static inline GraphWeight genUniform(uint64_t seed, uint64_t k)
+{ return (GraphWeight)((genHash(seed ^ genHash(k)) >> 11) * (1.0/9007199254740992.0)); }
+
+// the points of a process are uniform in X and in the strip 
+// [parts[p]/nv, parts[p+1]/nv) of Y, so the density is uniform
+// for any number of processes
+static inline void rggPoint(const PartRanges &parts, const GraphElem nv, const int p, 
+        const GraphElem v, GraphWeight &x, GraphWeight &y)
+{
+    const GraphWeight lo = (GraphWeight)parts[p]/(GraphWeight)nv;
+    const GraphWeight hi = (GraphWeight)parts[p+1]/(GraphWeight)nv;
+
+    x = genUniform(RGG_SEED, 2*v);
+    y = lo + genUniform(RGG_SEED, 2*v + 1)*(hi - lo);
+} // rggPoint
+
+static inline GraphWeight rggDistance(GraphWeight x0, GraphWeight y0, GraphWeight x1, GraphWeight y1)
+{
+    const GraphWeight dx = x0 - x1;
+    const GraphWeight dy = y0 - y1;
+    return sqrt(dx*dx + dy*dy);
+} // rggDistance
+
+struct RGGPoint
+{
+    GraphWeight x, y;
+    GraphElem id;
+};
+
+// visit the points within rn of point p in cell c, in the 3x3 cells 
+// around it, the points are stored in the order of the cells
+template<class Emit>
+static inline void rggVisitNeighbors(const RGGPoint &p, const GraphElem c, const GraphWeight rn, 
+        const std::vector<RGGPoint> &points, const std::vector<GraphElem> &cellStart, 
+        const GraphElem ncx, const GraphElem ncy, Emit emit)
+{
+    const GraphElem cx = c % ncx, cy = c / ncx;
+    const GraphWeight rn2 = rn*rn;
+
+    for (GraphElem j = std::max((GraphElem)0, cy - 1); j <= std::min(ncy - 1, cy + 1); j++) {
+        const GraphElem first = cellStart[j*ncx + std::max((GraphElem)0, cx - 1)];
+        const GraphElem last = cellStart[j*ncx + std::min(ncx - 1, cx + 1) + 1];
+
+        // the (up to) 3 cells of a row of cells are contiguous
+        for (GraphElem k = first; k < last; k++) {
+            const GraphWeight dx = p.x - points[k].x;
+            const GraphWeight dy = p.y - points[k].y;
+            // are the two vertices within the range?
+            if ((dx*dx + dy*dy) <= rn2 && points[k].id != p.id)
+                emit(points[k].id, sqrt(dx*dx + dy*dy));
         }
-        if (rank == 0)
-            down = 1;
-        if (rank == (nprocs - 1))
-            up = rank - 1;
     }
+} // rggVisitNeighbors
 
-    GraphElem n = nv / nprocs;
+// send the edges of the threads to the owners of their 
+// sources, with alltoallv in batches of at most GENERATED_EDGE_BATCH 
+// edges per process, so the byte counts stay within INT limits
+static void exchangeGeneratedEdges(int nprocs, const PartRanges &parts, 
+        std::vector<std::vector<EdgeTuple>> &tedges, std::vector<EdgeTuple> &redges)
+{
+    const int nthreads = tedges.size();
+    std::vector<GraphElem> ssizes(nprocs, 0), rsizes(nprocs);
+    std::vector<GraphElem> sdispls(nprocs + 1, 0), rdispls(nprocs + 1, 0);
 
-    // Generate random coordinate points
-    std::vector<GraphWeight> X, Y, X_up, Y_up, X_down, Y_down;
-    X.resize(2*n);
-    Y.resize(n);
+    auto owner = [&parts](GraphElem v) 
+    { return (int)(std::upper_bound(parts.begin(), parts.end(), v) - parts.begin() - 1); };
 
-    if (up != MPI_PROC_NULL) {
-        X_up.resize(n);
-        Y_up.resize(n);
-    }
+    for (int t = 0; t < nthreads; t++)
+        for (const EdgeTuple &e : tedges[t])
+            ssizes[owner(e.ij_[0])]++;
+
+    for (int p = 0; p < nprocs; p++)
+        sdispls[p+1] = sdispls[p] + ssizes[p];
 
-    if (down != MPI_PROC_NULL) {
-        X_down.resize(n);
-        Y_down.resize(n);
+    std::vector<EdgeTuple> sedges(sdispls[nprocs]);
+    {
+        std::vector<GraphElem> spos(sdispls.begin(), sdispls.end() - 1);
+        for (int t = 0; t < nthreads; t++) {
+            for (const EdgeTuple &e : tedges[t])
+                sedges[spos[owner(e.ij_[0])]++] = e;
+            std::vector<EdgeTuple>().swap(tedges[t]);
+        }
     }
 
-    // create local graph
-    std::vector<GraphElem> party(nprocs+1);
-    DistGraph* dg = new DistGraph(nv, 0);
-    party[0] = 0;
+    MPI_Alltoall(ssizes.data(), 1, MPI_GRAPH_TYPE, rsizes.data(), 1, MPI_GRAPH_TYPE, MPI_COMM_WORLD);
 
-    // account for hash in data structure...
-    for (int i = 1;i < nprocs + 1; i++)
-        party[i]=((nv * i) / nprocs);  
+    for (int p = 0; p < nprocs; p++)
+        rdispls[p+1] = rdispls[p] + rsizes[p];
 
-    // set #edges later
-    dg->createLocalGraph(n, 0, &party);
-    Graph &g = dg->getLocalGraph(); 
+    redges.resize(rdispls[nprocs]);
 
-    // generate random number within range
-    // X: 0, 1
-    // Y: rank_*1/p, (rank_+1)*1/p,
-    GraphWeight rec_np = (GraphWeight)(1.0/(GraphWeight)nprocs);
-    GraphWeight lo = rank* rec_np; 
-    GraphWeight hi = lo + rec_np;
-    assert(hi > lo);
+    GraphElem maxCount = std::max(*std::max_element(ssizes.begin(), ssizes.end()), 
+            *std::max_element(rsizes.begin(), rsizes.end()));
+    GraphElem rounds = (maxCount + GENERATED_EDGE_BATCH - 1) / GENERATED_EDGE_BATCH;
+    MPI_Allreduce(MPI_IN_PLACE, &rounds, 1, MPI_GRAPH_TYPE, MPI_MAX, MPI_COMM_WORLD);
 
-    // measure the time to generate random numbers
-    MPI_Barrier(MPI_COMM_WORLD);
-    double st = MPI_Wtime();
+    std::vector<int> scounts(nprocs), rcounts(nprocs), sbytes(nprocs), rbytes(nprocs);
+    std::vector<int> sdisp(nprocs), rdisp(nprocs);
+    std::vector<EdgeTuple> sbatch, rbatch;
 
-    // X | Y
-    // e.g seeds: 1741, 3821
-    // create LCG object
-    // seed to generate x0
-    LCG xr(1, X.data(), 2*n); 
-
-    // generate random numbers between 0-1
-    xr.generate();
-
-    // rescale xr further between lo-hi
-    // and put the numbers in Y taking
-    // from X[n]
-    xr.rescale(Y.data(), n, lo);
-
-#if defined(PRINT_RANDOM_XY_COORD)
-    for (int k = 0; k < nprocs; k++) {
-        if (k == rank) {
-            std::cout << "Random number generated on Process#" << k << " :" << std::endl;
-            for (GraphElem i = 0; i < n; i++) {
-                std::cout << "X, Y: " << X[i] << ", " << Y[i] << std::endl;
-            }
+    for (GraphElem r = 0; r < rounds; r++) {
+        const GraphElem first = r * GENERATED_EDGE_BATCH;
+        int spos = 0, rpos = 0;
+
+        for (int p = 0; p < nprocs; p++) {
+            scounts[p] = (int)std::max((GraphElem)0, std::min((GraphElem)GENERATED_EDGE_BATCH, ssizes[p] - first));
+            rcounts[p] = (int)std::max((GraphElem)0, std::min((GraphElem)GENERATED_EDGE_BATCH, rsizes[p] - first));
+        }
+
+        sbatch.resize(std::accumulate(scounts.begin(), scounts.end(), (GraphElem)0));
+        rbatch.resize(std::accumulate(rcounts.begin(), rcounts.end(), (GraphElem)0));
+
+        for (int p = 0; p < nprocs; p++) {
+            std::copy(sedges.begin() + sdispls[p] + first, 
+                    sedges.begin() + sdispls[p] + first + scounts[p], sbatch.begin() + spos);
+
+            sbytes[p] = scounts[p] * sizeof(struct EdgeTuple);
+            rbytes[p] = rcounts[p] * sizeof(struct EdgeTuple);
+            sdisp[p] = spos * sizeof(struct EdgeTuple);
+            rdisp[p] = rpos * sizeof(struct EdgeTuple);
+
+            spos += scounts[p];
+            rpos += rcounts[p];
+        }
+
+        MPI_Alltoallv(sbatch.data(), sbytes.data(), sdisp.data(), MPI_BYTE, 
+                rbatch.data(), rbytes.data(), rdisp.data(), MPI_BYTE, MPI_COMM_WORLD);
+
+        rpos = 0;
+        for (int p = 0; p < nprocs; p++) {
+            std::copy(rbatch.begin() + rpos, rbatch.begin() + rpos + rcounts[p], 
+                    redges.begin() + rdispls[p] + first);
+            rpos += rcounts[p];
         }
-        MPI_Barrier(MPI_COMM_WORLD);
     }
-#endif
-    
+} // exchangeGeneratedEdges
+
+// set the sorted edges (local sources) and the row offsets 
+// (degree) as the local graph, returns the global #edges
+static GraphElem setGeneratedEdges(DistGraph *dg, const std::vector<EdgeTuple> &edgeList, 
+        const std::vector<GraphElem> &degree)
+{
+    Graph &g = dg->getLocalGraph(); 
+    const GraphElem n = g.getNumVertices();
+
+    // set graph edge indices and prepare
+    // graph data structure
+    const GraphElem nedges = edgeList.size();
+    g.setNumEdges(nedges);
+
+    for (GraphElem i = 0; i < n + 1; i++)
+        g.setEdgeStartForVertex(i, degree[i]);
+
+#pragma omp parallel for schedule(static)
+    for (GraphElem j = 0; j < nedges; j++)
+        g.setEdge(j, edgeList[j].ij_[1], edgeList[j].w_);
+
+    GraphElem tot_nedges = 0;
+    MPI_Allreduce(&nedges, &tot_nedges, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+    dg->setNumEdges(tot_nedges);
+
+    return tot_nedges;
+} // setGeneratedEdges
+
+// write the generated graph, with the row offsets (degree)
+static void writeGeneratedGraph(int rank, int nprocs, DistGraph *&dg, 
+        const std::vector<GraphElem> &degree, std::string &fileOut, bool compressOut)
+{
+    const GraphElem nv = dg->getTotalNumVertices(), base = dg->getBase(rank);
+    const GraphElem n = dg->getLocalGraph().getNumVertices();
+
     // create an global edge count vector
-    std::vector<GraphElem> edgeCount;
-    if (!fileOut.empty())
-        edgeCount.resize(nv+1);
- 
-    double et = MPI_Wtime();
-    double tt = et - st;
-    double tot_tt = 0.0;
-    MPI_Reduce(&tt, &tot_tt, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-
-    if (rank == 0) {
-        double tot_avg = (tot_tt/nprocs);
-        std::cout << "Average time to generate " << 2*n 
-            << " random numbers using LCG (in s): " 
-            << tot_avg << std::endl;
-    }
+    std::vector<GraphElem> edgeCount(nv+1, 0);
+    for (GraphElem i = 0; i < n; i++)
+        edgeCount[base+i+1] = degree[i+1] - degree[i];
 
-    // ghost(s)
+    writeGraph(rank, nprocs, dg, edgeCount, fileOut, compressOut);
+    if (rank == 0)
+        std::cout << "Written binary file: " << fileOut << std::endl;
+} // writeGeneratedGraph
 
-    // cross edges, each processor
-    // communicates with up or/and down
-    // neighbor only
-    std::vector<EdgeTuple> sendup_edges, senddn_edges; 
-    std::vector<EdgeTuple> recvup_edges, recvdn_edges;
-    std::vector<EdgeTuple> edgeList;
+// create RGG and returns Graph
+// use Euclidean distance as edge weight
+//
+// every process owns the vertices [(nv*p)/nprocs, (nv*(p+1))/nprocs),
+// and computes the points of the processes whose strips are within rn
+// of its own (the halo), which are binned in cells of side >= rn, so a
+// vertex only scans the 3x3 cells around it; both ends of an edge 
+// compute it from the same coordinates, so rows are built independently
+// (no exchange), and only the random edges (-e) are exchanged
+DistGraph* generateRGG(int rank, int nprocs, GraphElem nv, GraphWeight rn, 
+        GraphWeight randomEdgePercent, std::string fileOut, bool compressOut)
+{
+    PartRanges party(nprocs+1);
+    for (int i = 0; i < nprocs + 1; i++)
+        party[i] = ((nv * i) / nprocs);  
 
-    // counts, indexing: [2] = {up - 0, down - 1}
-    // TODO can't we use MPI_INT 
-    std::array<GraphElem, 2> send_sizes = {0, 0}, recv_sizes = {0, 0};
-#if defined(CHECK_NUM_EDGES)
-    GraphElem numEdges = 0;
-#endif
+    const GraphElem base = party[rank];
+    const GraphElem n = party[rank+1] - party[rank];
 
-    // local
-    // TODO FIXME parallelize
-    for (GraphElem i = 0; i < n; i++) {
-        for (GraphElem j = i + 1; j < n; j++) {
-            // euclidean distance:
-            // 2D: sqrt((px-qx)^2 + (py-qy)^2)
-            GraphWeight dx = X[i] - X[j];
-            GraphWeight dy = Y[i] - Y[j];
-            GraphWeight ed = sqrt(dx*dx + dy*dy);
-            // are the two vertices within the range?
-            if (ed <= rn) {
-                // local to global index
-                const GraphElem g_i = dg->localToGlobal(i, rank);
-                const GraphElem g_j = dg->localToGlobal(j, rank);
+    DistGraph* dg = new DistGraph(nv, 0);
 
-                edgeList.emplace_back(i, g_j, ed);
-                edgeList.emplace_back(j, g_i, ed);
+    // set #edges later
+    dg->createLocalGraph(n, 0, &party);
+    Graph &g = dg->getLocalGraph(); 
 
-#if defined(CHECK_NUM_EDGES)
-                numEdges += 2;
-#endif
+    MPI_Barrier(MPI_COMM_WORLD);
+    double st = MPI_Wtime();
 
-                g.edgeListIndexes[i+1]++;
-                g.edgeListIndexes[j+1]++;
+    const GraphWeight ylo = (GraphWeight)party[rank]/(GraphWeight)nv;
+    const GraphWeight yhi = (GraphWeight)party[rank+1]/(GraphWeight)nv;
+    const GraphWeight blo = ylo - rn, bhi = yhi + rn;
 
-                if (!fileOut.empty()) {
-                    edgeCount[g_i+1]++;
-                    edgeCount[g_j+1]++;
-                }
+    // my points first, then the halo points
+    std::vector<GraphWeight> X(n), Y(n);
+    std::vector<GraphElem> ids(n);
+
+#pragma omp parallel for schedule(static)
+    for (GraphElem i = 0; i < n; i++) {
+        rggPoint(party, nv, rank, base + i, X[i], Y[i]);
+        ids[i] = base + i;
+    }
+
+    for (int p = 0; p < nprocs; p++) {
+        if (p == rank || party[p+1] == party[p])
+            continue;
+        if (((GraphWeight)party[p+1]/(GraphWeight)nv) < blo 
+                || ((GraphWeight)party[p]/(GraphWeight)nv) >= bhi)
+            continue;
+
+        for (GraphElem v = party[p]; v < party[p+1]; v++) {
+            GraphWeight x, y;
+            rggPoint(party, nv, p, v, x, y);
+            if (y >= blo && y < bhi) {
+                X.push_back(x);
+                Y.push_back(y);
+                ids.push_back(v);
             }
         }
     }
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    // bin the points in cells (counting sort)
+    const GraphElem npts = X.size();
+    const GraphElem ncx = std::max((GraphElem)1, (GraphElem)(1.0/rn));
+    const GraphElem ncy = std::max((GraphElem)1, (GraphElem)((bhi - blo)/rn));
+    const GraphWeight cw = 1.0/(GraphWeight)ncx, ch = (bhi - blo)/(GraphWeight)ncy;
 
-    // communicate ghost coordinates with neighbors
-    const int x_ndown   = X_down.empty() ? 0 : n;
-    const int y_ndown   = Y_down.empty() ? 0 : n;
-    const int x_nup     = X_up.empty() ? 0 : n;
-    const int y_nup     = Y_up.empty() ? 0 : n;
-
-    MPI_Sendrecv(X.data(), n, MPI_WEIGHT_TYPE, up, SR_X_UP_TAG, 
-            X_down.data(), x_ndown, MPI_WEIGHT_TYPE, down, SR_X_UP_TAG, 
-            MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    MPI_Sendrecv(X.data(), n, MPI_WEIGHT_TYPE, down, SR_X_DOWN_TAG, 
-            X_up.data(), x_nup, MPI_WEIGHT_TYPE, up, SR_X_DOWN_TAG, 
-            MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    MPI_Sendrecv(Y.data(), n, MPI_WEIGHT_TYPE, up, SR_Y_UP_TAG, 
-            Y_down.data(), y_ndown, MPI_WEIGHT_TYPE, down, SR_Y_UP_TAG, 
-            MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    MPI_Sendrecv(Y.data(), n, MPI_WEIGHT_TYPE, down, SR_Y_DOWN_TAG, 
-            Y_up.data(), y_nup, MPI_WEIGHT_TYPE, up, SR_Y_DOWN_TAG, 
-            MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    // exchange ghost vertices / cross edges
-    if (nprocs > 1) {
-        if (up != MPI_PROC_NULL) {
-
-            for (GraphElem i = 0; i < n; i++) {
-                for (GraphElem j = i + 1; j < n; j++) {
-                    GraphWeight dx = X[i] - X_up[j];
-                    GraphWeight dy = Y[i] - Y_up[j];
-                    GraphWeight ed = sqrt(dx*dx + dy*dy);
-
-                    if (ed <= rn) {
-                        const GraphElem g_i = dg->localToGlobal(i, rank);
-                        const GraphElem g_j = j + up*n;
-                        sendup_edges.emplace_back(j, g_i, ed);
-                        edgeList.emplace_back(i, g_j, ed);
-
-#if defined(CHECK_NUM_EDGES)
-                        numEdges++;
-#endif
-                        g.edgeListIndexes[i+1]++;
-                        if (!fileOut.empty())
-                            edgeCount[g_i+1]++;
-                    }
-                }
-            }
+    std::vector<GraphElem> pcell(npts), cellStart(ncx*ncy + 1, 0);
 
-            // send up sizes
-            send_sizes[0] = sendup_edges.size();
+#pragma omp parallel for schedule(static)
+    for (GraphElem k = 0; k < npts; k++) {
+        const GraphElem cx = std::min(ncx - 1, (GraphElem)(X[k]/cw));
+        const GraphElem cy = std::min(ncy - 1, std::max((GraphElem)0, (GraphElem)((Y[k] - blo)/ch)));
+        pcell[k] = cy*ncx + cx;
+    }
+
+    for (GraphElem k = 0; k < npts; k++)
+        cellStart[pcell[k] + 1]++;
+    std::partial_sum(cellStart.begin(), cellStart.end(), cellStart.begin());
+    
+    std::vector<RGGPoint> points(npts);
+    {
+        std::vector<GraphElem> cellPos(cellStart.begin(), cellStart.end() - 1);
+        for (GraphElem k = 0; k < npts; k++) {
+            RGGPoint &p = points[cellPos[pcell[k]]++];
+            p.x = X[k];
+            p.y = Y[k];
+            p.id = ids[k];
         }
+    }
 
-        if (down != MPI_PROC_NULL) {
+    std::vector<GraphWeight>().swap(X);
+    std::vector<GraphWeight>().swap(Y);
+    std::vector<GraphElem>().swap(ids);
+    std::vector<GraphElem>().swap(pcell);
 
-            for (GraphElem i = 0; i < n; i++) {
-                for (GraphElem j = i + 1; j < n; j++) {
-                    GraphWeight dx = X[i] - X_down[j];
-                    GraphWeight dy = Y[i] - Y_down[j];
-                    GraphWeight ed = sqrt(dx*dx + dy*dy);
+    // the rows of my vertices are emitted in the order of the cells 
+    // (neighboring cells are then in cache) into per-thread buffers, 
+    // sorted, and then copied to their positions
+    const int nthreads = omp_get_max_threads();
+    std::vector<GraphElem> degree(n + 1, 0);
+    std::vector<std::vector<EdgeTuple>> tedges(nthreads);
 
-                    if (ed <= rn) {
-                        const GraphElem g_i = dg->localToGlobal(i, rank);
-                        const GraphElem g_j = j + down*n;
+    auto ecmp = [] (EdgeTuple const& e0, EdgeTuple const& e1)
+    { return ((e0.ij_[0] < e1.ij_[0]) || ((e0.ij_[0] == e1.ij_[0]) && (e0.ij_[1] < e1.ij_[1]))); };
 
-                        senddn_edges.emplace_back(j, g_i, ed);
-                        edgeList.emplace_back(i, g_j, ed);
-#if defined(CHECK_NUM_EDGES)
-                        numEdges++;
-#endif
-                        g.edgeListIndexes[i+1]++;
-                        if (!fileOut.empty())
-                            edgeCount[g_i+1]++;
-                    }
-                }
-            }
+#pragma omp parallel
+    {
+        std::vector<EdgeTuple> &myEdges = tedges[omp_get_thread_num()];
+
+#pragma omp for schedule(dynamic, 256)
+        for (GraphElem c = 0; c < ncx*ncy; c++) {
+            for (GraphElem k = cellStart[c]; k < cellStart[c+1]; k++) {
+                const RGGPoint &p = points[k];
+                if (p.id < base || p.id >= base + n)
+                    continue;
+
+                const GraphElem i = p.id - base;
+                const GraphElem start = myEdges.size();
+
+                rggVisitNeighbors(p, c, rn, points, cellStart, ncx, ncy, 
+                        [&](GraphElem j, GraphWeight ed) { myEdges.emplace_back(i, j, ed); });
 
-            // send down sizes
-            send_sizes[1] = senddn_edges.size();
+                std::sort(myEdges.begin() + start, myEdges.end(), ecmp);
+                degree[i+1] = myEdges.size() - start;
+            }
         }
     }
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    std::vector<RGGPoint>().swap(points);
 
-    // communicate ghost vertices with neighbors
-    // send/recv buffer sizes
-
-    MPI_Sendrecv(&send_sizes[0], 1, MPI_GRAPH_TYPE, up, SR_SIZES_UP_TAG, 
-            &recv_sizes[1], 1, MPI_GRAPH_TYPE, down, SR_SIZES_UP_TAG, 
-            MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    MPI_Sendrecv(&send_sizes[1], 1, MPI_GRAPH_TYPE, down, SR_SIZES_DOWN_TAG, 
-            &recv_sizes[0], 1, MPI_GRAPH_TYPE, up, SR_SIZES_DOWN_TAG, 
-            MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    // resize recv buffers
-
-    if (recv_sizes[0] > 0)
-        recvup_edges.resize(recv_sizes[0]);
-    if (recv_sizes[1] > 0)
-        recvdn_edges.resize(recv_sizes[1]);
-
-    // send/recv both up and down
-
-    MPI_Sendrecv(sendup_edges.data(), send_sizes[0]*sizeof(struct EdgeTuple), MPI_BYTE, 
-            up, SR_UP_TAG, recvdn_edges.data(), recv_sizes[1]*sizeof(struct EdgeTuple), 
-            MPI_BYTE, down, SR_UP_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    MPI_Sendrecv(senddn_edges.data(), send_sizes[1]*sizeof(struct EdgeTuple), MPI_BYTE, 
-            down, SR_DOWN_TAG, recvup_edges.data(), recv_sizes[0]*sizeof(struct EdgeTuple), 
-            MPI_BYTE, up, SR_DOWN_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    // update local #edges
-
-    // down
-    if (down != MPI_PROC_NULL) {
-        for (GraphElem i = 0; i < recv_sizes[1]; i++) {
-#if defined(CHECK_NUM_EDGES)
-            numEdges++;
-#endif           
-            edgeList.emplace_back(recvdn_edges[i].ij_[0], recvdn_edges[i].ij_[1], recvdn_edges[i].w_);
-            g.edgeListIndexes[recvdn_edges[i].ij_[0]+1]++;
-            if (!fileOut.empty())
-                edgeCount[dg->localToGlobal(recvdn_edges[i].ij_[0], rank)+1]++;
-        } 
-    }
+    std::partial_sum(degree.begin(), degree.end(), degree.begin());
 
-    // up
-    if (up != MPI_PROC_NULL) {
-        for (GraphElem i = 0; i < recv_sizes[0]; i++) {
-#if defined(CHECK_NUM_EDGES)
-            numEdges++;
-#endif
-            edgeList.emplace_back(recvup_edges[i].ij_[0], recvup_edges[i].ij_[1], recvup_edges[i].w_);
-            g.edgeListIndexes[recvup_edges[i].ij_[0]+1]++;
-            if (!fileOut.empty())
-                edgeCount[dg->localToGlobal(recvup_edges[i].ij_[0], rank)+1]++;
+    std::vector<EdgeTuple> edgeList(degree[n]);
+
+#pragma omp parallel
+    {
+        std::vector<EdgeTuple> &myEdges = tedges[omp_get_thread_num()];
+
+        for (GraphElem e = 0; e < (GraphElem)myEdges.size(); ) {
+            const GraphElem i = myEdges[e].ij_[0], len = degree[i+1] - degree[i];
+            std::copy(myEdges.begin() + e, myEdges.begin() + e + len, edgeList.begin() + degree[i]);
+            e += len;
         }
+        std::vector<EdgeTuple>().swap(myEdges);
     }
 
     // add random edges based on 
@@ -706,291 +1261,608 @@ DistGraph* generateRGG(int rank, int nprocs, GraphElem nv, GraphWeight rn,
         MPI_Allreduce(&pnedges, &tot_pnedges, 1, MPI_GRAPH_TYPE, 
                 MPI_SUM, MPI_COMM_WORLD);
 
-        // extra #edges per process
+        // extra #edges, random edge k is generated by 
+        // the process of [(nrande*p)/nprocs, (nrande*(p+1))/nprocs)
         const GraphElem nrande = (((GraphElem)(randomEdgePercent * (GraphWeight)tot_pnedges))/100);
-        GraphElem pnrande;
+        const GraphElem klo = (nrande * rank) / nprocs, khi = (nrande * (rank + 1)) / nprocs;
 
-        // TODO FIXME try to ensure a fair edge distibution
-        if (nrande < nprocs) {
-            if (rank == (nprocs - 1))
-                pnrande += nrande;
-        }
-        else {
-            pnrande = nrande / nprocs;
-            const GraphElem pnrem = nrande % nprocs;
-            if (pnrem != 0) {
-                if (rank == (nprocs - 1))
-                    pnrande += pnrem;
+        // per-thread edges, both directions
+
+#pragma omp parallel
+        {
+            std::vector<EdgeTuple> &myEdges = tedges[omp_get_thread_num()];
+
+#pragma omp for schedule(static)
+            for (GraphElem k = klo; k < khi; k++) {
+                if (n == 0)
+                    continue;
+
+                const GraphElem i = (GraphElem)(genHash(RGG_RANDOM_EDGE_SEED ^ genHash(2*k)) % (uint64_t)n);
+                const GraphElem g_j = (GraphElem)(genHash(RGG_RANDOM_EDGE_SEED ^ genHash(2*k + 1)) % (uint64_t)nv);
+                const GraphElem g_i = base + i;
+
+                if (g_i == g_j)
+                    continue;
+
+                // already an edge of the RGG
+                if (std::binary_search(edgeList.begin() + degree[i], edgeList.begin() + degree[i+1], 
+                            EdgeTuple(i, g_j), ecmp))
+                    continue;
+
+                GraphWeight xi, yi, xj, yj;
+                rggPoint(party, nv, rank, g_i, xi, yi);
+                rggPoint(party, nv, dg->getOwner(g_j), g_j, xj, yj);
+                const GraphWeight weight = rggDistance(xi, yi, xj, yj);
+
+                myEdges.emplace_back(g_i, g_j, weight);
+                myEdges.emplace_back(g_j, g_i, weight);
             }
         }
 
-        // add pnrande edges 
+        std::vector<EdgeTuple> recvrand_edges;
+        exchangeGeneratedEdges(nprocs, party, tedges, recvrand_edges);
+
+        // merge the received edges (to local sources) into the sorted 
+        // rows, a pair can come twice (picked by both ends), or be an
+        // RGG edge of the other end, so the rows are made unique
+#pragma omp parallel for schedule(static)
+        for (GraphElem k = 0; k < (GraphElem)recvrand_edges.size(); k++)
+            recvrand_edges[k].ij_[0] -= base;
 
-        // send/recv buffers
-        std::vector<std::vector<EdgeTuple>> rand_edges(nprocs); 
-        std::vector<EdgeTuple> sendrand_edges, recvrand_edges;
+        std::sort(recvrand_edges.begin(), recvrand_edges.end(), ecmp);
 
-        // outgoing/incoming send/recv sizes
-        // TODO FIXME if number of randomly added edges are above
-        // INT_MAX, weird things will happen, fix it
-        std::vector<int> sendrand_sizes(nprocs), recvrand_sizes(nprocs);
+        std::vector<EdgeTuple> mergedList(edgeList.size() + recvrand_edges.size());
+        std::merge(edgeList.begin(), edgeList.end(), recvrand_edges.begin(), recvrand_edges.end(), 
+                mergedList.begin(), ecmp);
+        mergedList.erase(std::unique(mergedList.begin(), mergedList.end(), 
+                    [] (EdgeTuple const& e0, EdgeTuple const& e1)
+                    { return (e0.ij_[0] == e1.ij_[0]) && (e0.ij_[1] == e1.ij_[1]); }), mergedList.end());
 
 #if defined(PRINT_EXTRA_NEDGES)
-        int extraEdges = 0;
+        GraphElem extraEdges = mergedList.size() - edgeList.size(), totExtraEdges = 0;
+        MPI_Reduce(&extraEdges, &totExtraEdges, 1, MPI_GRAPH_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
+        if (rank == 0)
+            std::cout << "Adding extra " << totExtraEdges/2 << " edges while trying to incorporate " 
+                << randomEdgePercent << "%" << " extra edges globally." << std::endl;
 #endif
 
-#if defined(DEBUG_PRINTF)
-        for (int i = 0; i < nprocs; i++) {
-            if (i == rank) {
-                std::cout << "[" << i << "]Target process for random edge insertion between " 
-                    << lo << " and " << hi << std::endl;
-            }
-            MPI_Barrier(MPI_COMM_WORLD);
-        }
-#endif
+        edgeList.swap(mergedList);
+        std::vector<EdgeTuple>().swap(mergedList);
+        std::vector<EdgeTuple>().swap(recvrand_edges);
+
+        std::fill(degree.begin(), degree.end(), 0);
+        for (const EdgeTuple &e : edgeList)
+            degree[e.ij_[0] + 1]++;
+        std::partial_sum(degree.begin(), degree.end(), degree.begin());
+    } // end of (conditional) random edges addition
+   
+    const GraphElem tot_nedges = setGeneratedEdges(dg, edgeList, degree);
+
+    double et = MPI_Wtime();
+    double tt = et - st;
+    double max_tt = 0.0;
+    MPI_Reduce(&tt, &max_tt, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+        std::cout << "Time to generate the RGG with " << tot_nedges 
+            << " edges (in s): " << max_tt << std::endl;
+
+    // write file
+    if (!fileOut.empty())
+        writeGeneratedGraph(rank, nprocs, dg, degree, fileOut, compressOut);
+
+    return dg;
+}
+
+// a bijection of [0, 2^bits), multiplications by odd constants 
+// and xor-shifts are bijections modulo 2^bits
+static inline uint64_t genBijection(uint64_t x, const int bits, const uint64_t seed)
+{
+    const uint64_t mask = (bits >= 64) ? ~0ULL : ((1ULL << bits) - 1);
+    const int shift = (bits + 1) / 2;
+
+    x = (x * 0x9e3779b97f4a7c15ULL + seed) & mask;
+    x ^= (x >> shift);
+    x = (x * 0xbf58476d1ce4e5b9ULL) & mask;
+    x ^= (x >> shift);
+    return x;
+} // genBijection
+
+// permutation of [0, nv), cycle-walking the bijection of [0, 2^bits)
+static inline GraphElem genPermute(const GraphElem v, const GraphElem nv, const int bits, 
+        const uint64_t seed)
+{
+    uint64_t x = v;
+    do {
+        x = genBijection(x, bits, seed);
+    } while (x >= (uint64_t)nv);
 
-        // make sure each process has a 
-        // different seed this time since
-        // we want random edges
-        unsigned rande_seed = (unsigned)(time(0)^getpid());
-        GraphWeight weight = 1.0;
-        std::hash<GraphElem> reh;
+    return (GraphElem)x;
+} // genPermute
 
-        // cannot use genRandom if it's already been seeded
-        std::default_random_engine re(rande_seed); 
-        std::uniform_int_distribution<GraphElem> IR, JR; 
-        std::uniform_real_distribution<GraphWeight> IJW; 
+static inline int genBits(const GraphElem nv)
+{
+    int bits = 1;
+    while (bits < 63 && (GraphElem(1) << bits) < nv)
+        bits++;
+    return bits;
+} // genBits
+
+// sort the received edges (global sources) by source and tail, 
+// dropping self-loops and summing the weights of duplicates
+static void buildGeneratedRows(const GraphElem base, const GraphElem n, 
+        std::vector<EdgeTuple> &redges, std::vector<EdgeTuple> &edgeList, 
+        std::vector<GraphElem> &degree)
+{
+    std::vector<GraphElem> rowStart(n + 1, 0);
 
-        for (GraphElem k = 0; k < pnrande; k++) {
+    for (const EdgeTuple &e : redges)
+        rowStart[e.ij_[0] - base + 1]++;
+    std::partial_sum(rowStart.begin(), rowStart.end(), rowStart.begin());
 
-            // randomly pick start/end vertex and target from my list
-            const GraphElem i = (GraphElem)IR(re, std::uniform_int_distribution<GraphElem>::param_type{0, (n - 1)});
-            const GraphElem g_j = (GraphElem)JR(re, std::uniform_int_distribution<GraphElem>::param_type{0, (nv - 1)});
-            const int target = dg->getOwner(g_j);
-            const GraphElem j = dg->globalToLocal(g_j, target); // local
+    edgeList.resize(redges.size());
+    {
+        std::vector<GraphElem> pos(rowStart.begin(), rowStart.end() - 1);
+        for (const EdgeTuple &e : redges)
+            edgeList[pos[e.ij_[0] - base]++] = EdgeTuple(e.ij_[0] - base, e.ij_[1], e.w_);
+    }
+    std::vector<EdgeTuple>().swap(redges);
 
-            if (i == j) 
+    auto tcmp = [] (EdgeTuple const& e0, EdgeTuple const& e1) { return e0.ij_[1] < e1.ij_[1]; };
+
+    degree.assign(n + 1, 0);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (GraphElem i = 0; i < n; i++) {
+        std::vector<EdgeTuple>::iterator first = edgeList.begin() + rowStart[i], 
+            last = edgeList.begin() + rowStart[i+1], out = first;
+
+        std::sort(first, last, tcmp);
+
+        for (std::vector<EdgeTuple>::iterator it = first; it != last; ++it) {
+            if (it->ij_[1] == (base + i))
                 continue;
+            if (out != first && (out - 1)->ij_[1] == it->ij_[1])
+                (out - 1)->w_ += it->w_;
+            else
+                *out++ = *it;
+        }
+
+        degree[i+1] = out - first;
+    }
 
-            const GraphElem g_i = dg->localToGlobal(i, rank);
+    // compact the rows
+    std::vector<GraphElem> offset(degree);
+    std::partial_sum(offset.begin(), offset.end(), offset.begin());
 
-            // check for duplicates prior to edgeList insertion
-            auto found = std::find_if(edgeList.begin(), edgeList.end(), 
-                    [&](EdgeTuple const& et) 
-                    { return ((et.ij_[0] == i) && (et.ij_[1] == g_j)); });
+    for (GraphElem i = 0; i < n; i++)
+        std::copy(edgeList.begin() + rowStart[i], edgeList.begin() + rowStart[i] + degree[i+1], 
+                edgeList.begin() + offset[i]);
+
+    edgeList.resize(offset[n]);
+    degree.swap(offset);
+} // buildGeneratedRows
+
+// create an R-MAT (Graph500-like) graph of nv vertices and 
+// edgeFactor*nv edges (before removing duplicates and self-loops):
+// an edge recursively picks a quadrant of the adjacency matrix of 
+// the next power of 2 (and is drawn again if out of [0, nv)), then 
+// the vertices are permuted, so their degrees are not ordered;
+// every process draws its share of the edges (both directions), 
+// which are sent to the owners of their sources, duplicates are
+// merged and weighted with their multiplicity
+DistGraph* generateRMAT(int rank, int nprocs, GraphElem nv, GraphElem edgeFactor, 
+        std::string fileOut, bool compressOut)
+{
+    PartRanges party(nprocs+1);
+    for (int i = 0; i < nprocs + 1; i++)
+        party[i] = ((nv * i) / nprocs);  
 
-            // OK to insert, not in list
-            if (found == std::end(edgeList)) { 
+    const GraphElem base = party[rank];
+    const GraphElem n = party[rank+1] - party[rank];
 
-                // calculate weight
-                // TODO FIXME when target isn't myself or
-                // my neighbors then edge weight is random
-                // (it's not purely RGG at this point anyway)
-                if (target == rank) {
-                    GraphWeight dx = X[i] - X[j];
-                    GraphWeight dy = Y[i] - Y[j];
-                    weight = sqrt(dx*dx + dy*dy);
-                }
-                else if (target == up) {
-                    GraphWeight dx = X[i] - X_up[j];
-                    GraphWeight dy = Y[i] - Y_up[j];
-                    weight = sqrt(dx*dx + dy*dy);
-                }
-                else if (target == down) {
-                    GraphWeight dx = X[i] - X_down[j];
-                    GraphWeight dy = Y[i] - Y_down[j];
-                    weight = sqrt(dx*dx + dy*dy);
-                }
-                else {
-                    unsigned randw_seed = reh((GraphElem)(g_i*nv+g_j));
-                    std::default_random_engine rew(randw_seed); 
-                    weight = (GraphWeight)IJW(rew, std::uniform_real_distribution<GraphWeight>::param_type{0.01, 1.0});
+    DistGraph* dg = new DistGraph(nv, 0);
+    dg->createLocalGraph(n, 0, &party);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double st = MPI_Wtime();
+
+    const int bits = genBits(nv);
+    const GraphElem ne = edgeFactor * nv;
+    const GraphElem klo = (ne * rank) / nprocs, khi = (ne * (rank + 1)) / nprocs;
+    const int nthreads = omp_get_max_threads();
+    std::vector<std::vector<EdgeTuple>> tedges(nthreads);
+
+#pragma omp parallel
+    {
+        std::vector<EdgeTuple> &myEdges = tedges[omp_get_thread_num()];
+
+#pragma omp for schedule(static)
+        for (GraphElem k = klo; k < khi; k++) {
+            for (uint64_t attempt = 0; attempt < 64; attempt++) {
+                GraphElem u = 0, v = 0;
+
+                for (int l = 0; l < bits; l++) {
+                    const GraphWeight r = genUniform(RMAT_SEED, ((uint64_t)k << 12) | (attempt << 6) | l);
+                    const int row = (r >= (RMAT_A + RMAT_B)), col = (r >= RMAT_A && r < (RMAT_A + RMAT_B)) 
+                        || (r >= (RMAT_A + RMAT_B + RMAT_C));
+                    u = (u << 1) | row;
+                    v = (v << 1) | col;
                 }
 
-                rand_edges[target].emplace_back(j, g_i, weight);
-                sendrand_sizes[target]++;
+                if (u >= nv || v >= nv)
+                    continue;
 
-#if defined(PRINT_EXTRA_NEDGES)
-                extraEdges++;
-#endif
-#if defined(CHECK_NUM_EDGES)
-                numEdges++;
-#endif                       
-                edgeList.emplace_back(i, g_j, weight);
-                g.edgeListIndexes[i+1]++;
-                if (!fileOut.empty())
-                    edgeCount[g_i+1]++;
+                u = genPermute(u, nv, bits, RMAT_SEED);
+                v = genPermute(v, nv, bits, RMAT_SEED);
+
+                if (u != v) {
+                    myEdges.emplace_back(u, v, 1.0);
+                    myEdges.emplace_back(v, u, 1.0);
+                }
+                break;
             }
         }
+    }
 
-#if defined(PRINT_EXTRA_NEDGES)
-        int totExtraEdges = 0;
-        MPI_Reduce(&extraEdges, &totExtraEdges, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
-        if (rank == 0)
-            std::cout << "Adding extra " << totExtraEdges << " edges while trying to incorporate " 
-                << randomEdgePercent << "%" << " extra edges globally." << std::endl;
-#endif
+    std::vector<EdgeTuple> redges, edgeList;
+    std::vector<GraphElem> degree;
 
-        MPI_Barrier(MPI_COMM_WORLD);
+    exchangeGeneratedEdges(nprocs, party, tedges, redges);
+    buildGeneratedRows(base, n, redges, edgeList, degree);
 
-        // communicate ghosts edges
-        MPI_Request rande_sreq;
+    const GraphElem tot_nedges = setGeneratedEdges(dg, edgeList, degree);
 
-        MPI_Ialltoall(sendrand_sizes.data(), 1, MPI_INT, 
-                recvrand_sizes.data(), 1, MPI_INT, 
-                MPI_COMM_WORLD, &rande_sreq);
+    double et = MPI_Wtime();
+    double tt = et - st;
+    double max_tt = 0.0;
+    MPI_Reduce(&tt, &max_tt, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
 
-        // send data if outgoing size > 0
-        for (int p = 0; p < nprocs; p++) {
-            sendrand_edges.insert(sendrand_edges.end(), 
-                    rand_edges[p].begin(), rand_edges[p].end());
-        }
+    if (rank == 0)
+        std::cout << "Time to generate the R-MAT graph with " << tot_nedges 
+            << " edges (in s): " << max_tt << std::endl;
 
-        MPI_Wait(&rande_sreq, MPI_STATUS_IGNORE);
+    if (!fileOut.empty())
+        writeGeneratedGraph(rank, nprocs, dg, degree, fileOut, compressOut);
 
-        // total recvbuffer size
-        const int rcount = std::accumulate(recvrand_sizes.begin(), recvrand_sizes.end(), 0);
-        recvrand_edges.resize(rcount);
+    return dg;
+} // generateRMAT
 
-        // alltoallv for incoming data
-        // TODO FIXME make sure size of extra edges is 
-        // within INT limits
+// power-law sample in [a, b] with exponent gamma (inverse CDF)
+static inline GraphWeight genPowerLaw(const GraphWeight a, const GraphWeight b, 
+        const GraphWeight gamma, const GraphWeight u)
+{
+    if (gamma == 1.0)
+        return a * pow(b / a, u);
+
+    const GraphWeight ea = pow(a, 1.0 - gamma), eb = pow(b, 1.0 - gamma);
+    return pow(ea + u * (eb - ea), 1.0 / (1.0 - gamma));
+} // genPowerLaw
+
+// create a graph with planted communities (LFR-like): the vertices
+// [(nv*p)/nprocs, (nv*(p+1))/nprocs) of a process are split in 
+// communities (of power-law sizes), a vertex draws a power-law degree
+// and half of its edges, a fraction mu of them to random vertices 
+// outside of its community and the others to random members, and 
+// then the vertices are permuted, so the communities are spread over
+// the processes; groundTruth gets the communities of my vertices
+DistGraph* generatePlanted(int rank, int nprocs, GraphElem nv, GraphWeight avgDegree, 
+        GraphWeight mixing, std::vector<GraphElem> &groundTruth, std::string fileOut, 
+        bool compressOut)
+{
+    PartRanges party(nprocs+1);
+    for (int i = 0; i < nprocs + 1; i++)
+        party[i] = ((nv * i) / nprocs);  
 
-        int rpos = 0, spos = 0;
-        std::vector<int> sdispls(nprocs), rdispls(nprocs);
+    const GraphElem base = party[rank];
+    const GraphElem n = party[rank+1] - party[rank];
 
-        for (int p = 0; p < nprocs; p++) {
+    DistGraph* dg = new DistGraph(nv, 0);
+    dg->createLocalGraph(n, 0, &party);
 
-            sendrand_sizes[p] *= sizeof(struct EdgeTuple);
-            recvrand_sizes[p] *= sizeof(struct EdgeTuple);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double st = MPI_Wtime();
 
-            sdispls[p] = spos;
-            rdispls[p] = rpos;
+    const int bits = genBits(nv);
+    const GraphWeight kmin = std::max(1.0, avgDegree / 2.0), kmax = 4.0 * avgDegree;
+    const GraphWeight cmin = kmax, cmax = 8.0 * kmax;
 
-            spos += sendrand_sizes[p];
-            rpos += recvrand_sizes[p];
+    // my communities (before the permutation), the 
+    // last one takes a remainder smaller than cmin
+    std::vector<GraphElem> cstart(1, base);
+
+    while (cstart.back() < (base + n)) {
+        const GraphElem size = (GraphElem)genPowerLaw(cmin, cmax, 1.0, 
+                genUniform(PLANTED_SEED, 2*cstart.back()));
+        if ((base + n - cstart.back() - size) < cmin) {
+            cstart.push_back(base + n);
+            break;
         }
+        cstart.push_back(cstart.back() + size);
+    }
 
-        MPI_Alltoallv(sendrand_edges.data(), sendrand_sizes.data(), sdispls.data(), 
-                MPI_BYTE, recvrand_edges.data(), recvrand_sizes.data(), rdispls.data(), 
-                MPI_BYTE, MPI_COMM_WORLD);
+    GraphElem ncomm = cstart.size() - 1, cbase = 0;
+    MPI_Exscan(&ncomm, &cbase, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0)
+        cbase = 0;
 
-        // update local edge list
-        for (int i = 0; i < rcount; i++) {
-#if defined(CHECK_NUM_EDGES)
-            numEdges++;
-#endif
-            edgeList.emplace_back(recvrand_edges[i].ij_[0], recvrand_edges[i].ij_[1], recvrand_edges[i].w_);
-            g.edgeListIndexes[recvrand_edges[i].ij_[0]+1]++;
-            if (!fileOut.empty())
-                edgeCount[dg->localToGlobal(recvrand_edges[i].ij_[0], rank)+1]++;
+    const int nthreads = omp_get_max_threads();
+    std::vector<std::vector<EdgeTuple>> tedges(nthreads), tcomm(nthreads);
+
+#pragma omp parallel
+    {
+        std::vector<EdgeTuple> &myEdges = tedges[omp_get_thread_num()];
+        std::vector<EdgeTuple> &myComm = tcomm[omp_get_thread_num()];
+
+#pragma omp for schedule(static)
+        for (GraphElem c = 0; c < ncomm; c++) {
+            const GraphElem cs = cstart[c], ce = cstart[c+1];
+
+            for (GraphElem u = cs; u < ce; u++) {
+                const GraphElem v = genPermute(u, nv, bits, PLANTED_SEED);
+                const GraphWeight d = genPowerLaw(kmin, kmax, 2.0, genUniform(PLANTED_SEED, 2*u + 1));
+                
+                myComm.emplace_back(v, cbase + c, 0.0);
+
+                // half of the edges, rounded at random
+                const GraphWeight half = d / 2.0;
+                const GraphElem nedges = (GraphElem)half 
+                    + (genUniform(PLANTED_SEED ^ 1, u) < (half - (GraphElem)half));
+
+                for (GraphElem e = 0; e < nedges; e++) {
+                    // the stream of edge e of u, the retries of a draw 
+                    // are numbered apart, so they do not reuse the 
+                    // draws of another edge
+                    const uint64_t key = genHash(u) ^ (uint64_t)e;
+                    const bool outside = (genUniform(PLANTED_SEED ^ 2, key) < mixing) || ((ce - cs) < 2);
+                    uint64_t attempt = 0;
+                    GraphElem w;
+
+                    if (outside) {
+                        if ((ce - cs) == nv)
+                            continue;
+                        do {
+                            w = (GraphElem)(genHash(PLANTED_SEED ^ 3 ^ genHash(genHash(key) ^ attempt++)) 
+                                    % (uint64_t)nv);
+                        } while (w >= cs && w < ce);
+                    }
+                    else {
+                        do {
+                            w = cs + (GraphElem)(genHash(PLANTED_SEED ^ 4 ^ genHash(genHash(key) ^ attempt++)) 
+                                    % (uint64_t)(ce - cs));
+                        } while (w == u);
+                    }
+
+                    w = genPermute(w, nv, bits, PLANTED_SEED);
+                    myEdges.emplace_back(v, w, 1.0);
+                    myEdges.emplace_back(w, v, 1.0);
+                }
+            }
         }
+    }
 
-        sendrand_edges.clear();
-        recvrand_edges.clear();
-        rand_edges.clear();
-    } // end of (conditional) random edges addition
-   
-    MPI_Barrier(MPI_COMM_WORLD);
- 
-    // set graph edge indices and prepare
-    // graph data structure
+    std::vector<EdgeTuple> redges, edgeList;
+    std::vector<GraphElem> degree;
 
-    std::vector<GraphElem> ecTmp(n+1);
-    std::partial_sum(g.edgeListIndexes.begin(), g.edgeListIndexes.end(), ecTmp.begin());
-    g.edgeListIndexes = ecTmp;
+    exchangeGeneratedEdges(nprocs, party, tedges, redges);
+    buildGeneratedRows(base, n, redges, edgeList, degree);
 
-    for(GraphElem i = 1; i < n+1; i++)
-        g.edgeListIndexes[i] -= g.edgeListIndexes[0];   
-    g.edgeListIndexes[0] = 0;
+    const GraphElem tot_nedges = setGeneratedEdges(dg, edgeList, degree);
 
-    g.setEdgeStartForVertex(0, 0);
-    for (GraphElem i = 0; i < n; i++)
-        g.setEdgeStartForVertex(i+1, g.edgeListIndexes[i+1]);
+    // the communities of the (permuted) vertices to their owners
+    exchangeGeneratedEdges(nprocs, party, tcomm, redges);
 
-    const GraphElem nedges = g.edgeListIndexes[n] - g.edgeListIndexes[0];
-    g.setNumEdges(nedges);
+    groundTruth.assign(n, -1);
+    for (const EdgeTuple &e : redges)
+        groundTruth[e.ij_[0] - base] = e.ij_[1];
 
-    // set graph edge list
-    // sort edge list
-    auto ecmp = [] (EdgeTuple const& e0, EdgeTuple const& e1)
-    { return ((e0.ij_[0] < e1.ij_[0]) || ((e0.ij_[0] == e1.ij_[0]) && (e0.ij_[1] < e1.ij_[1]))); };
+    double et = MPI_Wtime();
+    double tt = et - st;
+    double max_tt = 0.0;
+    MPI_Reduce(&tt, &max_tt, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
 
-    if (!std::is_sorted(edgeList.begin(), edgeList.end(), ecmp)) {
-#if defined(DEBUG_PRINTF)
-        std::cout << "Edge list is not sorted." << std::endl;
-#endif
-        std::sort(edgeList.begin(), edgeList.end(), ecmp);
-    }
-#if defined(DEBUG_PRINTF)
-    else
-        std::cout << "Edge list is sorted!" << std::endl;
-#endif
+    GraphElem tot_ncomm = 0;
+    MPI_Reduce(&ncomm, &tot_ncomm, 1, MPI_GRAPH_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
 
-    GraphElem ePos = 0;
-    for (GraphElem i = 0; i < n; i++) {
-        GraphElem e0, e1;
+    if (rank == 0)
+        std::cout << "Time to generate the graph with " << tot_ncomm << " planted communities and " 
+            << tot_nedges << " edges (in s): " << max_tt << std::endl;
 
+    if (!fileOut.empty())
+        writeGeneratedGraph(rank, nprocs, dg, degree, fileOut, compressOut);
+
+    return dg;
+} // generatePlanted
+
+// keep an edge {u, v} of the graph with probability fraction, weighted 
+// by 1/fraction, so the weighted degrees (and the total weight) are 
+// preserved in expectation; the draw is a hash of the two endpoints, 
+// so both directions are kept by their owners without communication,
+// and self loops are always kept (as is) 
+DistGraph* sampleDistGraph(int rank, int nprocs, const DistGraph &dg, GraphWeight fraction)
+{
+    const Graph &g = dg.getLocalGraph();
+    const GraphElem n = g.getNumVertices();
+    const GraphElem base = dg.getBase(rank);
+    const GraphWeight scale = 1.0 / fraction;
+
+    double st = MPI_Wtime();
+
+    DistGraph *sg = new DistGraph(dg.getTotalNumVertices(), 0, dg.getComm());
+    sg->createLocalGraph(n, 0, dg.parts);
+
+    std::vector<GraphElem> degree(n + 1, 0);
+
+    auto keep = [&](const GraphElem u, const GraphElem v) -> bool {
+        if (u == v)
+            return true;
+        const uint64_t lo = std::min(u, v), hi = std::max(u, v);
+        return genUniform(SAMPLE_SEED ^ genHash(lo), hi) < fraction;
+    };
+
+#pragma omp parallel for schedule(guided)
+    for (GraphElem i = 0; i < n; i++) {
+        GraphElem e0, e1, kept = 0;
         g.getEdgeRangeForVertex(i, e0, e1);
+        for (GraphElem e = e0; e < e1; e++) {
+            if (keep(base + i, g.getEdge(e).tail))
+                kept++;
+        }
+        degree[i+1] = kept;
+    }
 
-#if defined(DEBUG_PRINTF)
-        if ((i % 100000) == 0)
-            std::cout << "Processing edges for vertex: " << i << ", range(" << e0 << ", " << e1 <<
-                ")" << std::endl;
-#endif
-        for (GraphElem j = e0; j < e1; j++) {
-            Edge &edge = g.getEdge(j);
+    for (GraphElem i = 0; i < n; i++)
+        degree[i+1] += degree[i];
 
-            assert(ePos == j);
-            assert(i == edgeList[ePos].ij_[0]);
+    Graph &sgl = sg->getLocalGraph();
+    const GraphElem nedges = degree[n];
+    sgl.setNumEdges(nedges);
 
-            edge.tail = edgeList[ePos].ij_[1];
-            edge.weight = edgeList[ePos].w_;
+    for (GraphElem i = 0; i < n + 1; i++)
+        sgl.setEdgeStartForVertex(i, degree[i]);
 
-            ePos++;
+#pragma omp parallel for schedule(guided)
+    for (GraphElem i = 0; i < n; i++) {
+        GraphElem e0, e1, pos = degree[i];
+        g.getEdgeRangeForVertex(i, e0, e1);
+        for (GraphElem e = e0; e < e1; e++) {
+            const Edge &edge = g.getEdge(e);
+            if (keep(base + i, edge.tail)) 
+                sgl.setEdge(pos++, edge.tail, (edge.tail == base + i) ? edge.weight 
+                        : edge.weight * scale);
         }
     }
 
-#if defined(CHECK_NUM_EDGES)
-    GraphElem tot_numEdges = 0;
-    MPI_Allreduce(&numEdges, &tot_numEdges, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
-    const GraphElem tne = dg->getTotalNumEdges();
-    assert(tne == tot_numEdges);
-#endif
+    GraphElem tot_nedges = 0;
+    MPI_Allreduce(&nedges, &tot_nedges, 1, MPI_GRAPH_TYPE, MPI_SUM, dg.getComm());
+    sg->setNumEdges(tot_nedges);
+
+    double tt = MPI_Wtime() - st;
+    double max_tt = 0.0;
+    MPI_Reduce(&tt, &max_tt, 1, MPI_DOUBLE, MPI_MAX, 0, dg.getComm());
+
+    if (rank == 0)
+        std::cout << "Time to sample " << tot_nedges << " of " << dg.getTotalNumEdges() 
+            << " edges (in s): " << max_tt << std::endl;
+
+    return sg;
+} // sampleDistGraph
+
+static void writeFileRange(MPI_File fh, MPI_Offset offset, const void *buf, uint64_t tot_bytes)
+{
+    MPI_Status status;
+    uint8_t *curr_pointer = (uint8_t*)buf;
     
-    // write file
-    if (!fileOut.empty()) {
-        writeGraph(rank, nprocs, dg, edgeCount, fileOut);
-        if (rank == 0)
-            std::cout << "Written binary file: " << fileOut << std::endl;
-    } 
+    while (tot_bytes > 0) {
+        const int chunk_bytes = (tot_bytes < INT_MAX) ? tot_bytes : INT_MAX;
+        MPI_File_write_at(fh, offset, curr_pointer, chunk_bytes, MPI_BYTE, &status);
+        tot_bytes -= chunk_bytes;
+        offset += chunk_bytes;
+        curr_pointer += chunk_bytes;
+    }
+} // writeFileRange
+
+// write graph in the compressed binary format (see compress.hpp), 
+// every process compresses its vertices into its own chunks
+static void writeGraphCompressed(int me, int nprocs, DistGraph *&dg, std::string &fileName)
+{
+    MPI_File fh;
+    const Graph &g = dg->getLocalGraph(); 
+    std::vector<CompressedGraphChunk> chunks;
+    std::vector<ByteBuffer> blocks;
 
-    edgeList.clear();
+    int weighted = !hasUnitEdgeWeights(g);
+    MPI_Allreduce(MPI_IN_PLACE, &weighted, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
 
-    X.clear();
-    Y.clear();
-    X_up.clear();
-    Y_up.clear();
-    X_down.clear();
-    Y_down.clear();
+    compressGraphChunks(g, dg->getBase(me), weighted, COMPRESSED_CHUNK_VERTICES, chunks, blocks);
 
-    sendup_edges.clear();
-    senddn_edges.clear();
-    recvup_edges.clear();
-    recvdn_edges.clear();
+    // {#chunks, #edges, #bytes} of the processes before this one
+    uint64_t counts[3] = {chunks.size(), (uint64_t)g.getNumEdges(), 0}, bases[3] = {0, 0, 0};
+    for (size_t c = 0; c < blocks.size(); c++)
+        counts[2] += blocks[c].size();
 
-    return dg;
-}
+    MPI_Exscan(counts, bases, 3, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (me == 0)
+        bases[0] = bases[1] = bases[2] = 0;
+
+    CompressedGraphHeader header;
+    uint64_t totals[3];
+    MPI_Allreduce(counts, totals, 3, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    header.magic = COMPRESSED_GRAPH_MAGIC;
+    header.version = COMPRESSED_GRAPH_VERSION;
+    header.elemBytes = sizeof(GraphElem);
+    header.weightBytes = sizeof(GraphWeight);
+    header.flags = (weighted ? COMPRESSED_GRAPH_WEIGHTED : 0);
+    header.nv = dg->getTotalNumVertices();
+    header.ne = totals[1];
+    header.nchunks = totals[0];
+
+    const uint64_t dataBase = sizeof(CompressedGraphHeader) 
+        + (header.nchunks + 1)*sizeof(CompressedGraphChunk);
+    uint64_t offset = dataBase + bases[2];
+
+    ByteBuffer data(counts[2]);
+    for (size_t c = 0; c < chunks.size(); c++) {
+        std::copy(blocks[c].begin(), blocks[c].end(), data.begin() + (offset - dataBase - bases[2]));
+        chunks[c].edge += bases[1];
+        chunks[c].offset = offset;
+        offset += blocks[c].size();
+        ByteBuffer().swap(blocks[c]);
+    }
+
+    // the index is assembled on the root
+    const int chunkBytes = chunks.size()*sizeof(CompressedGraphChunk);
+    std::vector<int> rcounts(nprocs), rdispls(nprocs, 0);
+    std::vector<CompressedGraphChunk> index(me == 0 ? (header.nchunks + 1) : 0);
+
+    MPI_Gather(&chunkBytes, 1, MPI_INT, rcounts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    for (int p = 1; p < nprocs; p++)
+        rdispls[p] = rdispls[p-1] + rcounts[p-1];
+    MPI_Gatherv(chunks.data(), chunkBytes, MPI_BYTE, index.data(), rcounts.data(), 
+            rdispls.data(), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    int file_open_error = MPI_File_open(MPI_COMM_WORLD, fileName.c_str(), 
+          MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh); 
+
+    if (file_open_error != MPI_SUCCESS) {
+        std::cout<< " Error opening output binary file for storing graph data! " << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    MPI_File_set_size(fh, dataBase + totals[2]);
+
+    if (me == 0) {
+        const CompressedGraphChunk sentinel = {header.nv, header.ne, dataBase + totals[2], 0, 0};
+        index.back() = sentinel;
+        header.checksum = checksumBytes(reinterpret_cast<const uint8_t*>(index.data()), 
+                index.size()*sizeof(CompressedGraphChunk));
+
+        writeFileRange(fh, 0, &header, sizeof(CompressedGraphHeader));
+        writeFileRange(fh, sizeof(CompressedGraphHeader), index.data(), 
+                index.size()*sizeof(CompressedGraphChunk));
+    }
 
-// write graph in CSR binary format
-void writeGraph(int me, int nprocs, DistGraph *&dg, std::vector<GraphElem>& edgeCount, std::string &fileName)
+    writeFileRange(fh, dataBase + bases[2], data.data(), data.size());
+
+    MPI_File_close(&fh);
+} // writeGraphCompressed
+
+// write graph in CSR binary format (or the compressed format)
+void writeGraph(int me, int nprocs, DistGraph *&dg, std::vector<GraphElem>& edgeCount, 
+        std::string &fileName, bool compressed)
 {
+    if (compressed) {
+        writeGraphCompressed(me, nprocs, dg, fileName);
+        return;
+    }
+
     MPI_File fh;
     MPI_Status status;
     GraphElem globalNumEdges = 0, globalNumVertices = dg->getTotalNumVertices();
     
     Graph &g = dg->getLocalGraph(); 
-    GraphElem my_nedges = g.edgeList.size();     
+    GraphElem my_nedges = g.getNumEdges();     
     MPI_Allreduce(&my_nedges, &globalNumEdges, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
     MPI_Allreduce(MPI_IN_PLACE, edgeCount.data(), globalNumVertices+1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
     std::vector<GraphElem> ecTmp(globalNumVertices+1);
@@ -1034,13 +1906,18 @@ void writeGraph(int me, int nprocs, DistGraph *&dg, std::vector<GraphElem>& edge
     
     MPI_Barrier(MPI_COMM_WORLD);
      
-    GraphElem hi_idx = ((globalNumVertices * (me + 1)) / nprocs);
-    GraphElem lo_idx = ((globalNumVertices * me) / nprocs);
+    // the vertex range of the process (the rebuilt graphs are not 
+    // always split evenly)
+    GraphElem hi_idx = dg->getBound(me);
+    GraphElem lo_idx = dg->getBase(me);
 
     GraphElem localNumEdges = ecTmp[hi_idx]-ecTmp[lo_idx];
     uint64_t tot_bytes=localNumEdges*(sizeof(Edge));
     MPI_Offset offset = 2*sizeof(GraphElem) + (globalNumVertices+1)*sizeof(GraphElem) + ecTmp[lo_idx]*(sizeof(Edge));
 
+#if defined(USE_SOA_EDGE_LIST)
+    writeEdgeRecords(fh, offset, g);
+#else
     if (tot_bytes<INT_MAX)
         MPI_File_write_at(fh, offset, &g.edgeList[0], tot_bytes, MPI_BYTE, &status);
     else {
@@ -1058,7 +1935,8 @@ void writeGraph(int me, int nprocs, DistGraph *&dg, std::vector<GraphElem>& edge
             if (tot_bytes-transf_bytes<INT_MAX)
                 chunk_bytes=tot_bytes-transf_bytes;
         } 
-    }    
+    }
+#endif    
 
     MPI_File_close(&fh);
 }
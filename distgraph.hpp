@@ -63,14 +63,32 @@
 // miniVite
 
 #define PI                          (3.14159)
-#define SR_UP_TAG                   100
-#define SR_DOWN_TAG                 101
-#define SR_SIZES_UP_TAG             102
-#define SR_SIZES_DOWN_TAG           103
-#define SR_X_UP_TAG                 104
-#define SR_X_DOWN_TAG               105
-#define SR_Y_UP_TAG                 106
-#define SR_Y_DOWN_TAG               107
+
+// seeds of the coordinates and of the random edges of the RGG
+#define RGG_SEED                    (1741)
+#define RGG_RANDOM_EDGE_SEED        (3821)
+
+// R-MAT probabilities of the quadrants (Graph500), d = 1 - a - b - c
+#define RMAT_A                      (0.57)
+#define RMAT_B                      (0.19)
+#define RMAT_C                      (0.19)
+#define RMAT_SEED                   (2287)
+#define RMAT_EDGE_FACTOR            (16)
+
+// the planted-community (LFR-like) graph: power-law degrees (exponent 2)
+// in [k/2, 4k] for an average degree k, and community sizes (exponent 1)
+// in [4k, 8*4k], a fraction mu of the edges of a vertex leave its community
+#define PLANTED_SEED                (4099)
+#define PLANTED_AVG_DEGREE          (16)
+#define PLANTED_MIXING              (0.3)
+
+// seed of the edges kept by the sampled first phase
+#define SAMPLE_SEED                 (5113)
+
+// max #generated edges per process in an alltoallv
+#define GENERATED_EDGE_BATCH        (1 << 24)
+
+enum GeneratorType {RGG_GENERATOR, RMAT_GENERATOR, PLANTED_GENERATOR};
 
 typedef std::vector<GraphElem> PartRanges;
 
@@ -79,14 +97,18 @@ protected:
   GraphElem totalNumVertices;
   GraphElem totalNumEdges;
   Graph *localGraph;
+  // the processes of the graph, the parts are indexed by rank in comm
+  MPI_Comm comm;
 
 public:
-  DistGraph(const GraphElem tnv, const GraphElem tne);
+  DistGraph(const GraphElem tnv, const GraphElem tne, MPI_Comm comm_ = MPI_COMM_WORLD);
   DistGraph(const DistGraph &othis);
   ~DistGraph();
 
   GraphElem getTotalNumVertices() const;
   GraphElem getTotalNumEdges() const;
+  MPI_Comm getComm() const;
+  void setComm(MPI_Comm comm_);
 
   void createLocalGraph(const GraphElem lnv, const GraphElem lne,
 			const PartRanges *oparts = NULL);
@@ -106,31 +128,46 @@ protected:
   DistGraph &operator = (const DistGraph &othis);
 };
 
-void balanceEdges(int nprocs, std::string& fileName, std::vector<GraphElem>& mbins);
+void balanceEdges(int me, int nprocs, int ranks_per_node, std::string& fileName, 
+        std::vector<GraphElem>& mbins, const GraphWeight vertexCost = 0);
 void loadDistGraphMPIIO(int me, int nprocs, int ranks_per_node, 
         DistGraph *&dg, std::string& fileName);
 void loadDistGraphMPIIOBalanced(int me, int nprocs, int ranks_per_node, 
-        DistGraph *&dg, std::string& fileName);
+        DistGraph *&dg, std::string& fileName, const GraphWeight vertexCost = 0);
+void loadDistGraphMmap(int me, int nprocs, int ranks_per_node, DistGraph *&dg, 
+        std::string &fileName, int advice, bool balanced, const GraphWeight vertexCost = 0);
+bool isCompressedGraphFile(int me, std::string &fileName);
+void loadDistGraphCompressed(int me, int nprocs, int ranks_per_node, DistGraph *&dg, 
+        std::string &fileName, bool balanced, const GraphWeight vertexCost = 0);
 
 // graph generation
-void generateInMemGraph(int rank, int nprocs, DistGraph *&dg, GraphElem nv, GraphWeight randomEdgePercent, std::string fileOut);
-DistGraph* generateRGG(int rank, int nprocs, GraphElem nv, GraphWeight rn, GraphWeight randomEdgePercent, std::string fileOut);
+void generateInMemGraph(int rank, int nprocs, DistGraph *&dg, GraphElem nv, GraphWeight randomEdgePercent, std::string fileOut, bool compressOut = false,
+        int genType = RGG_GENERATOR, const std::vector<GraphWeight> &genArgs = std::vector<GraphWeight>(), 
+        std::vector<GraphElem> *groundTruth = NULL);
+DistGraph* generateRGG(int rank, int nprocs, GraphElem nv, GraphWeight rn, GraphWeight randomEdgePercent, std::string fileOut, bool compressOut = false);
+DistGraph* generateRMAT(int rank, int nprocs, GraphElem nv, GraphElem edgeFactor, std::string fileOut, bool compressOut = false);
+DistGraph* generatePlanted(int rank, int nprocs, GraphElem nv, GraphWeight avgDegree, GraphWeight mixing, 
+        std::vector<GraphElem> &groundTruth, std::string fileOut, bool compressOut = false);
+
+// a sparsified copy of the graph for the first phase
+DistGraph* sampleDistGraph(int rank, int nprocs, const DistGraph &dg, GraphWeight fraction);
 
-void writeGraph(int me, int nprocs, DistGraph *&dg, std::vector<GraphElem>& edgeCount, std::string &fileName);
+void writeGraph(int me, int nprocs, DistGraph *&dg, std::vector<GraphElem>& edgeCount, std::string &fileName, 
+        bool compressed = false);
 
 inline DistGraph::DistGraph()
-  : totalNumVertices(0), totalNumEdges(0), localGraph(NULL), parts(NULL)
+  : totalNumVertices(0), totalNumEdges(0), localGraph(NULL), comm(MPI_COMM_WORLD), parts(NULL)
 {
 } // DistGraph
 
-inline DistGraph::DistGraph(const GraphElem tnv, const GraphElem tne)
-  : totalNumVertices(tnv), totalNumEdges(tne), localGraph(NULL), parts(NULL)
+inline DistGraph::DistGraph(const GraphElem tnv, const GraphElem tne, MPI_Comm comm_)
+  : totalNumVertices(tnv), totalNumEdges(tne), localGraph(NULL), comm(comm_), parts(NULL)
 {
 } // DistGraph
 
 inline DistGraph::DistGraph(const DistGraph &othis)
   : totalNumVertices(othis.totalNumVertices), totalNumEdges(othis.totalNumEdges),
-    localGraph(new Graph(*othis.localGraph)), parts(NULL)
+    localGraph(new Graph(*othis.localGraph)), comm(othis.comm), parts(NULL)
 { parts = new PartRanges(*othis.parts); } // DistGraph
 
 inline DistGraph::~DistGraph()
@@ -146,12 +183,19 @@ inline GraphElem DistGraph::getTotalNumVertices() const
 inline GraphElem DistGraph::getTotalNumEdges() const
 { return totalNumEdges; } // getTotalNumEdges
 
+inline MPI_Comm DistGraph::getComm() const
+{ return comm; } // getComm
+
+// the graph is used on another communicator (with the same ranks)
+inline void DistGraph::setComm(MPI_Comm comm_)
+{ comm = comm_; } // setComm
+
 // print statistics about edge distribution
 inline void DistGraph::printStats()
 {
     int me, size;
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-    MPI_Comm_rank(MPI_COMM_WORLD, &me);
+    MPI_Comm_size(comm, &size);
+    MPI_Comm_rank(comm, &me);
 
     Graph &g = this->getLocalGraph(); // local graph 
     long lne = (long)g.getNumEdges(); // local #edges
@@ -160,23 +204,23 @@ inline void DistGraph::printStats()
     // number of edges and not total, keep a separate variable
     //const GraphElem ne = this->getTotalNumEdges(); // global #edges
     long ne = 0;
-    MPI_Allreduce(&lne, &ne, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&lne, &ne, 1, MPI_LONG, MPI_SUM, comm);
 
     long sumdeg = 0, maxdeg = 0, mindeg = 0;
-    MPI_Reduce(&lne, &sumdeg, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&lne, &maxdeg, 1, MPI_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&lne, &mindeg, 1, MPI_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&lne, &sumdeg, 1, MPI_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(&lne, &maxdeg, 1, MPI_LONG, MPI_MAX, 0, comm);
+    MPI_Reduce(&lne, &mindeg, 1, MPI_LONG, MPI_MIN, 0, comm);
 
     long my_sq = lne*lne;
     long sum_sq = 0;
-    MPI_Reduce(&my_sq, &sum_sq, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&my_sq, &sum_sq, 1, MPI_LONG, MPI_SUM, 0, comm);
 
     double average  = (double) sumdeg / size;
     double avg_sq   = (double) sum_sq / size;
     double var      = avg_sq - (average*average);
     double stddev   = sqrt(var);
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Barrier(comm);
 
     if (me == 0)
     {
@@ -277,11 +321,65 @@ inline GraphElem DistGraph::getNumGhosts(const int me) const
   for (GraphElem i = 0; i < g.getNumVertices(); i++) {
     const GraphElem lb = g.edgeListIndexes[i], ub = g.edgeListIndexes[i + 1];
     for (GraphElem j = lb; j < ub; j++) {
-      const Edge &edge = g.getEdge(j);
-      if (this->getOwner(edge.tail) != me)
+      if (this->getOwner(g.getEdgeTail(j)) != me)
           numGhosts += 1;
     }
   }
   return numGhosts;
 } // return number of ghost vertices
+
+// send the sorted (distinct) ids to the processes of their ranges (the
+// ids of process p are in [bases[p], bases[p+1])), which reply with 
+// value(id); prepare is first called with all the received ids
+template<typename Prepare, typename Value>
+inline void queryRanges(int me, int nprocs, const std::vector<GraphElem> &bases, 
+        const std::vector<GraphElem> &ids, std::vector<GraphElem> &replies, 
+        Prepare prepare, Value value, MPI_Comm comm = MPI_COMM_WORLD)
+{
+    std::vector<int> scounts(nprocs), rcounts(nprocs), sdispls(nprocs+1), rdispls(nprocs+1, 0);
+
+    for (int p = 0; p < nprocs; p++)
+        sdispls[p] = std::lower_bound(ids.begin(), ids.end(), bases[p]) - ids.begin();
+    sdispls[nprocs] = ids.size();
+    
+    for (int p = 0; p < nprocs; p++)
+        scounts[p] = sdispls[p+1] - sdispls[p];
+
+    MPI_Alltoall(scounts.data(), 1, MPI_INT, rcounts.data(), 1, MPI_INT, comm);
+
+    for (int p = 0; p < nprocs; p++)
+        rdispls[p+1] = rdispls[p] + rcounts[p];
+
+    std::vector<GraphElem> requests(rdispls[nprocs]), answers(rdispls[nprocs]);
+    
+    MPI_Alltoallv(ids.data(), scounts.data(), sdispls.data(), MPI_GRAPH_TYPE, 
+            requests.data(), rcounts.data(), rdispls.data(), MPI_GRAPH_TYPE, comm);
+
+    prepare(requests);
+
+    const GraphElem nreq = requests.size();
+#pragma omp parallel for
+    for (GraphElem k = 0; k < nreq; k++)
+        answers[k] = value(requests[k]);
+
+    replies.resize(ids.size());
+    MPI_Alltoallv(answers.data(), rcounts.data(), rdispls.data(), MPI_GRAPH_TYPE, 
+            replies.data(), scounts.data(), sdispls.data(), MPI_GRAPH_TYPE, comm);
+} // queryRanges
+
+// send the sorted (distinct) vertex ids to their owners, which reply 
+// with value(id); prepare is first called with all the received ids
+template<typename Prepare, typename Value>
+inline void queryOwners(int me, int nprocs, const DistGraph &dg, 
+        const std::vector<GraphElem> &ids, std::vector<GraphElem> &replies, 
+        Prepare prepare, Value value)
+{
+    std::vector<GraphElem> bases(nprocs);
+
+    for (int p = 0; p < nprocs; p++)
+        bases[p] = dg.getBase(p);
+
+    queryRanges(me, nprocs, bases, ids, replies, prepare, value, dg.getComm());
+} // queryOwners
+
 #endif // __DISTGRAPH_H
@@ -57,18 +57,41 @@
 
 #include <mpi.h>
 
+#include "allocator.hpp"
+
 #ifdef USE_32_BIT_GRAPH
 typedef int32_t GraphElem;
-typedef float GraphWeight;
 const MPI_Datatype MPI_GRAPH_TYPE = MPI_INT32_T;
-const MPI_Datatype MPI_WEIGHT_TYPE = MPI_FLOAT;
 #else
 typedef int64_t GraphElem;
-typedef double GraphWeight;
 const MPI_Datatype MPI_GRAPH_TYPE = MPI_INT64_T;
+#endif
+
+// weights follow the vertex id width, unless
+// USE_32_BIT_WEIGHTS asks for float weights
+// with 64-bit vertex ids
+#if defined(USE_32_BIT_GRAPH) || defined(USE_32_BIT_WEIGHTS)
+typedef float GraphWeight;
+const MPI_Datatype MPI_WEIGHT_TYPE = MPI_FLOAT;
+#else
+typedef double GraphWeight;
 const MPI_Datatype MPI_WEIGHT_TYPE = MPI_DOUBLE;
 #endif
 
+// indices that never leave a process: the CSR offsets
+// of the local graph and the ghost-renumbered edge tails
+// (#local vertices + #ghosts); with USE_32_BIT_LOCAL_INDEX
+// these are 32-bit, while global vertex/community ids
+// (GraphElem) stay 64-bit, so the local edges of
+// a process must be within the 32-bit range
+#if defined(USE_32_BIT_LOCAL_INDEX) && !defined(USE_32_BIT_GRAPH)
+typedef int32_t LocalElem;
+const MPI_Datatype MPI_LOCAL_TYPE = MPI_INT32_T;
+#else
+typedef GraphElem LocalElem;
+const MPI_Datatype MPI_LOCAL_TYPE = MPI_GRAPH_TYPE;
+#endif
+
 struct Edge {
   GraphElem tail;
   GraphWeight weight;
@@ -95,7 +118,7 @@ struct EdgeTuple
     {}
 };
 
-typedef std::vector<GraphElem> EdgeIndexes;
+typedef std::vector<LocalElem, DataAllocator<LocalElem> > EdgeIndexes;
 
 inline Edge::Edge()
   : tail(-1), weight(0.0)
@@ -138,7 +138,15 @@ int main(int argc, char *argv[])
   ofs.write(reinterpret_cast<char *>(&nv), sizeof(GraphElem));
   ofs.write(reinterpret_cast<char *>(&ne), sizeof(GraphElem));
 
+#if defined(USE_32_BIT_LOCAL_INDEX)
+  // the file format stores the offsets as GraphElem
+  for (GraphElem v = 0; v <= nv; v++) {
+      const GraphElem idx = g->edgeListIndexes[v];
+      ofs.write(reinterpret_cast<const char *>(&idx), sizeof(GraphElem));
+  }
+#else
   ofs.write(reinterpret_cast<char *>(&g->edgeListIndexes[0]), (nv+1)*sizeof(GraphElem));
+#endif
 
   for (GraphElem v = 0; v < nv; v++) {
       GraphElem e0, e1;
@@ -52,8 +52,11 @@
 #define __GRAPH_H
 
 #include <cassert>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <ostream>
 #include <vector>
 
@@ -67,23 +70,38 @@ struct Comm {
 };
 
 
-#if defined(__CRAY_MIC_KNL) && defined(USE_AUTOHBW_MEMALLOC)
-#include <hbw_allocator.h>
-typedef std::vector<Comm, hbw::allocator<Comm> > CommVector;
-#else
-typedef std::vector<Comm> CommVector;
-#endif
+typedef std::vector<Comm, DataAllocator<Comm> > CommVector;
 
+// By default the edges are stored as an array of {tail, weight}
+// structures; with USE_SOA_EDGE_LIST the tails and weights are kept
+// in separate arrays, so that passes which only need the tails touch
+// half the memory. In that layout, a graph with unit weights may also
+// drop its weights array altogether (see dropUnitEdgeWeights).
+// Use getEdgeTail/getEdgeWeight/setEdge to access the edges
+// independently of the layout.
+// With the AoS layout, the edges may also be a view of a mapped 
+// region of the binary file (see mapEdges), which is unmapped 
+// when the graph is destroyed; edgeList is then empty.
 class Graph {
 protected:
-  typedef std::vector<Edge> EdgeList;
+#if defined(USE_SOA_EDGE_LIST)
+  typedef std::vector<GraphElem, DataAllocator<GraphElem> > EdgeTailList;
+  typedef std::vector<GraphWeight, DataAllocator<GraphWeight> > EdgeWeightList;
+#else
+  typedef std::vector<Edge, DataAllocator<Edge> > EdgeList;
+#endif
 
   GraphElem numVertices;
   GraphElem numEdges;
 
 public:
   EdgeIndexes edgeListIndexes;
+#if defined(USE_SOA_EDGE_LIST)
+  EdgeTailList edgeTails;
+  EdgeWeightList edgeWeights; // empty for an unweighted graph
+#else
   EdgeList edgeList;
+#endif
 
   Graph(const GraphElem onv, const GraphElem one);
   Graph(const Graph &othis);
@@ -94,46 +112,91 @@ public:
   void setEdgeWeightstoOne();
   void setNumEdges(GraphElem numEdges);
   void getEdgeRangeForVertex(const GraphElem vertex, GraphElem &e0, GraphElem &e1) const;
+  GraphElem getEdgeTail(const GraphElem edge) const;
+  GraphWeight getEdgeWeight(const GraphElem edge) const;
+  void setEdge(const GraphElem edge, const GraphElem tail, const GraphWeight weight);
+  bool isWeighted() const;
+  bool dropUnitEdgeWeights();
+#if defined(USE_SOA_EDGE_LIST)
+  Edge getEdge(const GraphElem edge) const;
+#else
   const Edge &getEdge(const GraphElem edge) const;
+  Edge &getEdge(const GraphElem edge);
+#endif
 
   void setEdgeStartForVertex(const GraphElem vertex, const GraphElem e0);
-  Edge &getEdge(const GraphElem edge);
+  void permute(const std::vector<GraphElem> &order, const std::vector<GraphElem> &tails);
+#if !defined(USE_SOA_EDGE_LIST)
+  void mapEdges(void *addr, const size_t length, Edge *first);
+#endif
+  void releaseEdges(const GraphElem e0, const GraphElem e1);
   
   friend std::ostream &operator <<(std::ostream &os, const Graph &g);
 protected:
+#if !defined(USE_SOA_EDGE_LIST)
+  Edge *edges; // edgeList.data(), or the mapped edges
+  void *mappedAddr;
+  size_t mappedLength;
+#endif
+
   Graph();
   Graph &operator = (const Graph &othis);
 };
 
 inline Graph::Graph()
   : numVertices(0), numEdges(0)
+#if !defined(USE_SOA_EDGE_LIST)
+    , edges(NULL), mappedAddr(NULL), mappedLength(0)
+#endif
 {
 } // Graph
 
 inline Graph::Graph(const GraphElem onv, const GraphElem one)
   : numVertices(onv), numEdges(one)
+#if !defined(USE_SOA_EDGE_LIST)
+    , mappedAddr(NULL), mappedLength(0)
+#endif
 {
   edgeListIndexes.resize(numVertices + 1);
+#if defined(USE_SOA_EDGE_LIST)
+  edgeTails.resize(numEdges);
+  edgeWeights.resize(numEdges);
+#else
   edgeList.resize(numEdges);
+  edges = edgeList.data();
+#endif
 
   std::for_each(edgeListIndexes.begin(), edgeListIndexes.end(),
-		[] (GraphElem &idx) { idx = 0; } );
+		[] (LocalElem &idx) { idx = 0; } );
   
 } // Graph
 
 inline Graph::Graph(const Graph &othis)
   : numVertices(othis.numVertices), numEdges(othis.numEdges)
+#if !defined(USE_SOA_EDGE_LIST)
+    , mappedAddr(NULL), mappedLength(0)
+#endif
 {
   edgeListIndexes.resize(numVertices + 1);
-  edgeList.resize(numEdges);
 
   std::copy(othis.edgeListIndexes.begin(), othis.edgeListIndexes.end(),
 	    edgeListIndexes.begin());
-  std::copy(othis.edgeList.begin(), othis.edgeList.end(), edgeList.begin());
+#if defined(USE_SOA_EDGE_LIST)
+  edgeTails = othis.edgeTails;
+  edgeWeights = othis.edgeWeights;
+#else
+  edgeList.resize(numEdges);
+  std::copy(othis.edges, othis.edges + numEdges, edgeList.begin());
+  edges = edgeList.data();
+#endif
 } // Graph
 
 inline Graph::~Graph()
 {
+#if !defined(USE_SOA_EDGE_LIST)
+  if (mappedAddr)
+      munmap(mappedAddr, mappedLength);
+#endif
 } // ~Graph
 
 inline GraphElem Graph::getNumVertices() const
@@ -147,15 +210,59 @@ inline GraphElem Graph::getNumEdges() const
 } // getNumEdges
 
 inline void Graph::setNumEdges(GraphElem numEdges) {
+#if defined(USE_SOA_EDGE_LIST)
+    const bool weighted = (this->numEdges == 0) || !this->edgeWeights.empty();
+    this->edgeTails.resize(numEdges);
+    if (weighted)
+        this->edgeWeights.resize(numEdges);
+#else
     this->edgeList.resize(numEdges);	
+    this->edges = this->edgeList.data();
+#endif
     this->numEdges=numEdges;
 }
 
 inline void Graph::setEdgeWeightstoOne() {
+#if defined(USE_SOA_EDGE_LIST)
+    EdgeWeightList().swap(this->edgeWeights);
+#else
     for (GraphElem i = 0; i < this->numEdges; i++)
-        this->edgeList[i].weight = 1.0;
+        this->edges[i].weight = 1.0;
+#endif
 }
 
+inline bool Graph::isWeighted() const
+{
+#if defined(USE_SOA_EDGE_LIST)
+  return ((numEdges == 0) || !edgeWeights.empty());
+#else
+  return true;
+#endif
+} // isWeighted
+
+// release the weights array if every weight is 1.0, 
+// returns true if the graph has no weights array 
+// afterwards (always false for the AoS layout)
+inline bool Graph::dropUnitEdgeWeights()
+{
+#if defined(USE_SOA_EDGE_LIST)
+  if (!isWeighted())
+      return true;
+
+  bool unit = true;
+#pragma omp parallel for reduction(&&: unit) schedule(static)
+  for (GraphElem i = 0; i < numEdges; i++)
+      unit = unit && (edgeWeights[i] == 1.0);
+
+  if (unit && (numEdges > 0))
+      EdgeWeightList().swap(edgeWeights);
+
+  return (unit && (numEdges > 0));
+#else
+  return false;
+#endif
+} // dropUnitEdgeWeights
+
 inline void Graph::getEdgeRangeForVertex(const GraphElem vertex, GraphElem &e0, GraphElem &e1) const
 {
   assert((vertex >= 0) && (vertex < numVertices));
@@ -168,15 +275,63 @@ inline void Graph::getEdgeRangeForVertex(const GraphElem vertex, GraphElem &e0,
 #endif
 } // getEdgeRangeForVertex
 
-inline const Edge &Graph::getEdge(const GraphElem edge) const
+inline GraphElem Graph::getEdgeTail(const GraphElem edge) const
+{
+#if defined(DEBUG_BUILD)
+  assert((edge >= 0) && (edge < numEdges));
+#endif
+#if defined(USE_SOA_EDGE_LIST)
+  return edgeTails[edge];
+#else
+  return edges[edge].tail;
+#endif
+} // getEdgeTail
+
+inline GraphWeight Graph::getEdgeWeight(const GraphElem edge) const
+{
+#if defined(DEBUG_BUILD)
+  assert((edge >= 0) && (edge < numEdges));
+#endif
+#if defined(USE_SOA_EDGE_LIST)
+  return (edgeWeights.empty() ? 1.0 : edgeWeights[edge]);
+#else
+  return edges[edge].weight;
+#endif
+} // getEdgeWeight
+
+inline void Graph::setEdge(const GraphElem edge, const GraphElem tail, const GraphWeight weight)
 {
 #if defined(DEBUG_BUILD)
   assert((edge >= 0) && (edge < numEdges));
-  return edgeList.at(edge);
+#endif
+#if defined(USE_SOA_EDGE_LIST)
+  edgeTails[edge] = tail;
+  if (!edgeWeights.empty())
+      edgeWeights[edge] = weight;
+#if defined(DEBUG_BUILD)
+  else
+      assert(weight == 1.0);
+#endif
+#else
+  edges[edge].tail = tail;
+  edges[edge].weight = weight;
+#endif
+} // setEdge
+
+#if defined(USE_SOA_EDGE_LIST)
+inline Edge Graph::getEdge(const GraphElem edge) const
+{
+  return Edge(getEdgeTail(edge), getEdgeWeight(edge));
+} // getEdge
 #else
-  return edgeList[edge];
+inline const Edge &Graph::getEdge(const GraphElem edge) const
+{
+#if defined(DEBUG_BUILD)
+  assert((edge >= 0) && (edge < numEdges));
 #endif
+  return edges[edge];
 } // getEdge
+#endif
 
 inline void Graph::setEdgeStartForVertex(const GraphElem vertex, const GraphElem e0)
 {
@@ -189,18 +344,121 @@ inline void Graph::setEdgeStartForVertex(const GraphElem vertex, const GraphElem
 #endif
 } // setEdgeRangeForVertex
 
+#if !defined(USE_SOA_EDGE_LIST)
 inline Edge &Graph::getEdge(const GraphElem edge)
 {
 #if defined(DEBUG_BUILD)
   if ((edge < 0) || (edge >= numEdges))
     std::cerr << "ERROR: out of bounds access: " << edge << ", max: " << numEdges << std::endl;
   assert((edge >= 0) && (edge < numEdges));
-  return edgeList.at(edge);
-#else
-  return edgeList[edge];  
 #endif
+  return edges[edge];  
 } // getEdge
 
+// point the edges at numEdges edges starting at first, inside 
+// a mapping [addr, addr + length) owned by the graph henceforth
+inline void Graph::mapEdges(void *addr, const size_t length, Edge *first)
+{
+  if (mappedAddr)
+      munmap(mappedAddr, mappedLength);
+
+  EdgeList().swap(edgeList);
+  edges = first;
+  mappedAddr = addr;
+  mappedLength = length;
+} // mapEdges
+#endif
+
+// give the pages wholly inside [first, last) back to the system
+static inline void releasePages(const void *first, const void *last)
+{
+  const uintptr_t page = sysconf(_SC_PAGESIZE);
+  const uintptr_t lo = ((uintptr_t)first + page - 1) & ~(page - 1);
+  const uintptr_t hi = (uintptr_t)last & ~(page - 1);
+
+  if (hi > lo)
+      madvise((void *)lo, hi - lo, MADV_DONTNEED);
+} // releasePages
+
+// release the memory of the edges [e0, e1), which are not accessed 
+// anymore (e.g., by a rebuild that streams the edges), while the
+// graph keeps its size; reading them afterwards is undefined
+inline void Graph::releaseEdges(const GraphElem e0, const GraphElem e1)
+{
+#if defined(USE_SOA_EDGE_LIST)
+  releasePages(edgeTails.data() + e0, edgeTails.data() + e1);
+  if (!edgeWeights.empty())
+      releasePages(edgeWeights.data() + e0, edgeWeights.data() + e1);
+#else
+  releasePages(edges + e0, edges + e1);
+#endif
+} // releaseEdges
+
+// relabel the vertices, vertex order[i] becomes vertex i, and 
+// edge j gets the tail tails[j]; the edges of every vertex 
+// are sorted by their new tails (a mapped edge list is 
+// replaced by an owned one)
+inline void Graph::permute(const std::vector<GraphElem> &order, const std::vector<GraphElem> &tails)
+{
+  EdgeIndexes indexes(numVertices + 1);
+
+  indexes[0] = 0;
+  for (GraphElem i = 0; i < numVertices; i++)
+      indexes[i + 1] = indexes[i] + (edgeListIndexes[order[i] + 1] - edgeListIndexes[order[i]]);
+
+#if defined(USE_SOA_EDGE_LIST)
+  const bool weighted = isWeighted();
+  EdgeTailList newTails(numEdges);
+  EdgeWeightList newWeights(weighted ? numEdges : 0);
+#else
+  EdgeList newEdges(numEdges);
+#endif
+
+#pragma omp parallel
+  {
+      std::vector<Edge> row;
+
+#pragma omp for schedule(guided)
+      for (GraphElem i = 0; i < numVertices; i++) {
+          const GraphElem e0 = edgeListIndexes[order[i]], e1 = edgeListIndexes[order[i] + 1];
+
+          row.clear();
+          for (GraphElem j = e0; j < e1; j++)
+              row.push_back(Edge(tails[j], getEdgeWeight(j)));
+
+          std::sort(row.begin(), row.end(), 
+                  [] (const Edge &a, const Edge &b) { return a.tail < b.tail; });
+
+          GraphElem k = indexes[i];
+          for (const Edge &edge : row) {
+#if defined(USE_SOA_EDGE_LIST)
+              newTails[k] = edge.tail;
+              if (weighted)
+                  newWeights[k] = edge.weight;
+#else
+              newEdges[k] = edge;
+#endif
+              k++;
+          }
+      }
+  }
+
+  edgeListIndexes.swap(indexes);
+#if defined(USE_SOA_EDGE_LIST)
+  edgeTails.swap(newTails);
+  edgeWeights.swap(newWeights);
+#else
+  if (mappedAddr) {
+      munmap(mappedAddr, mappedLength);
+      mappedAddr = NULL;
+      mappedLength = 0;
+  }
+
+  edgeList.swap(newEdges);
+  edges = edgeList.data();
+#endif
+} // permute
+
 inline std::ostream &operator <<(std::ostream &os, const Graph &g)
 {
 #if defined(DEBUG_BUILD)
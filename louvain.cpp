@@ -1,2149 +1,1947 @@
 #include "louvain.hpp"
+#include <climits>
 #include <cstring>
+#include <iterator>
 #include <sstream>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 
-#include "locks.hpp"
+// the diagnostics of the process (opened by bin/graphClustering
+// unless built with -DDONT_CREATE_DIAG_FILES)
+std::ofstream ofs;
 
-GraphWeight distLouvainMethod(const int me, const int nprocs, const DistGraph &dg,
-        size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters, bool ETLocalOrRemote)
+// count the probes and moves of the iteration (accumulated by 
+// every thread), and end the iteration of the profiler
+static void distProfileIteration(ClusterLocalAccumulatorVector &claccs)
 {
-  CommunityVector pastComm, currComm, targetComm;
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight, frozenClusterWeight;
-  CommVector localCinfo, localCupdate;
- 
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+  GraphElem probes = 0, moves = 0;
 
-  GraphWeight constantForSecondTerm;
-  GraphWeight prevMod = lower;
-  GraphWeight currMod = -1.0;
-  int numIters = 0;
+  for (size_t t = 0; t < claccs.size(); t++) {
+      probes += claccs[t].probes();
+      moves += claccs[t].moves();
+      claccs[t].resetCounters();
+  }
 
-  // initializations
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
-  
-  // for frozen vertices
-  frozenClusterWeight.resize(nv);
-  std::vector<bool> vActive;
-  vActive.resize(nv);
+  profiler.count(PROFILE_PROBES, probes);
+  profiler.count(PROFILE_MOVED, moves);
+  profiler.endIteration();
+} // distProfileIteration
 
-  std::fill(vActive.begin(), vActive.end(), true);
+// The state of a phase of the method, which is shared
+// by the policies of distLouvainEngine (see below)
+struct LouvainState
+{
+    const DistGraph &dg;
+    const Graph &g;
+    const int me;
+    const GraphElem nv, base, bound;
+
+    CommunityVector pastComm, currComm, targetComm;
+    GraphWeightVector vDegree, clusterWeight;
+    CommVector localCinfo, localCupdate;
+
+    LocalElemVector localTails;
+    GraphElemVector remoteCids;
+    CommunityVector remoteComm;
+    CommVector remoteCinfo, remoteCupdate;
+    ClusterLocalAccumulatorVector claccs;
+    CommUpdateAccumulatorVector cupdates; // one per thread with privateUpdates
+
+    GraphWeight constantForSecondTerm;
+
+    // the local terms of the modularity (sums of the cluster
+    // weights and of the squared community degrees), summed 
+    // when the community updates are applied
+    GraphWeight le_xx, la2_x;
+
+    LouvainState(const DistGraph &dg_, const int me_): dg(dg_), g(dg_.getLocalGraph()),
+        me(me_), nv(g.getNumVertices()), base(dg_.getBase(me_)), bound(dg_.getBound(me_)),
+        constantForSecondTerm(0.0), le_xx(0.0), la2_x(0.0) {}
+};
+
+// execute the iteration on vertex i, unless the early termination
+// froze it (then it keeps its cluster weight), returns 1 if frozen
+template<class Termination>
+static inline long distVisitVertex(LouvainState &s, Termination &term, const GraphElem i)
+{
+  if (!term.active(i)) {
+      term.restore(s, i);
+      return 1;
+  }
 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
-#endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
+  const int t = omp_get_thread_num();
 
-#ifdef DEBUG_PRINTF  
-  double t0, t1;
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
-#endif
-  
-  while(true) {
-#ifdef DEBUG_PRINTF  
-    const double t2 = MPI_Wtime();
-    ofs << "Starting iteration: " << numIters << std::endl;
-#endif
-    numIters++;
-    long vc_count = 0;
+  s.clusterWeight[i] = 0;
+  distExecuteLouvainIteration(i, s.dg, s.localTails, s.currComm, s.targetComm, s.vDegree,
+          s.localCinfo, s.localCupdate, s.remoteComm, s.remoteCids, s.remoteCinfo,
+          s.remoteCupdate, s.constantForSecondTerm, s.clusterWeight, s.claccs[t], 
+          s.cupdates.empty() ? NULL : &s.cupdates[t], s.me);
+  term.freeze(i, s.clusterWeight[i]);
 
-#ifdef DEBUG_PRINTF  
-    t0 = MPI_Wtime();
-#endif
+  return 0;
+} // distVisitVertex
 
-    fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-            rsizes, svdata, rvdata, currComm, localCinfo, 
-            remoteCinfo, remoteComm, remoteCupdate);
+// move the communities of vertex i to the next iteration
+static inline void distSwapComm(LouvainState &s, const GraphElem i)
+{
+  GraphElem tmp = s.pastComm[i];
+  s.pastComm[i] = s.currComm[i];
+  s.currComm[i] = s.targetComm[i];
+  s.targetComm[i] = tmp;
+} // distSwapComm
+
+// add the per-thread community updates to localCupdate/remoteCupdate:
+// the keys of every accumulator are grouped into as many ranges as
+// there are accumulators, then a thread adds the updates of a range
+// from all the accumulators, so that each update has a single writer
+static void distMergeCommUpdates(LouvainState &s)
+{
+  const GraphElem n = s.nv + s.remoteCupdate.size();
+  const int nbufs = s.cupdates.size();
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Remote community map size: " << remoteComm.size() << std::endl;
-    ofs << "Iteration communication time: " << (t1 - t0) << std::endl;
-#endif
+#pragma omp parallel
+  {
+      const int t = omp_get_thread_num(), nt = omp_get_num_threads();
 
-#ifdef DEBUG_PRINTF  
-    t0 = MPI_Wtime();
-#endif
+      for (int b = t; b < nbufs; b += nt)
+          s.cupdates[b].group(n, nbufs);
 
-#pragma omp parallel \
-    shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, pastComm, dg, remoteCupdate, \
-        frozenClusterWeight, vActive), firstprivate(constantForSecondTerm) \
-    reduction(+: vc_count)
-    {
-        distCleanCWandCU(nv, clusterWeight, localCupdate);
+#pragma omp barrier
+
+      for (int r = t; r < nbufs; r += nt) {
+          for (int b = 0; b < nbufs; b++) {
+              const CommUpdateAccumulator &cu = s.cupdates[b];
+
+              for (GraphElem j = cu.groupBegin(r); j < cu.groupEnd(r); j++) {
+                  const GraphElem key = cu.key(j);
+                  Comm &c = (key < s.nv) ? s.localCupdate[key] : s.remoteCupdate[key - s.nv];
+
+                  c.degree += cu.update(j).degree;
+                  c.size += cu.update(j).size;
+              }
+          }
+      }
+
+#pragma omp barrier
+
+      for (int b = t; b < nbufs; b += nt)
+          s.cupdates[b].clear();
+  }
+} // distMergeCommUpdates
+
+// add the community updates to the local community info, and
+// sum the local terms of the modularity in the same pass
+static void distApplyLocalCupdate(LouvainState &s)
+{
+  GraphWeight le_xx = 0.0, la2_x = 0.0;
 
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp for schedule(runtime)
+#pragma omp parallel for reduction(+: le_xx, la2_x) schedule(runtime)
 #else
-#pragma omp for schedule(guided)
+#pragma omp parallel for reduction(+: le_xx, la2_x) schedule(static)
 #endif
-        for (GraphElem i = 0; i < nv; i++) {
-            if (!vActive[i]) {
-                clusterWeight[i] = frozenClusterWeight[i];
-                vc_count++;
-                continue;
-            }
-            else
-            {
-                distExecuteLouvainIteration(i, dg, currComm, targetComm, vDegree, localCinfo, 
-                        localCupdate, remoteComm, remoteCinfo, remoteCupdate,
-                        constantForSecondTerm, clusterWeight, me);
-                frozenClusterWeight[i] = clusterWeight[i];
-            }
-        }
-    }
-    if (!ETLocalOrRemote) {
-        MPI_Allreduce(MPI_IN_PLACE, &vc_count, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
-        GraphWeight perc = 100.0 * ((GraphWeight)(tnv-vc_count)/(GraphWeight)tnv);
-        if (vc_count >= ET_CUTOFF) {
-            currMod = -1;
-            break;
-        }
-    }
+  for (GraphElem i = 0; i < s.nv; i++) {
+      s.localCinfo[i].size += s.localCupdate[i].size;
+      s.localCinfo[i].degree += s.localCupdate[i].degree;
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Iteration computation time: " << (t1 - t0) << std::endl;
-    t0 = MPI_Wtime();
-#endif
+      s.localCupdate[i].size = 0;
+      s.localCupdate[i].degree = 0;
 
-#pragma omp parallel shared(localCinfo, localCupdate)
-    {
-        distUpdateLocalCinfo(localCinfo, localCupdate);
-    }
+      le_xx += s.clusterWeight[i];
+      la2_x += static_cast<GraphWeight>(s.localCinfo[i].degree) * 
+          static_cast<GraphWeight>(s.localCinfo[i].degree);
+  }
 
-#ifdef DEBUG_PRINTF  
-    t0 = MPI_Wtime();
-#endif
-    updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Update remote communities communication time: " << (t1 - t0) << std::endl;
-    t0 = MPI_Wtime();
-#endif
+  s.le_xx = le_xx;
+  s.la2_x = la2_x;
+} // distApplyLocalCupdate
 
-    currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
+// apply the community updates of the visited vertices: the updates
+// of remote communities go to their owners, which add them to their
+// own (localCupdate), and then all are applied at once
+template<class Exchange>
+static void distUpdateCommunities(LouvainState &s, Exchange &exch)
+{
+  if (!s.cupdates.empty())
+      distMergeCommUpdates(s);
+
+  exch.update(s);
+  distApplyLocalCupdate(s);
+} // distUpdateCommunities
+
+/// Early termination policies: the vertices of an iteration are
+/// vertex(k) for k < count(), of which the active ones are visited
+/// (the others restore their frozen cluster weight), refresh follows the ghost communities after an exchange, cutoff
+/// tells if the phase stops given the number of frozen vertices of 
+/// the iteration (across the processes), and swap moves the communities of the
+/// active vertices to the next iteration
+
+// every vertex is visited in every iteration
+class NoTermination
+{
+    public:
+        void setup(const LouvainState &s) { nv_ = s.nv; }
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Modularity computation + communication time: " << (t1 - t0) << std::endl;
-#endif
+        GraphElem count() const { return nv_; }
+        GraphElem vertex(const GraphElem k) const { return k; }
 
-    if ((currMod - prevMod) < threshMod){
-#ifdef DEBUG_PRINTF  
-        ofs << "Break here - no updates " << std::endl;
-#endif
-        break;
-    }
+        bool active(const GraphElem i) const { return true; }
+        void restore(LouvainState &s, const GraphElem i) const {}
+        void freeze(const GraphElem i, const GraphWeight w) {}
 
-    prevMod = currMod;
+        void refresh(const LouvainState &s) {}
 
-    if (prevMod < lower)
-        prevMod = lower;
+        bool cutoff(const long frozen) const { return false; }
 
+        void swap(LouvainState &s, const int numIters)
+        {
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for \
-    shared(pastComm, currComm, targetComm, vActive) \
-    firstprivate(numIters) schedule(runtime)
+#pragma omp parallel for schedule(runtime)
 #else
-#pragma omp parallel for \
-    shared(pastComm, currComm, targetComm, vActive) \
-    firstprivate(numIters) schedule(static)
+#pragma omp parallel for schedule(static)
 #endif
-    for (GraphElem i = 0; i < nv; i++) {
-        if (numIters > 2 
-                && (targetComm[i] == currComm[i] == pastComm[i]))
-            vActive[i] = false;
-        else {
-            GraphElem tmp = pastComm[i];
-            pastComm[i] = currComm[i];
-            currComm[i] = targetComm[i];
-            targetComm[i] = tmp;
+          for (GraphElem i = 0; i < s.nv; i++)
+              distSwapComm(s, i);
         }
-    }
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Update local communities time: " << (t1 - t0) << std::endl;
-    ofs << "Total iteration time: " << (t1 - t2) << std::endl;
-#endif
-  };
 
-  cvect = pastComm;
-  iters = numIters;
-  
-  vActive.clear();
-  frozenClusterWeight.clear();
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethod with early termination
+    private:
+        GraphElem nv_;
+};
 
-GraphWeight distLouvainMethod(const int me, const int nprocs, 
-        const DistGraph &dg, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters, GraphWeight ETDelta, bool ETLocalOrRemote)
+// a vertex is frozen once its communities stop changing (-t 1/3),
+// when not ETLocalOrRemote the phase also stops once ET_CUTOFF
+// vertices are frozen in an iteration (across the processes)
+class InactiveTermination
 {
-  CommunityVector pastComm, currComm, targetComm;
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight, frozenClusterWeight;
-  CommVector localCinfo, localCupdate;
- 
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+    public:
+        InactiveTermination(const bool ETLocalOrRemote): ETLocalOrRemote_(ETLocalOrRemote) {}
 
-  GraphWeight constantForSecondTerm;
-  GraphWeight prevMod = lower;
-  GraphWeight currMod = -1.0;
-  int numIters = 0;
+        void setup(const LouvainState &s)
+        {
+          nv_ = s.nv;
+          vActive_.assign(s.nv, true);
+          frozenClusterWeight_.resize(s.nv);
+        }
 
-  // initializations
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
-  
-  // for frozen vertices
-  frozenClusterWeight.resize(nv);
-  std::vector<bool> vActive;
-  vActive.resize(nv);
-  
-  // vertex probabilities for current and previous iteration
-  std::vector<GraphWeight> p_curr, p_prev;
-  p_curr.resize(nv); 
-  p_prev.resize(nv);
+        GraphElem count() const { return nv_; }
+        GraphElem vertex(const GraphElem k) const { return k; }
 
-  std::fill(vActive.begin(), vActive.end(), true);
-  std::fill(p_prev.begin(), p_prev.end(), 1.0);
+        bool active(const GraphElem i) const { return vActive_[i]; }
+        void restore(LouvainState &s, const GraphElem i) const 
+        { s.clusterWeight[i] = frozenClusterWeight_[i]; }
+        void freeze(const GraphElem i, const GraphWeight w) { frozenClusterWeight_[i] = w; }
 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
-#endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
+        void refresh(const LouvainState &s) {}
 
-#ifdef DEBUG_PRINTF  
-  double t0, t1;
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
-#endif
-  
-  while(true) {
-#ifdef DEBUG_PRINTF  
-    const double t2 = MPI_Wtime();
-    ofs << "Starting iteration: " << numIters << std::endl;
-#endif
-    numIters++;
-    long vc_count = 0;
+        bool cutoff(const long frozen) const
+        {
+          return (!ETLocalOrRemote_ && (frozen >= ET_CUTOFF));
+        }
 
-#ifdef DEBUG_PRINTF  
-    t0 = MPI_Wtime();
+        void swap(LouvainState &s, const int numIters)
+        {
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for schedule(runtime)
+#else
+#pragma omp parallel for schedule(static)
 #endif
+          for (GraphElem i = 0; i < s.nv; i++) {
+              if (numIters > 2
+                      && (s.targetComm[i] == s.currComm[i] == s.pastComm[i]))
+                  vActive_[i] = false;
+              else
+                  distSwapComm(s, i);
+          }
+        }
 
-    fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-            rsizes, svdata, rvdata, currComm, localCinfo, 
-            remoteCinfo, remoteComm, remoteCupdate);
+    protected:
+        const bool ETLocalOrRemote_;
+        GraphElem nv_;
+        std::vector<bool> vActive_;
+        GraphWeightVector frozenClusterWeight_;
+};
+
+// a vertex is frozen once the probability of it being active,
+// which decreases by ETDelta every iteration its community stays
+// the same, reaches P_CUTOFF (-t 2/4)
+class ProbabilisticTermination: public InactiveTermination
+{
+    public:
+        ProbabilisticTermination(const GraphWeight ETDelta, const bool ETLocalOrRemote):
+            InactiveTermination(ETLocalOrRemote), ETDelta_(ETDelta) {}
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Remote community map size: " << remoteComm.size() << std::endl;
-    ofs << "Iteration communication time: " << (t1 - t0) << std::endl;
-#endif
+        void setup(const LouvainState &s)
+        {
+          InactiveTermination::setup(s);
 
-#ifdef DEBUG_PRINTF  
-    t0 = MPI_Wtime();
-#endif
+          p_curr_.resize(s.nv);
+          p_prev_.assign(s.nv, 1.0);
+        }
 
-#pragma omp parallel \
-    shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, pastComm, dg, remoteCupdate, \
-        frozenClusterWeight, vActive), firstprivate(constantForSecondTerm) \
-    reduction(+: vc_count)
-    {
-        distCleanCWandCU(nv, clusterWeight, localCupdate);
+        void swap(LouvainState &s, const int numIters)
+        {
+          const GraphWeight one_minus_delta = (1.0 - ETDelta_);
 
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp for schedule(runtime) 
+#pragma omp parallel for schedule(runtime)
 #else
-#pragma omp for schedule(guided) 
+#pragma omp parallel for schedule(static)
 #endif
-        for (GraphElem i = 0; i < nv; i++) {
-            if (!vActive[i]) {
-                clusterWeight[i] = frozenClusterWeight[i];
-                vc_count++;
-                continue;
-            }
-            else
-            {
-                distExecuteLouvainIteration(i, dg, currComm, targetComm, vDegree, localCinfo, 
-                        localCupdate, remoteComm, remoteCinfo, remoteCupdate,
-                        constantForSecondTerm, clusterWeight, me);
-                frozenClusterWeight[i] = clusterWeight[i];
-            }
-        }
-    }
-    if (!ETLocalOrRemote) {
-        MPI_Allreduce(MPI_IN_PLACE, &vc_count, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
-        GraphWeight perc = 100.0 * ((GraphWeight)(tnv-vc_count)/(GraphWeight)tnv);
-        if (vc_count >= ET_CUTOFF) {
-            currMod = -1;
-            break;
-        }
-    }
+          for (GraphElem i = 0; i < s.nv; i++) {
+              if (!vActive_[i])
+                  continue;
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Iteration computation time: " << (t1 - t0) << std::endl;
-    t0 = MPI_Wtime();
-#endif
+              if (numIters > 2 && (s.currComm[i] == s.pastComm[i])) {
+                  p_curr_[i] = p_prev_[i]*one_minus_delta;
+                  if (p_curr_[i] <= P_CUTOFF)
+                      vActive_[i] = false;
+              }
 
-#pragma omp parallel shared(localCinfo, localCupdate)
-    {
-        distUpdateLocalCinfo(localCinfo, localCupdate);
-    }
+              if (vActive_[i])
+                  distSwapComm(s, i);
+          }
 
-#ifdef DEBUG_PRINTF  
-    t0 = MPI_Wtime();
-#endif
-    updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Update remote communities communication time: " << (t1 - t0) << std::endl;
-    t0 = MPI_Wtime();
-#endif
+          // swap p_active k, k-1 iteration
+          std::swap(p_curr_, p_prev_);
+        }
 
-    currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
+    private:
+        const GraphWeight ETDelta_;
+        GraphWeightVector p_curr_, p_prev_;
+};
+
+// only the vertices whose neighborhood changed are visited (-t 5): a
+// vertex that moves puts itself and its local neighbors in the next
+// frontier, and so does a ghost whose community changed for its local
+// neighbors, so the work of an iteration follows the frontier (the
+// cluster weights of the other vertices are unchanged)
+class FrontierTermination
+{
+    public:
+        FrontierTermination(const GraphElemVector *initial = NULL): initial_(initial) {}
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Modularity computation + communication time: " << (t1 - t0) << std::endl;
-#endif
+        void setup(const LouvainState &s)
+        {
+          const GraphElem nv = s.nv, ne = s.g.getNumEdges();
+          GraphElem ng = 0;
+
+          if (initial_) {
+              frontier_ = *initial_;
+              inFrontier_.assign(nv, 0);
+              for (const GraphElem i : frontier_)
+                  inFrontier_[i] = 1;
+          }
+          else {
+              frontier_.resize(nv);
+              std::iota(frontier_.begin(), frontier_.end(), 0);
+              inFrontier_.assign(nv, 1);
+          }
+          lastRemoteComm_.clear();
+          seeded_ = (initial_ == NULL);
+          buffers_.resize(omp_get_max_threads());
+
+          // local neighbors of the ghosts (CSR-like)
+#pragma omp parallel for reduction(max: ng) schedule(static)
+          for (GraphElem j = 0; j < ne; j++) {
+              if (s.localTails[j] >= nv && (s.localTails[j] - nv + 1) > ng)
+                  ng = s.localTails[j] - nv + 1;
+          }
 
-    if ((currMod - prevMod) < threshMod){
-#ifdef DEBUG_PRINTF  
-        ofs << "Break here - no updates " << std::endl;
-#endif
-        break;
-    }
+          ng_ = ng;
+          std::vector<GraphElem> ghostAdded(ng, 0);
+          ghostPtr_.assign(ng+1, 0);
 
-    prevMod = currMod;
+#pragma omp parallel for schedule(static)
+          for (GraphElem j = 0; j < ne; j++) {
+              if (s.localTails[j] >= nv)
+                  __sync_fetch_and_add(&ghostPtr_[s.localTails[j] - nv + 1], 1);
+          }
 
-    if (prevMod < lower)
-        prevMod = lower;
+          for (GraphElem k = 0; k < ng; k++)
+              ghostPtr_[k+1] += ghostPtr_[k];
 
-    const GraphWeight one_minus_delta = (1.0 - ETDelta);
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for \
-    shared(pastComm, currComm, targetComm, vActive, p_curr, p_prev) \
-    firstprivate(numIters, one_minus_delta) schedule(runtime)
-#else
-#pragma omp parallel for \
-    shared(pastComm, currComm, targetComm, vActive, p_curr, p_prev) \
-    firstprivate(numIters, one_minus_delta) schedule(static)
-#endif
-    for (GraphElem i = 0; i < nv; i++) {
-        if (!vActive[i])
-            continue;
-        
-        if (numIters > 2 && (currComm[i] == pastComm[i])) {
-            p_curr[i] = p_prev[i]*one_minus_delta;
-            if (p_curr[i] <= P_CUTOFF)
-                vActive[i] = false;
-        }
+          ghostAdj_.resize(ghostPtr_[ng]);
 
-        if (vActive[i]) 
-        {
-            GraphElem tmp = pastComm[i];
-            pastComm[i] = currComm[i];
-            currComm[i] = targetComm[i];
-            targetComm[i] = tmp;
+#pragma omp parallel for schedule(guided)
+          for (GraphElem i = 0; i < nv; i++) {
+              GraphElem e0, e1;
+              s.g.getEdgeRangeForVertex(i, e0, e1);
+
+              for (GraphElem j = e0; j < e1; j++) {
+                  const GraphElem k = s.localTails[j] - nv;
+                  if (k >= 0)
+                      ghostAdj_[ghostPtr_[k] + __sync_fetch_and_add(&ghostAdded[k], 1)] = i;
+              }
+          }
         }
-    }
-    
-    // swap p_active k, k-1 iteration
-    std::swap(p_curr, p_prev);
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Update local communities time: " << (t1 - t0) << std::endl;
-    ofs << "Total iteration time: " << (t1 - t2) << std::endl;
-#endif
-  };
+        GraphElem count() const { return frontier_.size(); }
+        GraphElem vertex(const GraphElem k) const { return frontier_[k]; }
 
-  cvect = pastComm;
-  iters = numIters;
-  
-  p_curr.clear();
-  p_prev.clear();
-  vActive.clear();
-  frozenClusterWeight.clear();
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethod with early termination probabilities
+        bool active(const GraphElem i) const { return inFrontier_[i]; }
+        void restore(LouvainState &s, const GraphElem i) const {}
+        void freeze(const GraphElem i, const GraphWeight w) {}
 
-GraphWeight distLouvainMethod(const int me, const int nprocs, const DistGraph &dg,
-        size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters)
-{
-  CommunityVector pastComm, currComm, targetComm;
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight;
-  CommVector localCinfo, localCupdate;
-  
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+        // the ghost communities only change between iterations, the
+        // first exchange of a phase is kept as reference (and gives the
+        // cluster weights of the vertices that start frozen)
+        void refresh(LouvainState &s)
+        {
+          const GraphElem ng = s.remoteComm.size();
 
-  GraphWeight constantForSecondTerm;
-  GraphWeight prevMod = lower;
-  GraphWeight currMod = -1.0;
-  int numIters = 0;
- 
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
+          if (!seeded_) {
+              frozenClusterWeights(s);
+              seeded_ = true;
+          }
 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
-#endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
+          if (static_cast<GraphElem>(lastRemoteComm_.size()) != ng) {
+              lastRemoteComm_ = s.remoteComm;
+              return;
+          }
 
-#ifdef DEBUG_PRINTF  
-  double t0, t1;
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
-#endif
-  
-  while(true) {
-#ifdef DEBUG_PRINTF  
-    const double t2 = MPI_Wtime();
-    ofs << "Starting iteration: " << numIters << std::endl;
-#endif
-    numIters++;
+#pragma omp parallel for schedule(static)
+          for (GraphElem k = 0; k < ng; k++) {
+              if (s.remoteComm[k] != lastRemoteComm_[k]) {
+                  lastRemoteComm_[k] = s.remoteComm[k];
 
-#ifdef DEBUG_PRINTF  
-    t0 = MPI_Wtime();
-#endif
+                  for (GraphElem p = ghostPtr_[k]; k < ng_ && p < ghostPtr_[k+1]; p++)
+                      enqueue(ghostAdj_[p]);
+              }
+          }
 
-    fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-            rsizes, svdata, rvdata, currComm, localCinfo, 
-            remoteCinfo, remoteComm, remoteCupdate);
+          merge();
+        }
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Remote community map size: " << remoteComm.size() << std::endl;
-    ofs << "Iteration communication time: " << (t1 - t0) << std::endl;
-#endif
+        bool cutoff(const long frozen) const { return false; }
 
-#ifdef DEBUG_PRINTF  
-    t0 = MPI_Wtime();
-#endif
-#pragma omp parallel \
-    shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, pastComm, dg, remoteCupdate), \
-    firstprivate(constantForSecondTerm)
-    {
-        distCleanCWandCU(nv, clusterWeight, localCupdate);
+        void swap(LouvainState &s, const int numIters)
+        {
+          const GraphElem nf = frontier_.size();
+          moved_.resize(nf);
+
+#pragma omp parallel
+          {
+#pragma omp for schedule(static)
+              for (GraphElem k = 0; k < nf; k++) {
+                  const GraphElem i = frontier_[k];
+
+                  moved_[k] = (s.targetComm[i] != s.currComm[i]);
+                  inFrontier_[i] = 0;
+                  distSwapComm(s, i);
+              }
 
 #ifdef OMP_SCHEDULE_RUNTIME
 #pragma omp for schedule(runtime)
 #else
-#pragma omp for schedule(guided) 
+#pragma omp for schedule(guided)
 #endif
-        for (GraphElem i = 0; i < nv; i++) {
-            distExecuteLouvainIteration(i, dg, currComm, targetComm, vDegree, localCinfo, 
-                    localCupdate, remoteComm, remoteCinfo, remoteCupdate,
-                    constantForSecondTerm, clusterWeight, me);
-        }
-    }
+              for (GraphElem k = 0; k < nf; k++) {
+                  if (!moved_[k])
+                      continue;
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Iteration computation time: " << (t1 - t0) << std::endl;
-    t0 = MPI_Wtime();
-#endif
-
-#pragma omp parallel shared(localCinfo, localCupdate)
-    {
-        distUpdateLocalCinfo(localCinfo, localCupdate);
-    }
+                  const GraphElem i = frontier_[k];
+                  GraphElem e0, e1;
 
-#ifdef DEBUG_PRINTF  
-    t0 = MPI_Wtime();
-#endif
-    updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Update remote communities communication time: " << (t1 - t0) << std::endl;
-    t0 = MPI_Wtime();
-#endif
+                  enqueue(i);
+                  s.g.getEdgeRangeForVertex(i, e0, e1);
 
-    currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
-
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Modularity computation + communication time: " << (t1 - t0) << std::endl;
-#endif
-
-    if ((currMod - prevMod) < threshMod) {
-#ifdef DEBUG_PRINTF  
-        ofs << "Break here - no updates " << std::endl;
-#endif
-        break;
-    }
-
-    prevMod = currMod;
-
-    if (prevMod < lower)
-        prevMod = lower;
+                  for (GraphElem j = e0; j < e1; j++) {
+                      if (s.localTails[j] < s.nv)
+                          enqueue(s.localTails[j]);
+                  }
+              }
+          }
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for  \
-    shared(pastComm, currComm, targetComm) \
-    schedule(runtime)
-#else
-#pragma omp parallel for  \
-    shared(pastComm, currComm, targetComm) \
-    schedule(static)
-#endif
-    for (GraphElem i = 0; i < nv; i++) {
-        GraphElem tmp = pastComm[i];
-        pastComm[i] = currComm[i];
-        currComm[i] = targetComm[i];
-        targetComm[i] = tmp;
-    }
+          frontier_.clear();
+          merge();
+        }
 
-#ifdef DEBUG_PRINTF  
-    t1 = MPI_Wtime();
-    ofs << "Update local communities time: " << (t1 - t0) << std::endl;
-    ofs << "Total iteration time: " << (t1 - t2) << std::endl;
-#endif
-  };
+    private:
+        // the weight of the edges to its community, for a vertex that
+        // is not visited
+        void frozenClusterWeights(LouvainState &s) const
+        {
+#pragma omp parallel for schedule(guided)
+          for (GraphElem i = 0; i < s.nv; i++) {
+              if (inFrontier_[i])
+                  continue;
 
-  cvect = pastComm;
-  iters = numIters;
-  
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethod plain
+              GraphElem e0, e1;
+              GraphWeight w = 0.0;
+              s.g.getEdgeRangeForVertex(i, e0, e1);
 
-GraphWeight distLouvainMethodWithColoring(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters)
-{
-  // if no colors, then fall back to original distLouvain  
-  if (numColor == 1) {
-      ofs << "No color specified, executing non-color Louvain..." << std::endl;
-      return distLouvainMethod(me, nprocs, dg, ssz, rsz, ssizes, 
-              rsizes, svdata, rvdata, cvect, lower, thresh, iters);
-  }
-    
-  CommunityVector pastComm, currComm, targetComm; 
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight;
-  CommVector localCinfo, localCupdate;
+              for (GraphElem j = e0; j < e1; j++) {
+                  const GraphElem t = s.localTails[j];
+                  const GraphElem tcomm = (t < s.nv) ? s.currComm[t] : s.remoteComm[t - s.nv];
 
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+                  if (tcomm == s.currComm[i])
+                      w += s.g.getEdgeWeight(j);
+              }
 
-  GraphWeight constantForSecondTerm;
-  GraphWeight prevMod = lower;
-  GraphWeight currMod = -1.0;
-  int numIters = 0;
+              s.clusterWeight[i] = w;
+          }
+        }
 
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
+        // add vertex i to the next frontier (within a parallel region)
+        void enqueue(const GraphElem i)
+        {
+          if (__sync_bool_compare_and_swap(&inFrontier_[i], 0, 1))
+              buffers_[omp_get_thread_num()].push_back(i);
+        }
 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
-#endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
-  double t0, t1;
+        // append the enqueued vertices to the frontier, in 
+        // increasing order for the locality of the visits
+        void merge()
+        {
+          const size_t nf = frontier_.size();
 
-#ifdef DEBUG_PRINTF  
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
-#endif
+          for (size_t t = 0; t < buffers_.size(); t++) {
+              frontier_.insert(frontier_.end(), buffers_[t].begin(), buffers_[t].end());
+              buffers_[t].clear();
+          }
 
-  /*** Create a CSR-like datastructure for vertex-colors ***/
-  std::vector<long> colorPtr(numColor+1,0);
-  std::vector<long> colorIndex(nv,0);
-  std::vector<long> colorAdded(numColor,0);
+          if (frontier_.size() != nf)
+              std::sort(frontier_.begin(), frontier_.end());
+        }
 
-  // Count the size of each color	
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
-#endif
-  for(long i=0; i < nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      __sync_fetch_and_add(&colorPtr[(long)start+1],1);
-  }
+        const GraphElemVector *initial_;
+        bool seeded_;
+        GraphElemVector frontier_;
+        std::vector<char> inFrontier_, moved_;
+        std::vector<GraphElemVector> buffers_;
+        CommunityVector lastRemoteComm_;
+        GraphElem ng_;
+        GraphElemVector ghostPtr_, ghostAdj_;
+};
+
+/// Communication policies: setup exchanges the ghost vertex
+/// requests, fill exchanges the ghost communities and community
+/// info before the vertices are visited, update sends back the
+/// remote community updates, and endIteration ends the iteration
+/// of the profiler (which is collective)
+
+// the ghost communities are exchanged with their owners
+class GhostExchange
+{
+    public:
+        GhostExchange(const int nprocs, MPI_Comm comm, size_t &ssz, size_t &rsz,
+                std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes,
+                std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata):
+            nprocs_(nprocs), comm_(comm), ssz_(ssz), rsz_(rsz), ssizes_(ssizes), rsizes_(rsizes),
+            svdata_(svdata), rvdata_(rvdata) {}
 
-  //Prefix sum:
-  for(long i=0; i<numColor; i++) {
-      colorPtr[i+1] += colorPtr[i];
-  }	
-  
-  //Group vertices with the same color in particular order
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
-#endif
-  for (long i=0; i<nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      const long vindex = colorPtr[start] + __sync_fetch_and_add(&(colorAdded[start]), 1);
-      colorIndex[vindex] = i;
-  }
+        MPI_Comm comm() const { return comm_; }
 
-  while(true) {
-      
-#ifdef DEBUG_PRINTF  
-      const double t2 = MPI_Wtime();
-      ofs << "Starting iteration: " << numIters << std::endl;
-#endif      
-      numIters++;	
-#ifdef DEBUG_PRINTF  
-      t0 = MPI_Wtime();
-#endif
+        void setup(LouvainState &s)
+        {
+          exchangeVertexReqs(s.dg, ssz_, rsz_, ssizes_, rsizes_,
+                  svdata_, rvdata_, s.localTails, s.me, nprocs_);
+        }
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight) schedule(runtime)
-#else
-#pragma omp parallel for schedule(static) shared(clusterWeight)
+        void fill(LouvainState &s)
+        {
+          fillRemoteCommunities(s.dg, s.me, nprocs_, ssz_, rsz_, ssizes_,
+                  rsizes_, svdata_, rvdata_, s.currComm, s.localCinfo,
+                  s.remoteCids, s.remoteCinfo, s.remoteComm, s.remoteCupdate);
+#ifdef DEBUG_PRINTF
+          ofs << "Remote community map size: " << s.remoteComm.size() << std::endl;
 #endif
-      for (GraphElem i = 0L; i < nv; i++)
-          clusterWeight[i] = 0;
+        }
 
-      // Color loop
-      for(long ci = 0; ci < numColor; ci++) {
+        // the received updates are added to localCupdate
+        void update(LouvainState &s)
+        {
+          updateRemoteCommunities(s.dg, s.localCupdate, s.remoteCids,
+                  s.remoteCupdate, s.me, nprocs_);
+        }
 
-          fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-                  rsizes, svdata, rvdata, currComm, localCinfo, 
-                  remoteCinfo, remoteComm, remoteCupdate);
+        void endIteration(LouvainState &s) { distProfileIteration(s.claccs); }
 
-          const long coloradj1 = colorPtr[ci];
-          const long coloradj2 = colorPtr[ci+1];
+    protected:
+        const int nprocs_;
+        MPI_Comm comm_;
+        size_t &ssz_, &rsz_;
+        std::vector<GraphElem> &ssizes_, &rsizes_, &svdata_, &rvdata_;
+};
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, dg, remoteCupdate, pastComm), \
-          firstprivate(me, constantForSecondTerm) schedule(runtime)
-#else
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, dg, remoteCupdate, pastComm), \
-          firstprivate(me, constantForSecondTerm) schedule(static)
-#endif
-          for (long K = coloradj1; K < coloradj2; K++) {
-              distExecuteLouvainIteration(colorIndex[K], dg, currComm, targetComm, 
-                      vDegree, localCinfo, localCupdate, remoteComm, remoteCinfo, 
-                      remoteCupdate, constantForSecondTerm, clusterWeight, me);
-          }
+// same as GhostExchange, except that the ghost communities of an
+// iteration are in flight while the interior vertices (without
+// ghost neighbors) are visited in the natural order (-l)
+class OverlappedGhostExchange: public GhostExchange
+{
+    public:
+        OverlappedGhostExchange(const int nprocs, MPI_Comm comm, size_t &ssz, size_t &rsz,
+                std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes,
+                std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata):
+            GhostExchange(nprocs, comm, ssz, rsz, ssizes, rsizes, svdata, rvdata) {}
 
-          // update local cinfo
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(runtime)
-#else
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(static)
-#endif          
-          for (GraphElem i = 0; i < nv; i++) {
-              localCinfo[i].size += localCupdate[i].size;
-              localCinfo[i].degree += localCupdate[i].degree;
+        void setup(LouvainState &s)
+        {
+          GhostExchange::setup(s);
 
-              localCupdate[i].size = 0;
-              localCupdate[i].degree = 0;
-          }
-          
-          updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-      } // end of Color loop
-#ifdef DEBUG_PRINTF  
-      t1 = MPI_Wtime();
-      ofs << "Color iteration computation time: " << (t1 - t0) << std::endl;
-#endif      
-      
-      // global modularity
-      currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
-      if ((currMod - prevMod) < threshMod) {
-#ifdef DEBUG_PRINTF  
-          ofs << "Break here - no updates " << std::endl;
+          distClassifyVertices(s.g, s.localTails, interior_, boundary_);
+          deferred_.resize(interior_.size());
+#ifdef DEBUG_PRINTF
+          ofs << "Interior vertices: " << interior_.size() << ", boundary vertices: "
+              << boundary_.size() << std::endl;
 #endif
-          break;
-      }
-      
-      prevMod = currMod;
-      if (prevMod < lower)
-          prevMod = lower;   
+        }
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm) \
-      schedule(runtime)
-#else
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm) \
-      schedule(static)
-#endif
-      for (GraphElem i = 0L; i < nv; i++) {    
-          GraphElem tmp = pastComm[i];
-          pastComm[i] = currComm[i];
-          currComm[i] = targetComm[i];
-          targetComm[i] = tmp;       
-      }
-  }; // end while loop
+        void post(LouvainState &s)
+        {
+          postGhostCommunities(s.dg, s.me, nprocs_, ssz_, rsz_, ssizes_, rsizes_,
+                  svdata_, s.currComm, s.remoteComm, greqs_);
+        }
 
-  cvect = pastComm;  
-  iters = numIters;
-  
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethodWithColoring plain
+        void wait(LouvainState &s)
+        {
+          waitGhostCommunities(greqs_, s.remoteComm);
+          exchangeRemoteCommunityInfo(s.dg, s.me, nprocs_, s.currComm, s.localCinfo,
+                  s.remoteComm, s.remoteCids, s.remoteCinfo, s.remoteCupdate);
+#ifdef DEBUG_PRINTF
+          ofs << "Remote community map size: " << s.remoteComm.size() << std::endl;
+#endif
+        }
 
-GraphWeight distLouvainMethodWithColoring(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters, bool ETLocalOrRemote)
+        const GraphElemVector &interior() const { return interior_; }
+        const GraphElemVector &boundary() const { return boundary_; }
+        std::vector<char> &deferred() { return deferred_; }
+
+    private:
+        GraphElemVector interior_, boundary_;
+        std::vector<char> deferred_;
+        GhostCommunityRequests greqs_;
+};
+
+#if defined(USE_MPI_RMA)
+// same as GhostExchange, except that the exchanges of an iteration are
+// one-sided: every process exposes a copy of its communities and of its
+// community info (refreshed before every fill) in RMA windows, the 
+// ghost communities and the remote community info are read with MPI_Get 
+// (a get per run of consecutive ids of an owner), and the updates of the
+// remote communities are added with MPI_Accumulate to a third window, 
+// which the owner adds to localCupdate; the windows are locked (shared,
+// passive target) for the phase, and every exchange ends with a flush 
+// and a barrier
+class RmaGhostExchange: public GhostExchange
 {
-  // if no colors, then fall back to original distLouvain  
-  if (numColor == 1) {
-      ofs << "No color specified, executing non-color Louvain..." << std::endl;
-      return distLouvainMethod(me, nprocs, dg, ssz, rsz, ssizes, 
-              rsizes, svdata, rvdata, cvect, lower, thresh, iters);
-  }
-    
-  CommunityVector pastComm, currComm, targetComm; 
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight, frozenClusterWeight;
-  CommVector localCinfo, localCupdate;
+    public:
+        RmaGhostExchange(const int nprocs, MPI_Comm comm, size_t &ssz, size_t &rsz,
+                std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes,
+                std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata):
+            GhostExchange(nprocs, comm, ssz, rsz, ssizes, rsizes, svdata, rvdata), 
+            nv_(0), windows_(false) {}
+
+        ~RmaGhostExchange()
+        {
+          if (!windows_)
+              return;
+
+          MPI_Win_unlock_all(commWin_);
+          MPI_Win_unlock_all(cinfoWin_);
+          MPI_Win_unlock_all(cupdateWin_);
+          MPI_Win_free(&commWin_);
+          MPI_Win_free(&cinfoWin_);
+          MPI_Win_free(&cupdateWin_);
+        }
 
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+        void setup(LouvainState &s)
+        {
+          GhostExchange::setup(s);
 
-  GraphWeight constantForSecondTerm;
-  GraphWeight prevMod = lower;
-  GraphWeight currMod = -1.0;
-  int numIters = 0;
+          nv_ = s.nv;
 
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
-  
-  // for frozen vertices
-  frozenClusterWeight.resize(nv);
-  std::vector<bool> vActive;
-  vActive.resize(nv);
-  std::fill(vActive.begin(), vActive.end(), true);
- 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
-#endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
-  double t0, t1;
+          MPI_Win_allocate(nv_*sizeof(GraphElem), sizeof(GraphElem), MPI_INFO_NULL, 
+                  comm_, &commBase_, &commWin_);
+          MPI_Win_allocate(nv_*sizeof(Comm), 1, MPI_INFO_NULL, 
+                  comm_, &cinfoBase_, &cinfoWin_);
+          MPI_Win_allocate(nv_*sizeof(Comm), 1, MPI_INFO_NULL, 
+                  comm_, &cupdateBase_, &cupdateWin_);
+          
+          for (GraphElem i = 0; i < nv_; i++)
+              cupdateBase_[i] = Comm();
+
+          MPI_Win_lock_all(MPI_MODE_NOCHECK, commWin_);
+          MPI_Win_lock_all(MPI_MODE_NOCHECK, cinfoWin_);
+          MPI_Win_lock_all(MPI_MODE_NOCHECK, cupdateWin_);
+          windows_ = true;
+
+          // the ghosts (rvdata, sorted) as runs of consecutive ids
+          ghostRuns_.clear();
+          for (GraphElem k = 0; k < static_cast<GraphElem>(rvdata_.size()); k++) {
+              const GraphElem v = rvdata_[k];
+
+              if (k > 0 && v == rvdata_[k-1] + 1 && s.dg.getOwner(v) == ghostRuns_.back().owner)
+                  ghostRuns_.back().count++;
+              else {
+                  const int owner = s.dg.getOwner(v);
+                  ghostRuns_.push_back({owner, v - s.dg.getBase(owner), k, 1});
+              }
+          }
 
-#ifdef DEBUG_PRINTF  
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
-#endif
+          MPI_Barrier(comm_);
+        }
 
-  /*** Create a CSR-like datastructure for vertex-colors ***/
-  std::vector<long> colorPtr(numColor+1, 0);
-  std::vector<long> colorIndex(nv, 0);
-  std::vector<long> colorAdded(numColor, 0);
+        void fill(LouvainState &s)
+        {
+          const GraphElem ng = rvdata_.size();
+
+          // expose the communities of this iteration
+          std::copy(s.currComm.begin(), s.currComm.begin() + nv_, commBase_);
+          std::copy(s.localCinfo.begin(), s.localCinfo.begin() + nv_, cinfoBase_);
+          MPI_Win_sync(commWin_);
+          MPI_Win_sync(cinfoWin_);
+          MPI_Barrier(comm_);
+
+          s.remoteComm.resize(ng);
+          for (const Run &r : ghostRuns_)
+              MPI_Get(s.remoteComm.data() + r.first, r.count, MPI_GRAPH_TYPE, r.owner, 
+                      r.disp, r.count, MPI_GRAPH_TYPE, commWin_);
+          MPI_Win_flush_all(commWin_);
+
+          // the remote communities, of the ghosts and of my vertices
+          s.remoteCids.clear();
+          for (GraphElem k = 0; k < ng; k++) {
+              if (s.remoteComm[k] < s.base || s.remoteComm[k] >= s.bound)
+                  s.remoteCids.push_back(s.remoteComm[k]);
+          }
+          for (GraphElem i = 0; i < nv_; i++) {
+              if (s.currComm[i] < s.base || s.currComm[i] >= s.bound)
+                  s.remoteCids.push_back(s.currComm[i]);
+          }
+          std::sort(s.remoteCids.begin(), s.remoteCids.end());
+          s.remoteCids.erase(std::unique(s.remoteCids.begin(), s.remoteCids.end()), 
+                  s.remoteCids.end());
 
-  // Count the size of each color	
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
-#endif
-  for(long i=0; i < nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      __sync_fetch_and_add(&colorPtr[(long)start+1],1);
-  }
+          const GraphElem nr = s.remoteCids.size();
+          s.remoteCinfo.resize(nr);
+          s.remoteCupdate.assign(nr, Comm());
 
-  //Prefix sum:
-  for(long i=0; i<numColor; i++) {
-      colorPtr[i+1] += colorPtr[i];
-  }	
-  
-  //Group vertices with the same color in particular order
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
-#endif
-  for (long i=0; i<nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      const long vindex = colorPtr[start] + __sync_fetch_and_add(&(colorAdded[start]), 1);
-      colorIndex[vindex] = i;
-  }
-
-  while(true) {
-      
-#ifdef DEBUG_PRINTF  
-      const double t2 = MPI_Wtime();
-      ofs << "Starting iteration: " << numIters << std::endl;
-#endif      
-      numIters++;	
-      long vc_count = 0;
-#ifdef DEBUG_PRINTF  
-      t0 = MPI_Wtime();
-#endif
+          communityRuns(s);
+          for (const Run &r : commRuns_)
+              MPI_Get(s.remoteCinfo.data() + r.first, r.count*sizeof(Comm), MPI_BYTE, r.owner, 
+                      r.disp*sizeof(Comm), r.count*sizeof(Comm), MPI_BYTE, cinfoWin_);
+          MPI_Win_flush_all(cinfoWin_);
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight) schedule(runtime)
-#else
-#pragma omp parallel for schedule(static) shared(clusterWeight)
+          profiler.count(PROFILE_BYTES_SENT, ng*sizeof(GraphElem) + nr*sizeof(Comm));
+#ifdef DEBUG_PRINTF
+          ofs << "Remote community map size: " << s.remoteComm.size() << std::endl;
 #endif
-      for (GraphElem i = 0L; i < nv; i++)
-          clusterWeight[i] = 0;
+        }
 
-      // Color loop
-      for(long ci = 0; ci < numColor; ci++) {
+        // the updates are added by the processes to the window, which is
+        // then added to localCupdate
+        void update(LouvainState &s)
+        {
+          for (const Run &r : commRuns_) {
+              const MPI_Aint disp = r.disp*sizeof(Comm);
+              Comm *first = s.remoteCupdate.data() + r.first;
+
+              if (r.count == 1) {
+                  MPI_Accumulate(&first->size, 1, MPI_GRAPH_TYPE, r.owner, 
+                          disp + offsetof(Comm, size), 1, MPI_GRAPH_TYPE, MPI_SUM, cupdateWin_);
+                  MPI_Accumulate(&first->degree, 1, MPI_WEIGHT_TYPE, r.owner, 
+                          disp + offsetof(Comm, degree), 1, MPI_WEIGHT_TYPE, MPI_SUM, cupdateWin_);
+              }
+              else {
+                  MPI_Datatype sizes, degrees;
 
-          fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-                  rsizes, svdata, rvdata, currComm, localCinfo, 
-                  remoteCinfo, remoteComm, remoteCupdate);
+                  MPI_Type_create_hvector(r.count, 1, sizeof(Comm), MPI_GRAPH_TYPE, &sizes);
+                  MPI_Type_create_hvector(r.count, 1, sizeof(Comm), MPI_WEIGHT_TYPE, &degrees);
+                  MPI_Type_commit(&sizes);
+                  MPI_Type_commit(&degrees);
 
-          const long coloradj1 = colorPtr[ci];
-          const long coloradj2 = colorPtr[ci+1];
+                  MPI_Accumulate(&first->size, 1, sizes, r.owner, 
+                          disp + offsetof(Comm, size), 1, sizes, MPI_SUM, cupdateWin_);
+                  MPI_Accumulate(&first->degree, 1, degrees, r.owner, 
+                          disp + offsetof(Comm, degree), 1, degrees, MPI_SUM, cupdateWin_);
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, dg, remoteCupdate, pastComm, \
-        colorIndex, frozenClusterWeight, vActive), firstprivate(constantForSecondTerm), \
-          reduction(+: vc_count) schedule(runtime)
-#else
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, dg, remoteCupdate, pastComm, \
-        colorIndex, frozenClusterWeight, vActive), firstprivate(constantForSecondTerm), \
-          reduction(+: vc_count) schedule(static)
-#endif
-          for (long K = coloradj1; K < coloradj2; K++) {
-              if (!vActive[colorIndex[K]]) {
-                  clusterWeight[colorIndex[K]] = frozenClusterWeight[colorIndex[K]];
-                  vc_count++;
-                  continue;
-              }
-              else
-              {
-                  distExecuteLouvainIteration(colorIndex[K], dg, currComm, targetComm, 
-                          vDegree, localCinfo, localCupdate, remoteComm, remoteCinfo, 
-                          remoteCupdate, constantForSecondTerm, clusterWeight, me);
-                  frozenClusterWeight[colorIndex[K]] = clusterWeight[colorIndex[K]];
+                  MPI_Type_free(&sizes);
+                  MPI_Type_free(&degrees);
               }
           }
 
-          // update local cinfo
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(runtime)
-#else
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(static)
-#endif
-          for (GraphElem i = 0; i < nv; i++) {
-              localCinfo[i].size += localCupdate[i].size;
-              localCinfo[i].degree += localCupdate[i].degree;
+          MPI_Win_flush_all(cupdateWin_);
+          profiler.count(PROFILE_BYTES_SENT, s.remoteCupdate.size()*sizeof(Comm));
+          MPI_Barrier(comm_);
+          MPI_Win_sync(cupdateWin_);
 
-              localCupdate[i].size = 0;
-              localCupdate[i].degree = 0;
-          }
-          
-          updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-      } // end of Color loop
-#ifdef DEBUG_PRINTF  
-      t1 = MPI_Wtime();
-      ofs << "Color iteration computation time: " << (t1 - t0) << std::endl;
-#endif      
-
-      if (!ETLocalOrRemote) {
-          MPI_Allreduce(MPI_IN_PLACE, &vc_count, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
-          GraphWeight perc = 100.0 * ((GraphWeight)(tnv-vc_count)/(GraphWeight)tnv);
-          if (vc_count >= ET_CUTOFF) {
-              currMod = -1;
-              break;
+#pragma omp parallel for schedule(static)
+          for (GraphElem i = 0; i < nv_; i++) {
+              s.localCupdate[i].size += cupdateBase_[i].size;
+              s.localCupdate[i].degree += cupdateBase_[i].degree;
+              cupdateBase_[i] = Comm();
           }
-      }
 
-      // global modularity
-      currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
-      if ((currMod - prevMod) < threshMod) {
-#ifdef DEBUG_PRINTF  
-          ofs << "Break here - no updates " << std::endl;
-#endif
-          break;
-      }
-      prevMod = currMod;
-      if (prevMod < lower)
-          prevMod = lower;   
-
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm, vActive) \
-      firstprivate(numIters) schedule(runtime)
-#else
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm, vActive) \
-      firstprivate(numIters) schedule(static)
-#endif
-      for (GraphElem i = 0L; i < nv; i++) {    
-          if (numIters > 2 
-                  && (targetComm[i] == currComm[i] == pastComm[i]))
-              vActive[i] = false;
-          else {
-              GraphElem tmp = pastComm[i];
-              pastComm[i] = currComm[i];
-              currComm[i] = targetComm[i];
-              targetComm[i] = tmp;
-          }
-      }
-  }; // end while loop
+          MPI_Win_sync(cupdateWin_);
+        }
 
-  cvect = pastComm;  
-  iters = numIters;
+    private:
+        // ids [disp, disp + count) of owner, at [first, first + count)
+        struct Run 
+        { 
+            int owner; 
+            GraphElem disp, first, count; 
+        };
 
-  vActive.clear();
-  frozenClusterWeight.clear();
-    
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethodWithColoring with early termination
+        void communityRuns(const LouvainState &s)
+        {
+          commRuns_.clear();
+          for (GraphElem k = 0; k < static_cast<GraphElem>(s.remoteCids.size()); k++) {
+              const GraphElem c = s.remoteCids[k];
+
+              if (k > 0 && c == s.remoteCids[k-1] + 1 && s.dg.getOwner(c) == commRuns_.back().owner)
+                  commRuns_.back().count++;
+              else {
+                  const int owner = s.dg.getOwner(c);
+                  commRuns_.push_back({owner, c - s.dg.getBase(owner), k, 1});
+              }
+          }
+        }
 
-GraphWeight distLouvainMethodWithColoring(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters, GraphWeight ETDelta, bool ETLocalOrRemote)
+        GraphElem nv_;
+        bool windows_;
+        MPI_Win commWin_, cinfoWin_, cupdateWin_;
+        GraphElem *commBase_;
+        Comm *cinfoBase_, *cupdateBase_;
+        std::vector<Run> ghostRuns_, commRuns_;
+};
+#endif
+
+#if defined(USE_NODE_GHOST_CACHE)
+// same as GhostExchange, except that the ghost communities are 
+// exchanged per node (the processes sharing memory): every process
+// exposes a copy of its communities in a shared window, read directly
+// by the processes of its node, and the node leader (node rank 0) gets
+// the communities of the ghosts owned off the node (the union over
+// its node, each vertex once) from the other leaders, into a shared
+// cache read by the processes of the node; the leaders answer from
+// the windows of their node, so only the leaders communicate across
+// nodes (the community info and updates are still exchanged by
+// every process, as in GhostExchange)
+class NodeGhostExchange: public GhostExchange
 {
-  // if no colors, then fall back to original distLouvain  
-  if (numColor == 1) {
-      ofs << "No color specified, executing non-color Louvain..." << std::endl;
-      return distLouvainMethod(me, nprocs, dg, ssz, rsz, ssizes, 
-              rsizes, svdata, rvdata, cvect, lower, thresh, iters);
-  }
-    
-  CommunityVector pastComm, currComm, targetComm; 
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight, frozenClusterWeight;
-  CommVector localCinfo, localCupdate;
-
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+    public:
+        NodeGhostExchange(const int nprocs, MPI_Comm comm, size_t &ssz, size_t &rsz,
+                std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes,
+                std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata):
+            GhostExchange(nprocs, comm, ssz, rsz, ssizes, rsizes, svdata, rvdata), 
+            nodeComm_(MPI_COMM_NULL), leaderComm_(MPI_COMM_NULL), windows_(false) {}
+
+        ~NodeGhostExchange()
+        {
+          if (windows_) {
+              MPI_Win_unlock_all(commWin_);
+              MPI_Win_unlock_all(cacheWin_);
+              MPI_Win_free(&commWin_);
+              MPI_Win_free(&cacheWin_);
+          }
+          if (leaderComm_ != MPI_COMM_NULL)
+              MPI_Comm_free(&leaderComm_);
+          if (nodeComm_ != MPI_COMM_NULL)
+              MPI_Comm_free(&nodeComm_);
+        }
 
-  GraphWeight constantForSecondTerm;
-  GraphWeight prevMod = lower;
-  GraphWeight currMod = -1.0;
-  int numIters = 0;
+        void setup(LouvainState &s)
+        {
+          GhostExchange::setup(s);
 
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
-  
-  // for frozen vertices
-  frozenClusterWeight.resize(nv);
-  std::vector<bool> vActive;
-  vActive.resize(nv);
-  
-  // vertex probabilities for current and previous iteration
-  std::vector<GraphWeight> p_curr, p_prev;
-  p_curr.resize(nv); 
-  p_prev.resize(nv); 
+          nv_ = s.nv;
 
-  std::fill(vActive.begin(), vActive.end(), true);
-  std::fill(p_prev.begin(), p_prev.end(), 1.0);
+#if defined(NODE_GHOST_CACHE_RANKS)
+          // consecutive processes as nodes (which must share memory)
+          MPI_Comm_split(comm_, s.me / NODE_GHOST_CACHE_RANKS, s.me, &nodeComm_);
+#else
+          MPI_Comm_split_type(comm_, MPI_COMM_TYPE_SHARED, s.me, 
+                  MPI_INFO_NULL, &nodeComm_);
+#endif
+          MPI_Comm_rank(nodeComm_, &nodeRank_);
+          MPI_Comm_size(nodeComm_, &nodeSize_);
+          MPI_Comm_split(comm_, nodeRank_ == 0 ? 0 : MPI_UNDEFINED, 
+                  s.me, &leaderComm_);
+
+          // the node rank of the processes of my node (-1 off the 
+          // node), and the node (leader rank) of every process
+          std::vector<int> nodeProcs(nodeSize_);
+          MPI_Allgather(&s.me, 1, MPI_INT, nodeProcs.data(), 1, MPI_INT, nodeComm_);
+          nodeRankOf_.assign(nprocs_, -1);
+          for (int r = 0; r < nodeSize_; r++)
+              nodeRankOf_[nodeProcs[r]] = r;
+
+          int node = 0, numNodes = 1;
+          if (nodeRank_ == 0) {
+              MPI_Comm_rank(leaderComm_, &node);
+              MPI_Comm_size(leaderComm_, &numNodes);
+          }
+          MPI_Bcast(&node, 1, MPI_INT, 0, nodeComm_);
+          MPI_Bcast(&numNodes, 1, MPI_INT, 0, nodeComm_);
+          nodeOf_.resize(nprocs_);
+          MPI_Allgather(&node, 1, MPI_INT, nodeOf_.data(), 1, MPI_INT, comm_);
+
+          // my communities, shared with the node
+          MPI_Info info;
+          MPI_Info_create(&info);
+          MPI_Info_set(info, "alloc_shared_noncontig", "true");
+          GraphElem *mine;
+          MPI_Win_allocate_shared(nv_*sizeof(GraphElem), sizeof(GraphElem), info, 
+                  nodeComm_, &mine, &commWin_);
+          commBase_ = mine;
+          peers_.resize(nodeSize_);
+          for (int r = 0; r < nodeSize_; r++) {
+              MPI_Aint size;
+              int unit;
+              MPI_Win_shared_query(commWin_, r, &size, &unit, &peers_[r]);
+          }
 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
-#endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
-  double t0, t1;
+          // the ghosts owned off the node, gathered at the leader
+          const GraphElem ng = rvdata_.size();
+          std::vector<GraphElem> offNode;
+          for (GraphElem k = 0; k < ng; k++) {
+              if (nodeRankOf_[s.dg.getOwner(rvdata_[k])] < 0)
+                  offNode.push_back(rvdata_[k]);
+          }
 
-#ifdef DEBUG_PRINTF  
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
-#endif
+          int noff = offNode.size();
+          std::vector<int> counts(nodeSize_), displs(nodeSize_, 0);
+          MPI_Gather(&noff, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, nodeComm_);
+          std::vector<GraphElem> nodeGhosts;
+          if (nodeRank_ == 0) {
+              for (int r = 1; r < nodeSize_; r++)
+                  displs[r] = displs[r-1] + counts[r-1];
+              nodeGhosts.resize(displs[nodeSize_-1] + counts[nodeSize_-1]);
+          }
+          MPI_Gatherv(offNode.data(), noff, MPI_GRAPH_TYPE, nodeGhosts.data(), 
+                  counts.data(), displs.data(), MPI_GRAPH_TYPE, 0, nodeComm_);
+          std::sort(nodeGhosts.begin(), nodeGhosts.end());
+          nodeGhosts.erase(std::unique(nodeGhosts.begin(), nodeGhosts.end()), nodeGhosts.end());
+
+          // the cache is the sorted ids followed by their communities
+          GraphElem nc = nodeGhosts.size();
+          MPI_Bcast(&nc, 1, MPI_GRAPH_TYPE, 0, nodeComm_);
+          GraphElem *cache;
+          MPI_Win_allocate_shared(nodeRank_ == 0 ? 2*nc*sizeof(GraphElem) : 0, 
+                  sizeof(GraphElem), info, nodeComm_, &cache, &cacheWin_);
+          MPI_Info_free(&info);
+          if (nodeRank_ != 0) {
+              MPI_Aint size;
+              int unit;
+              MPI_Win_shared_query(cacheWin_, 0, &size, &unit, &cache);
+          }
+          cacheIds_ = cache;
+          cacheComm_ = cache + nc;
+          if (nodeRank_ == 0)
+              std::copy(nodeGhosts.begin(), nodeGhosts.end(), cacheIds_);
+
+          MPI_Win_lock_all(MPI_MODE_NOCHECK, commWin_);
+          MPI_Win_lock_all(MPI_MODE_NOCHECK, cacheWin_);
+          windows_ = true;
+
+          if (nodeRank_ == 0)
+              leaderRequests(s, nodeGhosts, numNodes);
+
+          MPI_Win_sync(cacheWin_);
+          MPI_Barrier(nodeComm_);
+          MPI_Win_sync(cacheWin_);
+
+          // where the community of every ghost is read from
+          src_.resize(ng);
+          for (GraphElem k = 0; k < ng; k++) {
+              const GraphElem v = rvdata_[k];
+              const int owner = s.dg.getOwner(v);
+
+              if (nodeRankOf_[owner] >= 0)
+                  src_[k] = static_cast<GraphElem*>(peers_[nodeRankOf_[owner]]) 
+                      + (v - s.dg.getBase(owner));
+              else
+                  src_[k] = cacheComm_ + (std::lower_bound(cacheIds_, cacheIds_ + nc, v) 
+                          - cacheIds_);
+          }
+        }
 
-  /*** Create a CSR-like datastructure for vertex-colors ***/
-  std::vector<long> colorPtr(numColor+1, 0);
-  std::vector<long> colorIndex(nv, 0);
-  std::vector<long> colorAdded(numColor, 0);
+        void fill(LouvainState &s)
+        {
+          std::copy(s.currComm.begin(), s.currComm.begin() + nv_, commBase_);
+          MPI_Win_sync(commWin_);
+          MPI_Barrier(nodeComm_);
+          MPI_Win_sync(commWin_);
+
+          if (nodeRank_ == 0) {
+              const GraphElem nserve = serve_.size(), nreq = cachePos_.size();
+              std::vector<GraphElem> scdata(nserve), rcdata(nreq);
+
+              for (GraphElem j = 0; j < nserve; j++)
+                  scdata[j] = *serve_[j];
+
+              profiler.count(PROFILE_BYTES_SENT, nserve*sizeof(GraphElem));
+              MPI_Alltoallv(scdata.data(), scounts_.data(), sdispls_.data(), MPI_GRAPH_TYPE,
+                      rcdata.data(), rcounts_.data(), rdispls_.data(), MPI_GRAPH_TYPE, 
+                      leaderComm_);
+
+              for (GraphElem i = 0; i < nreq; i++)
+                  cacheComm_[cachePos_[i]] = rcdata[i];
+              MPI_Win_sync(cacheWin_);
+          }
 
-  // Count the size of each color	
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
-#endif
-  for(long i=0; i < nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      __sync_fetch_and_add(&colorPtr[(long)start+1],1);
-  }
+          MPI_Barrier(nodeComm_);
+          MPI_Win_sync(cacheWin_);
 
-  //Prefix sum:
-  for(long i=0; i<numColor; i++) {
-      colorPtr[i+1] += colorPtr[i];
-  }	
-  
-  //Group vertices with the same color in particular order
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
-#endif
-  for (long i=0; i<nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      const long vindex = colorPtr[start] + __sync_fetch_and_add(&(colorAdded[start]), 1);
-      colorIndex[vindex] = i;
-  }
+          const GraphElem ng = src_.size();
+          s.remoteComm.resize(ng);
+          profiler.count(PROFILE_GHOSTS, ng);
+#pragma omp parallel for schedule(static)
+          for (GraphElem k = 0; k < ng; k++)
+              s.remoteComm[k] = *src_[k];
 
-  while(true) {
-      
-#ifdef DEBUG_PRINTF  
-      const double t2 = MPI_Wtime();
-      ofs << "Starting iteration: " << numIters << std::endl;
-#endif      
-      numIters++;	
-      long vc_count = 0;
-#ifdef DEBUG_PRINTF  
-      t0 = MPI_Wtime();
-#endif
+          // nobody writes its communities or the cache 
+          // before everybody on the node has read them
+          MPI_Barrier(nodeComm_);
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight) schedule(runtime)
-#else
-#pragma omp parallel for schedule(static) shared(clusterWeight)
+          exchangeRemoteCommunityInfo(s.dg, s.me, nprocs_, s.currComm, s.localCinfo,
+                  s.remoteComm, s.remoteCids, s.remoteCinfo, s.remoteCupdate);
+#ifdef DEBUG_PRINTF
+          ofs << "Remote community map size: " << s.remoteComm.size() << std::endl;
 #endif
-      for (GraphElem i = 0L; i < nv; i++)
-          clusterWeight[i] = 0;
+        }
 
-      // Color loop
-      for(long ci = 0; ci < numColor; ci++) {
+    private:
+        // the leaders exchange the node ghosts (per owner node) 
+        // once per phase, and find the vertices they serve
+        void leaderRequests(const LouvainState &s, const std::vector<GraphElem> &nodeGhosts,
+                const int numNodes)
+        {
+          const GraphElem nc = nodeGhosts.size();
+          std::vector<GraphElem> sids(nc);
+
+          scounts_.assign(numNodes, 0);
+          rcounts_.assign(numNodes, 0);
+          sdispls_.assign(numNodes, 0);
+          rdispls_.assign(numNodes, 0);
+
+          // requests are grouped by node, and cachePos_ is
+          // the position of the answers in the cache
+          for (GraphElem i = 0; i < nc; i++)
+              rcounts_[nodeOf_[s.dg.getOwner(nodeGhosts[i])]]++;
+          for (int n = 1; n < numNodes; n++)
+              rdispls_[n] = rdispls_[n-1] + rcounts_[n-1];
+
+          std::vector<int> pos(rdispls_);
+          cachePos_.resize(nc);
+          for (GraphElem i = 0; i < nc; i++) {
+              const int n = nodeOf_[s.dg.getOwner(nodeGhosts[i])];
+              sids[pos[n]] = nodeGhosts[i];
+              cachePos_[pos[n]++] = i;
+          }
 
-          fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-                  rsizes, svdata, rvdata, currComm, localCinfo, 
-                  remoteCinfo, remoteComm, remoteCupdate);
+          MPI_Alltoall(rcounts_.data(), 1, MPI_INT, scounts_.data(), 1, MPI_INT, leaderComm_);
+          for (int n = 1; n < numNodes; n++)
+              sdispls_[n] = sdispls_[n-1] + scounts_[n-1];
 
-          const long coloradj1 = colorPtr[ci];
-          const long coloradj2 = colorPtr[ci+1];
+          std::vector<GraphElem> rids(sdispls_[numNodes-1] + scounts_[numNodes-1]);
+          MPI_Alltoallv(sids.data(), rcounts_.data(), rdispls_.data(), MPI_GRAPH_TYPE,
+                  rids.data(), scounts_.data(), sdispls_.data(), MPI_GRAPH_TYPE, leaderComm_);
+          profiler.count(PROFILE_BYTES_SENT, nc*sizeof(GraphElem));
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, dg, remoteCupdate, pastComm, \
-        vActive, frozenClusterWeight, colorIndex), firstprivate(constantForSecondTerm), \
-          reduction(+: vc_count) schedule(runtime)
-#else
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, dg, remoteCupdate, pastComm, \
-        vActive, frozenClusterWeight, colorIndex), firstprivate(constantForSecondTerm), \
-          reduction(+: vc_count) schedule(static)
-#endif
-          for (long K = coloradj1; K < coloradj2; K++) {
-              if (!vActive[colorIndex[K]]) {
-                  clusterWeight[colorIndex[K]] = frozenClusterWeight[colorIndex[K]];
-                  vc_count++;
-                  continue;
-              }
-              else
-              {
-                  distExecuteLouvainIteration(colorIndex[K], dg, currComm, targetComm, 
-                          vDegree, localCinfo, localCupdate, remoteComm, remoteCinfo, 
-                          remoteCupdate, constantForSecondTerm, clusterWeight, me);
-                  frozenClusterWeight[colorIndex[K]] = clusterWeight[colorIndex[K]];
-              }
+          serve_.resize(rids.size());
+          for (size_t j = 0; j < rids.size(); j++) {
+              const int owner = s.dg.getOwner(rids[j]);
+              serve_[j] = static_cast<GraphElem*>(peers_[nodeRankOf_[owner]]) 
+                  + (rids[j] - s.dg.getBase(owner));
           }
+        }
 
-          // update local cinfo
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(runtime)
-#else
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(static)
-#endif
-          for (GraphElem i = 0; i < nv; i++) {
-              localCinfo[i].size += localCupdate[i].size;
-              localCinfo[i].degree += localCupdate[i].degree;
-
-              localCupdate[i].size = 0;
-              localCupdate[i].degree = 0;
-          }
-          
-          updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-      } // end of Color loop
-#ifdef DEBUG_PRINTF  
-      t1 = MPI_Wtime();
-      ofs << "Color iteration computation time: " << (t1 - t0) << std::endl;
-#endif      
-
-      if (!ETLocalOrRemote) {
-          MPI_Allreduce(MPI_IN_PLACE, &vc_count, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
-          GraphWeight perc = 100.0 * ((GraphWeight)(tnv-vc_count)/(GraphWeight)tnv);
-          if (vc_count >= ET_CUTOFF) {
-              currMod = -1;
-              break;
-          }
-      }
+        MPI_Comm nodeComm_, leaderComm_;
+        int nodeRank_, nodeSize_;
+        GraphElem nv_;
+        bool windows_;
+        MPI_Win commWin_, cacheWin_;
+        GraphElem *commBase_, *cacheIds_, *cacheComm_;
+        std::vector<void*> peers_;
+        std::vector<int> nodeRankOf_, nodeOf_;
+        std::vector<const GraphElem*> src_, serve_;
+        // the leader exchange, scounts_ are the vertices
+        // served and rcounts_ the vertices requested
+        std::vector<int> scounts_, rcounts_, sdispls_, rdispls_;
+        std::vector<GraphElem> cachePos_;
+};
+#endif
+
+// every vertex is owned by the calling process (which is thus
+// process 0 of a single process), so there are no ghosts and
+// no communication outside the process
+class NoExchange
+{
+    public:
+        MPI_Comm comm() const { return MPI_COMM_SELF; }
 
-      // global modularity
-      currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
-      if ((currMod - prevMod) < threshMod) {
-#ifdef DEBUG_PRINTF  
-          ofs << "Break here - no updates " << std::endl;
-#endif
-          break;
-      }
-      prevMod = currMod;
-      if (prevMod < lower)
-          prevMod = lower;   
+        // with no ghosts, the local tails are the tails
+        void setup(LouvainState &s)
+        {
+          const GraphElem ne = s.g.getNumEdges();
+          s.localTails.resize(ne);
 
-      const GraphWeight one_minus_delta = (1.0 - ETDelta);
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for \
-    shared(pastComm, currComm, targetComm, vActive, p_curr, p_prev) \
-    firstprivate(numIters, one_minus_delta) schedule(runtime)
-#else
-#pragma omp parallel for \
-    shared(pastComm, currComm, targetComm, vActive, p_curr, p_prev) \
-    firstprivate(numIters, one_minus_delta) schedule(static)
-#endif
-    for (GraphElem i = 0; i < nv; i++) {
-        if (!vActive[i])
-            continue;
-        
-        if (numIters > 2 && (currComm[i] == pastComm[i])) {
-            p_curr[i] = p_prev[i]*one_minus_delta;
-            if (p_curr[i] <= P_CUTOFF)
-                vActive[i] = false;
+#pragma omp parallel for schedule(static)
+          for (GraphElem j = 0; j < ne; j++)
+              s.localTails[j] = s.g.getEdgeTail(j);
         }
 
-        if (vActive[i]) 
-        {
-            GraphElem tmp = pastComm[i];
-            pastComm[i] = currComm[i];
-            currComm[i] = targetComm[i];
-            targetComm[i] = tmp;
-        }
-    }
-    
-    // swap p_active k, k-1 iteration
-    std::swap(p_curr, p_prev);
-  }; // end while loop
+        void fill(LouvainState &s) {}
+        void update(LouvainState &s) {}
+        void endIteration(LouvainState &s) {}
+};
 
-  cvect = pastComm;  
-  iters = numIters;
-  
-  frozenClusterWeight.clear();
-  vActive.clear();
-  p_curr.clear();
-  p_prev.clear();
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethodWithColoring with early termination + probability
-
-// Invoke Louvain step according to a vertex ordering scheme implemented
-// by coloring...the difference between this and the previous coloring 
-// version is that communication is exactly same as in non-coloring version,
-// only the Louvain step is arranged such that adjacent locally owned vertices 
-// are not processed at a time 
-GraphWeight distLouvainMethodVertexOrder(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters)
+/// Vertex ordering policies: compute visits the local vertices of
+/// an iteration (exchanging through the communication policy) and
+/// returns the number of frozen ones, and update applies the
+/// community updates that compute left
+
+// the vertices are visited in their natural order
+class NaturalOrder
 {
-  // if no colors, then fall back to original distLouvain  
-  if (numColor == 1) {
-      ofs << "No color specified, executing non-color Louvain..." << std::endl;
-      return distLouvainMethod(me, nprocs, dg, ssz, rsz, ssizes, 
-              rsizes, svdata, rvdata, cvect, lower, thresh, iters);
-  }
-    
-  CommunityVector pastComm, currComm, targetComm; 
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight;
-  CommVector localCinfo, localCupdate;
+    public:
+        void setup(const LouvainState &s) {}
 
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+        template<class Termination, class Exchange>
+        long compute(LouvainState &s, Termination &term, Exchange &exch)
+        {
+          long frozen = 0;
 
-  GraphWeight constantForSecondTerm;
-  GraphWeight prevMod = lower;
-  GraphWeight currMod = -1.0;
-  int numIters = 0;
+          exch.fill(s);
+          term.refresh(s);
+          profiler.lap(PROFILE_EXCHANGE);
 
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
+          const GraphElem nc = term.count();
 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for reduction(+: frozen) schedule(runtime)
+#else
+#pragma omp parallel for reduction(+: frozen) schedule(guided)
 #endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
-  double t0, t1;
+          for (GraphElem k = 0; k < nc; k++)
+              frozen += distVisitVertex(s, term, term.vertex(k));
 
-#ifdef DEBUG_PRINTF  
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
-#endif
+          return frozen;
+        }
 
-  /*** Create a CSR-like datastructure for vertex-colors ***/
-  std::vector<long> colorPtr(numColor+1, 0);
-  std::vector<long> colorIndex(nv, 0);
-  std::vector<long> colorAdded(numColor, 0);
+        // the interior vertices are visited while the ghost communities
+        // are in flight, except those whose community or neighboring
+        // communities are remote (which need the community info), so
+        // they are deferred after the boundary vertices
+        template<class Termination>
+        long compute(LouvainState &s, Termination &term, OverlappedGhostExchange &exch)
+        {
+          const GraphElemVector &interior = exch.interior();
+          const GraphElemVector &boundary = exch.boundary();
+          std::vector<char> &deferred = exch.deferred();
+          const GraphElem nint = interior.size(), nbnd = boundary.size();
+          long frozen = 0;
 
-  // Count the size of each color	
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
-#endif
-  for(long i=0; i < nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      __sync_fetch_and_add(&colorPtr[(long)start+1],1);
-  }
+          exch.post(s);
+          profiler.lap(PROFILE_EXCHANGE);
 
-  //Prefix sum:
-  for(long i=0; i<numColor; i++) {
-      colorPtr[i+1] += colorPtr[i];
-  }	
-  
-  //Group vertices with the same color in particular order
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
+#pragma omp parallel for reduction(+: frozen) schedule(runtime)
 #else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
+#pragma omp parallel for reduction(+: frozen) schedule(guided)
 #endif
-  for (long i=0; i<nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      const long vindex = colorPtr[start] + __sync_fetch_and_add(&(colorAdded[start]), 1);
-      colorIndex[vindex] = i;
-  }
+          for (GraphElem k = 0; k < nint; k++) {
+              const GraphElem i = interior[k];
 
-  while(true) {
-      
-#ifdef DEBUG_PRINTF  
-      const double t2 = MPI_Wtime();
-      ofs << "Starting iteration: " << numIters << std::endl;
-#endif      
-      numIters++;	
+              deferred[k] = !distHasLocalCommunities(i, s.g, s.localTails,
+                      s.currComm, s.base, s.bound);
+              if (!deferred[k])
+                  frozen += distVisitVertex(s, term, i);
+          }
+
+          profiler.lap(PROFILE_COMPUTE);
+
+          exch.wait(s);
+          term.refresh(s);
+          profiler.lap(PROFILE_EXCHANGE);
 
+#pragma omp parallel reduction(+: frozen)
+          {
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight) schedule(runtime)
+#pragma omp for schedule(runtime) nowait
 #else
-#pragma omp parallel for schedule(static) shared(clusterWeight)
+#pragma omp for schedule(guided) nowait
 #endif
-      for (GraphElem i = 0L; i < nv; i++)
-          clusterWeight[i] = 0;
-          
-      fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-                  rsizes, svdata, rvdata, currComm, localCinfo, 
-                  remoteCinfo, remoteComm, remoteCupdate);
-       
-#ifdef DEBUG_PRINTF  
-      t0 = MPI_Wtime();
-#endif
-      // Color loop
-      for(long ci = 0; ci < numColor; ci++) {
-        
-          const long coloradj1 = colorPtr[ci];
-          const long coloradj2 = colorPtr[ci+1];
+              for (GraphElem k = 0; k < nbnd; k++)
+                  frozen += distVisitVertex(s, term, boundary[k]);
 
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, pastComm, dg, remoteCupdate, \
-        colorIndex), firstprivate(constantForSecondTerm) schedule(runtime)
-#else
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, pastComm, dg, remoteCupdate, \
-        colorIndex), firstprivate(constantForSecondTerm) schedule(static)
-#endif
-          for (long K = coloradj1; K < coloradj2; K++) {
-              distExecuteLouvainIteration(colorIndex[K], dg, currComm, targetComm, 
-                      vDegree, localCinfo, localCupdate, remoteComm, remoteCinfo, 
-                      remoteCupdate, constantForSecondTerm, clusterWeight, me);
-          }
-      } // end of Color loop
-#ifdef DEBUG_PRINTF  
-      t1 = MPI_Wtime();
-      ofs << "Color iteration computation time: " << (t1 - t0) << std::endl;
-#endif      
-      
-      // update local cinfo
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(runtime)
+#pragma omp for schedule(runtime)
 #else
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(static)
+#pragma omp for schedule(guided)
 #endif
-      for (GraphElem i = 0; i < nv; i++) {
-          localCinfo[i].size += localCupdate[i].size;
-          localCinfo[i].degree += localCupdate[i].degree;
-
-          localCupdate[i].size = 0;
-          localCupdate[i].degree = 0;
-      }
+              for (GraphElem k = 0; k < nint; k++) {
+                  if (deferred[k])
+                      frozen += distVisitVertex(s, term, interior[k]);
+              }
+          }
 
-      updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-      
-      // global modularity
-      currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
-      if ((currMod - prevMod) < threshMod) {
-#ifdef DEBUG_PRINTF  
-          ofs << "Break here - no updates " << std::endl;
-#endif
-          break;
-      }
-      prevMod = currMod;
-      if (prevMod < lower)
-          prevMod = lower;   
-      
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm) \
-      schedule(runtime)
-#else
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm) \
-      schedule(static)
-#endif
-      for (GraphElem i = 0; i < nv; i++) {
-          GraphElem tmp = pastComm[i];
-          pastComm[i] = currComm[i];
-          currComm[i] = targetComm[i];
-          targetComm[i] = tmp;       
-      }
-  }; // end while loop
+          return frozen;
+        }
 
-  cvect = pastComm;
-  iters = numIters;
-  
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethodVertexOrder plain
+        template<class Exchange>
+        void update(LouvainState &s, Exchange &exch)
+        {
+          distUpdateCommunities(s, exch);
+          profiler.lap(PROFILE_UPDATE);
+        }
+};
 
-GraphWeight distLouvainMethodVertexOrder(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters, bool ETLocalOrRemote)
+// same as NaturalOrder, except that the vertices of degree at least
+// hubDegree (hubs) are visited one after another, each with all the
+// threads (which accumulate the communities of a chunk of its edges,
+// then reduced into a single accumulator), before the others (-h)
+class HubOrder: public NaturalOrder
 {
-  // if no colors, then fall back to original distLouvain  
-  if (numColor == 1) {
-      ofs << "No color specified, executing non-color Louvain..." << std::endl;
-      return distLouvainMethod(me, nprocs, dg, ssz, rsz, ssizes, 
-              rsizes, svdata, rvdata, cvect, lower, thresh, iters);
-  }
-    
-  CommunityVector pastComm, currComm, targetComm; 
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight, frozenClusterWeight;
-  CommVector localCinfo, localCupdate;
+    public:
+        HubOrder(const GraphElem hubDegree): hubDegree_(hubDegree) {}
 
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+        // bucket the vertices by degree
+        void setup(const LouvainState &s)
+        {
+          GraphElem maxDegree = 0;
 
-  GraphWeight constantForSecondTerm;
-  GraphWeight prevMod = lower;
-  GraphWeight currMod = -1.0;
-  int numIters = 0;
+          hubs_.clear();
+          rest_.clear();
 
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
-  
-  // for frozen vertices
-  frozenClusterWeight.resize(nv);
-  std::vector<bool> vActive;
-  vActive.resize(nv);
-  std::fill(vActive.begin(), vActive.end(), true);
+          for (GraphElem i = 0; i < s.nv; i++) {
+              GraphElem e0, e1;
+              s.g.getEdgeRangeForVertex(i, e0, e1);
 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
-#endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
-  double t0, t1;
+              if ((e1 - e0) >= hubDegree_) {
+                  hubs_.push_back(i);
+                  maxDegree = std::max(maxDegree, e1 - e0);
+              }
+              else
+                  rest_.push_back(i);
+          }
 
-#ifdef DEBUG_PRINTF  
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
+          hubAcc_.reserve(maxDegree + 1);
+#ifdef DEBUG_PRINTF
+          ofs << "Hub vertices: " << hubs_.size() << ", maximum degree: " 
+              << maxDegree << std::endl;
 #endif
+        }
 
-  /*** Create a CSR-like datastructure for vertex-colors ***/
-  std::vector<long> colorPtr(numColor+1, 0);
-  std::vector<long> colorIndex(nv, 0);
-  std::vector<long> colorAdded(numColor, 0);
-
-  // Count the size of each color	
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
-#endif
-  for(long i=0; i < nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      __sync_fetch_and_add(&colorPtr[(long)start+1],1);
-  }
+        template<class Termination, class Exchange>
+        long compute(LouvainState &s, Termination &term, Exchange &exch)
+        {
+          const GraphElem nr = rest_.size();
+          long frozen = 0;
 
-  //Prefix sum:
-  for(long i=0; i<numColor; i++) {
-      colorPtr[i+1] += colorPtr[i];
-  }	
-  
-  //Group vertices with the same color in particular order
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
-#endif
-  for (long i=0; i<nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      const long vindex = colorPtr[start] + __sync_fetch_and_add(&(colorAdded[start]), 1);
-      colorIndex[vindex] = i;
-  }
+          exch.fill(s);
+          term.refresh(s);
+          profiler.lap(PROFILE_EXCHANGE);
 
-  while(true) {
-      
-#ifdef DEBUG_PRINTF  
-      const double t2 = MPI_Wtime();
-      ofs << "Starting iteration: " << numIters << std::endl;
-#endif      
-      numIters++;	
-      long vc_count = 0;
+          for (size_t h = 0; h < hubs_.size(); h++)
+              frozen += visitHub(s, term, hubs_[h]);
 
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight) schedule(runtime)
+#pragma omp parallel for reduction(+: frozen) schedule(runtime)
 #else
-#pragma omp parallel for schedule(static) shared(clusterWeight)
+#pragma omp parallel for reduction(+: frozen) schedule(guided)
 #endif
-      for (GraphElem i = 0L; i < nv; i++)
-          clusterWeight[i] = 0;
+          for (GraphElem k = 0; k < nr; k++)
+              frozen += distVisitVertex(s, term, rest_[k]);
 
-      fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-                  rsizes, svdata, rvdata, currComm, localCinfo, 
-                  remoteCinfo, remoteComm, remoteCupdate);
-       
-#ifdef DEBUG_PRINTF  
-      t0 = MPI_Wtime();
-#endif
-      // Color loop
-      for(long ci = 0; ci < numColor; ci++) {
-
-          const long coloradj1 = colorPtr[ci];
-          const long coloradj2 = colorPtr[ci+1];
+          return frozen;
+        }
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, pastComm, dg, remoteCupdate, \
-        frozenClusterWeight, colorIndex), firstprivate(constantForSecondTerm) \
-          reduction(+:vc_count) schedule(runtime)
-#else
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, pastComm, dg, remoteCupdate, \
-        frozenClusterWeight, colorIndex), firstprivate(constantForSecondTerm) \
-          reduction(+:vc_count) schedule(static)
-#endif
-          for (long K = coloradj1; K < coloradj2; K++) {
-              if (!vActive[colorIndex[K]]) {
-                  clusterWeight[colorIndex[K]] = frozenClusterWeight[colorIndex[K]];
-                  vc_count++;
-                  continue;
-              }
-              else
-              {
-                  distExecuteLouvainIteration(colorIndex[K], dg, currComm, targetComm, 
-                          vDegree, localCinfo, localCupdate, remoteComm, remoteCinfo, 
-                          remoteCupdate, constantForSecondTerm, clusterWeight, me);
-                  frozenClusterWeight[colorIndex[K]] = clusterWeight[colorIndex[K]];
-              }
-          }
-      } // end of Color loop
-#ifdef DEBUG_PRINTF  
-      t1 = MPI_Wtime();
-      ofs << "Color iteration computation time: " << (t1 - t0) << std::endl;
-#endif      
- 
-      if (!ETLocalOrRemote) {
-          MPI_Allreduce(MPI_IN_PLACE, &vc_count, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
-          GraphWeight perc = 100.0 * ((GraphWeight)(tnv-vc_count)/(GraphWeight)tnv);
-          if (vc_count >= ET_CUTOFF) {
-              currMod = -1;
-              break;
-          }
-      }     
-      
-      // update local cinfo
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(runtime)
-#else
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(static)
-#endif
-      for (GraphElem i = 0; i < nv; i++) {
-          localCinfo[i].size += localCupdate[i].size;
-          localCinfo[i].degree += localCupdate[i].degree;
+    private:
+        template<class Termination>
+        long visitHub(LouvainState &s, Termination &term, const GraphElem i)
+        {
+          if (!term.active(i)) {
+              term.restore(s, i);
+              return 1;
+          }
 
-          localCupdate[i].size = 0;
-          localCupdate[i].degree = 0;
-      }
+          GraphElem e0, e1;
+          GraphWeight selfLoop = 0.0;
 
-      updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-      
-      // global modularity
-      currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
-      if ((currMod - prevMod) < threshMod) {
-#ifdef DEBUG_PRINTF  
-          ofs << "Break here - no updates " << std::endl;
-#endif
-          break;
-      }
-      prevMod = currMod;
-      if (prevMod < lower)
-          prevMod = lower;   
-      
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm, vActive) \
-      firstprivate(numIters) schedule(runtime)
-#else
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm, vActive) \
-      firstprivate(numIters) schedule(static)
-#endif
-      for (GraphElem i = 0L; i < nv; i++) {    
-          if (numIters > 2 
-                  && (targetComm[i] == currComm[i] == pastComm[i]))
-              vActive[i] = false;
-          else {
-              GraphElem tmp = pastComm[i];
-              pastComm[i] = currComm[i];
-              currComm[i] = targetComm[i];
-              targetComm[i] = tmp;
+          s.g.getEdgeRangeForVertex(i, e0, e1);
+
+          for (size_t t = 0; t < s.claccs.size(); t++)
+              s.claccs[t].clear();
+
+#pragma omp parallel reduction(+: selfLoop)
+          {
+              const GraphElem t = omp_get_thread_num(), nt = omp_get_num_threads();
+              const GraphElem c0 = e0 + ((e1 - e0)*t)/nt;
+              const GraphElem c1 = e0 + ((e1 - e0)*(t + 1))/nt;
+
+              selfLoop += distBuildLocalMapCounter(c0, c1, s.claccs[t], s.localTails, 
+                      s.g, s.currComm, s.remoteComm, i);
           }
-      }
-  }; // end while loop
 
-  cvect = pastComm;
-  iters = numIters;
+          // the current community comes first
+          hubAcc_.clear();
+          hubAcc_.add(s.currComm[i], 0.0);
 
-  vActive.clear();
-  frozenClusterWeight.clear();
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethodVertexOrder with early termination
+          for (size_t t = 0; t < s.claccs.size(); t++) {
+              const ClusterLocalAccumulator &clacc = s.claccs[t];
 
-GraphWeight distLouvainMethodVertexOrder(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters, GraphWeight ETDelta, bool ETLocalOrRemote)
-{
-  // if no colors, then fall back to original distLouvain  
-  if (numColor == 1) {
-      ofs << "No color specified, executing non-color Louvain..." << std::endl;
-      return distLouvainMethod(me, nprocs, dg, ssz, rsz, ssizes, 
-              rsizes, svdata, rvdata, cvect, lower, thresh, iters);
-  }
-    
-  CommunityVector pastComm, currComm, targetComm; 
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight, frozenClusterWeight;
-  CommVector localCinfo, localCupdate;
+              for (GraphElem k = 0; k < clacc.size(); k++)
+                  hubAcc_.add(clacc.community(k), clacc.weight(k));
+          }
 
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+          s.clusterWeight[i] = 0;
+          distMoveVertex(i, s.dg, s.currComm, s.targetComm, s.vDegree, s.localCinfo, 
+                  s.localCupdate, s.remoteCids, s.remoteCinfo, s.remoteCupdate, 
+                  s.constantForSecondTerm, s.clusterWeight, hubAcc_, 
+                  s.cupdates.empty() ? NULL : &s.cupdates[0], selfLoop, s.me);
+          term.freeze(i, s.clusterWeight[i]);
 
-  GraphWeight constantForSecondTerm;
-  GraphWeight prevMod = lower;
-  GraphWeight currMod = -1.0;
-  int numIters = 0;
+          // the counters of the profiler are kept by the threads
+          if (s.targetComm[i] != s.currComm[i])
+              s.claccs[0].countMove();
+          hubAcc_.resetCounters();
 
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
-  
-  // for frozen vertices
-  frozenClusterWeight.resize(nv);
-  std::vector<bool> vActive;
-  vActive.resize(nv);
-   
-  // vertex probabilities for current and previous iteration
-  std::vector<GraphWeight> p_curr, p_prev;
-  p_curr.resize(nv); 
-  p_prev.resize(nv); 
+          return 0;
+        }
 
-  std::fill(vActive.begin(), vActive.end(), true);
-  std::fill(p_prev.begin(), p_prev.end(), 1.0);
+        const GraphElem hubDegree_;
+        GraphElemVector hubs_, rest_;
+        ClusterLocalAccumulator hubAcc_;
+};
 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
-#endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
-  double t0, t1;
+// the vertices are visited one color class after another, with the
+// communities exchanged before, and updated after, every class (-c)
+class ColorOrder
+{
+    public:
+        ColorOrder(const long numColor, const ColorVector &vertexColor):
+            numColor_(numColor), vertexColor_(vertexColor) {}
 
-#ifdef DEBUG_PRINTF  
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
-#endif
+        // create a CSR-like datastructure for the vertex colors
+        void setup(const LouvainState &s)
+        {
+          const long numColor = numColor_;
+          std::vector<long> colorAdded(numColor, 0);
 
-  /*** Create a CSR-like datastructure for vertex-colors ***/
-  std::vector<long> colorPtr(numColor+1, 0);
-  std::vector<long> colorIndex(nv, 0);
-  std::vector<long> colorAdded(numColor, 0);
+          colorPtr_.assign(numColor+1, 0);
+          colorIndex_.assign(s.nv, 0);
 
-  // Count the size of each color	
+          // count the size of each color
 #ifdef OMP_SCHEDULE_RUNTIME
 #pragma omp parallel for firstprivate(numColor) schedule(runtime)
 #else
 #pragma omp parallel for firstprivate(numColor) schedule(static)
 #endif
-  for(long i=0; i < nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      __sync_fetch_and_add(&colorPtr[(long)start+1],1);
-  }
+          for (long i = 0; i < s.nv; i++) {
+              const long start = (vertexColor_[i] < 0)?(numColor-1):vertexColor_[i];
+              __sync_fetch_and_add(&colorPtr_[start+1], 1);
+          }
 
-  //Prefix sum:
-  for(long i=0; i<numColor; i++) {
-      colorPtr[i+1] += colorPtr[i];
-  }	
-  
-  //Group vertices with the same color in particular order
+          // prefix sum
+          for (long i = 0; i < numColor; i++)
+              colorPtr_[i+1] += colorPtr_[i];
+
+          // group vertices with the same color in particular order
 #ifdef OMP_SCHEDULE_RUNTIME
 #pragma omp parallel for firstprivate(numColor) schedule(runtime)
 #else
 #pragma omp parallel for firstprivate(numColor) schedule(static)
 #endif
-  for (long i=0; i<nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-      const long vindex = colorPtr[start] + __sync_fetch_and_add(&(colorAdded[start]), 1);
-      colorIndex[vindex] = i;
-  }
+          for (long i = 0; i < s.nv; i++) {
+              const long start = (vertexColor_[i] < 0)?(numColor-1):vertexColor_[i];
+              const long vindex = colorPtr_[start] + __sync_fetch_and_add(&(colorAdded[start]), 1);
+              colorIndex_[vindex] = i;
+          }
+        }
 
-  while(true) {
-      
-#ifdef DEBUG_PRINTF  
-      const double t2 = MPI_Wtime();
-      ofs << "Starting iteration: " << numIters << std::endl;
-#endif      
-      numIters++;	
-      long vc_count = 0;
+        template<class Termination, class Exchange>
+        long compute(LouvainState &s, Termination &term, Exchange &exch)
+        {
+          long frozen = 0;
+
+          for (long ci = 0; ci < numColor_; ci++) {
+              exch.fill(s);
+              term.refresh(s);
+              profiler.lap(PROFILE_EXCHANGE);
+
+              frozen += visitColor(s, term, ci);
+              profiler.lap(PROFILE_COMPUTE);
+
+              distUpdateCommunities(s, exch);
+              profiler.lap(PROFILE_UPDATE);
+          }
+
+          return frozen;
+        }
+
+        template<class Exchange>
+        void update(LouvainState &s, Exchange &exch) {}
+
+    protected:
+        template<class Termination>
+        long visitColor(LouvainState &s, Termination &term, const long ci) const
+        {
+          const long coloradj1 = colorPtr_[ci];
+          const long coloradj2 = colorPtr_[ci+1];
+          long frozen = 0;
 
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight) schedule(runtime)
+#pragma omp parallel for reduction(+: frozen) schedule(runtime)
 #else
-#pragma omp parallel for schedule(static) shared(clusterWeight)
+#pragma omp parallel for reduction(+: frozen) schedule(static)
 #endif
-      for (GraphElem i = 0L; i < nv; i++)
-          clusterWeight[i] = 0;
+          for (long k = coloradj1; k < coloradj2; k++)
+              frozen += distVisitVertex(s, term, colorIndex_[k]);
 
-      fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-                  rsizes, svdata, rvdata, currComm, localCinfo, 
-                  remoteCinfo, remoteComm, remoteCupdate);
-       
-#ifdef DEBUG_PRINTF  
-      t0 = MPI_Wtime();
-#endif
-      // Color loop
-      for(long ci = 0; ci < numColor; ci++) {
+          return frozen;
+        }
 
-          const long coloradj1 = colorPtr[ci];
-          const long coloradj2 = colorPtr[ci+1];
+        const long numColor_;
+        const ColorVector &vertexColor_;
+        std::vector<long> colorPtr_, colorIndex_;
+};
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, pastComm, dg, remoteCupdate, \
-        frozenClusterWeight, colorIndex), firstprivate(constantForSecondTerm) \
-          reduction(+:vc_count) schedule(runtime)
-#else
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, pastComm, dg, remoteCupdate, \
-        frozenClusterWeight, colorIndex), firstprivate(constantForSecondTerm) \
-          reduction(+:vc_count) schedule(static)
-#endif
-          for (long K = coloradj1; K < coloradj2; K++) {
-              if (!vActive[colorIndex[K]]) {
-                  clusterWeight[colorIndex[K]] = frozenClusterWeight[colorIndex[K]];
-                  vc_count++;
-                  continue;
-              }
-              else
-              {
-                  distExecuteLouvainIteration(colorIndex[K], dg, currComm, targetComm, 
-                          vDegree, localCinfo, localCupdate, remoteComm, remoteCinfo, 
-                          remoteCupdate, constantForSecondTerm, clusterWeight, me);
-                  frozenClusterWeight[colorIndex[K]] = clusterWeight[colorIndex[K]];
-              }
+// same as ColorOrder, except that the communication is exactly the
+// same as in the natural order, only the visit is arranged such that
+// adjacent local vertices are not processed at a time (-d)
+class VertexOrder: public ColorOrder
+{
+    public:
+        VertexOrder(const long numColor, const ColorVector &vertexColor):
+            ColorOrder(numColor, vertexColor) {}
+
+        template<class Termination, class Exchange>
+        long compute(LouvainState &s, Termination &term, Exchange &exch)
+        {
+          long frozen = 0;
+
+          exch.fill(s);
+          term.refresh(s);
+          profiler.lap(PROFILE_EXCHANGE);
+
+          for (long ci = 0; ci < numColor_; ci++)
+              frozen += visitColor(s, term, ci);
+
+          return frozen;
+        }
+
+        template<class Exchange>
+        void update(LouvainState &s, Exchange &exch)
+        {
+          distUpdateCommunities(s, exch);
+          profiler.lap(PROFILE_UPDATE);
+        }
+};
+
+#if defined(OMP_TARGET_OFFLOAD)
+// the (binary searched) index of a remote community, on the device
+#pragma omp declare target
+static inline GraphElem distDeviceRemoteIndex(const GraphElem *rcids, const GraphElem nr, 
+        const GraphElem comm)
+{
+  GraphElem lo = 0, hi = nr;
+
+  while (lo < hi) {
+      const GraphElem mid = lo + (hi - lo)/2;
+
+      if (rcids[mid] < comm)
+          lo = mid + 1;
+      else
+          hi = mid;
+  }
+
+  return lo;
+} // distDeviceRemoteIndex
+#pragma omp end declare target
+
+// distExecuteLouvainIteration on all the local vertices, with every
+// array a device pointer: the weights of the neighboring communities
+// of vertex i are summed in an open-addressing table of 2*(degree + 1)
+// slots at offset 2*(e0 + i) of the scratch arrays, and the community
+// of maximum gain is chosen as in distGetMaxIndex; the community updates
+// are atomic. Returns the number of vertices that moved.
+static GraphElem distDeviceMoveVertices(const int dev, const bool offload,
+        const GraphElem nv, const GraphElem base, const GraphElem bound,
+        const LocalElem *indexes, const LocalElem *tails, const GraphWeight *weights,
+        const GraphWeight *vDegree, const GraphElem *currComm, const GraphElem *remoteComm, 
+        const Comm *localCinfo, const GraphElem *remoteCids, const Comm *remoteCinfo, 
+        const GraphElem nr, GraphElem *targetComm, GraphWeight *clusterWeight, 
+        Comm *localCupdate, Comm *remoteCupdate, GraphElem *skeys, GraphWeight *sweights,
+        const GraphWeight constant)
+{
+  GraphElem moves = 0;
+
+#pragma omp target teams distribute parallel for if (target: offload) device(dev) \
+  is_device_ptr(indexes, tails, weights, vDegree, currComm, remoteComm, localCinfo, \
+          remoteCids, remoteCinfo, targetComm, clusterWeight, localCupdate, \
+          remoteCupdate, skeys, sweights) \
+  reduction(+: moves) map(tofrom: moves)
+  for (GraphElem i = 0; i < nv; i++) {
+      const GraphElem e0 = indexes[i], e1 = indexes[i + 1];
+      const GraphElem cc = currComm[i];
+
+      clusterWeight[i] = 0;
+
+      // an isolated vertex stays in its community
+      if (e0 == e1) {
+          targetComm[i] = cc;
+          continue;
+      }
+
+      const GraphElem cap = 2*(e1 - e0 + 1);
+      GraphElem *keys = skeys + 2*(e0 + i);
+      GraphWeight *sums = sweights + 2*(e0 + i);
+      GraphWeight selfLoop = 0.0, eix = 0.0;
+
+      for (GraphElem k = 0; k < cap; k++)
+          keys[k] = -1;
+
+      for (GraphElem j = e0; j < e1; j++) {
+          const GraphElem tail = tails[j];
+          const GraphElem tcomm = (tail < nv) ? currComm[tail] : remoteComm[tail - nv];
+          GraphElem h = static_cast<GraphElem>((static_cast<uint64_t>(tcomm) * 
+                      0x9E3779B97F4A7C15ULL) >> 32) % cap;
+
+          if (tail == i)
+              selfLoop += weights[j];
+          if (tcomm == cc)
+              eix += weights[j];
+
+          while ((keys[h] != -1) && (keys[h] != tcomm))
+              h = (h + 1 == cap) ? 0 : h + 1;
+
+          if (keys[h] == -1) {
+              keys[h] = tcomm;
+              sums[h] = weights[j];
           }
-      } // end of Color loop
-#ifdef DEBUG_PRINTF  
-      t1 = MPI_Wtime();
-      ofs << "Color iteration computation time: " << (t1 - t0) << std::endl;
-#endif      
- 
-      if (!ETLocalOrRemote) {
-          MPI_Allreduce(MPI_IN_PLACE, &vc_count, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
-          GraphWeight perc = 100.0 * ((GraphWeight)(tnv-vc_count)/(GraphWeight)tnv);
-          if (vc_count >= ET_CUTOFF) {
-              currMod = -1;
-              break;
+          else
+              sums[h] += weights[j];
+      }
+
+      clusterWeight[i] = eix;
+
+      const bool ccLocal = (cc >= base) && (cc < bound);
+      const GraphElem ccIndex = ccLocal ? -1 : distDeviceRemoteIndex(remoteCids, nr, cc);
+      const Comm &ccInfo = ccLocal ? localCinfo[cc - base] : remoteCinfo[ccIndex];
+      const GraphWeight vd = vDegree[i], scale = 2.0 * vd;
+      const GraphWeight ax = ccInfo.degree - vd;
+
+      eix -= selfLoop;
+
+      // the candidate of maximum (positive) gain, 
+      // with the lower community id on ties
+      GraphWeight maxGain = 0.0;
+      GraphElem target = -1, targetIndex = -1;
+
+      for (GraphElem k = 0; k < cap; k++) {
+          const GraphElem comm = keys[k];
+
+          if ((comm == -1) || (comm == cc))
+              continue;
+
+          const bool local = (comm >= base) && (comm < bound);
+          const GraphElem index = local ? -1 : distDeviceRemoteIndex(remoteCids, nr, comm);
+          const GraphWeight ay = local ? localCinfo[comm - base].degree : remoteCinfo[index].degree;
+          const GraphWeight gain = 2.0 * (sums[k] - eix) - scale * (ay - ax) * constant;
+
+          if ((gain > maxGain) || ((gain == maxGain) && (target != -1) && (comm < target))) {
+              maxGain = gain;
+              target = comm;
+              targetIndex = index;
           }
-      }     
-      
-      // update local cinfo
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(runtime)
-#else
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(static)
-#endif
-      for (GraphElem i = 0; i < nv; i++) {
-          localCinfo[i].size += localCupdate[i].size;
-          localCinfo[i].degree += localCupdate[i].degree;
+      }
+
+      // two singletons only merge into the lower id
+      if (target != -1) {
+          const GraphElem maxSize = (targetIndex == -1) ? localCinfo[target - base].size 
+              : remoteCinfo[targetIndex].size;
 
-          localCupdate[i].size = 0;
-          localCupdate[i].degree = 0;
+          if ((maxSize == 1) && (ccInfo.size == 1) && (target > cc))
+              target = -1;
       }
 
-      updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-      
-      // global modularity
-      currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
-      if ((currMod - prevMod) < threshMod) {
-#ifdef DEBUG_PRINTF  
-          ofs << "Break here - no updates " << std::endl;
-#endif
-          break;
+      if (target == -1) {
+          targetComm[i] = cc;
+          continue;
       }
-      prevMod = currMod;
-      if (prevMod < lower)
-          prevMod = lower;   
 
-      const GraphWeight one_minus_delta = (1.0 - ETDelta);
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for \
-    shared(pastComm, currComm, targetComm, vActive, p_curr, p_prev) \
-    firstprivate(numIters, one_minus_delta) schedule(runtime)
-#else
-#pragma omp parallel for \
-    shared(pastComm, currComm, targetComm, vActive, p_curr, p_prev) \
-    firstprivate(numIters, one_minus_delta) schedule(static)
-#endif
-    for (GraphElem i = 0; i < nv; i++) {
-        if (!vActive[i])
-            continue;
-        
-        if (numIters > 2 && (currComm[i] == pastComm[i])) {
-            p_curr[i] = p_prev[i]*one_minus_delta;
-            if (p_curr[i] <= P_CUTOFF)
-                vActive[i] = false;
+      Comm &from = ccLocal ? localCupdate[cc - base] : remoteCupdate[ccIndex];
+      Comm &to = (targetIndex == -1) ? localCupdate[target - base] : remoteCupdate[targetIndex];
+
+#pragma omp atomic update
+      from.degree -= vd;
+#pragma omp atomic update
+      from.size--;
+#pragma omp atomic update
+      to.degree += vd;
+#pragma omp atomic update
+      to.size++;
+
+      targetComm[i] = target;
+      moves++;
+  }
+
+  return moves;
+} // distDeviceMoveVertices
+
+// A device buffer (of the device of the process), that is grown 
+// as needed; with no device, the buffers are host memory
+class DeviceBuffer
+{
+    public:
+        DeviceBuffer(): ptr_(NULL), bytes_(0), dev_(0) {}
+        ~DeviceBuffer() { release(); }
+
+        template<class T>
+        T *get() const { return static_cast<T*>(ptr_); }
+
+        // make room for bytes, the contents are lost on growth
+        void reserve(const int dev, const size_t bytes)
+        {
+            if (bytes <= bytes_)
+                return;
+
+            release();
+            dev_ = dev;
+            bytes_ = bytes;
+            ptr_ = omp_target_alloc(bytes, dev);
+
+            if (!ptr_) {
+                std::cerr << "Error allocating " << bytes << " bytes on device " << dev << std::endl;
+                MPI_Abort(MPI_COMM_WORLD, -99);
+            }
         }
 
-        if (vActive[i]) 
+        void toDevice(const void *src, const size_t bytes)
         {
-            GraphElem tmp = pastComm[i];
-            pastComm[i] = currComm[i];
-            currComm[i] = targetComm[i];
-            targetComm[i] = tmp;
+            if (bytes)
+                omp_target_memcpy(ptr_, const_cast<void*>(src), bytes, 0, 0, 
+                        dev_, omp_get_initial_device());
         }
-    }
-    
-    // swap p_active k, k-1 iteration
-    std::swap(p_curr, p_prev);
-  }; // end while loop
 
-  cvect = pastComm;
-  iters = numIters;
+        void fromDevice(void *dst, const size_t bytes) const
+        {
+            if (bytes)
+                omp_target_memcpy(dst, ptr_, bytes, 0, 0, 
+                        omp_get_initial_device(), dev_);
+        }
 
-  vActive.clear();
-  frozenClusterWeight.clear();
-  p_curr.clear();
-  p_prev.clear();
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethodVertexOrder with early termination
+    private:
+        void release()
+        {
+            if (ptr_)
+                omp_target_free(ptr_, dev_);
+            ptr_ = NULL;
+            bytes_ = 0;
+        }
 
-GraphWeight distLouvainMethodWithColoringCommOpt(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters)
+        DeviceBuffer(const DeviceBuffer &);
+        DeviceBuffer &operator=(const DeviceBuffer &);
+
+        void *ptr_;
+        size_t bytes_;
+        int dev_;
+};
+
+// the vertices are visited in their natural order on the device
+// (device me % #devices) where the local graph (CSR offsets, local
+// tails and weights) stays for the phase, and only the vectors of 
+// the vertices and of the remote communities are copied in and out
+// every iteration, for the exchanges that remain on the host (-G);
+// with no device, the same kernel runs on the host
+class DeviceOrder
 {
-  // if no colors, then fall back to original distLouvain  
-  if (numColor == 1) {
-      ofs << "No color specified, executing non-color Louvain..." << std::endl;
-      return distLouvainMethod(me, nprocs, dg, ssz, rsz, ssizes, 
-              rsizes, svdata, rvdata, cvect, lower, thresh, iters);
-  }
-    
-  CommunityVector pastComm, currComm, targetComm; 
-  GraphWeightVector vDegree;
-  GraphWeightVector clusterWeight;
-  CommVector localCinfo, localCupdate;
+    public:
+        DeviceOrder(const int me)
+        {
+          const int ndevs = omp_get_num_devices();
 
-  VertexCommMap remoteComm;
-  CommMap remoteCinfo, remoteCupdate;
-  
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem tnv = dg.getTotalNumVertices();
-  const GraphElem nv = g.getNumVertices();
-  const GraphElem ne = g.getNumEdges();
-  const GraphWeight threshMod = thresh;
+          offload_ = (ndevs > 0);
+          dev_ = offload_ ? (me % ndevs) : omp_get_initial_device();
+        }
+
+        void setup(const LouvainState &s)
+        {
+          const GraphElem nv = s.nv, ne = s.g.getNumEdges();
+          GraphWeightVector weights(ne);
+
+#pragma omp parallel for schedule(static)
+          for (GraphElem j = 0; j < ne; j++)
+              weights[j] = s.g.getEdgeWeight(j);
+
+          indexes_.reserve(dev_, (nv + 1)*sizeof(LocalElem));
+          indexes_.toDevice(s.g.edgeListIndexes.data(), (nv + 1)*sizeof(LocalElem));
+          tails_.reserve(dev_, ne*sizeof(LocalElem));
+          tails_.toDevice(s.localTails.data(), ne*sizeof(LocalElem));
+          weights_.reserve(dev_, ne*sizeof(GraphWeight));
+          weights_.toDevice(weights.data(), ne*sizeof(GraphWeight));
+          vDegree_.reserve(dev_, nv*sizeof(GraphWeight));
+          vDegree_.toDevice(s.vDegree.data(), nv*sizeof(GraphWeight));
+
+          skeys_.reserve(dev_, 2*(ne + nv)*sizeof(GraphElem));
+          sweights_.reserve(dev_, 2*(ne + nv)*sizeof(GraphWeight));
+
+          currComm_.reserve(dev_, nv*sizeof(GraphElem));
+          targetComm_.reserve(dev_, nv*sizeof(GraphElem));
+          clusterWeight_.reserve(dev_, nv*sizeof(GraphWeight));
+          localCinfo_.reserve(dev_, nv*sizeof(Comm));
+          localCupdate_.reserve(dev_, nv*sizeof(Comm));
+        }
+
+        template<class Termination, class Exchange>
+        long compute(LouvainState &s, Termination &term, Exchange &exch)
+        {
+          exch.fill(s);
+          term.refresh(s);
+          profiler.lap(PROFILE_EXCHANGE);
+
+          const GraphElem nv = s.nv, ng = s.remoteComm.size(), nr = s.remoteCids.size();
+
+          currComm_.toDevice(s.currComm.data(), nv*sizeof(GraphElem));
+          localCinfo_.toDevice(s.localCinfo.data(), nv*sizeof(Comm));
+          localCupdate_.toDevice(s.localCupdate.data(), nv*sizeof(Comm));
+          remoteComm_.reserve(dev_, ng*sizeof(GraphElem));
+          remoteComm_.toDevice(s.remoteComm.data(), ng*sizeof(GraphElem));
+          remoteCids_.reserve(dev_, nr*sizeof(GraphElem));
+          remoteCids_.toDevice(s.remoteCids.data(), nr*sizeof(GraphElem));
+          remoteCinfo_.reserve(dev_, nr*sizeof(Comm));
+          remoteCinfo_.toDevice(s.remoteCinfo.data(), nr*sizeof(Comm));
+          remoteCupdate_.reserve(dev_, nr*sizeof(Comm));
+          remoteCupdate_.toDevice(s.remoteCupdate.data(), nr*sizeof(Comm));
+
+          const GraphElem moves = distDeviceMoveVertices(dev_, offload_, nv, s.base, s.bound,
+                  indexes_.get<LocalElem>(), tails_.get<LocalElem>(), weights_.get<GraphWeight>(),
+                  vDegree_.get<GraphWeight>(), currComm_.get<GraphElem>(), 
+                  remoteComm_.get<GraphElem>(), localCinfo_.get<Comm>(), 
+                  remoteCids_.get<GraphElem>(), remoteCinfo_.get<Comm>(), nr,
+                  targetComm_.get<GraphElem>(), clusterWeight_.get<GraphWeight>(), 
+                  localCupdate_.get<Comm>(), remoteCupdate_.get<Comm>(), 
+                  skeys_.get<GraphElem>(), sweights_.get<GraphWeight>(), 
+                  s.constantForSecondTerm);
+
+          targetComm_.fromDevice(s.targetComm.data(), nv*sizeof(GraphElem));
+          clusterWeight_.fromDevice(s.clusterWeight.data(), nv*sizeof(GraphWeight));
+          localCupdate_.fromDevice(s.localCupdate.data(), nv*sizeof(Comm));
+          remoteCupdate_.fromDevice(s.remoteCupdate.data(), nr*sizeof(Comm));
+
+          s.claccs[0].countMove(moves);
+
+          return 0;
+        }
+
+        template<class Exchange>
+        void update(LouvainState &s, Exchange &exch)
+        {
+          distUpdateCommunities(s, exch);
+          profiler.lap(PROFILE_UPDATE);
+        }
+
+    private:
+        int dev_;
+        bool offload_;
+
+        DeviceBuffer indexes_, tails_, weights_, vDegree_, skeys_, sweights_;
+        DeviceBuffer currComm_, targetComm_, clusterWeight_, localCinfo_, localCupdate_;
+        DeviceBuffer remoteComm_, remoteCids_, remoteCinfo_, remoteCupdate_;
+};
+#endif
 
-  GraphWeight constantForSecondTerm;
+// A phase of the method, with the vertex ordering, early termination
+// and communication policies (above) bound at compile time, so that
+// the loops over the vertices are specialized for each combination
+template<class Order, class Termination, class Exchange>
+static GraphWeight distLouvainEngine(const int me, const DistGraph &dg,
+        Order &order, Termination &term, Exchange &exch, CommunityVector &cvect,
+        const GraphWeight lower, const GraphWeight thresh, int& iters, 
+        const bool privateUpdates, const CommunityVector *initialComm = NULL)
+{
+  LouvainState s(dg, me);
   GraphWeight prevMod = lower;
   GraphWeight currMod = -1.0;
   int numIters = 0;
 
-  distInitLouvain(dg, pastComm, currComm, vDegree, clusterWeight, localCinfo, 
-          localCupdate, constantForSecondTerm, me);
-  targetComm.resize(nv);
+  distInitLouvain(dg, s.pastComm, s.currComm, s.vDegree, s.clusterWeight, s.localCinfo,
+          s.localCupdate, s.claccs, s.constantForSecondTerm, me, exch.comm());
+  s.targetComm.resize(s.nv);
 
-#ifdef DEBUG_PRINTF  
-  ofs << "constantForSecondTerm: " << constantForSecondTerm << std::endl;
-#endif
-  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
-  double t0, t1;
+  if (initialComm)
+      distSeedComm(dg, *initialComm, s.vDegree, s.pastComm, s.currComm, s.localCinfo, 
+              me, exch.comm());
 
-#ifdef DEBUG_PRINTF  
-  t0 = MPI_Wtime();
-#endif
-  exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, 
-          svdata, rvdata, me, nprocs);
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ofs << "Initial communication setup time: " << (t1 - t0) << std::endl;
+  if (privateUpdates)
+      s.cupdates.resize(omp_get_max_threads());
+
+#ifdef DEBUG_PRINTF
+  ofs << "constantForSecondTerm: " << s.constantForSecondTerm << std::endl;
 #endif
 
-  /*** Create a CSR-like datastructure for vertex-colors ***/
-  std::vector<long> colorPtr(numColor+1,0);
-  std::vector<long> colorIndex(nv,0);
-  std::vector<long> colorAdded(numColor,0);
+  exch.setup(s);
+  term.setup(s);
+  order.setup(s);
+  profiler.lap(PROFILE_SETUP);
 
-  // Count the size of each color	
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
+  while(true) {
+#ifdef DEBUG_PRINTF
+    ofs << "Starting iteration: " << numIters << std::endl;
 #endif
-  for(long i=0; i < nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-#pragma omp atomic update
-      colorPtr[start+1] += 1;
-  }
+    numIters++;
 
-  //Prefix sum:
-  for(long i=0; i<numColor; i++) {
-      colorPtr[i+1] += colorPtr[i];
-  }	
-  long added = -1;
-  //Group vertices with the same color in particular order
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for firstprivate(numColor) schedule(runtime)
-#else
-#pragma omp parallel for firstprivate(numColor) schedule(static)
+    long frozen = order.compute(s, term, exch);
+    profiler.lap(PROFILE_COMPUTE);
+
+    order.update(s, exch);
+
+    // a single reduction for the modularity and the frozen vertices
+    currMod = distComputeModularity(s.le_xx, s.la2_x, frozen,
+            s.constantForSecondTerm, exch.comm());
+    profiler.lap(PROFILE_MODULARITY);
+
+    if (term.cutoff(frozen)) {
+        exch.endIteration(s);
+        break;
+    }
+
+    if ((currMod - prevMod) < thresh) {
+#ifdef DEBUG_PRINTF
+        ofs << "Break here - no updates " << std::endl;
 #endif
-  for (long i=0; i<nv; i++) {
-      const long start = (vertexColor[i] < 0)?(numColor-1):vertexColor[i];
-#pragma omp atomic capture
-      added = colorAdded[start] += 1;
-      const long vindex = colorPtr[start] + added;
-      colorIndex[vindex] = i;
+        exch.endIteration(s);
+        break;
+    }
+
+    prevMod = currMod;
+
+    if (prevMod < lower)
+        prevMod = lower;
+
+    term.swap(s, numIters);
+    profiler.lap(PROFILE_LOCAL_UPDATE);
+    exch.endIteration(s);
+  };
+
+  cvect.swap(s.pastComm);
+  iters = numIters;
+
+  return prevMod;
+} // distLouvainEngine
+
+// instantiate the engine for the early termination of the options
+template<class Order, class Exchange>
+static GraphWeight distLouvainDispatch(const int me, const DistGraph &dg,
+        Order &order, Exchange &exch, CommunityVector &cvect, const GraphWeight lower,
+        const GraphWeight thresh, int& iters, const LouvainOptions &options)
+{
+  switch (options.termination) {
+      case INACTIVE_TERMINATION: {
+          InactiveTermination term(options.ETLocalOrRemote);
+          return distLouvainEngine(me, dg, order, term, exch, cvect, lower, thresh, iters, 
+                  options.privateUpdates, options.initialComm);
+      }
+      case PROBABILISTIC_TERMINATION: {
+          ProbabilisticTermination term(options.ETDelta, options.ETLocalOrRemote);
+          return distLouvainEngine(me, dg, order, term, exch, cvect, lower, thresh, iters, 
+                  options.privateUpdates, options.initialComm);
+      }
+      case FRONTIER_TERMINATION: {
+          FrontierTermination term(options.initialFrontier);
+          return distLouvainEngine(me, dg, order, term, exch, cvect, lower, thresh, iters, 
+                  options.privateUpdates, options.initialComm);
+      }
+      default: {
+          NoTermination term;
+          return distLouvainEngine(me, dg, order, term, exch, cvect, lower, thresh, iters, 
+                  options.privateUpdates, options.initialComm);
+      }
   }
+} // distLouvainDispatch
 
-  while(true) {
-      
-#ifdef DEBUG_PRINTF  
-      const double t2 = MPI_Wtime();
-      ofs << "Starting iteration: " << numIters << std::endl;
-#endif      
-      numIters++;	
-#ifdef DEBUG_PRINTF  
-      t0 = MPI_Wtime();
-#endif
+GraphWeight distLouvainMethod(const int me, const int nprocs, const DistGraph &dg,
+        size_t &ssz, size_t &rsz,
+        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes,
+        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
+        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh,
+        int& iters, const LouvainOptions &options)
+{
+  // if no colors, then fall back to original distLouvain
+  if (options.order != NATURAL_ORDER && options.numColor == 1) {
+      ofs << "No color specified, executing non-color Louvain..." << std::endl;
+      return distLouvainMethod(me, nprocs, dg, ssz, rsz, ssizes,
+              rsizes, svdata, rvdata, cvect, lower, thresh, iters);
+  }
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight) schedule(runtime)
+#if defined(USE_MPI_RMA)
+  RmaGhostExchange exch(nprocs, dg.getComm(), ssz, rsz, ssizes, rsizes, svdata, rvdata);
+#elif defined(USE_NODE_GHOST_CACHE)
+  NodeGhostExchange exch(nprocs, dg.getComm(), ssz, rsz, ssizes, rsizes, svdata, rvdata);
 #else
-#pragma omp parallel for schedule(static) shared(clusterWeight)
+  GhostExchange exch(nprocs, dg.getComm(), ssz, rsz, ssizes, rsizes, svdata, rvdata);
 #endif
-      for (GraphElem i = 0L; i < nv; i++)
-          clusterWeight[i] = 0;
 
-      // Color loop
-      for(long ci = 0; ci < numColor; ci++) {
+  if (options.order == COLOR_ORDER) {
+      ColorOrder order(options.numColor, *options.vertexColor);
+      return distLouvainDispatch(me, dg, order, exch, cvect, lower, thresh, iters, options);
+  }
 
-          fillRemoteCommunities(dg, me, nprocs, ssz, rsz, ssizes, 
-                  rsizes, svdata, rvdata, currComm, localCinfo, 
-                  remoteCinfo, remoteComm, remoteCupdate);
+  if (options.order == VERTEX_ORDER) {
+      VertexOrder order(options.numColor, *options.vertexColor);
+      return distLouvainDispatch(me, dg, order, exch, cvect, lower, thresh, iters, options);
+  }
 
-          const long coloradj1 = colorPtr[ci];
-          const long coloradj2 = colorPtr[ci+1];
+#if defined(OMP_TARGET_OFFLOAD)
+  if (options.deviceIteration) {
+      DeviceOrder order(me);
+      NoTermination term;
+      return distLouvainEngine(me, dg, order, term, exch, cvect, lower, thresh, iters, false, 
+              options.initialComm);
+  }
+#endif
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, dg, remoteCupdate, pastComm), \
-          firstprivate(me, constantForSecondTerm) schedule(runtime)
-#else
-#pragma omp parallel for shared(clusterWeight, localCupdate, currComm, targetComm, \
-        vDegree, localCinfo, remoteCinfo, remoteComm, dg, remoteCupdate, pastComm), \
-          firstprivate(me, constantForSecondTerm) schedule(static)
-#endif
-          for (long K = coloradj1; K < coloradj2; K++) {
-              distExecuteLouvainIteration(colorIndex[K], dg, currComm, targetComm, 
-                      vDegree, localCinfo, localCupdate, remoteComm, remoteCinfo, 
-                      remoteCupdate, constantForSecondTerm, clusterWeight, me);
-          }
+  if (options.hubDegree > 0) {
+      HubOrder order(options.hubDegree);
+      return distLouvainDispatch(me, dg, order, exch, cvect, lower, thresh, iters, options);
+  }
 
-          // update local cinfo
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(runtime)
-#else
-#pragma omp parallel for shared(localCinfo, localCupdate) schedule(static)
-#endif          
-          for (GraphElem i = 0; i < nv; i++) {
-              localCinfo[i].size += localCupdate[i].size;
-              localCinfo[i].degree += localCupdate[i].degree;
+  NaturalOrder order;
 
-              localCupdate[i].size = 0;
-              localCupdate[i].degree = 0;
-          }
-          
-          updateRemoteCommunities(dg, localCinfo, remoteCupdate, me, nprocs);
-      } // end of Color loop
-#ifdef DEBUG_PRINTF  
-      t1 = MPI_Wtime();
-      ofs << "Color iteration computation time: " << (t1 - t0) << std::endl;
-#endif      
-      
-      // global modularity
-      currMod = distComputeModularity(g, localCinfo, clusterWeight, constantForSecondTerm, me);
-      if ((currMod - prevMod) < threshMod) {
-#ifdef DEBUG_PRINTF  
-          ofs << "Break here - no updates " << std::endl;
-#endif
-          break;
-      }
-      
-      prevMod = currMod;
-      if (prevMod < lower)
-          prevMod = lower;   
+  if (options.overlapComm) {
+      OverlappedGhostExchange oexch(nprocs, dg.getComm(), ssz, rsz, ssizes, rsizes, svdata, rvdata);
+      return distLouvainDispatch(me, dg, order, oexch, cvect, lower, thresh, iters, options);
+  }
 
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm) \
-      schedule(runtime)
-#else
-#pragma omp parallel for \
-      shared(pastComm, currComm, targetComm) \
-      schedule(static)
-#endif
-      for (GraphElem i = 0L; i < nv; i++) {    
-          GraphElem tmp = pastComm[i];
-          pastComm[i] = currComm[i];
-          currComm[i] = targetComm[i];
-          targetComm[i] = tmp;       
-      }
-  }; // end while loop
+  return distLouvainDispatch(me, dg, order, exch, cvect, lower, thresh, iters, options);
+} // distLouvainMethod
 
-  cvect = pastComm;  
-  iters = numIters;
-  
-  vDegree.clear();
-  pastComm.clear();
-  currComm.clear();
-  targetComm.clear();
-  clusterWeight.clear();
-  localCinfo.clear();
-  localCupdate.clear();
-  
-  return prevMod;
-} // distLouvainMethodWithColoring + comm buffering
+GraphWeight distLouvainMethod(const int me, const int nprocs, const DistGraph &dg,
+        size_t &ssz, size_t &rsz,
+        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes,
+        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
+        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh,
+        int& iters)
+{
+  return distLouvainMethod(me, nprocs, dg, ssz, rsz, ssizes, rsizes, svdata,
+          rvdata, cvect, lower, thresh, iters, LouvainOptions());
+} // distLouvainMethod plain
+
+GraphWeight louvainMethodSharedMemory(const DistGraph &dg, CommunityVector &cvect,
+        const GraphWeight lower, const GraphWeight thresh, int& iters)
+{
+  NaturalOrder order;
+  NoTermination term;
+  NoExchange exch;
+
+  return distLouvainEngine(0, dg, order, term, exch, cvect, lower, thresh, iters, false);
+} // louvainMethodSharedMemory
 
 void distInitLouvain(const DistGraph &dg, CommunityVector &pastComm, 
         CommunityVector &currComm, GraphWeightVector &vDegree, 
         GraphWeightVector &clusterWeight, CommVector &localCinfo, 
-        CommVector &localCupdate, GraphWeight &constantForSecondTerm,
-        const int me)
+        CommVector &localCupdate, ClusterLocalAccumulatorVector &claccs,
+        GraphWeight &constantForSecondTerm, const int me, MPI_Comm comm)
 {
   const Graph &g = dg.getLocalGraph();
   const GraphElem base = dg.getBase(me);
   const GraphElem nv = g.getNumVertices();
+  GraphElem maxDegree = 0;
 
   vDegree.resize(nv);
   pastComm.resize(nv);
@@ -2153,9 +1951,26 @@ void distInitLouvain(const DistGraph &dg, CommunityVector &pastComm,
   localCupdate.resize(nv);
  
   distSumVertexDegree(g, vDegree, localCinfo);
-  constantForSecondTerm = distCalcConstantForSecondTerm(vDegree);
+  constantForSecondTerm = distCalcConstantForSecondTerm(vDegree, comm);
 
   distInitComm(pastComm, currComm, base);
+
+#pragma omp parallel for shared(g), reduction(max: maxDegree) schedule(static)
+  for (GraphElem i = 0; i < nv; i++) {
+    GraphElem e0, e1;
+    g.getEdgeRangeForVertex(i, e0, e1);
+    if ((e1 - e0) > maxDegree)
+        maxDegree = e1 - e0;
+  }
+
+  // one accumulator per thread, sized for the 
+  // maximum degree (+1 for the current community)
+  claccs.resize(omp_get_max_threads());
+
+#pragma omp parallel shared(claccs)
+  {
+      claccs[omp_get_thread_num()].reserve(maxDegree + 1);
+  }
 } // distInitLouvain
 
 void distSumVertexDegree(const Graph &g, GraphWeightVector &vDegree, CommVector &localCinfo)
@@ -2174,8 +1989,7 @@ void distSumVertexDegree(const Graph &g, GraphWeightVector &vDegree, CommVector
     g.getEdgeRangeForVertex(i, e0, e1);
 
     for (GraphElem k = e0; k < e1; k++) {
-      const Edge &edge = g.getEdge(k);
-      tw += edge.weight;
+      tw += g.getEdgeWeight(k);
     }
 
     vDegree[i] = tw;
@@ -2185,7 +1999,7 @@ void distSumVertexDegree(const Graph &g, GraphWeightVector &vDegree, CommVector
   }
 } // distSumVertexDegree
 
-GraphWeight distCalcConstantForSecondTerm(const GraphWeightVector &vDegree)
+GraphWeight distCalcConstantForSecondTerm(const GraphWeightVector &vDegree, MPI_Comm comm)
 {
   GraphWeight totalEdgeWeightTwice = 0;
   GraphWeight localWeight = 0;
@@ -2208,7 +2022,7 @@ GraphWeight distCalcConstantForSecondTerm(const GraphWeightVector &vDegree)
 
   // Global reduction
   MPI_Allreduce(&localWeight, &totalEdgeWeightTwice, 1, MPI_WEIGHT_TYPE, 
-          MPI_SUM, MPI_COMM_WORLD);
+          MPI_SUM, comm);
 
 #ifdef DEBUG_PRINTF  
   ofs << "Global: " << totalEdgeWeightTwice << std::endl;
@@ -2217,9 +2031,82 @@ GraphWeight distCalcConstantForSecondTerm(const GraphWeightVector &vDegree)
   return (1.0 / static_cast<GraphWeight>(totalEdgeWeightTwice));
 } // distCalcConstantForSecondTerm
 
-GraphElem distGetMaxIndex(const ClusterLocalMap &clmap, const GraphWeightVector &counter,
+// The gains of the candidate communities y (all but the current one,
+// x) are 2*(e_iy - e_ix) - 2*k_i*(a_y - a_x)*constant, computed over
+// contiguous arrays with AVX-512 or AVX2 when the build targets them
+// (for double weights), and by a (compiler vectorized) loop otherwise.
+// gains holds a_y on input, and the gains on output. Returns the
+// candidate of maximum gain with the lower community id on ties, or
+// -1 if no gain is positive.
+GraphElem distMaxGainCandidate(const GraphElem nc, const GraphElem *comms, 
+        const GraphWeight *eiy, GraphWeight *gains, const GraphWeight eix, 
+        const GraphWeight ax, const GraphWeight vDegree, const GraphWeight constant)
+{
+  const GraphWeight scale = 2.0 * vDegree;
+  GraphWeight maxGain = 0.0;
+  GraphElem k = 0;
+
+#if defined(__AVX512F__) && !defined(USE_32_BIT_GRAPH) && !defined(USE_32_BIT_WEIGHTS)
+  const __m512d veix = _mm512_set1_pd(eix), vax = _mm512_set1_pd(ax);
+  const __m512d vtwo = _mm512_set1_pd(2.0), vscale = _mm512_set1_pd(scale);
+  const __m512d vconstant = _mm512_set1_pd(constant);
+  __m512d vmax = _mm512_setzero_pd();
+
+  for (; k + 8 <= nc; k += 8) {
+      const __m512d vgain = _mm512_sub_pd(
+              _mm512_mul_pd(vtwo, _mm512_sub_pd(_mm512_loadu_pd(eiy + k), veix)),
+              _mm512_mul_pd(_mm512_mul_pd(vscale, _mm512_sub_pd(_mm512_loadu_pd(gains + k), vax)), 
+                  vconstant));
+      _mm512_storeu_pd(gains + k, vgain);
+      vmax = _mm512_max_pd(vmax, vgain);
+  }
+
+  maxGain = _mm512_reduce_max_pd(vmax);
+#elif defined(__AVX2__) && !defined(USE_32_BIT_GRAPH) && !defined(USE_32_BIT_WEIGHTS)
+  const __m256d veix = _mm256_set1_pd(eix), vax = _mm256_set1_pd(ax);
+  const __m256d vtwo = _mm256_set1_pd(2.0), vscale = _mm256_set1_pd(scale);
+  const __m256d vconstant = _mm256_set1_pd(constant);
+  __m256d vmax = _mm256_setzero_pd();
+
+  for (; k + 4 <= nc; k += 4) {
+      const __m256d vgain = _mm256_sub_pd(
+              _mm256_mul_pd(vtwo, _mm256_sub_pd(_mm256_loadu_pd(eiy + k), veix)),
+              _mm256_mul_pd(_mm256_mul_pd(vscale, _mm256_sub_pd(_mm256_loadu_pd(gains + k), vax)), 
+                  vconstant));
+      _mm256_storeu_pd(gains + k, vgain);
+      vmax = _mm256_max_pd(vmax, vgain);
+  }
+
+  double lanes[4];
+  _mm256_storeu_pd(lanes, vmax);
+  maxGain = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+
+  // the remainder (or all of the candidates, without AVX)
+#pragma omp simd reduction(max: maxGain)
+  for (GraphElem j = k; j < nc; j++) {
+      gains[j] = 2.0 * (eiy[j] - eix) - scale * (gains[j] - ax) * constant;
+      maxGain = std::max(maxGain, gains[j]);
+  }
+
+  if (maxGain <= 0.0)
+      return -1;
+
+  GraphElem maxIndex = -1;
+
+  for (GraphElem j = 0; j < nc; j++) {
+      if ((gains[j] == maxGain) && ((maxIndex == -1) || (comms[j] < comms[maxIndex])))
+          maxIndex = j;
+  }
+
+  return maxIndex;
+} // distMaxGainCandidate
+
+// the first community of clacc is the current one
+GraphElem distGetMaxIndex(ClusterLocalAccumulator &clacc,
 			  const GraphWeight selfLoop, const CommVector &localCinfo, 
-			  const CommMap &remoteCinfo,
+			  const GraphElemVector &remoteCids,
+			  const CommVector &remoteCinfo,
 			  const GraphWeight vDegree, 
                           const GraphElem currSize,
                           const GraphWeight currDegree, 
@@ -2228,82 +2115,107 @@ GraphElem distGetMaxIndex(const ClusterLocalMap &clmap, const GraphWeightVector
 			  const GraphElem bound,
 			  const GraphWeight constant)
 {
-  ClusterLocalMap::const_iterator storedAlready;
-  GraphElem maxIndex = currComm;
-  GraphWeight curGain = 0.0, maxGain = 0.0;
-  GraphWeight eix = static_cast<GraphWeight>(counter[0]) - static_cast<GraphWeight>(selfLoop);
+  const GraphElem nc = clacc.size();
+#ifdef DEBUG_PRINTF  
+  assert(nc > 0);
+  assert(clacc.community(0) == currComm);
+#endif
+  if (nc == 1)
+      return currComm;
 
-  GraphWeight ax = currDegree - vDegree;
-  GraphWeight eiy = 0.0, ay = 0.0;
+  const GraphElem *comms = clacc.communities().data();
+  GraphWeight *ay = clacc.gains();
 
-  GraphElem maxSize = currSize; 
-  GraphElem size = 0;
+  // the degrees of the candidates, local ones by direct 
+  // access, remote ones by searching the sorted ids
+  for (GraphElem k = 1; k < nc; k++) {
+      const GraphElem comm = comms[k];
 
-  storedAlready = clmap.begin();
-#ifdef DEBUG_PRINTF  
-  assert(storedAlready != clmap.end());
-#endif
-  do {
-      if (currComm != storedAlready->first) {
+      if ((comm >= base) && (comm < bound))
+          ay[k] = localCinfo[comm - base].degree;
+      else
+          ay[k] = remoteCinfo[distGetRemoteCommIndex(remoteCids, comm)].degree;
+  }
 
-          // is_local, direct access local info
-          if ((storedAlready->first >= base) && (storedAlready->first < bound)) {
-              ay = localCinfo[storedAlready->first-base].degree;
-              size = localCinfo[storedAlready->first - base].size;   
-          }
-          else {
-              // is_remote, lookup map
-              CommMap::const_iterator citer = remoteCinfo.find(storedAlready->first);
-              ay = citer->second.degree;
-              size = citer->second.size; 
-          }
+  const GraphWeight eix = static_cast<GraphWeight>(clacc.weight(0)) - static_cast<GraphWeight>(selfLoop);
+  const GraphWeight ax = currDegree - vDegree;
 
-          eiy = counter[storedAlready->second];
+  const GraphElem k = distMaxGainCandidate(nc - 1, comms + 1, clacc.weights().data() + 1, 
+          ay + 1, eix, ax, vDegree, constant);
 
-          curGain = 2.0 * (eiy - eix) - 2.0 * vDegree * (ay - ax) * constant;
+  if (k == -1)
+      return currComm;
 
-          if ((curGain > maxGain) ||
-                  ((curGain == maxGain) && (curGain != 0.0) && (storedAlready->first < maxIndex))) {
-              maxGain = curGain;
-              maxIndex = storedAlready->first;
-              maxSize = size;
-          }
-      }
-      storedAlready++;
-  } while (storedAlready != clmap.end());
+  const GraphElem maxIndex = comms[k + 1];
+  const GraphElem maxSize = ((maxIndex >= base) && (maxIndex < bound)) ? localCinfo[maxIndex - base].size 
+      : remoteCinfo[distGetRemoteCommIndex(remoteCids, maxIndex)].size;
 
+  // two singletons only merge into the lower id
   if ((maxSize == 1) && (currSize == 1) && (maxIndex > currComm))
-    maxIndex = currComm;
+    return currComm;
 
   return maxIndex;
 } // distGetMaxIndex
 
 void distExecuteLouvainIteration(const GraphElem i, const DistGraph &dg,
+				 const LocalElemVector &localTails,
 				 const CommunityVector &currComm,
 				 CommunityVector &targetComm,
 			         const GraphWeightVector &vDegree,
                                  CommVector &localCinfo, 
                                  CommVector &localCupdate,
-				 const VertexCommMap &remoteComm,
-                                 const CommMap &remoteCinfo,
-                                 CommMap &remoteCupdate,
+				 const CommunityVector &remoteComm,
+                                 const GraphElemVector &remoteCids,
+                                 const CommVector &remoteCinfo,
+                                 CommVector &remoteCupdate,
                                  const GraphWeight constantForSecondTerm,
                                  GraphWeightVector &clusterWeight, 
+                                 ClusterLocalAccumulator &clacc,
+                                 CommUpdateAccumulator *cupdate,
 				 const int me)
 {
-  GraphElem localTarget = -1;
   GraphElem e0, e1; 
-  GraphWeight selfLoop = 0.0;
-  ClusterLocalMap clmap;
-  GraphWeightVector counter;
+  const Graph &g = dg.getLocalGraph();
+  const GraphElem cc = currComm[i];
+
+  g.getEdgeRangeForVertex(i, e0, e1);
+
+  // an isolated vertex stays in its community
+  if (e0 == e1) {
+    targetComm[i] = cc;
+    return;
+  }
+
+  clacc.clear();
+  clacc.reserve(e1 - e0 + 1);
+  clacc.add(cc, 0.0);
+
+  const GraphWeight selfLoop = distBuildLocalMapCounter(e0, e1, clacc, localTails, 
+          g, currComm, remoteComm, i);
+
+  distMoveVertex(i, dg, currComm, targetComm, vDegree, localCinfo, localCupdate, 
+          remoteCids, remoteCinfo, remoteCupdate, constantForSecondTerm, clusterWeight, 
+          clacc, cupdate, selfLoop, me);
+} // distExecuteLouvainIteration
+
+void distMoveVertex(const GraphElem i, const DistGraph &dg,
+        const CommunityVector &currComm, CommunityVector &targetComm,
+        const GraphWeightVector &vDegree, CommVector &localCinfo, 
+        CommVector &localCupdate, const GraphElemVector &remoteCids, 
+        const CommVector &remoteCinfo, CommVector &remoteCupdate,
+        const GraphWeight constantForSecondTerm, GraphWeightVector &clusterWeight, 
+        ClusterLocalAccumulator &clacc, CommUpdateAccumulator *cupdate,
+        const GraphWeight selfLoop, const int me)
+{
+  GraphElem localTarget = -1;
 
   const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
-  const Graph &g = dg.getLocalGraph();
   const GraphElem cc = currComm[i];
   GraphWeight ccDegree;
   GraphElem ccSize;  
   bool currCommIsLocal=false; 
   bool targetCommIsLocal=false;
+  GraphElem ccIndex = -1, targetIndex = -1;
 
   // Current Community is local
   if (cc >= base && cc < bound) {
@@ -2312,35 +2224,33 @@ void distExecuteLouvainIteration(const GraphElem i, const DistGraph &dg,
         currCommIsLocal=true;
   } else {
   // is remote
-        CommMap::const_iterator citer = remoteCinfo.find(cc);
-	ccDegree = citer->second.degree;
- 	ccSize = citer->second.size;
+        ccIndex = distGetRemoteCommIndex(remoteCids, cc);
+	ccDegree = remoteCinfo[ccIndex].degree;
+ 	ccSize = remoteCinfo[ccIndex].size;
 	currCommIsLocal=false;
   }
 
-  g.getEdgeRangeForVertex(i, e0, e1);
-
-  if (e0 != e1) {
-    clmap.insert(ClusterLocalMap::value_type(cc, 0));
-    counter.push_back(0.0);
+  clusterWeight[i] += clacc.weight(0);
 
-    selfLoop =  distBuildLocalMapCounter(e0, e1, clmap, counter, g, currComm, remoteComm, i, base, bound);
-
-    clusterWeight[i] += counter[0];
-
-    localTarget = distGetMaxIndex(clmap, counter, selfLoop, localCinfo, remoteCinfo, vDegree[i], ccSize, ccDegree, cc, base, bound, constantForSecondTerm);
-  
-  }
-  else
-    localTarget = cc;
+  localTarget = distGetMaxIndex(clacc, selfLoop, localCinfo, remoteCids, remoteCinfo, vDegree[i], ccSize, ccDegree, cc, base, bound, constantForSecondTerm);
 
    // is the Target Local?
    if (localTarget >= base && localTarget < bound) {
       targetCommIsLocal = true;
    }
+   else if (localTarget != cc)
+      targetIndex = distGetRemoteCommIndex(remoteCids, localTarget);
+
+  // per-thread sums, merged after the vertices are visited
+  if ((localTarget != cc) && (localTarget != -1) && cupdate) {
+      const GraphElem nv = localCupdate.size();
+
+      cupdate->add(currCommIsLocal ? (cc - base) : (nv + ccIndex), -vDegree[i], -1);
+      cupdate->add(targetCommIsLocal ? (localTarget - base) : (nv + targetIndex), vDegree[i], 1);
+  }
   
   // current and target comm are local - atomic updates to vectors
-  if ((localTarget != cc) && (localTarget != -1) && currCommIsLocal && targetCommIsLocal) {
+  if ((localTarget != cc) && (localTarget != -1) && !cupdate && currCommIsLocal && targetCommIsLocal) {
         
 #ifdef DEBUG_PRINTF  
         assert( base < localTarget < bound);
@@ -2359,207 +2269,128 @@ void distExecuteLouvainIteration(const GraphElem i, const DistGraph &dg,
      }	
 
   // current is local, target is not - do atomic on local, accumulate in Maps for remote
-  if ((localTarget != cc) && (localTarget != -1) && currCommIsLocal && !targetCommIsLocal) {
+  if ((localTarget != cc) && (localTarget != -1) && !cupdate && currCommIsLocal && !targetCommIsLocal) {
         #pragma omp atomic update
         localCupdate[cc-base].degree -= vDegree[i];
         #pragma omp atomic update
         localCupdate[cc-base].size--;
  
-        // search target!     
-        CommMap::iterator iter=remoteCupdate.find(localTarget);
- 
         #pragma omp atomic update
-        iter->second.degree += vDegree[i];
+        remoteCupdate[targetIndex].degree += vDegree[i];
         #pragma omp atomic update
-        iter->second.size++;
+        remoteCupdate[targetIndex].size++;
   }
         
    // current is remote, target is local - accumulate for current, atomic on local
-   if ((localTarget != cc) && (localTarget != -1) && !currCommIsLocal && targetCommIsLocal) {
+   if ((localTarget != cc) && (localTarget != -1) && !cupdate && !currCommIsLocal && targetCommIsLocal) {
         #pragma omp atomic update
         localCupdate[localTarget-base].degree += vDegree[i];
         #pragma omp atomic update
         localCupdate[localTarget-base].size++;
        
-        // search current 
-        CommMap::iterator iter=remoteCupdate.find(cc);
-  
         #pragma omp atomic update
-        iter->second.degree -= vDegree[i];
+        remoteCupdate[ccIndex].degree -= vDegree[i];
         #pragma omp atomic update
-        iter->second.size--;
+        remoteCupdate[ccIndex].size--;
    }
                     
    // current and target are remote - accumulate for both
-   if ((localTarget != cc) && (localTarget != -1) && !currCommIsLocal && !targetCommIsLocal) {
+   if ((localTarget != cc) && (localTarget != -1) && !cupdate && !currCommIsLocal && !targetCommIsLocal) {
        
-        // search current 
-        CommMap::iterator iter=remoteCupdate.find(cc);
-  
         #pragma omp atomic update
-        iter->second.degree -= vDegree[i];
+        remoteCupdate[ccIndex].degree -= vDegree[i];
         #pragma omp atomic update
-        iter->second.size--;
+        remoteCupdate[ccIndex].size--;
    
-        // search target
-        iter=remoteCupdate.find(localTarget);
-  
         #pragma omp atomic update
-        iter->second.degree += vDegree[i];
+        remoteCupdate[targetIndex].degree += vDegree[i];
         #pragma omp atomic update
-        iter->second.size++;
+        remoteCupdate[targetIndex].size++;
    }
 
 #ifdef DEBUG_PRINTF  
   assert(localTarget != -1);
 #endif
+  if (localTarget != cc)
+      clacc.countMove();
+
   targetComm[i] = localTarget;
-} // distExecuteLouvainIteration
+} // distMoveVertex
 
 GraphWeight distBuildLocalMapCounter(const GraphElem e0, const GraphElem e1,
-				   ClusterLocalMap &clmap, 
-				   GraphWeightVector &counter,
+				   ClusterLocalAccumulator &clacc,
+				   const LocalElemVector &localTails,
 				   const Graph &g, const CommunityVector &currComm,
-				   const VertexCommMap &remoteComm,
-				   const GraphElem vertex, 
-				   const GraphElem base, const GraphElem bound)
+				   const CommunityVector &remoteComm,
+				   const GraphElem vertex)
 {
-  GraphElem numUniqueClusters = 1L;
   GraphWeight selfLoop = 0.0;
-  ClusterLocalMap::const_iterator storedAlready;
+  const GraphElem nv = currComm.size();
 
   for (GraphElem j = e0; j < e1; j++) {
         
-    const Edge &edge = g.getEdge(j);
-    const GraphElem &tail = edge.tail;
-    const GraphWeight &weight = edge.weight;
+    const GraphElem tail = localTails[j];
+    const GraphWeight weight = g.getEdgeWeight(j);
     GraphElem tcomm;
 
-    if (tail == vertex + base)
+    if (tail == vertex)
       selfLoop += weight;
 
+    // tails are ghost-renumbered: [0, nv) are local,
+    // and nv + k is the k-th ghost vertex
+    if (tail < nv)
+      tcomm = currComm[tail];
+    else
+      tcomm = remoteComm[tail - nv];
 
-    // is_local, direct access local CommunityVector
-    if ((tail >= base) && (tail < bound))
-      tcomm = currComm[tail - base];
-    else { // is_remote, lookup map
-      VertexCommMap::const_iterator iter = remoteComm.find(tail);
-
-#ifdef DEBUG_PRINTF  
-      assert(iter != remoteComm.end());
-#endif
-      tcomm = iter->second;
-    }
-
-    storedAlready = clmap.find(tcomm);
-    
-    if (storedAlready != clmap.end())
-      counter[storedAlready->second] += weight;
-    else {
-        clmap.insert(ClusterLocalMap::value_type(tcomm, numUniqueClusters));
-        counter.push_back(weight);
-        numUniqueClusters++;
-    }
+    clacc.add(tcomm, weight);
   }
 
   return selfLoop;
 } // distBuildLocalMapCounter
 
-GraphWeight distComputeModularity(const Graph &g, CommVector &localCinfo,
-			     const GraphWeightVector &clusterWeight,
-			     const GraphWeight constantForSecondTerm,
-			     const int me)
+GraphWeight distComputeModularity(const GraphWeight le_xx, const GraphWeight la2_x,
+        long &frozen, const GraphWeight constantForSecondTerm, MPI_Comm comm)
 {
-  const GraphElem nv = g.getNumVertices();
-
-  GraphWeight le_la_xx[2];
-  GraphWeight e_a_xx[2] = {0.0, 0.0};
-  GraphWeight le_xx = 0.0, la2_x = 0.0;
-
-#ifdef DEBUG_PRINTF  
-  assert((clusterWeight.size() == nv));
-#endif
-
-const GraphWeight* clusterWeight_ptr = clusterWeight.data();
-const Comm* localCinfo_ptr = localCinfo.data();
-#ifdef OMP_TARGET_OFFLOAD
-int size;
-int ndevs = omp_get_num_devices();
-int to_offload = (ndevs > 0);
-#pragma omp target parallel for if (to_offload) \
-reduction(+:le_xx) \
-reduction(+:la2_x) \
-map(tofrom:le_xx, la2_x) \
-map(to:clusterWeight_ptr[0:nv], localCinfo_ptr[0:nv]) \
-device(me % ndevs)
-#elif OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for default(shared), shared(clusterWeight, localCinfo), \
-  reduction(+: le_xx), reduction(+: la2_x) schedule(runtime)
-#else
-#pragma omp parallel for default(shared), shared(clusterWeight, localCinfo), \
-  reduction(+: le_xx), reduction(+: la2_x) schedule(static)
-#endif
-  for (GraphElem i = 0L; i < nv; i++) {
-    le_xx += clusterWeight_ptr[i];
-    la2_x += static_cast<GraphWeight>(localCinfo_ptr[i].degree) * static_cast<GraphWeight>(localCinfo_ptr[i].degree);
-  }
-  le_la_xx[0] = le_xx;
-  le_la_xx[1] = la2_x;
+  // the counts are exact in double precision
+  double sums[3] = {static_cast<double>(le_xx), static_cast<double>(la2_x), 
+      static_cast<double>(frozen)};
 
 #ifdef DEBUG_PRINTF  
   const double t0 = MPI_Wtime();
 #endif
 
-  MPI_Allreduce(le_la_xx, e_a_xx, 2, MPI_WEIGHT_TYPE, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(MPI_IN_PLACE, sums, 3, MPI_DOUBLE, MPI_SUM, comm);
 
 #ifdef DEBUG_PRINTF  
   const double t1 = MPI_Wtime();
 #endif
+  const GraphWeight e_xx = sums[0], a2_x = sums[1];
+  frozen = static_cast<long>(sums[2]);
+
 #if defined(ABS_MOD_PER_ITER)
-  GraphWeight currMod = std::fabs((e_a_xx[0] * constantForSecondTerm) - 
-                        (e_a_xx[1] * constantForSecondTerm * constantForSecondTerm));
+  GraphWeight currMod = std::fabs((e_xx * constantForSecondTerm) - 
+                        (a2_x * constantForSecondTerm * constantForSecondTerm));
 #else
-  GraphWeight currMod = ((e_a_xx[0] * constantForSecondTerm) - 
-                        (e_a_xx[1] * constantForSecondTerm * constantForSecondTerm));
+  GraphWeight currMod = ((e_xx * constantForSecondTerm) - 
+                        (a2_x * constantForSecondTerm * constantForSecondTerm));
 #endif
 #ifdef DEBUG_PRINTF  
   ofs << "le_xx: " << le_xx << ", la2_x: " << la2_x << std::endl;
-  ofs << "e_xx: " << e_a_xx[0] << ", a2_x: " << e_a_xx[1] << ", currMod: " << currMod << std::endl;
+  ofs << "e_xx: " << e_xx << ", a2_x: " << a2_x << ", currMod: " << currMod << std::endl;
   ofs << "Reduction time: " << (t1 - t0) << std::endl;
 #endif
 
   return currMod;
 } // distComputeModularity
 
-void distUpdateLocalCinfo(CommVector &localCinfo, const CommVector &localCupdate)
+GraphElem distGetRemoteCommIndex(const GraphElemVector &remoteCids, const GraphElem comm)
 {
-    size_t csz = localCinfo.size();
-
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp for schedule(runtime)
-#else
-#pragma omp for schedule(static)
-#endif
-    for (GraphElem i = 0L; i < csz; i++) {
-        localCinfo[i].size += localCupdate[i].size;
-        localCinfo[i].degree += localCupdate[i].degree;
-    }
-}
-
-void distCleanCWandCU(const GraphElem nv, GraphWeightVector &clusterWeight,
-        CommVector &localCupdate)
-{
-#ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp for schedule(runtime)
-#else
-#pragma omp for schedule(static)
+#ifdef DEBUG_PRINTF  
+  assert(std::binary_search(remoteCids.begin(), remoteCids.end(), comm));
 #endif
-    for (GraphElem i = 0L; i < nv; i++) {
-        clusterWeight[i] = 0;
-        localCupdate[i].degree = 0;
-        localCupdate[i].size = 0;
-    }
-} // distCleanCWandCU
+  return (std::lower_bound(remoteCids.begin(), remoteCids.end(), comm) - remoteCids.begin());
+} // distGetRemoteCommIndex
 
 void distInitComm(CommunityVector &pastComm, CommunityVector &currComm, const GraphElem base)
 {
@@ -2580,20 +2411,92 @@ void distInitComm(CommunityVector &pastComm, CommunityVector &currComm, const Gr
   }
 } // distInitComm
 
+void distSeedComm(const DistGraph &dg, const CommunityVector &initialComm, 
+        const GraphWeightVector &vDegree, CommunityVector &pastComm, 
+        CommunityVector &currComm, CommVector &localCinfo, const int me, MPI_Comm comm)
+{
+  const GraphElem nv = currComm.size();
+  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
+  int nprocs;
+
+  MPI_Comm_size(comm, &nprocs);
+
+  std::copy(initialComm.begin(), initialComm.begin() + nv, currComm.begin());
+  std::copy(initialComm.begin(), initialComm.begin() + nv, pastComm.begin());
+
+  // the vertices grouped by community, the sums of the 
+  // remote communities go to their owners
+  std::vector<GraphElem> order(nv);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&] (const GraphElem a, const GraphElem b) 
+          { return currComm[a] < currComm[b]; });
+
+  std::vector<CommInfoVector> remoteArray(nprocs);
+
+  for (GraphElem i = 0; i < nv; i++) {
+      localCinfo[i].size = 0;
+      localCinfo[i].degree = 0;
+  }
+
+  for (GraphElem k = 0; k < nv; ) {
+      const GraphElem c = currComm[order[k]];
+      CommInfo info = {c, 0, 0.0};
+
+      for (; k < nv && currComm[order[k]] == c; k++) {
+          info.size++;
+          info.degree += vDegree[order[k]];
+      }
+
+      if (c >= base && c < bound) {
+          localCinfo[c - base].size += info.size;
+          localCinfo[c - base].degree += info.degree;
+      }
+      else
+          remoteArray[dg.getOwner(c)].push_back(info);
+  }
+
+  std::vector<int> scounts(nprocs), rcounts(nprocs), sdispls(nprocs, 0), rdispls(nprocs, 0);
+  CommInfoVector sdata, rdata;
+
+  for (int p = 0; p < nprocs; p++) {
+      scounts[p] = remoteArray[p].size();
+      if (p > 0)
+          sdispls[p] = sdispls[p-1] + scounts[p-1];
+      sdata.insert(sdata.end(), remoteArray[p].begin(), remoteArray[p].end());
+  }
+
+  MPI_Alltoall(scounts.data(), 1, MPI_INT, rcounts.data(), 1, MPI_INT, comm);
+
+  for (int p = 1; p < nprocs; p++)
+      rdispls[p] = rdispls[p-1] + rcounts[p-1];
+  rdata.resize(rdispls[nprocs-1] + rcounts[nprocs-1]);
+
+  MPI_Alltoallv(sdata.data(), scounts.data(), sdispls.data(), commType, 
+          rdata.data(), rcounts.data(), rdispls.data(), commType, comm);
+
+  for (const CommInfo &curr : rdata) {
+      localCinfo[curr.community - base].size += curr.size;
+      localCinfo[curr.community - base].degree += curr.degree;
+  }
+} // distSeedComm
+
 void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
         const size_t &ssz, const size_t &rsz, const std::vector<GraphElem> &ssizes, 
         const std::vector<GraphElem> &rsizes, const std::vector<GraphElem> &svdata, 
         const std::vector<GraphElem> &rvdata, const CommunityVector &currComm, 
-        const CommVector &localCinfo, CommMap &remoteCinfo, VertexCommMap &remoteComm, 
-        CommMap &remoteCupdate)
+        const CommVector &localCinfo, GraphElemVector &remoteCids, CommVector &remoteCinfo, 
+        CommunityVector &remoteComm, CommVector &remoteCupdate)
 {
-  std::vector<GraphElem> rcdata(rsz), scdata(ssz);
-  GraphElem spos, rpos;
-#if defined(REPLACE_STL_UOSET_WITH_VECTOR)
-  std::vector< std::vector< GraphElem > > rcinfo(nprocs);
+  // communities of the ghost vertices are received directly
+  // into remoteComm, in the (sorted) order of rvdata
+  remoteComm.resize(rsz);
+  GraphElem *rcdata = remoteComm.data();
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+  std::vector<GraphElem> &scdata = ghostNbrs.scdata;
 #else
-  std::vector<std::unordered_set<GraphElem> > rcinfo(nprocs);
+  std::vector<GraphElem> scdata(ssz);
 #endif
+  GraphElem spos, rpos;
 #ifdef DEBUG_PRINTF  
   double t0, t1, ta = 0.0;
 #endif
@@ -2618,15 +2521,27 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
     scdata[i] = comm;
   }
 
-  std::vector<GraphElem> rcsizes(nprocs), scsizes(nprocs);
-  CommInfoVector sinfo, rinfo;
-
 #ifdef DEBUG_PRINTF  
   t0 = MPI_Wtime();
 #endif
   spos = 0;
   rpos = 0;
-#if defined(USE_MPI_COLLECTIVES)
+  profiler.count(PROFILE_GHOSTS, rsz);
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+  profiler.count(PROFILE_BYTES_SENT, ssz*sizeof(GraphElem));
+#if MPI_VERSION >= 4
+  MPI_Start(&ghostNbrs.creq);
+  MPI_Wait(&ghostNbrs.creq, MPI_STATUS_IGNORE);
+  std::copy(ghostNbrs.rcdata.begin(), ghostNbrs.rcdata.end(), rcdata);
+#else
+  MPI_Neighbor_alltoallv(scdata.data(), ghostNbrs.scnts.data(), ghostNbrs.sdispls.data(), 
+          MPI_GRAPH_TYPE, rcdata, ghostNbrs.rcnts.data(), ghostNbrs.rdispls.data(), 
+          MPI_GRAPH_TYPE, ghostNbrs.comm);
+#endif
+  spos = ssz;
+  rpos = rsz;
+#elif defined(USE_MPI_COLLECTIVES)
+  profiler.count(PROFILE_BYTES_SENT, ssz*sizeof(GraphElem));
   std::vector<int> scnts(nprocs), rcnts(nprocs), sdispls(nprocs), rdispls(nprocs);
   for (int i = 0; i < nprocs; i++) {
       scnts[i] = ssizes[i];
@@ -2639,24 +2554,38 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
   scnts[me] = 0;
   rcnts[me] = 0;
   MPI_Alltoallv(scdata.data(), scnts.data(), sdispls.data(), 
-          MPI_GRAPH_TYPE, rcdata.data(), rcnts.data(), rdispls.data(), 
-          MPI_GRAPH_TYPE, MPI_COMM_WORLD);
+          MPI_GRAPH_TYPE, rcdata, rcnts.data(), rdispls.data(), 
+          MPI_GRAPH_TYPE, dg.getComm());
 #elif defined(USE_MPI_SENDRECV)
+  profiler.count(PROFILE_BYTES_SENT, ssz*sizeof(GraphElem));
   for (int i = 0; i < nprocs; i++) {
       if (i != me)
           MPI_Sendrecv(scdata.data() + spos, ssizes[i], MPI_GRAPH_TYPE, i, CommunityTag, 
-                  rcdata.data() + rpos, rsizes[i], MPI_GRAPH_TYPE, i, CommunityTag, 
-                  MPI_COMM_WORLD, MPI_STATUSES_IGNORE);
+                  rcdata + rpos, rsizes[i], MPI_GRAPH_TYPE, i, CommunityTag, 
+                  dg.getComm(), MPI_STATUSES_IGNORE);
 
       spos += ssizes[i];
       rpos += rsizes[i];
   }
 #else
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+  // after the first exchange of a phase, only the 
+  // ghosts whose community changed are sent
+  if (ghostSent.valid) {
+      exchangeGhostCommunityDeltas(me, nprocs, dg.getComm(), ssizes, rsizes, scdata, remoteComm);
+      spos = ssz;
+      rpos = rsz;
+  }
+  else {
+  ghostSent.sent = scdata;
+  ghostSent.valid = true;
+#endif
+  profiler.count(PROFILE_BYTES_SENT, ssz*sizeof(GraphElem));
   std::vector<MPI_Request> rreqs(nprocs), sreqs(nprocs);
   for (int i = 0; i < nprocs; i++) {
     if (i != me)
-      MPI_Irecv(rcdata.data() + rpos, rsizes[i], MPI_GRAPH_TYPE, i, 
-              CommunityTag, MPI_COMM_WORLD, &rreqs[i]);
+      MPI_Irecv(rcdata + rpos, rsizes[i], MPI_GRAPH_TYPE, i, 
+              CommunityTag, dg.getComm(), &rreqs[i]);
     else
       rreqs[i] = MPI_REQUEST_NULL;
 
@@ -2665,7 +2594,7 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
   for (int i = 0; i < nprocs; i++) {
     if (i != me)
       MPI_Isend(scdata.data() + spos, ssizes[i], MPI_GRAPH_TYPE, i, 
-              CommunityTag, MPI_COMM_WORLD, &sreqs[i]);
+              CommunityTag, dg.getComm(), &sreqs[i]);
     else
       sreqs[i] = MPI_REQUEST_NULL;
 
@@ -2674,12 +2603,54 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
 
   MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
   MPI_Waitall(nprocs, rreqs.data(), MPI_STATUSES_IGNORE);
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+  }
+#endif
 #endif
 #ifdef DEBUG_PRINTF  
   t1 = MPI_Wtime();
   ta += (t1 - t0);
 #endif
 
+#ifdef DEBUG_PRINTF  
+  ofs << "Ghost communities MPI time: " << ta << std::endl;
+#endif
+
+  exchangeRemoteCommunityInfo(dg, me, nprocs, currComm, localCinfo, 
+          remoteComm, remoteCids, remoteCinfo, remoteCupdate);
+} // fillRemoteCommunities
+
+// find the remote communities (of the ghost vertices and of the
+// local vertices), and get their info from the owner processes
+void exchangeRemoteCommunityInfo(const DistGraph &dg, const int me, const int nprocs,
+        const CommunityVector &currComm, const CommVector &localCinfo, 
+        const CommunityVector &remoteComm, GraphElemVector &remoteCids, 
+        CommVector &remoteCinfo, CommVector &remoteCupdate)
+{
+  const GraphElem *rcdata = remoteComm.data();
+  GraphElem spos = 0, rpos = remoteComm.size();
+#if defined(REPLACE_STL_UOSET_WITH_VECTOR)
+  std::vector< std::vector< GraphElem > > rcinfo(nprocs);
+#else
+  ArenaScope scope; // the sets, per iteration
+  std::vector<std::unordered_set<GraphElem, std::hash<GraphElem>, std::equal_to<GraphElem>,
+      TempAllocator<GraphElem> > > rcinfo(nprocs);
+#endif
+#ifdef DEBUG_PRINTF  
+  double t0, t1, ta = 0.0;
+#endif
+
+  const GraphElem base = dg.getBase(me);
+  const GraphElem nv = dg.getLocalGraph().getNumVertices();
+
+  std::vector<GraphElem> rcsizes(nprocs), scsizes(nprocs);
+  CommInfoVector sinfo, rinfo;
+#if defined(USE_MPI_COLLECTIVES)
+  std::vector<int> scnts(nprocs), rcnts(nprocs), sdispls(nprocs), rdispls(nprocs);
+#elif !defined(USE_MPI_SENDRECV)
+  std::vector<MPI_Request> rreqs(nprocs), sreqs(nprocs);
+#endif
+
   // reserve vectors
 #if defined(REPLACE_STL_UOSET_WITH_VECTOR)
   for (GraphElem i = 0; i < nprocs; i++) {
@@ -2687,12 +2658,8 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
   }
 #endif
 
-  remoteComm.clear();
   for (GraphElem i = 0; i < rpos; i++) {
     const GraphElem comm = rcdata[i];
-
-    remoteComm.insert(VertexCommMap::value_type(rvdata[i], comm));
-
     const int tproc = dg.getOwner(comm);
 
     if (tproc != me)
@@ -2715,25 +2682,49 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
 #endif
   }
 
+  // request the remote communities from each owner in
+  // sorted order, so that the replies (and hence remoteCids)
+  // are sorted by community id
+  std::vector<std::vector<GraphElem> > rclist(nprocs);
+
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for shared(rcinfo, rclist) schedule(runtime)
+#else
+#pragma omp parallel for shared(rcinfo, rclist) schedule(dynamic)
+#endif
+  for (int i = 0; i < nprocs; i++) {
+#if defined(REPLACE_STL_UOSET_WITH_VECTOR)
+    rclist[i].swap(rcinfo[i]);
+    std::sort(rclist[i].begin(), rclist[i].end());
+    rclist[i].erase(std::unique(rclist[i].begin(), rclist[i].end()), rclist[i].end());
+#else
+    rclist[i].assign(rcinfo[i].begin(), rcinfo[i].end());
+    std::sort(rclist[i].begin(), rclist[i].end());
+#endif
+  }
+
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+  if (!fillRemoteCommunityInfoNeighbors(rclist, localCinfo, base, rinfo, me, nprocs, dg.getComm())) {
+#endif
 #ifdef DEBUG_PRINTF  
   t0 = MPI_Wtime();
 #endif
   GraphElem stcsz = 0, rtcsz = 0;
   
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for shared(scsizes, rcinfo) \
+#pragma omp parallel for shared(scsizes, rclist) \
   reduction(+:stcsz) schedule(runtime)
 #else
-#pragma omp parallel for shared(scsizes, rcinfo) \
+#pragma omp parallel for shared(scsizes, rclist) \
   reduction(+:stcsz) schedule(static)
 #endif
   for (int i = 0; i < nprocs; i++) {
-    scsizes[i] = rcinfo[i].size();
+    scsizes[i] = rclist[i].size();
     stcsz += scsizes[i];
   }
 
   MPI_Alltoall(scsizes.data(), 1, MPI_GRAPH_TYPE, rcsizes.data(), 
-          1, MPI_GRAPH_TYPE, MPI_COMM_WORLD);
+          1, MPI_GRAPH_TYPE, dg.getComm());
 
 #ifdef DEBUG_PRINTF  
   t1 = MPI_Wtime();
@@ -2757,14 +2748,11 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
 #if defined(USE_MPI_COLLECTIVES)
   std::vector<GraphElem> rcomms(rtcsz), scomms(stcsz);
 #else
-#if defined(REPLACE_STL_UOSET_WITH_VECTOR)
   std::vector<GraphElem> rcomms(rtcsz);
-#else
-  std::vector<GraphElem> rcomms(rtcsz), scomms(stcsz);
-#endif
 #endif
   sinfo.resize(rtcsz);
   rinfo.resize(stcsz);
+  profiler.count(PROFILE_BYTES_SENT, stcsz*sizeof(GraphElem) + rtcsz*sizeof(CommInfo));
 
 #ifdef DEBUG_PRINTF  
   t0 = MPI_Wtime();
@@ -2774,7 +2762,7 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
 #if defined(USE_MPI_COLLECTIVES)
   for (int i = 0; i < nprocs; i++) {
       if (i != me) {
-          std::copy(rcinfo[i].begin(), rcinfo[i].end(), scomms.data() + spos);
+          std::copy(rclist[i].begin(), rclist[i].end(), scomms.data() + spos);
       }
       scnts[i] = scsizes[i];
       rcnts[i] = rcsizes[i];
@@ -2787,15 +2775,15 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
   rcnts[me] = 0;
   MPI_Alltoallv(scomms.data(), scnts.data(), sdispls.data(), 
           MPI_GRAPH_TYPE, rcomms.data(), rcnts.data(), rdispls.data(), 
-          MPI_GRAPH_TYPE, MPI_COMM_WORLD);
+          MPI_GRAPH_TYPE, dg.getComm());
 
   for (int i = 0; i < nprocs; i++) {
       if (i != me) {
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for , shared(rcsizes, rcomms, localCinfo, sinfo, rdispls), \
+#pragma omp parallel for shared(rcsizes, rcomms, localCinfo, sinfo, rdispls), \
           firstprivate(i), schedule(runtime) /*, if(rcsizes[i] >= 1000) */
 #else
-#pragma omp parallel for , shared(rcsizes, rcomms, localCinfo, sinfo, rdispls), \
+#pragma omp parallel for shared(rcsizes, rcomms, localCinfo, sinfo, rdispls), \
           firstprivate(i), schedule(guided) /*, if(rcsizes[i] >= 1000) */
 #endif
           for (GraphElem j = 0; j < rcsizes[i]; j++) {
@@ -2807,7 +2795,7 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
   
   MPI_Alltoallv(sinfo.data(), rcnts.data(), rdispls.data(), 
           commType, rinfo.data(), scnts.data(), sdispls.data(), 
-          commType, MPI_COMM_WORLD);
+          commType, dg.getComm());
 #else
 #if !defined(USE_MPI_SENDRECV)
   std::vector<MPI_Request> rcreqs(nprocs);
@@ -2815,27 +2803,14 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
   for (int i = 0; i < nprocs; i++) {
       if (i != me) {
 #if defined(USE_MPI_SENDRECV)
-#if defined(REPLACE_STL_UOSET_WITH_VECTOR)
-          MPI_Sendrecv(rcinfo[i].data(), scsizes[i], MPI_GRAPH_TYPE, i, CommunityTag, 
-                  rcomms.data() + rpos, rcsizes[i], MPI_GRAPH_TYPE, i, CommunityTag, 
-                  MPI_COMM_WORLD, MPI_STATUSES_IGNORE);
-#else
-          std::copy(rcinfo[i].begin(), rcinfo[i].end(), scomms.data() + spos);
-          MPI_Sendrecv(scomms.data() + spos, scsizes[i], MPI_GRAPH_TYPE, i, CommunityTag, 
+          MPI_Sendrecv(rclist[i].data(), scsizes[i], MPI_GRAPH_TYPE, i, CommunityTag, 
                   rcomms.data() + rpos, rcsizes[i], MPI_GRAPH_TYPE, i, CommunityTag, 
-                  MPI_COMM_WORLD, MPI_STATUSES_IGNORE);
-#endif
+                  dg.getComm(), MPI_STATUSES_IGNORE);
 #else
           MPI_Irecv(rcomms.data() + rpos, rcsizes[i], MPI_GRAPH_TYPE, i, 
-                  CommunityTag, MPI_COMM_WORLD, &rreqs[i]);
-#if defined(REPLACE_STL_UOSET_WITH_VECTOR)
-          MPI_Isend(rcinfo[i].data(), scsizes[i], MPI_GRAPH_TYPE, i, 
-                  CommunityTag, MPI_COMM_WORLD, &sreqs[i]);
-#else
-          std::copy(rcinfo[i].begin(), rcinfo[i].end(), scomms.data() + spos);
-          MPI_Isend(scomms.data() + spos, scsizes[i], MPI_GRAPH_TYPE, i, 
-                  CommunityTag, MPI_COMM_WORLD, &sreqs[i]);
-#endif
+                  CommunityTag, dg.getComm(), &rreqs[i]);
+          MPI_Isend(rclist[i].data(), scsizes[i], MPI_GRAPH_TYPE, i, 
+                  CommunityTag, dg.getComm(), &sreqs[i]);
 #endif
       }
       else {
@@ -2866,10 +2841,10 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
       if (i != me) {
 #if defined(USE_MPI_SENDRECV)
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp parallel for , shared(rcsizes, rcomms, localCinfo, sinfo), \
+#pragma omp parallel for shared(rcsizes, rcomms, localCinfo, sinfo), \
           firstprivate(i, rpos, base), schedule(runtime) /*, if(rcsizes[i] >= 1000)*/
 #else
-#pragma omp parallel for , shared(rcsizes, rcomms, localCinfo, sinfo), \
+#pragma omp parallel for shared(rcsizes, rcomms, localCinfo, sinfo), \
           firstprivate(i, rpos, base), schedule(guided) /*, if(rcsizes[i] >= 1000)*/
 #endif
           for (GraphElem j = 0; j < rcsizes[i]; j++) {
@@ -2879,10 +2854,10 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
           
           MPI_Sendrecv(sinfo.data() + rpos, rcsizes[i], commType, i, CommunityDataTag, 
                   rinfo.data() + spos, scsizes[i], commType, i, CommunityDataTag, 
-                  MPI_COMM_WORLD, MPI_STATUSES_IGNORE);
+                  dg.getComm(), MPI_STATUSES_IGNORE);
 #else
           MPI_Irecv(rinfo.data() + spos, scsizes[i], commType, i, CommunityDataTag, 
-                  MPI_COMM_WORLD, &rcreqs[i]);
+                  dg.getComm(), &rcreqs[i]);
 
           // poke progress on last isend/irecvs
 #if defined(POKE_PROGRESS_FOR_COMMUNITY_SENDRECV_IN_LOOP)
@@ -2908,7 +2883,7 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
           }
 
           MPI_Isend(sinfo.data() + rpos, rcsizes[i], commType, i, CommunityDataTag, 
-                  MPI_COMM_WORLD, &sreqs[i]);
+                  dg.getComm(), &sreqs[i]);
 #endif
       }
       else {
@@ -2917,44 +2892,261 @@ void fillRemoteCommunities(const DistGraph &dg, const int me, const int nprocs,
           sreqs[i] = MPI_REQUEST_NULL;
 #endif
       }
-      rpos += rcsizes[i];
-      spos += scsizes[i];
+      rpos += rcsizes[i];
+      spos += scsizes[i];
+  }
+
+#if !defined(USE_MPI_SENDRECV)
+  MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
+  MPI_Waitall(nprocs, rcreqs.data(), MPI_STATUSES_IGNORE);
+#endif
+
+#endif
+
+#ifdef DEBUG_PRINTF  
+  t1 = MPI_Wtime();
+  ta += (t1 - t0);
+#endif
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+  }
+#endif
+
+  const GraphElem nrcomms = rinfo.size();
+
+  remoteCids.resize(nrcomms);
+  remoteCinfo.resize(nrcomms);
+  remoteCupdate.resize(nrcomms);
+
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for shared(rinfo, remoteCids, remoteCinfo, remoteCupdate) schedule(runtime)
+#else
+#pragma omp parallel for shared(rinfo, remoteCids, remoteCinfo, remoteCupdate) schedule(static)
+#endif
+  for (GraphElem i = 0; i < nrcomms; i++) {
+      remoteCids[i] = rinfo[i].community;
+      remoteCinfo[i].size = rinfo[i].size;
+      remoteCinfo[i].degree = rinfo[i].degree;
+      remoteCupdate[i] = Comm();
+  }
+
+#ifdef DEBUG_PRINTF  
+  ofs << "Actual MPI time: " << ta << std::endl;
+#endif
+} // exchangeRemoteCommunityInfo
+
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+// send (position in the segment of the receiver, community)
+// pairs for the ghosts whose community changed since the last 
+// exchange, and patch remoteComm with the received pairs
+void exchangeGhostCommunityDeltas(const int me, const int nprocs, MPI_Comm comm,
+        const std::vector<GraphElem> &ssizes, const std::vector<GraphElem> &rsizes, 
+        const std::vector<GraphElem> &scdata, CommunityVector &remoteComm)
+{
+  std::vector<GraphElem> &sent = ghostSent.sent;
+  std::vector<GraphElem> sdisp(nprocs + 1, 0), rdisp(nprocs + 1, 0);
+  std::vector<std::vector<GraphElem> > sdelta(nprocs);
+  std::vector<GraphElem> dsizes(nprocs), rdsizes(nprocs);
+
+  std::partial_sum(ssizes.begin(), ssizes.end(), sdisp.begin() + 1);
+  std::partial_sum(rsizes.begin(), rsizes.end(), rdisp.begin() + 1);
+
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for shared(sdelta, sent, scdata, sdisp) schedule(runtime)
+#else
+#pragma omp parallel for shared(sdelta, sent, scdata, sdisp) schedule(dynamic)
+#endif
+  for (int p = 0; p < nprocs; p++) {
+      for (GraphElem i = sdisp[p]; i < sdisp[p + 1]; i++) {
+          if (scdata[i] != sent[i]) {
+              sdelta[p].push_back(i - sdisp[p]);
+              sdelta[p].push_back(scdata[i]);
+              sent[i] = scdata[i];
+          }
+      }
+      dsizes[p] = sdelta[p].size();
+  }
+
+  MPI_Alltoall(dsizes.data(), 1, MPI_GRAPH_TYPE, rdsizes.data(), 
+          1, MPI_GRAPH_TYPE, comm);
+  profiler.count(PROFILE_BYTES_SENT, (std::accumulate(dsizes.begin(), dsizes.end(), 
+              GraphElem(0)) - dsizes[me])*sizeof(GraphElem));
+
+  std::vector<GraphElem> rddisp(nprocs + 1, 0);
+  std::partial_sum(rdsizes.begin(), rdsizes.end(), rddisp.begin() + 1);
+  std::vector<GraphElem> rdelta(rddisp[nprocs]);
+  std::vector<MPI_Request> rreqs(nprocs), sreqs(nprocs);
+
+  for (int p = 0; p < nprocs; p++) {
+      if ((p != me) && (rdsizes[p] > 0))
+          MPI_Irecv(rdelta.data() + rddisp[p], rdsizes[p], MPI_GRAPH_TYPE, p, 
+                  CommunityTag, comm, &rreqs[p]);
+      else
+          rreqs[p] = MPI_REQUEST_NULL;
+  }
+  for (int p = 0; p < nprocs; p++) {
+      if ((p != me) && (dsizes[p] > 0))
+          MPI_Isend(sdelta[p].data(), dsizes[p], MPI_GRAPH_TYPE, p, 
+                  CommunityTag, comm, &sreqs[p]);
+      else
+          sreqs[p] = MPI_REQUEST_NULL;
+  }
+
+  MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
+  MPI_Waitall(nprocs, rreqs.data(), MPI_STATUSES_IGNORE);
+
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for shared(rdelta, rddisp, rdisp, remoteComm) schedule(runtime)
+#else
+#pragma omp parallel for shared(rdelta, rddisp, rdisp, remoteComm) schedule(dynamic)
+#endif
+  for (int p = 0; p < nprocs; p++) {
+      for (GraphElem k = rddisp[p]; k < rddisp[p + 1]; k += 2)
+          remoteComm[rdisp[p] + rdelta[k]] = rdelta[k + 1];
+  }
+
+#ifdef DEBUG_PRINTF  
+  ofs << "Ghost community changes sent: " << std::accumulate(dsizes.begin(), 
+          dsizes.end(), GraphElem(0))/2 << std::endl;
+#endif
+} // exchangeGhostCommunityDeltas
+#endif
+
+// interior vertices have no ghost neighbors
+void distClassifyVertices(const Graph &g, const LocalElemVector &localTails, 
+        GraphElemVector &interior, GraphElemVector &boundary)
+{
+  const GraphElem nv = g.getNumVertices();
+
+  interior.clear();
+  boundary.clear();
+
+  for (GraphElem i = 0; i < nv; i++) {
+      GraphElem e0, e1;
+      bool isInterior = true;
+
+      g.getEdgeRangeForVertex(i, e0, e1);
+
+      for (GraphElem j = e0; j < e1; j++) {
+          if (localTails[j] >= nv) {
+              isInterior = false;
+              break;
+          }
+      }
+
+      if (isInterior)
+          interior.push_back(i);
+      else
+          boundary.push_back(i);
   }
+} // distClassifyVertices
 
-#if !defined(USE_MPI_SENDRECV)
-  MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
-  MPI_Waitall(nprocs, rcreqs.data(), MPI_STATUSES_IGNORE);
-#endif
+// true if the community of (interior) vertex i and the 
+// communities of its neighbors are owned by this process
+bool distHasLocalCommunities(const GraphElem i, const Graph &g, 
+        const LocalElemVector &localTails, const CommunityVector &currComm, 
+        const GraphElem base, const GraphElem bound)
+{
+  GraphElem e0, e1;
+
+  if ((currComm[i] < base) || (currComm[i] >= bound))
+      return false;
+
+  g.getEdgeRangeForVertex(i, e0, e1);
+
+  for (GraphElem j = e0; j < e1; j++) {
+      const GraphElem comm = currComm[localTails[j]];
+
+      if ((comm < base) || (comm >= bound))
+          return false;
+  }
+
+  return true;
+} // distHasLocalCommunities
+
+// non-blocking version of the ghost community exchange of
+// fillRemoteCommunities, completed by waitGhostCommunities
+void postGhostCommunities(const DistGraph &dg, const int me, const int nprocs,
+        const size_t &ssz, const size_t &rsz, const std::vector<GraphElem> &ssizes, 
+        const std::vector<GraphElem> &rsizes, const std::vector<GraphElem> &svdata, 
+        const CommunityVector &currComm, CommunityVector &remoteComm, 
+        GhostCommunityRequests &greqs)
+{
+  const GraphElem base = dg.getBase(me);
 
+  remoteComm.resize(rsz);
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+  std::vector<GraphElem> &scdata = ghostNbrs.scdata;
+#else
+  std::vector<GraphElem> &scdata = greqs.scdata;
+  scdata.resize(ssz);
 #endif
 
-#ifdef DEBUG_PRINTF  
-  t1 = MPI_Wtime();
-  ta += (t1 - t0);
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for shared(svdata, scdata, currComm) schedule(runtime)
+#else
+#pragma omp parallel for shared(svdata, scdata, currComm) schedule(static)
 #endif
+  for (GraphElem i = 0; i < ssz; i++)
+    scdata[i] = currComm[svdata[i] - base];
+
+  profiler.count(PROFILE_GHOSTS, rsz);
+  profiler.count(PROFILE_BYTES_SENT, ssz*sizeof(GraphElem));
 
-  remoteCinfo.clear();
-  remoteCupdate.clear();
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+#if MPI_VERSION >= 4
+  greqs.reqs.clear();
+  MPI_Start(&ghostNbrs.creq);
+#else
+  greqs.reqs.resize(1);
+  MPI_Ineighbor_alltoallv(scdata.data(), ghostNbrs.scnts.data(), ghostNbrs.sdispls.data(), 
+          MPI_GRAPH_TYPE, remoteComm.data(), ghostNbrs.rcnts.data(), ghostNbrs.rdispls.data(), 
+          MPI_GRAPH_TYPE, ghostNbrs.comm, &greqs.reqs[0]);
+#endif
+#else
+  GraphElem spos = 0, rpos = 0;
 
-  for (GraphElem i = 0; i < stcsz; i++) {
-      const GraphElem ccomm = rinfo[i].community;
+  greqs.reqs.resize(2*nprocs);
 
-      Comm comm;
+  for (int i = 0; i < nprocs; i++) {
+    if (i != me)
+      MPI_Irecv(remoteComm.data() + rpos, rsizes[i], MPI_GRAPH_TYPE, i, 
+              CommunityTag, dg.getComm(), &greqs.reqs[i]);
+    else
+      greqs.reqs[i] = MPI_REQUEST_NULL;
 
-      comm.size = rinfo[i].size;
-      comm.degree = rinfo[i].degree;
+    rpos += rsizes[i];
+  }
+  for (int i = 0; i < nprocs; i++) {
+    if (i != me)
+      MPI_Isend(scdata.data() + spos, ssizes[i], MPI_GRAPH_TYPE, i, 
+              CommunityTag, dg.getComm(), &greqs.reqs[nprocs + i]);
+    else
+      greqs.reqs[nprocs + i] = MPI_REQUEST_NULL;
 
-      remoteCinfo.insert(CommMap::value_type(ccomm, comm));
-      remoteCupdate.insert(CommMap::value_type(ccomm, Comm()));
+    spos += ssizes[i];
   }
+#endif
+} // postGhostCommunities
 
-#ifdef DEBUG_PRINTF  
-  ofs << "Actual MPI time: " << ta << std::endl;
+void waitGhostCommunities(GhostCommunityRequests &greqs, CommunityVector &remoteComm)
+{
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES) && (MPI_VERSION >= 4)
+  MPI_Wait(&ghostNbrs.creq, MPI_STATUS_IGNORE);
+  std::copy(ghostNbrs.rcdata.begin(), ghostNbrs.rcdata.end(), remoteComm.begin());
+#else
+  MPI_Waitall(greqs.reqs.size(), greqs.reqs.data(), MPI_STATUSES_IGNORE);
 #endif
-} // end fillRemoteCommunityMap
+} // waitGhostCommunities
+
+// the types are created by the first create, and freed by the last 
+// destroy (bin/graphClustering, and every call of cluster, see vite.hpp)
+static int communityTypeRefs = 0;
 
 void createCommunityMPIType()
 {
+  if (communityTypeRefs++ > 0)
+      return;
+
   CommInfo cinfo;
 
   MPI_Aint begin, community, size, degree;
@@ -2970,39 +3162,267 @@ void createCommunityMPIType()
 
   MPI_Type_create_struct(3, blens, displ, types, &commType);
   MPI_Type_commit(&commType);
+
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+  CommDelta cdelta;
+
+  MPI_Aint dbegin, dindex, dsize, ddegree;
+
+  MPI_Get_address(&cdelta, &dbegin);
+  MPI_Get_address(&cdelta.index, &dindex);
+  MPI_Get_address(&cdelta.size, &dsize);
+  MPI_Get_address(&cdelta.degree, &ddegree);
+
+  MPI_Aint ddispl[] = { dindex - dbegin, dsize - dbegin, ddegree - dbegin };
+  MPI_Datatype dtypes[] = { MPI_LOCAL_TYPE, MPI_LOCAL_TYPE, MPI_WEIGHT_TYPE };
+
+  MPI_Type_create_struct(3, blens, ddispl, dtypes, &commDeltaType);
+  MPI_Type_commit(&commDeltaType);
+#endif
 } // createCommunityMPIType
 
 void destroyCommunityMPIType()
-{ MPI_Type_free(&commType); } // destroyCommunityMPIType
+{ 
+  if (--communityTypeRefs > 0)
+      return;
+
+  MPI_Type_free(&commType); 
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+  MPI_Type_free(&commDeltaType);
+#endif
+} // destroyCommunityMPIType
+
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+void createGhostNeighborhood(const size_t &ssz, const size_t &rsz,
+        const std::vector<GraphElem> &ssizes, const std::vector<GraphElem> &rsizes, 
+        const int me, const int nprocs, MPI_Comm comm)
+{
+  GhostNeighborhood &nb = ghostNbrs;
+
+  destroyGhostNeighborhood();
+
+  nb.ranks.clear();
+  nb.index.assign(nprocs, -1);
+  nb.scnts.clear();
+  nb.sdispls.clear();
+  nb.rcnts.clear();
+  nb.rdispls.clear();
+
+  // the neighborhood is symmetric (a process is a neighbor 
+  // if it sends or receives ghosts), so that it can be used 
+  // for the replies of the community info requests 
+  GraphElem spos = 0, rpos = 0;
+
+  for (int p = 0; p < nprocs; p++) {
+      if ((p != me) && ((ssizes[p] > 0) || (rsizes[p] > 0))) {
+          nb.index[p] = nb.ranks.size();
+          nb.ranks.push_back(p);
+          nb.scnts.push_back(ssizes[p]);
+          nb.sdispls.push_back(spos);
+          nb.rcnts.push_back(rsizes[p]);
+          nb.rdispls.push_back(rpos);
+      }
+
+      spos += ssizes[p];
+      rpos += rsizes[p];
+  }
+
+  const int nn = nb.ranks.size();
+
+  MPI_Dist_graph_create_adjacent(comm, nn, nb.ranks.data(), MPI_UNWEIGHTED, 
+          nn, nb.ranks.data(), MPI_UNWEIGHTED, MPI_INFO_NULL, 0, &nb.comm);
+
+  nb.scdata.resize(ssz);
+  nb.cscnts.resize(nn);
+  nb.csdispls.resize(nn);
+  nb.crcnts.resize(nn);
+  nb.crdispls.resize(nn);
+  nb.commsOnNeighbors = false;
+
+#if MPI_VERSION >= 4
+  nb.rcdata.resize(rsz);
+  MPI_Neighbor_alltoallv_init(nb.scdata.data(), nb.scnts.data(), nb.sdispls.data(), 
+          MPI_GRAPH_TYPE, nb.rcdata.data(), nb.rcnts.data(), nb.rdispls.data(), 
+          MPI_GRAPH_TYPE, nb.comm, MPI_INFO_NULL, &nb.creq);
+#endif
+
+#ifdef DEBUG_PRINTF  
+  ofs << "Number of neighbor processes: " << nn << std::endl;
+#endif
+} // createGhostNeighborhood
+
+void destroyGhostNeighborhood()
+{
+  if (ghostNbrs.comm == MPI_COMM_NULL)
+      return;
+
+#if MPI_VERSION >= 4
+  MPI_Request_free(&ghostNbrs.creq);
+#endif
+  MPI_Comm_free(&ghostNbrs.comm);
+} // destroyGhostNeighborhood
+
+// exchange the community info of the remote communities with
+// their owners over the neighborhood, if all processes agree 
+// that the owners are neighbors (rinfo is then in the order 
+// of the requests, i.e., sorted by community)
+bool fillRemoteCommunityInfoNeighbors(const std::vector<std::vector<GraphElem> > &rclist,
+        const CommVector &localCinfo, const GraphElem base, CommInfoVector &rinfo,
+        const int me, const int nprocs, MPI_Comm comm)
+{
+  GhostNeighborhood &nb = ghostNbrs;
+  int onNeighbors = 1;
+
+  for (int p = 0; p < nprocs; p++) {
+      if ((p != me) && !rclist[p].empty() && (nb.index[p] < 0)) {
+          onNeighbors = 0;
+          break;
+      }
+  }
+
+  MPI_Allreduce(MPI_IN_PLACE, &onNeighbors, 1, MPI_INT, MPI_LAND, comm);
+  
+  nb.commsOnNeighbors = (onNeighbors == 1);
+  if (!nb.commsOnNeighbors)
+      return false;
+
+  const int nn = nb.ranks.size();
+  GraphElem spos = 0, rpos = 0;
+
+  for (int k = 0; k < nn; k++) {
+      nb.cscnts[k] = rclist[nb.ranks[k]].size();
+      nb.csdispls[k] = spos;
+      spos += nb.cscnts[k];
+  }
+
+  MPI_Neighbor_alltoall(nb.cscnts.data(), 1, MPI_INT, nb.crcnts.data(), 1, MPI_INT, nb.comm);
+
+  for (int k = 0; k < nn; k++) {
+      nb.crdispls[k] = rpos;
+      rpos += nb.crcnts[k];
+  }
+
+  std::vector<GraphElem> scomms(spos), rcomms(rpos);
+
+  for (int k = 0; k < nn; k++)
+      std::copy(rclist[nb.ranks[k]].begin(), rclist[nb.ranks[k]].end(), 
+              scomms.begin() + nb.csdispls[k]);
+
+  MPI_Neighbor_alltoallv(scomms.data(), nb.cscnts.data(), nb.csdispls.data(), 
+          MPI_GRAPH_TYPE, rcomms.data(), nb.crcnts.data(), nb.crdispls.data(), 
+          MPI_GRAPH_TYPE, nb.comm);
+
+  CommInfoVector sinfo(rpos);
+
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for shared(rcomms, localCinfo, sinfo) schedule(runtime)
+#else
+#pragma omp parallel for shared(rcomms, localCinfo, sinfo) schedule(static)
+#endif
+  for (GraphElem j = 0; j < rpos; j++) {
+      const GraphElem comm = rcomms[j];
+      sinfo[j] = {comm, localCinfo[comm-base].size, localCinfo[comm-base].degree};
+  }
+
+  rinfo.resize(spos);
+  profiler.count(PROFILE_BYTES_SENT, spos*sizeof(GraphElem) + rpos*sizeof(CommInfo));
+
+  MPI_Neighbor_alltoallv(sinfo.data(), nb.crcnts.data(), nb.crdispls.data(), 
+          commType, rinfo.data(), nb.cscnts.data(), nb.csdispls.data(), 
+          commType, nb.comm);
+
+  return true;
+} // fillRemoteCommunityInfoNeighbors
+#endif
 
 void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
-			     const CommMap &remoteCupdate,
+			     const GraphElemVector &remoteCids,
+			     const CommVector &remoteCupdate,
 			     const int me, const int nprocs)
 {
   const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
 
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+  std::vector<CommDeltaVector> remoteArray(nprocs);
+  const MPI_Datatype updateType = commDeltaType;
+#else
   std::vector<CommInfoVector> remoteArray(nprocs);
+  const MPI_Datatype updateType = commType;
+#endif
 
 #ifdef DEBUG_PRINTF  
   ofs << "Starting update remote communities" << std::endl;
 #endif
 
-  // FIXME TODO can we use TBB::concurrent_vector instead,
-  // first we have to get rid of maps
-  for (CommMap::const_iterator iter = remoteCupdate.begin(); iter != remoteCupdate.end(); iter++) {
-      const GraphElem i = iter->first;
-      const Comm &curr = iter->second;
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+  // the updates go back to the processes that sent the
+  // community info in fillRemoteCommunities (in the same 
+  // order), so the counts are already known
+  if (ghostNbrs.commsOnNeighbors) {
+      const GraphElem scnt = remoteCids.size();
+      const GraphElem rcnt = std::accumulate(ghostNbrs.crcnts.begin(), 
+              ghostNbrs.crcnts.end(), GraphElem(0));
+      CommInfoVector sdata(scnt), rdata(rcnt);
+
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for shared(sdata, remoteCids, remoteCupdate) schedule(runtime)
+#else
+#pragma omp parallel for shared(sdata, remoteCids, remoteCupdate) schedule(static)
+#endif
+      for (GraphElem k = 0; k < scnt; k++)
+          sdata[k] = {remoteCids[k], remoteCupdate[k].size, remoteCupdate[k].degree};
+
+      profiler.count(PROFILE_BYTES_SENT, scnt*sizeof(CommInfo));
+
+      MPI_Neighbor_alltoallv(sdata.data(), ghostNbrs.cscnts.data(), ghostNbrs.csdispls.data(), 
+              commType, rdata.data(), ghostNbrs.crcnts.data(), ghostNbrs.crdispls.data(), 
+              commType, ghostNbrs.comm);
+
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for shared(rdata, localCinfo) schedule(runtime)
+#else
+#pragma omp parallel for shared(rdata, localCinfo) schedule(dynamic)
+#endif
+      for (GraphElem k = 0; k < rcnt; k++) {
+          const CommInfo &curr = rdata[k];
+          
+          localCinfo[curr.community-base].size += curr.size;
+          localCinfo[curr.community-base].degree += curr.degree;
+      }
+
+      return;
+  }
+#endif
+
+  // remoteCids is sorted, so the updates for 
+  // each owner are appended in community order
+  for (GraphElem k = 0; k < static_cast<GraphElem>(remoteCids.size()); k++) {
+      const GraphElem i = remoteCids[k];
+      const Comm &curr = remoteCupdate[k];
 
       const int tproc = dg.getOwner(i);
 
 #ifdef DEBUG_PRINTF  
       assert(tproc != me);
 #endif
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+      // most communities are unchanged after the first 
+      // iterations, only the nonzero deltas are sent
+      if ((curr.size == 0) && (curr.degree == 0.0))
+          continue;
+
+      CommDelta rcinfo;
+
+      rcinfo.index = i - dg.getBase(tproc);
+      rcinfo.size = curr.size;
+      rcinfo.degree = curr.degree;
+#else
       CommInfo rcinfo;
 
       rcinfo.community = i;
       rcinfo.size = curr.size;
       rcinfo.degree = curr.degree;
+#endif
 
       remoteArray[tproc].push_back(rcinfo);
   }
@@ -3024,7 +3444,7 @@ void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
   }
 
   MPI_Alltoall(send_sz.data(), 1, MPI_GRAPH_TYPE, recv_sz.data(), 
-          1, MPI_GRAPH_TYPE, MPI_COMM_WORLD);
+          1, MPI_GRAPH_TYPE, dg.getComm());
 
 #ifdef DEBUG_PRINTF  
   const double t1 = MPI_Wtime();
@@ -3048,7 +3468,12 @@ void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
 #endif
 
   GraphElem currPos = 0;
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+  CommDeltaVector rdata(rcnt);
+#else
   CommInfoVector rdata(rcnt);
+#endif
+  profiler.count(PROFILE_BYTES_SENT, scnt*sizeof(rdata[0]));
 
 #ifdef DEBUG_PRINTF  
   const double t2 = MPI_Wtime();
@@ -3056,9 +3481,9 @@ void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
 #if defined(USE_MPI_SENDRECV)
   for (int i = 0; i < nprocs; i++) {
       if (i != me)
-          MPI_Sendrecv(remoteArray[i].data(), send_sz[i], commType, i, CommunityDataTag, 
-                  rdata.data() + currPos, recv_sz[i], commType, i, CommunityDataTag, 
-                  MPI_COMM_WORLD, MPI_STATUSES_IGNORE);
+          MPI_Sendrecv(remoteArray[i].data(), send_sz[i], updateType, i, CommunityDataTag, 
+                  rdata.data() + currPos, recv_sz[i], updateType, i, CommunityDataTag, 
+                  dg.getComm(), MPI_STATUSES_IGNORE);
 
       currPos += recv_sz[i];
   }
@@ -3066,8 +3491,8 @@ void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
   std::vector<MPI_Request> sreqs(nprocs), rreqs(nprocs);
   for (int i = 0; i < nprocs; i++) {
     if (i != me)
-      MPI_Irecv(rdata.data() + currPos, recv_sz[i], commType, i, 
-              CommunityDataTag, MPI_COMM_WORLD, &rreqs[i]);
+      MPI_Irecv(rdata.data() + currPos, recv_sz[i], updateType, i, 
+              CommunityDataTag, dg.getComm(), &rreqs[i]);
     else
       rreqs[i] = MPI_REQUEST_NULL;
 
@@ -3076,8 +3501,8 @@ void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
 
   for (int i = 0; i < nprocs; i++) {
     if (i != me)
-      MPI_Isend(remoteArray[i].data(), send_sz[i], commType, i, 
-              CommunityDataTag, MPI_COMM_WORLD, &sreqs[i]);
+      MPI_Isend(remoteArray[i].data(), send_sz[i], updateType, i, 
+              CommunityDataTag, dg.getComm(), &sreqs[i]);
     else
       sreqs[i] = MPI_REQUEST_NULL;
   }
@@ -3096,6 +3521,12 @@ void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
 #pragma omp parallel for shared(rdata, localCinfo) schedule(dynamic)
 #endif
   for (GraphElem i = 0; i < rcnt; i++) {
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+    const CommDelta &curr = rdata[i];
+
+    localCinfo[curr.index].size += curr.size;
+    localCinfo[curr.index].degree += curr.degree;
+#else
     const CommInfo &curr = rdata[i];
 
 #ifdef DEBUG_PRINTF  
@@ -3103,6 +3534,7 @@ void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
 #endif
     localCinfo[curr.community-base].size += curr.size;
     localCinfo[curr.community-base].degree += curr.degree;
+#endif
   }
 
 #ifdef DEBUG_PRINTF  
@@ -3111,7 +3543,8 @@ void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
 } // updateRemoteCommunities
 
 void updateRemoteCommunitiesNonBlocking(const DistGraph &dg, CommVector &localCinfo,
-			     const CommMap &remoteCupdate,
+			     const GraphElemVector &remoteCids,
+			     const CommVector &remoteCupdate,
 			     const int me, const int nprocs, 
            const int numColors)
 {
@@ -3123,11 +3556,11 @@ void updateRemoteCommunitiesNonBlocking(const DistGraph &dg, CommVector &localCi
   ofs << "Starting update remote communities for colored graphs" << std::endl;
 #endif
 
-  // FIXME TODO can we use TBB::concurrent_vector instead,
-  // first we have to get rid of maps
-  for (CommMap::const_iterator iter = remoteCupdate.begin(); iter != remoteCupdate.end(); iter++) {
-      const GraphElem i = iter->first;
-      const Comm &curr = iter->second;
+  // remoteCids is sorted, so the updates for 
+  // each owner are appended in community order
+  for (GraphElem k = 0; k < static_cast<GraphElem>(remoteCids.size()); k++) {
+      const GraphElem i = remoteCids[k];
+      const Comm &curr = remoteCupdate[k];
 
       const int tproc = dg.getOwner(i);
 
@@ -3160,7 +3593,7 @@ void updateRemoteCommunitiesNonBlocking(const DistGraph &dg, CommVector &localCi
   }
 
   MPI_Alltoall(send_sz.data(), 1, MPI_GRAPH_TYPE, recv_sz.data(), 
-          1, MPI_GRAPH_TYPE, MPI_COMM_WORLD);
+          1, MPI_GRAPH_TYPE, dg.getComm());
 
 #ifdef DEBUG_PRINTF  
   const double t1 = MPI_Wtime();
@@ -3185,6 +3618,7 @@ void updateRemoteCommunitiesNonBlocking(const DistGraph &dg, CommVector &localCi
 
   GraphElem currPos = 0;
   CommInfoVector rdata(rcnt);
+  profiler.count(PROFILE_BYTES_SENT, scnt*sizeof(CommInfo));
 
 #ifdef DEBUG_PRINTF  
   const double t2 = MPI_Wtime();
@@ -3194,7 +3628,7 @@ void updateRemoteCommunitiesNonBlocking(const DistGraph &dg, CommVector &localCi
       if (i != me)
           MPI_Sendrecv(remoteArray[i].data(), send_sz[i], commType, i, CommunityDataTag, 
                   rdata.data() + currPos, recv_sz[i], commType, i, CommunityDataTag, 
-                  MPI_COMM_WORLD, MPI_STATUSES_IGNORE);
+                  dg.getComm(), MPI_STATUSES_IGNORE);
 
       currPos += recv_sz[i];
   }
@@ -3203,7 +3637,7 @@ void updateRemoteCommunitiesNonBlocking(const DistGraph &dg, CommVector &localCi
   for (int i = 0; i < nprocs; i++) {
     if (i != me)
       MPI_Irecv(rdata.data() + currPos, recv_sz[i], commType, i, 
-              CommunityDataTag, MPI_COMM_WORLD, &rreqs[i]);
+              CommunityDataTag, dg.getComm(), &rreqs[i]);
     else
       rreqs[i] = MPI_REQUEST_NULL;
 
@@ -3213,7 +3647,7 @@ void updateRemoteCommunitiesNonBlocking(const DistGraph &dg, CommVector &localCi
   for (int i = 0; i < nprocs; i++) {
     if (i != me)
       MPI_Isend(remoteArray[i].data(), send_sz[i], commType, i, 
-              CommunityDataTag, MPI_COMM_WORLD, &sreqs[i]);
+              CommunityDataTag, dg.getComm(), &sreqs[i]);
     else
       sreqs[i] = MPI_REQUEST_NULL;
   }
@@ -3251,29 +3685,30 @@ void updateRemoteCommunitiesNonBlocking(const DistGraph &dg, CommVector &localCi
 void exchangeVertexReqs(const DistGraph &dg, size_t &ssz, size_t &rsz,
         std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
         std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        const int me, const int nprocs)
+        LocalElemVector &localTails, const int me, const int nprocs)
 {
   const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
   const Graph &g = dg.getLocalGraph();
   const GraphElem nv = g.getNumVertices();
 
-#ifdef USE_OPENMP_LOCK
-  std::vector<omp_lock_t> locks(nprocs);
-  for (int i = 0; i < nprocs; i++)
-    omp_init_lock(&locks[i]);
+#ifdef DEBUG_PRINTF  
+  const double t0 = MPI_Wtime();
 #endif
-  PartnerArray parray(nprocs);
 
-#ifdef USE_OPENMP_LOCK
-#pragma omp parallel shared(dg, g, locks, parray)
-#else
-#pragma omp parallel shared(dg, g, parray)
-#endif
+  // every thread collects the remote tails of its vertices 
+  // in a private buffer (sorted, without duplicates), and 
+  // the buffers are merged pairwise, so no locks are needed
+  const int nthreads = omp_get_max_threads();
+  std::vector<std::vector<GraphElem>> tghosts(nthreads);
+
+#pragma omp parallel shared(g, tghosts)
   {
+    std::vector<GraphElem> &ghosts = tghosts[omp_get_thread_num()];
+
 #ifdef OMP_SCHEDULE_RUNTIME
-#pragma omp for schedule(runtime)
+#pragma omp for schedule(runtime) nowait
 #else
-#pragma omp for schedule(guided)
+#pragma omp for schedule(guided) nowait
 #endif
     for (GraphElem i = 0; i < nv; i++) {
       GraphElem e0, e1;
@@ -3281,49 +3716,60 @@ void exchangeVertexReqs(const DistGraph &dg, size_t &ssz, size_t &rsz,
       g.getEdgeRangeForVertex(i, e0, e1);
 
       for (GraphElem j = e0; j < e1; j++) {
-	const Edge &edge = g.getEdge(j);
-	const int tproc = dg.getOwner(edge.tail);
+	const GraphElem tail = g.getEdgeTail(j);
 
-	if (tproc != me) {
-#ifdef USE_OPENMP_LOCK
-	  omp_set_lock(&locks[tproc]);
-#else
-          lock();
-#endif
-	  parray[tproc].insert(edge.tail);
-#ifdef USE_OPENMP_LOCK
-	  omp_unset_lock(&locks[tproc]);
-#else
-          unlock();
-#endif
-	}
+	if ((tail < base) || (tail >= bound))
+	  ghosts.push_back(tail);
       }
     }
+
+    std::sort(ghosts.begin(), ghosts.end());
+    ghosts.erase(std::unique(ghosts.begin(), ghosts.end()), ghosts.end());
   }
 
-#ifdef USE_OPENMP_LOCK
-  for (int i = 0; i < nprocs; i++) {
-#ifdef DEBUG_PRINTF
-    ofs << "Number of remote vertices from: " << i << ", " << parray[i].size() << std::endl;
-#endif
-    omp_destroy_lock(&locks[i]);
+  for (int stride = 1; stride < nthreads; stride *= 2) {
+#pragma omp parallel for shared(tghosts) schedule(dynamic)
+    for (int t = 0; t < (nthreads - stride); t += 2*stride) {
+      std::vector<GraphElem> &left = tghosts[t], &right = tghosts[t + stride];
+      std::vector<GraphElem> merged;
+
+      merged.reserve(left.size() + right.size());
+      std::set_union(left.begin(), left.end(), right.begin(), right.end(), 
+              std::back_inserter(merged));
+      left.swap(merged);
+      std::vector<GraphElem>().swap(right);
+    }
   }
+
+  // the ghosts are now sorted by id, and hence grouped 
+  // by owner, so the segment of each owner is found by 
+  // a binary search on its first vertex (instead of 
+  // finding the owner of each edge tail)
+  svdata.swap(tghosts[0]);
+  tghosts.clear();
+
+  std::vector<GraphElem> sdisp(nprocs + 1);
+
+  for (int p = 0; p < nprocs; p++)
+    sdisp[p] = std::lower_bound(svdata.begin(), svdata.end(), 
+            dg.getBase(p)) - svdata.begin();
+  sdisp[nprocs] = svdata.size();
+
+#ifdef DEBUG_PRINTF  
+  const double t1 = MPI_Wtime();
+  ofs << "Ghost vertices collection time: " << (t1 - t0) << ", #ghosts: " << svdata.size() << std::endl;
 #endif
   
   rsizes.resize(nprocs);
   ssizes.resize(nprocs);
-  ssz = 0, rsz = 0;
+  ssz = svdata.size(), rsz = 0;
 
-  int pproc = 0;
-  // TODO FIXME use OpenMP
-  for (PartnerArray::const_iterator iter = parray.begin(); iter != parray.end(); iter++) {
-    ssz += iter->size();
-    ssizes[pproc] = iter->size();
-    pproc++;
-  }
+  for (int p = 0; p < nprocs; p++)
+    ssizes[p] = sdisp[p + 1] - sdisp[p];
 
   MPI_Alltoall(ssizes.data(), 1, MPI_GRAPH_TYPE, rsizes.data(), 
-          1, MPI_GRAPH_TYPE, MPI_COMM_WORLD);
+          1, MPI_GRAPH_TYPE, dg.getComm());
+  profiler.count(PROFILE_BYTES_SENT, ssz*sizeof(GraphElem));
 
   GraphElem rsz_r = 0;
 #ifdef OMP_SCHEDULE_RUNTIME
@@ -3337,36 +3783,29 @@ void exchangeVertexReqs(const DistGraph &dg, size_t &ssz, size_t &rsz,
     rsz_r += rsizes[i];
   rsz = rsz_r;
   
-  svdata.resize(ssz);
   rvdata.resize(rsz);
 
-  GraphElem cpos = 0, rpos = 0;
-  pproc = 0;
+  GraphElem rpos = 0;
 #if defined(USE_MPI_COLLECTIVES)
   std::vector<int> scnts(nprocs), rcnts(nprocs), sdispls(nprocs), rdispls(nprocs);
   
-  for (PartnerArray::const_iterator iter = parray.begin(); iter != parray.end(); iter++) {
-      std::copy(iter->begin(), iter->end(), svdata.begin() + cpos);
-      
-      scnts[pproc] = iter->size();
-      rcnts[pproc] = rsizes[pproc];
-      sdispls[pproc] = cpos;
-      rdispls[pproc] = rpos;
-      cpos += iter->size();
-      rpos += rcnts[pproc];
-
-      pproc++;
+  for (int p = 0; p < nprocs; p++) {
+      scnts[p] = ssizes[p];
+      rcnts[p] = rsizes[p];
+      sdispls[p] = sdisp[p];
+      rdispls[p] = rpos;
+      rpos += rcnts[p];
   }
   scnts[me] = 0;
   rcnts[me] = 0;
   MPI_Alltoallv(svdata.data(), scnts.data(), sdispls.data(), 
           MPI_GRAPH_TYPE, rvdata.data(), rcnts.data(), rdispls.data(), 
-          MPI_GRAPH_TYPE, MPI_COMM_WORLD);
+          MPI_GRAPH_TYPE, dg.getComm());
 #else
   std::vector<MPI_Request> rreqs(nprocs), sreqs(nprocs);
   for (int i = 0; i < nprocs; i++) {
       if (i != me)
-          MPI_Irecv(rvdata.data() + rpos, rsizes[i], MPI_GRAPH_TYPE, i, VertexTag, MPI_COMM_WORLD,
+          MPI_Irecv(rvdata.data() + rpos, rsizes[i], MPI_GRAPH_TYPE, i, VertexTag, dg.getComm(),
                   &rreqs[i]);
       else
           rreqs[i] = MPI_REQUEST_NULL;
@@ -3374,17 +3813,12 @@ void exchangeVertexReqs(const DistGraph &dg, size_t &ssz, size_t &rsz,
       rpos += rsizes[i];
   }
 
-  for (PartnerArray::const_iterator iter = parray.begin(); iter != parray.end(); iter++) {
-      std::copy(iter->begin(), iter->end(), svdata.begin() + cpos);
-
-      if (me != pproc)
-          MPI_Isend(svdata.data() + cpos, iter->size(), MPI_GRAPH_TYPE, pproc, VertexTag, MPI_COMM_WORLD,
-                  &sreqs[pproc]);
+  for (int p = 0; p < nprocs; p++) {
+      if (me != p)
+          MPI_Isend(svdata.data() + sdisp[p], ssizes[p], MPI_GRAPH_TYPE, p, VertexTag, dg.getComm(),
+                  &sreqs[p]);
       else
-          sreqs[pproc] = MPI_REQUEST_NULL;
-
-      cpos += iter->size();
-      pproc++;
+          sreqs[p] = MPI_REQUEST_NULL;
   }
 
   MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
@@ -3394,6 +3828,46 @@ void exchangeVertexReqs(const DistGraph &dg, size_t &ssz, size_t &rsz,
   std::swap(svdata, rvdata);
   std::swap(ssizes, rsizes);
   std::swap(ssz, rsz);
+
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+  createGhostNeighborhood(ssz, rsz, ssizes, rsizes, me, nprocs, dg.getComm());
+#endif
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+  ghostSent.valid = false;
+#endif
+
+  // ghost-renumber the edge tails: owned vertices map 
+  // to [0, nv), and the k-th ghost vertex in rvdata (which 
+  // is sorted, as the owners are) maps to nv + k
+#if defined(USE_32_BIT_LOCAL_INDEX)
+  if ((nv + static_cast<GraphElem>(rvdata.size())) > std::numeric_limits<LocalElem>::max()) {
+      std::cout << "Process " << me << " has " << nv << " local and " << rvdata.size() 
+          << " ghost vertices, which exceeds the range of 32-bit local indices." << std::endl;
+      MPI_Abort(dg.getComm(), -99);
+  }
+#endif
+  localTails.resize(g.getNumEdges());
+
+#ifdef OMP_SCHEDULE_RUNTIME
+#pragma omp parallel for shared(g, rvdata, localTails) schedule(runtime)
+#else
+#pragma omp parallel for shared(g, rvdata, localTails) schedule(guided)
+#endif
+  for (GraphElem i = 0; i < nv; i++) {
+    GraphElem e0, e1;
+
+    g.getEdgeRangeForVertex(i, e0, e1);
+
+    for (GraphElem j = e0; j < e1; j++) {
+      const GraphElem tail = g.getEdgeTail(j);
+
+      if ((tail >= base) && (tail < bound))
+        localTails[j] = tail - base;
+      else
+        localTails[j] = nv + (std::lower_bound(rvdata.begin(), 
+                    rvdata.end(), tail) - rvdata.begin());
+    }
+  }
 } // exchangeVertexReqs
 
 // load ground truth file (vertex-id  community-id) into a vector
@@ -3478,3 +3952,326 @@ void gatherAllComm(int root, int me, int nprocs,
     delete []rcounts;
     delete []rdispls;
 } // gatherAllComm
+
+// the communities of a phase are renumbered densely (in the order of 
+// their ids, as the next level graph), and the original vertices are 
+// moved to the community of the (current level) vertex they belong to
+void updateMembership(int me, int nprocs, const DistGraph &dg, 
+        const CommunityVector &cvect, std::vector<GraphElem> &membership, 
+        bool firstPhase)
+{
+    const GraphElem lnv = dg.getLocalGraph().getNumVertices();
+    const GraphElem base = dg.getBase(me);
+
+    // distinct communities of my vertices, their owners 
+    // number the ones that are alive
+    std::vector<GraphElem> comms(cvect.begin(), cvect.begin() + lnv), denseComms;
+    std::vector<GraphElem> denseOwned(lnv, -1);
+
+    std::sort(comms.begin(), comms.end());
+    comms.erase(std::unique(comms.begin(), comms.end()), comms.end());
+
+    queryOwners(me, nprocs, dg, comms, denseComms, 
+            [&] (const std::vector<GraphElem> &requested) 
+            {
+                std::vector<char> alive(lnv, 0);
+                GraphElem nalive = 0, offset = 0;
+
+                for (const GraphElem c : requested)
+                    alive[c - base] = 1;
+                for (GraphElem i = 0; i < lnv; i++)
+                    nalive += alive[i];
+
+                MPI_Exscan(&nalive, &offset, 1, MPI_GRAPH_TYPE, MPI_SUM, dg.getComm());
+                if (me == 0)
+                    offset = 0;
+
+                for (GraphElem i = 0; i < lnv; i++) {
+                    if (alive[i])
+                        denseOwned[i] = offset++;
+                }
+            }, 
+            [&] (const GraphElem c) { return denseOwned[c - base]; });
+
+    // new community of my vertices
+    std::vector<GraphElem> newComm(lnv);
+
+#pragma omp parallel for
+    for (GraphElem i = 0; i < lnv; i++)
+        newComm[i] = denseComms[std::lower_bound(comms.begin(), comms.end(), cvect[i]) - comms.begin()];
+
+    if (firstPhase) {
+        membership.swap(newComm);
+        return;
+    }
+
+    // the original vertices ask the owners of their 
+    // (current level) vertices for the new community
+    std::vector<GraphElem> vertices(membership), newVertexComm;
+    
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+    queryOwners(me, nprocs, dg, vertices, newVertexComm, 
+            [] (const std::vector<GraphElem> &) {}, 
+            [&] (const GraphElem v) { return newComm[v - base]; });
+
+    const GraphElem nmembers = membership.size();
+#pragma omp parallel for
+    for (GraphElem v = 0; v < nmembers; v++)
+        membership[v] = newVertexComm[std::lower_bound(vertices.begin(), vertices.end(), 
+                membership[v]) - vertices.begin()];
+} // updateMembership
+
+GraphElem distSeedCommunities(int me, int nprocs, const DistGraph &dg, 
+        const std::vector<GraphElem> &labels, CommunityVector &seed)
+{
+    const GraphElem lnv = dg.getLocalGraph().getNumVertices();
+    const GraphElem nv = dg.getTotalNumVertices(), base = dg.getBase(me);
+    GraphElem maxLabel = -1;
+
+    for (GraphElem i = 0; i < lnv; i++)
+        maxLabel = std::max(maxLabel, labels[i]);
+    MPI_Allreduce(MPI_IN_PLACE, &maxLabel, 1, MPI_GRAPH_TYPE, MPI_MAX, dg.getComm());
+
+    // a vertex without label gets its own, after the others
+    std::vector<GraphElem> keys(lnv), distinct, dense;
+    for (GraphElem i = 0; i < lnv; i++)
+        keys[i] = (labels[i] >= 0) ? labels[i] : (maxLabel + 1 + base + i);
+
+    distinct = keys;
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+
+    // the keys are split evenly among the processes, which 
+    // number the distinct ones they receive
+    const GraphElem nkeys = maxLabel + 1 + nv;
+    std::vector<GraphElem> bases(nprocs), received;
+    GraphElem ndistinct = 0, offset = 0;
+
+    for (int p = 0; p < nprocs; p++)
+        bases[p] = (nkeys * p) / nprocs;
+
+    queryRanges(me, nprocs, bases, distinct, dense, 
+            [&] (const std::vector<GraphElem> &requested) 
+            {
+                received = requested;
+                std::sort(received.begin(), received.end());
+                received.erase(std::unique(received.begin(), received.end()), received.end());
+
+                ndistinct = received.size();
+                MPI_Exscan(&ndistinct, &offset, 1, MPI_GRAPH_TYPE, MPI_SUM, dg.getComm());
+                if (me == 0)
+                    offset = 0;
+            }, 
+            [&] (const GraphElem k) 
+            { return offset + (std::lower_bound(received.begin(), received.end(), k) - received.begin()); },
+            dg.getComm());
+
+    seed.resize(lnv);
+
+#pragma omp parallel for
+    for (GraphElem i = 0; i < lnv; i++)
+        seed[i] = dense[std::lower_bound(distinct.begin(), distinct.end(), keys[i]) - distinct.begin()];
+
+    MPI_Allreduce(MPI_IN_PLACE, &ndistinct, 1, MPI_GRAPH_TYPE, MPI_SUM, dg.getComm());
+
+    return ndistinct;
+} // distSeedCommunities
+
+GraphWeight distEvaluateModularity(int me, int nprocs, const DistGraph &dg, 
+        size_t &ssz, size_t &rsz, std::vector<GraphElem> &ssizes, 
+        std::vector<GraphElem> &rsizes, std::vector<GraphElem> &svdata, 
+        std::vector<GraphElem> &rvdata, const CommunityVector &cvect)
+{
+    const Graph &g = dg.getLocalGraph();
+    const GraphElem lnv = g.getNumVertices();
+    const GraphElem base = dg.getBase(me);
+
+    GraphWeightVector vDegree(lnv);
+    CommVector localCinfo(lnv);
+    CommunityVector pastComm(lnv), currComm(lnv);
+
+    distSumVertexDegree(g, vDegree, localCinfo);
+    const GraphWeight constantForSecondTerm = distCalcConstantForSecondTerm(vDegree, dg.getComm());
+    distSeedComm(dg, cvect, vDegree, pastComm, currComm, localCinfo, me, dg.getComm());
+
+    // the ghosts (sorted, in rvdata) get their communities from their owners
+    LocalElemVector localTails;
+    std::vector<GraphElem> ghostComm;
+
+    exchangeVertexReqs(dg, ssz, rsz, ssizes, rsizes, svdata, rvdata, localTails, me, nprocs);
+    queryOwners(me, nprocs, dg, rvdata, ghostComm, 
+            [] (const std::vector<GraphElem> &) {}, 
+            [&] (const GraphElem v) { return currComm[v - base]; });
+
+    GraphWeight le_xx = 0.0, la2_x = 0.0;
+
+#pragma omp parallel for reduction(+: le_xx, la2_x) schedule(guided)
+    for (GraphElem i = 0; i < lnv; i++) {
+        GraphElem e0, e1;
+        g.getEdgeRangeForVertex(i, e0, e1);
+
+        for (GraphElem e = e0; e < e1; e++) {
+            const GraphElem t = localTails[e];
+            const GraphElem c = (t < lnv) ? currComm[t] : ghostComm[t - lnv];
+            if (c == currComm[i])
+                le_xx += g.getEdgeWeight(e);
+        }
+
+        la2_x += static_cast<GraphWeight>(localCinfo[i].degree) * 
+            static_cast<GraphWeight>(localCinfo[i].degree);
+    }
+
+    long frozen = 0;
+    return distComputeModularity(le_xx, la2_x, frozen, constantForSecondTerm, dg.getComm());
+} // distEvaluateModularity
+
+// collective write in rounds of at most INT_MAX bytes
+static void writeAtAll(MPI_File fh, MPI_Offset offset, const char *buf, const uint64_t bytes)
+{
+    const uint64_t rounds = (bytes + INT_MAX - 1) / INT_MAX;
+    uint64_t maxRounds = 0;
+    
+    MPI_Allreduce(&rounds, &maxRounds, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+
+    for (uint64_t r = 0; r < maxRounds; r++) {
+        const uint64_t done = std::min<uint64_t>(bytes, r * INT_MAX);
+        const int count = std::min<uint64_t>(bytes - done, INT_MAX);
+
+        MPI_File_write_at_all(fh, offset + done, buf + done, count, MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+} // writeAtAll
+
+// decimal digits of value and a newline, returns the length
+static inline int formatLine(char *line, GraphElem value)
+{
+    char digits[24];
+    int n = 0, len = 0;
+    
+    if (value < 0) {
+        line[len++] = '-';
+        value = -value;
+    }
+
+    do {
+        digits[n++] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (n > 0)
+        line[len++] = digits[--n];
+    line[len++] = '\n';
+
+    return len;
+} // formatLine
+
+void writeCommunities(int me, int nprocs, const std::string &fileName, 
+        const std::vector<GraphElem> &membership, GraphElem base, GraphElem nv, 
+        bool asText)
+{
+    MPI_File fh;
+
+    if (MPI_File_open(MPI_COMM_WORLD, fileName.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, 
+                MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        std::cout << " Error creating community file: " << fileName << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    const GraphElem lnv = membership.size();
+
+    if (!asText) {
+        // the number of vertices, followed by their communities
+        MPI_File_set_size(fh, (nv + 1)*sizeof(GraphElem));
+        
+        if (me == 0)
+            MPI_File_write_at(fh, 0, &nv, sizeof(GraphElem), MPI_BYTE, MPI_STATUS_IGNORE);
+
+        writeAtAll(fh, (base + 1)*sizeof(GraphElem), reinterpret_cast<const char*>(membership.data()), 
+                lnv*sizeof(GraphElem));
+    }
+    else {
+        // one line per vertex, every thread formats a block of the vertices
+        const int nchunks = omp_get_max_threads();
+        std::vector<std::string> lines(nchunks);
+
+#pragma omp parallel for schedule(static, 1)
+        for (int c = 0; c < nchunks; c++) {
+            const GraphElem lo = (lnv * c) / nchunks, hi = (lnv * (c + 1)) / nchunks;
+            char line[32];
+
+            lines[c].reserve((hi - lo) * 8);
+            for (GraphElem v = lo; v < hi; v++)
+                lines[c].append(line, formatLine(line, membership[v]));
+        }
+
+        std::string text;
+        uint64_t bytes = 0, offset = 0, total = 0;
+
+        for (int c = 0; c < nchunks; c++)
+            bytes += lines[c].size();
+        
+        text.reserve(bytes);
+        for (int c = 0; c < nchunks; c++) {
+            text.append(lines[c]);
+            std::string().swap(lines[c]);
+        }
+
+        MPI_Exscan(&bytes, &offset, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        MPI_Allreduce(&bytes, &total, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        if (me == 0)
+            offset = 0;
+
+        MPI_File_set_size(fh, total);
+        writeAtAll(fh, offset, text.data(), bytes);
+    }
+
+    MPI_File_close(&fh);
+} // writeCommunities
+
+GraphElem readCommunities(int me, int nprocs, const std::string &fileName, 
+        GraphElem base, GraphElem count, std::vector<GraphElem> &membership)
+{
+    MPI_File fh;
+    MPI_Offset fileSize = 0;
+    GraphElem nv = -1;
+
+    if (MPI_File_open(MPI_COMM_WORLD, fileName.c_str(), MPI_MODE_RDONLY, 
+                MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        std::cout << " Error opening community file: " << fileName << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, -99);
+    }
+
+    MPI_File_get_size(fh, &fileSize);
+    if (fileSize >= static_cast<MPI_Offset>(sizeof(GraphElem)))
+        MPI_File_read_at_all(fh, 0, &nv, sizeof(GraphElem), MPI_BYTE, MPI_STATUS_IGNORE);
+
+    // the number of vertices, followed by their communities
+    if (nv < 0 || fileSize != static_cast<MPI_Offset>((nv + 1)*sizeof(GraphElem))) {
+        MPI_File_close(&fh);
+        return -1;
+    }
+
+    const GraphElem lo = std::min(base, nv), hi = std::min(base + count, nv);
+    const uint64_t bytes = (hi - lo)*sizeof(GraphElem);
+    const uint64_t rounds = (bytes + INT_MAX - 1) / INT_MAX;
+    uint64_t maxRounds = 0;
+
+    membership.assign(count, -1);
+    char *buf = reinterpret_cast<char*>(membership.data());
+
+    // in rounds of at most INT_MAX bytes
+    MPI_Allreduce(&rounds, &maxRounds, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+
+    for (uint64_t r = 0; r < maxRounds; r++) {
+        const uint64_t done = std::min<uint64_t>(bytes, r * INT_MAX);
+        const int rcount = std::min<uint64_t>(bytes - done, INT_MAX);
+
+        MPI_File_read_at_all(fh, (lo + 1)*sizeof(GraphElem) + done, buf + done, rcount, 
+                MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    MPI_File_close(&fh);
+
+    return nv;
+} // readCommunities
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <numeric>
 #include <vector>
@@ -17,41 +18,22 @@
 
 #include "distgraph.hpp"
 #include "coloring.hpp"
+#include "profile.hpp"
+#include "arena.hpp"
 
-#if defined(__CRAY_MIC_KNL) && defined(USE_AUTOHBW_MEMALLOC)
-#include <hbw_allocator.h>
-
-typedef std::vector<GraphElem, hbw::allocator<GraphElem> > CommunityVector;
-typedef std::vector<GraphWeight, hbw::allocator<GraphWeight> > GraphWeightVector;
-typedef std::vector<GraphElem, hbw::allocator<GraphElem> > GraphElemVector;
+// see allocator.hpp
+typedef std::vector<GraphElem, DataAllocator<GraphElem> > CommunityVector;
+typedef std::vector<GraphWeight, DataAllocator<GraphWeight> > GraphWeightVector;
+typedef std::vector<GraphElem, DataAllocator<GraphElem> > GraphElemVector;
+typedef std::vector<LocalElem, DataAllocator<LocalElem> > LocalElemVector;
 
 typedef std::unordered_map<GraphElem, GraphElem, std::hash<GraphElem>, std::equal_to<GraphElem>,
-        hbw::allocator< std::pair< const GraphElem, GraphElem > > > VertexCommMap;
-
-typedef std::unordered_set<GraphElem, std::hash<GraphElem>, std::equal_to<GraphElem>,
-        hbw::allocator<GraphElem> > RemoteVertexList;
-typedef std::vector<RemoteVertexList, hbw::allocator<RemoteVertexList> > PartnerArray;
+        DataAllocator< std::pair< const GraphElem, GraphElem > > > VertexCommMap;
 
-typedef std::vector<Comm, hbw::allocator<Comm> > CommVector;
 typedef std::map<GraphElem, Comm, std::less<GraphElem>,
-        hbw::allocator< std::pair< const GraphElem, Comm > > > CommMap;
+        DataAllocator< std::pair< const GraphElem, Comm > > > CommMap;
 typedef std::unordered_map<GraphElem, GraphElem, std::hash<GraphElem>, std::equal_to<GraphElem>,
-        hbw::allocator< std::pair< const GraphElem, GraphElem > > > ClusterLocalMap;
-#else
-typedef std::vector<GraphElem> CommunityVector;
-typedef std::vector<GraphWeight> GraphWeightVector;
-typedef std::vector<GraphElem> GraphElemVector;
-
-typedef std::unordered_map<GraphElem, GraphElem> VertexCommMap;
-
-typedef std::unordered_set<GraphElem> RemoteVertexList;
-typedef std::vector<RemoteVertexList> PartnerArray;
-
-typedef std::vector<Comm> CommVector;
-typedef std::map<GraphElem, Comm> CommMap;
-
-typedef std::unordered_map<GraphElem, GraphElem> ClusterLocalMap;
-#endif
+        DataAllocator< std::pair< const GraphElem, GraphElem > > > ClusterLocalMap;
 
 const int SizeTag = 1;
 const int VertexTag = 2;
@@ -74,120 +56,524 @@ struct CommInfo {
 #define P_CUTOFF 0.02
 
 typedef std::vector<CommInfo> CommInfoVector;
+
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+#if defined(USE_MPI_COLLECTIVES) || defined(USE_MPI_SENDRECV) || defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+#error "USE_DELTA_COMMUNITY_EXCHANGE only works with the default point-to-point communication"
+#endif
+// nonzero update of a remote community, as an
+// index relative to the base of its owner
+struct CommDelta {
+    LocalElem index;
+    LocalElem size;
+    GraphWeight degree;
+};
+
+typedef std::vector<CommDelta> CommDeltaVector;
+
+// communities of the vertices requested by other processes
+// (in the order of svdata) as of the last exchange of the 
+// phase, exchangeVertexReqs invalidates them
+struct GhostCommunityHistory 
+{
+    std::vector<GraphElem> sent;
+    bool valid;
+
+    GhostCommunityHistory(): valid(false) {}
+};
+#endif
+
+// ghost community exchange in flight (see postGhostCommunities)
+struct GhostCommunityRequests
+{
+    std::vector<GraphElem> scdata;
+    std::vector<MPI_Request> reqs;
+};
+
+// Per-thread scratch space that accumulates the edge weights from a
+// vertex to each of its neighboring communities. The distinct
+// communities and their weights are stored in insertion order, in
+// two contiguous arrays; an open-addressing (linear probing) table
+// of positions into these arrays is used for the lookup. clear() only
+// resets the slots touched by the previous vertex, so there is no
+// allocation per vertex once the table is large enough for the
+// maximum degree (one accumulator is allocated per thread per phase).
+// It also counts the table probes and the vertices that moved, for the
+// profiler (see distProfileIteration), and has room for the gains of
+// the candidate communities (see distGetMaxIndex).
+class ClusterLocalAccumulator
+{
+    public:
+        ClusterLocalAccumulator(): mask_(0), shift_(63), probes_(0), moves_(0)
+        {}
+
+        // make room for up to n distinct communities,
+        // keeping the load factor of the table under 0.5
+        void reserve(const GraphElem n)
+        {
+            if (2*n <= static_cast<GraphElem>(slots_.size()))
+                return;
+
+            GraphElem cap = 2;
+            int bits = 1;
+
+            while (cap < 2*n) {
+                cap <<= 1;
+                bits++;
+            }
+
+            slots_.assign(cap, -1);
+            mask_ = cap - 1;
+            shift_ = 64 - bits;
+
+            comms_.reserve(n);
+            weights_.reserve(n);
+            gains_.reserve(n);
+            pos_.reserve(n);
+        }
+
+        void clear()
+        {
+            for (GraphElem k = 0; k < static_cast<GraphElem>(pos_.size()); k++)
+                slots_[pos_[k]] = -1;
+
+            comms_.clear();
+            weights_.clear();
+            pos_.clear();
+        }
+
+        // add weight to the running sum of community comm
+        void add(const GraphElem comm, const GraphWeight weight)
+        {
+            GraphElem s = slot(comm);
+
+            while (true) {
+                const GraphElem k = slots_[s];
+
+                probes_++;
+
+                if (k == -1) {
+                    slots_[s] = comms_.size();
+                    pos_.push_back(s);
+                    comms_.push_back(comm);
+                    weights_.push_back(weight);
+                    return;
+                }
+
+                if (comms_[k] == comm) {
+                    weights_[k] += weight;
+                    return;
+                }
+
+                s = (s + 1) & mask_;
+            }
+        }
+
+        GraphElem size() const { return comms_.size(); }
+        GraphElem community(const GraphElem k) const { return comms_[k]; }
+        GraphWeight weight(const GraphElem k) const { return weights_[k]; }
+
+        const GraphElemVector& communities() const { return comms_; }
+        const GraphWeightVector& weights() const { return weights_; }
+
+        // one value per community, contiguous
+        GraphWeight *gains()
+        {
+            gains_.resize(comms_.size());
+            return gains_.data();
+        }
+
+        void countMove() { moves_++; }
+        void countMove(const GraphElem n) { moves_ += n; }
+        GraphElem probes() const { return probes_; }
+        GraphElem moves() const { return moves_; }
+        void resetCounters() { probes_ = 0; moves_ = 0; }
+
+    private:
+        // Fibonacci hashing, uses the high bits of the product
+        GraphElem slot(const GraphElem comm) const
+        {
+            return static_cast<GraphElem>((static_cast<uint64_t>(comm) *
+                        0x9E3779B97F4A7C15ULL) >> shift_) & mask_;
+        }
+
+        LocalElemVector slots_, pos_;
+        GraphElemVector comms_;
+        GraphWeightVector weights_, gains_;
+        GraphElem mask_;
+        int shift_;
+        GraphElem probes_, moves_;
+};
+
+typedef std::vector<ClusterLocalAccumulator> ClusterLocalAccumulatorVector;
+
+// Per-thread sums of the community updates of the vertices that moved
+// in an iteration, instead of atomic updates of localCupdate and
+// remoteCupdate (see LouvainOptions::privateUpdates). An update is
+// keyed by the index of its community in localCupdate, or by #local
+// communities + its index in remoteCupdate; the sums are stored in
+// insertion order, with an open-addressing table of their positions
+// for the lookup (grown as needed). To merge them, every thread
+// groups the keys of its accumulator into ranges, and each range is
+// then added by one thread from all the accumulators (see
+// distMergeCommUpdates).
+class CommUpdateAccumulator
+{
+    public:
+        CommUpdateAccumulator(): mask_(-1), shift_(64)
+        {}
+
+        void clear()
+        {
+            for (GraphElem k = 0; k < static_cast<GraphElem>(pos_.size()); k++)
+                slots_[pos_[k]] = -1;
+
+            keys_.clear();
+            updates_.clear();
+            pos_.clear();
+        }
+
+        // add degree and size to the update of key
+        void add(const GraphElem key, const GraphWeight degree, const GraphElem size)
+        {
+            if (2*(keys_.size() + 1) > slots_.size())
+                grow();
+
+            GraphElem s = slot(key);
+
+            while (true) {
+                const GraphElem k = slots_[s];
+
+                if (k == -1) {
+                    slots_[s] = keys_.size();
+                    pos_.push_back(s);
+                    keys_.push_back(key);
+                    updates_.push_back(Comm());
+                    updates_.back().degree = degree;
+                    updates_.back().size = size;
+                    return;
+                }
+
+                if (keys_[k] == key) {
+                    updates_[k].degree += degree;
+                    updates_[k].size += size;
+                    return;
+                }
+
+                s = (s + 1) & mask_;
+            }
+        }
+
+        // sort the updates into ngroups ranges of the keys [0, n)
+        void group(const GraphElem n, const int ngroups)
+        {
+            const GraphElem nk = keys_.size();
+
+            groupStart_.assign(ngroups + 1, 0);
+            grouped_.resize(nk);
+
+            for (GraphElem k = 0; k < nk; k++)
+                groupStart_[(keys_[k] * ngroups) / n + 1]++;
+            for (int g = 0; g < ngroups; g++)
+                groupStart_[g + 1] += groupStart_[g];
+
+            std::vector<GraphElem> next(groupStart_.begin(), groupStart_.end() - 1);
+            for (GraphElem k = 0; k < nk; k++)
+                grouped_[next[(keys_[k] * ngroups) / n]++] = k;
+        }
+
+        GraphElem groupBegin(const int g) const { return groupStart_[g]; }
+        GraphElem groupEnd(const int g) const { return groupStart_[g + 1]; }
+
+        // the j-th update in the order of the groups
+        GraphElem key(const GraphElem j) const { return keys_[grouped_[j]]; }
+        const Comm &update(const GraphElem j) const { return updates_[grouped_[j]]; }
+
+    private:
+        GraphElem slot(const GraphElem key) const
+        {
+            return static_cast<GraphElem>((static_cast<uint64_t>(key) *
+                        0x9E3779B97F4A7C15ULL) >> shift_) & mask_;
+        }
+
+        // double the table, and insert the keys again
+        void grow()
+        {
+            const GraphElem cap = std::max<GraphElem>(16, 2*slots_.size());
+
+            slots_.assign(cap, -1);
+            mask_ = cap - 1;
+            shift_ = 64;
+            for (GraphElem c = cap; c > 1; c >>= 1)
+                shift_--;
+
+            for (GraphElem k = 0; k < static_cast<GraphElem>(keys_.size()); k++) {
+                GraphElem s = slot(keys_[k]);
+
+                while (slots_[s] != -1)
+                    s = (s + 1) & mask_;
+
+                slots_[s] = k;
+                pos_[k] = s;
+            }
+        }
+
+        GraphElemVector slots_, pos_, keys_, grouped_, groupStart_;
+        std::vector<Comm> updates_;
+        GraphElem mask_;
+        int shift_;
+};
+
+typedef std::vector<CommUpdateAccumulator> CommUpdateAccumulatorVector;
+
 extern std::ofstream ofs;
 static MPI_Datatype commType;
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+static MPI_Datatype commDeltaType;
+static GhostCommunityHistory ghostSent;
+#endif
 
-GraphWeight distLouvainMethod(const int me, const int nprocs, const DistGraph &dg,
-        size_t &ssz, size_t &rsz, std::vector<GraphElem> &ssizes, 
-        std::vector<GraphElem> &rsizes, std::vector<GraphElem> &svdata, 
-        std::vector<GraphElem> &rvdata, CommunityVector &cvect, const GraphWeight lower,
-        const GraphWeight thresh, int& iters);
+#if defined(USE_MPI_RMA) && (defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES) || defined(USE_DELTA_COMMUNITY_EXCHANGE))
+#error "USE_MPI_RMA cannot be combined with USE_MPI_NEIGHBORHOOD_COLLECTIVES or USE_DELTA_COMMUNITY_EXCHANGE"
+#endif
+
+#if defined(USE_NODE_GHOST_CACHE) && (defined(USE_MPI_RMA) || defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES) || defined(USE_DELTA_COMMUNITY_EXCHANGE))
+#error "USE_NODE_GHOST_CACHE cannot be combined with USE_MPI_RMA, USE_MPI_NEIGHBORHOOD_COLLECTIVES or USE_DELTA_COMMUNITY_EXCHANGE"
+#endif
+
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+#if defined(USE_MPI_COLLECTIVES) || defined(USE_MPI_SENDRECV)
+#error "USE_MPI_NEIGHBORHOOD_COLLECTIVES cannot be combined with USE_MPI_COLLECTIVES or USE_MPI_SENDRECV"
+#endif
+// The processes sharing ghost vertices with this process, as a
+// distributed graph topology that is built once per phase (by
+// exchangeVertexReqs), along with the counts/displacements and
+// the buffers of the ghost community exchange, which is fixed
+// for the phase (and is a persistent collective with MPI-4).
+// The community info exchanges are dynamic, they go over the
+// topology only if every process owning a remote community
+// is a neighbor (decided collectively per iteration), and over
+// all the processes otherwise.
+struct GhostNeighborhood
+{
+    MPI_Comm comm;
+    std::vector<int> ranks;     // neighbors, in increasing order
+    std::vector<int> index;     // neighbor index of each process, or -1
+    
+    // ghost communities (per neighbor)
+    std::vector<int> scnts, sdispls, rcnts, rdispls;
+    std::vector<GraphElem> scdata, rcdata;
+#if MPI_VERSION >= 4
+    MPI_Request creq;
+#endif
+
+    // community info of the current iteration (per neighbor) 
+    bool commsOnNeighbors;
+    std::vector<int> cscnts, csdispls, crcnts, crdispls;
+
+    GhostNeighborhood(): comm(MPI_COMM_NULL), commsOnNeighbors(false) {}
+};
+
+static GhostNeighborhood ghostNbrs;
+#endif
+
+// the order in which the vertices are visited in an iteration: the
+// natural order, or one color class after another, with the ghost
+// communities exchanged before every class (COLOR_ORDER, -c) or
+// once per iteration (VERTEX_ORDER, -d)
+enum LouvainOrder { NATURAL_ORDER, COLOR_ORDER, VERTEX_ORDER };
+
+// early termination: the vertices whose communities stop changing
+// are frozen (INACTIVE_TERMINATION, -t 1/3), or are frozen once the
+// probability of them being active (decreased by ETDelta in every
+// such iteration) is low enough (PROBABILISTIC_TERMINATION, -t 2/4),
+// or only the vertices next to a community change of the previous
+// iteration are visited (FRONTIER_TERMINATION, -t 5)
+enum LouvainTermination { NO_TERMINATION, INACTIVE_TERMINATION, 
+    PROBABILISTIC_TERMINATION, FRONTIER_TERMINATION };
+
+// the variant of a phase of the method, when ETLocalOrRemote is false
+// the phase also stops once enough vertices are frozen (across the
+// processes), with overlapComm the ghost community exchange of an
+// iteration is overlapped with the computation on the interior
+// vertices, and with hubDegree > 0 the vertices of at least that
+// degree are each visited by all the threads (natural order only,
+// hubDegree takes precedence over overlapComm); with privateUpdates
+// the threads sum the community updates of the vertices that moved
+// in private buffers, that are merged after the vertices are visited,
+// instead of updating the communities atomically; with deviceIteration
+// (built with OMP_TARGET_OFFLOAD) the vertices are visited on the device,
+// without early termination (natural order only, takes precedence over
+// hubDegree, overlapComm and privateUpdates); initialComm (if not NULL) 
+// has the communities of the local vertices to start from instead of
+// the singletons (see distSeedCommunities), and initialFrontier (with 
+// FRONTIER_TERMINATION) the local vertices visited first, the others 
+// start frozen in their communities
+struct LouvainOptions
+{
+    LouvainOrder order;
+    long numColor;
+    const ColorVector *vertexColor;
+
+    LouvainTermination termination;
+    GraphWeight ETDelta;
+    bool ETLocalOrRemote;
+
+    bool overlapComm;
+    GraphElem hubDegree;
+    bool privateUpdates;
+    bool deviceIteration;
+
+    const CommunityVector *initialComm;
+    const GraphElemVector *initialFrontier;
+
+    LouvainOptions(): order(NATURAL_ORDER), numColor(1), vertexColor(NULL), 
+        termination(NO_TERMINATION), ETDelta(1.0), ETLocalOrRemote(true), 
+        overlapComm(false), hubDegree(0), privateUpdates(false),
+        deviceIteration(false), initialComm(NULL), initialFrontier(NULL) {}
+};
 
 GraphWeight distLouvainMethod(const int me, const int nprocs, const DistGraph &dg,
         size_t &ssz, size_t &rsz, std::vector<GraphElem> &ssizes, 
         std::vector<GraphElem> &rsizes, std::vector<GraphElem> &svdata, 
         std::vector<GraphElem> &rvdata, CommunityVector &cvect, const GraphWeight lower,
-        const GraphWeight thresh, int& iters, bool ETLocalOrRemote);
+        const GraphWeight thresh, int& iters, const LouvainOptions &options);
 
+// the plain method (natural order, no early termination)
 GraphWeight distLouvainMethod(const int me, const int nprocs, const DistGraph &dg,
         size_t &ssz, size_t &rsz, std::vector<GraphElem> &ssizes, 
         std::vector<GraphElem> &rsizes, std::vector<GraphElem> &svdata, 
         std::vector<GraphElem> &rvdata, CommunityVector &cvect, const GraphWeight lower,
-        const GraphWeight thresh, int& iters, GraphWeight ETDelta, bool ETLocalOrRemote);
-
-GraphWeight distLouvainMethodWithColoring(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, int& iters);
-
-GraphWeight distLouvainMethodWithColoring(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
-        int& iters, bool ETLocalOrRemote);
-
-GraphWeight distLouvainMethodWithColoring(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, 
-        size_t &ssz, size_t &rsz, std::vector<GraphElem> &ssizes, 
-        std::vector<GraphElem> &rsizes, std::vector<GraphElem> &svdata, 
-        std::vector<GraphElem> &rvdata, CommunityVector &cvect, 
-        const GraphWeight lower, const GraphWeight thresh, int& iters, GraphWeight ETDelta, 
-        bool ETLocalOrRemote);
-
-GraphWeight distLouvainMethodVertexOrder(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,                        
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, int& iters);
-
-GraphWeight distLouvainMethodVertexOrder(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,                        
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, int& iters, 
-        bool ETLocalOrRemote);
+        const GraphWeight thresh, int& iters);
 
-GraphWeight distLouvainMethodVertexOrder(const int me, const int nprocs, const DistGraph &dg,
-        const long numColor, const ColorVector &vertexColor, size_t &ssz, size_t &rsz, 
-        std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
-        std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,                        
-        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, int& iters, 
-        GraphWeight ETDelta, bool ETLocalOrRemote);
+// a single phase of the plain method on a graph wholly owned by 
+// the calling process (i.e., its base is 0 and it has no ghosts), 
+// which uses no communication outside the process
+GraphWeight louvainMethodSharedMemory(const DistGraph &dg, CommunityVector &cvect, 
+        const GraphWeight lower, const GraphWeight thresh, int& iters);
 
 static void distInitLouvain(const DistGraph &dg, CommunityVector &pastComm, 
         CommunityVector &currComm, GraphWeightVector &vDegree, 
         GraphWeightVector &clusterWeight, CommVector &localCinfo, 
-        CommVector &localCupdate, GraphWeight &constantForSecondTerm, 
-        const int me);
+        CommVector &localCupdate, ClusterLocalAccumulatorVector &claccs,
+        GraphWeight &constantForSecondTerm, const int me, 
+        MPI_Comm comm = MPI_COMM_WORLD);
 
 static void distExecuteLouvainIteration(const GraphElem i, const DistGraph &dg,
-        const CommunityVector &currComm, CommunityVector &targetComm,
-        const GraphWeightVector &vDegree, CommVector &localCinfo, CommVector &localCupdate, 
-        const VertexCommMap &remoteComm, const CommMap &remoteCinfo, CommMap &remoteCupdate,
-        const GraphWeight constantForSecondTerm, GraphWeightVector &clusterWeight, const int me);
-
-static void distSumVertexDegree(const Graph &g, GraphWeightVector &vDegree, CommVector &localCinfo);
-
-static GraphWeight distCalcConstantForSecondTerm(const GraphWeightVector &vDegree);
-
-static GraphElem distGetMaxIndex(const ClusterLocalMap &clmap, const GraphWeightVector &counter,
-        const GraphWeight selfLoop, const CommVector &localCinfo, const CommMap &remoteCinfo,
-        const GraphWeight vDegree, const GraphElem currSize, const GraphElem currDegree, 
+        const LocalElemVector &localTails, const CommunityVector &currComm, 
+        CommunityVector &targetComm, const GraphWeightVector &vDegree, 
+        CommVector &localCinfo, CommVector &localCupdate, const CommunityVector &remoteComm, 
+        const GraphElemVector &remoteCids, const CommVector &remoteCinfo, CommVector &remoteCupdate,
+        const GraphWeight constantForSecondTerm, GraphWeightVector &clusterWeight, 
+        ClusterLocalAccumulator &clacc, CommUpdateAccumulator *cupdate, const int me);
+
+// the second half of distExecuteLouvainIteration: move vertex i (with 
+// at least an edge) to the community of maximum gain, given the weights
+// of its neighboring communities in clacc (the first is its own); the
+// community updates go to cupdate if not NULL, atomically otherwise
+static void distMoveVertex(const GraphElem i, const DistGraph &dg,
+        const CommunityVector &currComm, CommunityVector &targetComm, 
+        const GraphWeightVector &vDegree, CommVector &localCinfo, 
+        CommVector &localCupdate, const GraphElemVector &remoteCids, 
+        const CommVector &remoteCinfo, CommVector &remoteCupdate,
+        const GraphWeight constantForSecondTerm, GraphWeightVector &clusterWeight, 
+        ClusterLocalAccumulator &clacc, CommUpdateAccumulator *cupdate,
+        const GraphWeight selfLoop, const int me);
+
+// (the kernels that are not static are also timed by the
+// microbenchmarks, see benchmarks/bench.cpp)
+void distSumVertexDegree(const Graph &g, GraphWeightVector &vDegree, CommVector &localCinfo);
+
+GraphWeight distCalcConstantForSecondTerm(const GraphWeightVector &vDegree,
+        MPI_Comm comm = MPI_COMM_WORLD);
+
+GraphElem distGetMaxIndex(ClusterLocalAccumulator &clacc,
+        const GraphWeight selfLoop, const CommVector &localCinfo, 
+        const GraphElemVector &remoteCids, const CommVector &remoteCinfo,
+        const GraphWeight vDegree, const GraphElem currSize, const GraphWeight currDegree, 
         const GraphElem currComm, const GraphElem base, const GraphElem bound, const GraphWeight constant);
 
-static GraphWeight distBuildLocalMapCounter(const GraphElem e0, const GraphElem e1,
-        ClusterLocalMap &clmap, GraphWeightVector &counter, const Graph &g, const CommunityVector &currComm,
-        const VertexCommMap &remoteComm, const GraphElem vertex, const GraphElem base, const GraphElem bound);
+static GraphElem distMaxGainCandidate(const GraphElem nc, const GraphElem *comms, 
+        const GraphWeight *eiy, GraphWeight *gains, const GraphWeight eix, 
+        const GraphWeight ax, const GraphWeight vDegree, const GraphWeight constant);
 
-static GraphWeight distComputeModularity(const Graph &g, CommVector &localCinfo,
-        const GraphWeightVector &clusterWeight, 
-        const GraphWeight constantForSecondTerm, const int me);
+GraphWeight distBuildLocalMapCounter(const GraphElem e0, const GraphElem e1,
+        ClusterLocalAccumulator &clacc, const LocalElemVector &localTails, 
+        const Graph &g, const CommunityVector &currComm, 
+        const CommunityVector &remoteComm, const GraphElem vertex);
 
-static void distUpdateLocalCinfo(CommVector &localCinfo, const CommVector &localCupdate);
+GraphElem distGetRemoteCommIndex(const GraphElemVector &remoteCids, const GraphElem comm);
 
-static void distCleanCWandCU(const GraphElem nv, GraphWeightVector &clusterWeight,
-        CommVector &localCupdate);
+// the modularity, given the local terms summed by distApplyLocalCupdate,
+// in the same reduction as the number of frozen vertices of the iteration
+static GraphWeight distComputeModularity(const GraphWeight le_xx, const GraphWeight la2_x,
+        long &frozen, const GraphWeight constantForSecondTerm, MPI_Comm comm);
 
-static void distInitComm(CommunityVector &pastComm, CommunityVector &currComm,
+void distInitComm(CommunityVector &pastComm, CommunityVector &currComm,
         const GraphElem base);
 
-static void updateRemoteCommunities(const DistGraph &dg, CommVector &localCinfo,
-        const CommMap &remoteCupdate,
+// start from the communities of initialComm, the sizes and degrees of the
+// communities are summed at their owners
+static void distSeedComm(const DistGraph &dg, const CommunityVector &initialComm, 
+        const GraphWeightVector &vDegree, CommunityVector &pastComm, 
+        CommunityVector &currComm, CommVector &localCinfo, const int me, MPI_Comm comm);
+
+// send the updates of the remote communities to their owners, and add
+// the received ones to cupdate (indexed by the local communities)
+static void updateRemoteCommunities(const DistGraph &dg, CommVector &cupdate,
+        const GraphElemVector &remoteCids, const CommVector &remoteCupdate,
         const int me, const int nprocs);
 
-static void fillRemoteCommunities(const DistGraph &dg, const int me, 
+void fillRemoteCommunities(const DistGraph &dg, const int me, 
         const int nprocs, const size_t &ssz, const size_t &rsz,
         const std::vector<GraphElem> &ssizes, const std::vector<GraphElem> &rsizes, 
         const std::vector<GraphElem> &svdata, const std::vector<GraphElem> &rvdata,
         const CommunityVector &currComm, const CommVector &localCinfo, 
-        CommMap &remoteCinfo, VertexCommMap &remoteComm, CommMap &remoteCupdate);
+        GraphElemVector &remoteCids, CommVector &remoteCinfo, 
+        CommunityVector &remoteComm, CommVector &remoteCupdate);
+
+static void exchangeRemoteCommunityInfo(const DistGraph &dg, const int me, const int nprocs,
+        const CommunityVector &currComm, const CommVector &localCinfo, 
+        const CommunityVector &remoteComm, GraphElemVector &remoteCids, 
+        CommVector &remoteCinfo, CommVector &remoteCupdate);
+
+#if defined(USE_DELTA_COMMUNITY_EXCHANGE)
+static void exchangeGhostCommunityDeltas(const int me, const int nprocs, MPI_Comm comm,
+        const std::vector<GraphElem> &ssizes, const std::vector<GraphElem> &rsizes, 
+        const std::vector<GraphElem> &scdata, CommunityVector &remoteComm);
+#endif
+
+static void distClassifyVertices(const Graph &g, const LocalElemVector &localTails, 
+        GraphElemVector &interior, GraphElemVector &boundary);
+
+static bool distHasLocalCommunities(const GraphElem i, const Graph &g, 
+        const LocalElemVector &localTails, const CommunityVector &currComm, 
+        const GraphElem base, const GraphElem bound);
+
+static void postGhostCommunities(const DistGraph &dg, const int me, const int nprocs,
+        const size_t &ssz, const size_t &rsz, const std::vector<GraphElem> &ssizes, 
+        const std::vector<GraphElem> &rsizes, const std::vector<GraphElem> &svdata, 
+        const CommunityVector &currComm, CommunityVector &remoteComm, 
+        GhostCommunityRequests &greqs);
 
-static void exchangeVertexReqs(const DistGraph &dg, size_t &ssz, size_t &rsz,
+static void waitGhostCommunities(GhostCommunityRequests &greqs, CommunityVector &remoteComm);
+
+void exchangeVertexReqs(const DistGraph &dg, size_t &ssz, size_t &rsz,
         std::vector<GraphElem> &ssizes, std::vector<GraphElem> &rsizes, 
         std::vector<GraphElem> &svdata, std::vector<GraphElem> &rvdata,
-        const int me, const int nprocs);
+        LocalElemVector &localTails, const int me, const int nprocs);
+
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+static void createGhostNeighborhood(const size_t &ssz, const size_t &rsz,
+        const std::vector<GraphElem> &ssizes, const std::vector<GraphElem> &rsizes, 
+        const int me, const int nprocs, MPI_Comm comm);
+
+static bool fillRemoteCommunityInfoNeighbors(const std::vector<std::vector<GraphElem> > &rclist,
+        const CommVector &localCinfo, const GraphElem base, CommInfoVector &rinfo,
+        const int me, const int nprocs, MPI_Comm comm);
+
+void destroyGhostNeighborhood();
+#endif
 
 void createCommunityMPIType();
 void destroyCommunityMPIType();
@@ -207,4 +593,44 @@ void gatherAllComm(int root, int me, int nprocs,
         std::vector<GraphElem>& commAll, 
         const CommunityVector& localComm);
 
+// membership[v] is the community of the (original) vertex base + v, 
+// where base is the first vertex of the process in the first phase; 
+// every phase replaces it by the community of the current phase (with 
+// the communities numbered as the vertices of the next level graph), 
+// without gathering the communities of all the vertices anywhere
+void updateMembership(int me, int nprocs, const DistGraph &dg, 
+        const CommunityVector &cvect, std::vector<GraphElem> &membership, 
+        bool firstPhase);
+
+// the communities (labels, any ids, negative if unknown) of the local 
+// vertices of a previous clustering are renumbered densely, in the 
+// order of the labels (a vertex without label is a singleton), so that 
+// they are valid communities (vertex ids) to start from (initialComm of 
+// LouvainOptions); returns the number of communities
+GraphElem distSeedCommunities(int me, int nprocs, const DistGraph &dg, 
+        const std::vector<GraphElem> &labels, CommunityVector &seed);
+
+// the modularity of the communities cvect (vertex ids, as returned by 
+// distLouvainMethod) of the local vertices on dg, e.g., of communities 
+// found on another graph with the same vertices; the ghost lists (ssz 
+// to rvdata) of dg are set as by distLouvainMethod, for the rebuild
+GraphWeight distEvaluateModularity(int me, int nprocs, const DistGraph &dg, 
+        size_t &ssz, size_t &rsz, std::vector<GraphElem> &ssizes, 
+        std::vector<GraphElem> &rsizes, std::vector<GraphElem> &svdata, 
+        std::vector<GraphElem> &rvdata, const CommunityVector &cvect);
+
+// collective MPI-IO write of the communities of the processes, binary 
+// (the number of vertices, followed by the community of every vertex, 
+// as GraphElem) or text (the community of a vertex per line)
+void writeCommunities(int me, int nprocs, const std::string &fileName, 
+        const std::vector<GraphElem> &membership, GraphElem base, GraphElem nv, 
+        bool asText);
+
+// collective MPI-IO read of the communities of the vertices [base, base +
+// count) from a binary file of writeCommunities (-1 for the vertices 
+// beyond the file), returns the number of vertices of the file, or -1 
+// (without reading) if it is not a binary community file
+GraphElem readCommunities(int me, int nprocs, const std::string &fileName, 
+        GraphElem base, GraphElem count, std::vector<GraphElem> &membership);
+
 #endif
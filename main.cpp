@@ -66,13 +66,18 @@
 #include "rebuild.hpp"
 #include "louvain.hpp"
 #include "compare.hpp"
+#include "reorder.hpp"
+#include "checkpoint.hpp"
 #include "utils.hpp"
 
-std::ofstream ofs;
 std::ofstream ofcks;
 
-static std::string inputFileName, outputFileName, colorArgs;
+static std::string inputFileName, outputFileName, colorArgs, genArgsStr;
 static std::string groundTruthFileName;
+static std::string profileFileName;
+static std::string checkpointPrefix, resumePrefix;
+static std::string warmStartFileName, changedEdgesFileName;
+static int    checkpointPhases          = 1;
 static int me, nprocs;
 
 // coloring related
@@ -81,16 +86,34 @@ static int    maxColors                 = 8;
 static bool   vertexOrdering            = false;
 static bool   runOnePhase               = false;
 static bool   singleColorIter           = false;
+static bool   projectColoring           = false;
 
 static bool   generateGraph             = false;
 static bool   justProcessGraph          = false;
 static GraphElem numVerticesGenGraph    = 0;
 static GraphWeight randomEdgePercent    = 0.0;
+static int    genType                   = RGG_GENERATOR;
+static std::vector<GraphWeight> genArgs;
 
 static bool   readBalanced              = false;
+static GraphWeight balanceVertexCost    = 0.0;
+static bool   mapInputFile              = false;
+static int    mapAdvice                 = 0;
+static bool   compressOutputFile        = false;
 static int    ranksPerNode              = 1;
 static bool   outputFiles               = false;
+static bool   textCommunities           = false;
 static bool   thresholdScaling          = false;
+static bool   overlapComm               = false;
+static bool   rebalancePhases           = false;
+static GraphElem minEdgesPerProcess     = 0;
+static GraphElem rebuildBatchEdges      = 0;
+static GraphElem sharedMemoryThreshold  = 0;
+static GraphElem hubDegree              = 0;
+static GraphWeight sampleFraction       = 1.0;
+static int    reorderType               = NO_REORDER;
+static bool   privateUpdates            = false;
+static bool   deviceIteration           = false;
 
 // early termination related
 static bool   earlyTerm                 = false;
@@ -104,6 +127,11 @@ static bool  isGroundTruthZeroBased     = true;
 // parse command line parameters
 static void parseCommandLine(const int argc, char * const argv[]);
 
+// the vertices [base, base + count) that are an endpoint of a line 
+// "u v" of the (text) changed edges file, every process reads it
+static void loadChangedVertices(const std::string &fileName, bool zeroBased, 
+        GraphElem base, GraphElem count, std::vector<GraphElem> &changed);
+
 int main(int argc, char *argv[])
 {
   double t0, t1, t2, t3;
@@ -115,29 +143,6 @@ int main(int argc, char *argv[])
 
   parseCommandLine(argc, argv);
 
-  // read ground truth info if compareCommunities
-  // is turned ON, serial
-  
-  // Ground Truth file is expected to be of the format generated 
-  // by LFR-gen by Fortunato, et al.
-  // https://sites.google.com/site/santofortunato/inthepress2
-
-  std::vector<GraphElem> commGroundTruth;
-  if (me == 0 /* root */ && compareCommunities) {
-      t1 = MPI_Wtime();
-      loadGroundTruthFile(commGroundTruth, groundTruthFileName, isGroundTruthZeroBased);
-      t2 = MPI_Wtime();
-#if defined(DONT_CREATE_DIAG_FILES)
-      std::cout << "Time taken to load ground truth file (" 
-          << groundTruthFileName << "): " << (t2-t1) << std::endl;
-#else
-      ofs << "Time taken to load ground truth file (" 
-          << groundTruthFileName << "): " << (t2-t1) << std::endl;
-#endif
-  }
-
-  MPI_Barrier(MPI_COMM_WORLD); // wait till GT file is loaded
-
 #if defined(DONT_CREATE_DIAG_FILES)
 #else
   std::ostringstream oss;
@@ -151,6 +156,14 @@ int main(int argc, char *argv[])
 
   rusage rus;
 
+  // the per-rank timings are logged in debug builds
+#ifdef DEBUG_PRINTF
+  profiler.enable();
+#else
+  if (!profileFileName.empty())
+      profiler.enable();
+#endif
+
   createCommunityMPIType();
   createEdgeMPIType();
   double td0, td1;
@@ -160,13 +173,39 @@ int main(int argc, char *argv[])
 
   GraphElem teps = 0;
 
+  // restart from the graph, communities and phase of a checkpoint
+  const bool resuming = !resumePrefix.empty();
+  CheckpointState resumeState;
+  std::vector<GraphElem> resumeMembership;
+  GraphElem resumeBase = 0;
+
+  // the ground truth of the planted communities comes with the graph
+  std::vector<GraphElem> commGroundTruth;
+  const bool plantedGroundTruth = generateGraph && !resuming && (genType == PLANTED_GENERATOR) 
+      && groundTruthFileName.empty();
+  if (plantedGroundTruth)
+      compareCommunities = true;
+
   // load the input data file and distribute data   
-  if (generateGraph) {
-      generateInMemGraph(me, nprocs, dg, numVerticesGenGraph, randomEdgePercent, outputFileName);
+  if (resuming) {
+      readCheckpoint(me, nprocs, ranksPerNode, resumePrefix, dg, resumeMembership, 
+              resumeBase, resumeState);
+
+      if (me == 0)
+          std::cout << "Resuming at phase " << resumeState.phase << " from checkpoint: " 
+              << resumePrefix << " (" << resumeState.coarseNv << " vertices)" << std::endl;
+  }
+  else if (generateGraph) {
+      generateInMemGraph(me, nprocs, dg, numVerticesGenGraph, randomEdgePercent, outputFileName, 
+              compressOutputFile, genType, genArgs, (plantedGroundTruth ? &commGroundTruth : NULL));
   }
   else {
-      if (readBalanced)
-          loadDistGraphMPIIOBalanced(me, nprocs, ranksPerNode, dg, inputFileName);
+      if (mapInputFile)
+          loadDistGraphMmap(me, nprocs, ranksPerNode, dg, inputFileName, mapAdvice, 
+                  readBalanced, balanceVertexCost);
+      else if (readBalanced)
+          loadDistGraphMPIIOBalanced(me, nprocs, ranksPerNode, dg, inputFileName, 
+                  balanceVertexCost);
       else
           loadDistGraphMPIIO(me, nprocs, ranksPerNode, dg, inputFileName);
   }
@@ -219,21 +258,161 @@ int main(int argc, char *argv[])
   int phase = 0, short_phase = 0;
 
   int iters = 0, tot_iters = 0;
-  ColorElem numColors;
+  ColorElem numColors = 0;
   ColorVector colors;
   CommunityVector cvect;
   GraphWeight threshold;
 
   std::vector<GraphElem> ssizes, rsizes, svdata, rvdata;
   size_t ssz = 0U, rsz = 0U;
-  const GraphElem nv = dg->getTotalNumVertices();
+  // #vertices of the input graph
+  const GraphElem nv = resuming ? resumeState.nv : dg->getTotalNumVertices();
+  const bool trackMembership = outputFiles || compareCommunities || !checkpointPrefix.empty();
+
+  if (resuming) {
+      phase = resumeState.phase;
+      short_phase = resumeState.shortPhase;
+      tot_iters = resumeState.totIters;
+      prevMod = resumeState.modularity;
+      numColors = resumeState.numColors;
+      teps = (me == 0) ? resumeState.teps : 0;
+      total = resumeState.total;
+      ctime = resumeState.ctime;
+
+      // the projected coloring is not saved, it is recolored
+      if ((coloring || vertexOrdering) && projectColoring)
+          colors.assign(dg->getLocalGraph().getNumVertices(), -1);
+  }
     
-  // gather all communities in root
-  std::vector<GraphElem> commAll, cvectAll;
+  // relabel the vertices of every process for locality, the community
+  // order uses the communities of a first Louvain phase with a coarse
+  // threshold (profiled as phase -1), and clustering restarts on the 
+  // relabeled graph
+  std::vector<GraphElem> reorderPerm;
+
+  if (reorderType != NO_REORDER && !resuming) {
+      std::vector<GraphElem> comm;
+
+      t1 = MPI_Wtime();
+      if (reorderType == COMMUNITY_REORDER) {
+          profiler.beginPhase(-1);
+          distLouvainMethod(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, 
+                  svdata, rvdata, cvect, currMod, 1.0E-3, iters);
+          comm.assign(cvect.begin(), cvect.begin() + dg->getLocalGraph().getNumVertices());
+      }
+
+      distReorderGraph(me, nprocs, *dg, static_cast<ReorderType>(reorderType), 
+              &comm, reorderPerm);
+      t0 = MPI_Wtime();
+
+      if (me == 0)
+#if defined(DONT_CREATE_DIAG_FILES)
+          std::cout << "Time to reorder the graph: " << (t0 - t1) << std::endl;
+#else
+          ofs << "Time to reorder the graph: " << (t0 - t1) << std::endl;
+#endif
+  }
+
+  // communities of my vertices of the input graph
+  std::vector<GraphElem> membership;
+  const GraphElem membershipBase = resuming ? resumeBase : dg->getBase(me);
+
+  if (resuming)
+      membership.swap(resumeMembership);
+  else if (trackMembership)
+      membership.resize(dg->getLocalGraph().getNumVertices(), -1);
+
+  // read ground truth info if compareCommunities is turned ON, every 
+  // process reads a part of the file and keeps the communities of 
+  // the vertices above
   
-  // initialize map
-  if (me == 0 && (outputFiles || compareCommunities))
-      commAll.resize(nv, -1);
+  // Ground Truth file is expected to be of the format generated 
+  // by LFR-gen by Fortunato, et al.
+  // https://sites.google.com/site/santofortunato/inthepress2
+
+  if (compareCommunities && !plantedGroundTruth) {
+      std::vector<GraphElem> parts(nprocs + 1, nv);
+      MPI_Allgather(&membershipBase, 1, MPI_GRAPH_TYPE, parts.data(), 1, MPI_GRAPH_TYPE, 
+              MPI_COMM_WORLD);
+
+      t1 = MPI_Wtime();
+      load_ground_truth_dist(me, nprocs, groundTruthFileName, isGroundTruthZeroBased, 
+              parts, commGroundTruth);
+      t2 = MPI_Wtime();
+
+      if (me == 0) {
+#if defined(DONT_CREATE_DIAG_FILES)
+          std::cout << "Time taken to load ground truth file (" 
+              << groundTruthFileName << "): " << (t2-t1) << std::endl;
+#else
+          ofs << "Time taken to load ground truth file (" 
+              << groundTruthFileName << "): " << (t2-t1) << std::endl;
+#endif
+      }
+  }
+
+  // the communities of a previous clustering to start the first phase
+  // from, and the vertices to revisit first (next to changed edges)
+  const bool warmStart = !warmStartFileName.empty() && !resuming;
+  CommunityVector seedComm;
+  GraphElemVector seedFrontier;
+
+  if (warmStart) {
+      const GraphElem lnv = dg->getLocalGraph().getNumVertices();
+      std::vector<GraphElem> labels;
+
+      t1 = MPI_Wtime();
+      if (readCommunities(me, nprocs, warmStartFileName, membershipBase, lnv, labels) < 0) {
+          std::vector<GraphElem> parts(nprocs + 1, nv);
+          MPI_Allgather(&membershipBase, 1, MPI_GRAPH_TYPE, parts.data(), 1, MPI_GRAPH_TYPE, 
+                  MPI_COMM_WORLD);
+          load_ground_truth_dist(me, nprocs, warmStartFileName, isGroundTruthZeroBased, 
+                  parts, labels);
+      }
+
+      std::vector<GraphElem> changed;
+      if (!changedEdgesFileName.empty())
+          loadChangedVertices(changedEdgesFileName, isGroundTruthZeroBased, membershipBase, 
+                  lnv, changed);
+
+      // to the relabeled vertices
+      if (!reorderPerm.empty()) {
+          std::vector<GraphElem> reordered(lnv);
+          for (GraphElem v = 0; v < lnv; v++)
+              reordered[reorderPerm[v]] = labels[v];
+          labels.swap(reordered);
+
+          for (GraphElem &v : changed)
+              v = reorderPerm[v];
+      }
+
+      const GraphElem nseeded = distSeedCommunities(me, nprocs, *dg, labels, seedComm);
+
+      // the vertices without a community are revisited too
+      if (!changedEdgesFileName.empty()) {
+          for (GraphElem v = 0; v < lnv; v++) {
+              if (labels[v] < 0)
+                  changed.push_back(v);
+          }
+          std::sort(changed.begin(), changed.end());
+          changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+          seedFrontier.assign(changed.begin(), changed.end());
+      }
+
+      GraphElem lfrontier = seedFrontier.size(), nfrontier = 0;
+      MPI_Reduce(&lfrontier, &nfrontier, 1, MPI_GRAPH_TYPE, MPI_SUM, 0, MPI_COMM_WORLD);
+      t0 = MPI_Wtime();
+
+      if (me == 0) {
+          std::cout << "Starting from " << nseeded << " communities of file: " << warmStartFileName;
+          if (!changedEdgesFileName.empty())
+              std::cout << ", revisiting " << nfrontier << " vertices first";
+          std::cout << " (in secs): " << (t0 - t1) << std::endl;
+      }
+  }
+
+  // the sample is drawn at the first phase, after a warm start
+  const bool sampleFirstPhase = (sampleFraction < 1.0) && !warmStart && !resuming;
 
   MPI_Barrier(MPI_COMM_WORLD);
 
@@ -261,111 +440,110 @@ int main(int argc, char *argv[])
     else
         threshold = 1.0E-6;
 
+    // finish on the root once the graph is small enough
+    const bool finishSharedMemory = !runOnePhase && (sharedMemoryThreshold > 0) 
+        && (dg->getTotalNumVertices() <= sharedMemoryThreshold) 
+        && canGatherDistGraph(*dg);
+
+    profiler.beginPhase(phase);
+    phaseArena.reset();
+
+    // the peak memory of the phase, and of its rebuild
+    double memCurrent = 0.0, memPeaks[2] = {0.0, 0.0};
+    resetPeakMemory();
+
     t1 = MPI_Wtime();
-    // only invoke coloring for first phase when the graph is the largest
-    if (coloring && (phase == 0)) { 
-        t1 = MPI_Wtime();
-        numColors = distColoringMultiHashMinMax(me, nprocs, *dg, colors, (maxColors/2), MAX_COVG, singleColorIter);
+    if (finishSharedMemory) {
+        currMod = distLouvainMethodSharedMemory(me, nprocs, *dg, cvect, currMod, 
+                threshold, iters);
+    }
+    else {
+        LouvainOptions options;
+
+        if (earlyTerm) {
+            if (ETType == 5)
+                options.termination = FRONTIER_TERMINATION;
+            else
+                options.termination = (ETType == 1 || ETType == 3) ? INACTIVE_TERMINATION 
+                    : PROBABILISTIC_TERMINATION;
+            options.ETDelta = ETDelta;
+            options.ETLocalOrRemote = (ETType == 1 || ETType == 2);
+        }
+        options.overlapComm = overlapComm;
+        options.hubDegree = hubDegree;
+        options.privateUpdates = privateUpdates;
+        options.deviceIteration = deviceIteration;
+
+        // the first phase starts from the previous communities
+        if (warmStart && phase == 0) {
+            options.initialComm = &seedComm;
+            if (!changedEdgesFileName.empty()) {
+                options.termination = FRONTIER_TERMINATION;
+                options.initialFrontier = &seedFrontier;
+            }
+        }
+
+        // only invoke coloring for first phase when the graph is the largest
+        if ((coloring || vertexOrdering) && (phase == 0)) {
+            t1 = MPI_Wtime();
+            numColors = distColoringMultiHashMinMax(me, nprocs, *dg, colors, (maxColors/2), MAX_COVG, singleColorIter);
 #if defined(DONT_CREATE_DIAG_FILES)
-        if (me == 0) std::cout << "Number of colors (2*nHash): " << numColors << std::endl;
+            if (me == 0) std::cout << "Number of colors (2*nHash): " << numColors << std::endl;
 #else
-        if (me == 0) ofs << "Number of colors (2*nHash): " << numColors << std::endl;
+            if (me == 0) ofs << "Number of colors (2*nHash): " << numColors << std::endl;
 #endif
-        t0 = MPI_Wtime();
-        if(me == 0) 
+            t0 = MPI_Wtime();
+            if(me == 0) 
 #if defined(DONT_CREATE_DIAG_FILES)
-            std::cout<< "Coloring Time: "<<t0-t1<<std::endl;
+                std::cout<< "Coloring Time: "<<t0-t1<<std::endl;
 #else
-            ofs<< "Coloring Time: "<<t0-t1<<std::endl;
+                ofs<< "Coloring Time: "<<t0-t1<<std::endl;
 #endif
-        if (earlyTerm && ETType == 1) {
-            currMod = distLouvainMethodWithColoring(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters, true);
-        }
-        else if (earlyTerm && ETType == 2) {
-            currMod = distLouvainMethodWithColoring(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters, ETDelta, true);
-        }
-        else if (earlyTerm && ETType == 3) {
-            currMod = distLouvainMethodWithColoring(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters, false);
-        }
-        else if (earlyTerm && ETType == 4) {
-            currMod = distLouvainMethodWithColoring(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters, ETDelta, false);
+            options.order = coloring ? COLOR_ORDER : VERTEX_ORDER;
+            options.numColor = numColors+1;
+            options.vertexColor = &colors;
         }
-        else {
-            currMod = distLouvainMethodWithColoring(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters);
-        }
-    }
-    else if (vertexOrdering && (phase == 0)) {
-        t1 = MPI_Wtime();
-        numColors = distColoringMultiHashMinMax(me, nprocs, *dg, colors, (maxColors/2), MAX_COVG, singleColorIter);
+        // the coloring was projected on this graph by the rebuild, 
+        // only its conflicts are recolored
+        else if ((coloring || vertexOrdering) && projectColoring) {
+            t1 = MPI_Wtime();
+            const GraphElem recolored = distRepairColoring(me, nprocs, *dg, colors, numColors);
+            t0 = MPI_Wtime();
+            if(me == 0) 
 #if defined(DONT_CREATE_DIAG_FILES)
-        if (me == 0) std::cout << "Number of colors (2*nHash): " << numColors << std::endl;
+                std::cout<< "Recolored vertices: " << recolored << ", Recoloring Time: "<<t0-t1<<std::endl;
 #else
-        if (me == 0) ofs << "Number of colors (2*nHash): " << numColors << std::endl;
+                ofs<< "Recolored vertices: " << recolored << ", Recoloring Time: "<<t0-t1<<std::endl;
 #endif
-        t0 = MPI_Wtime();
-        if(me == 0) 
+            options.order = coloring ? COLOR_ORDER : VERTEX_ORDER;
+            options.numColor = numColors+1;
+            options.vertexColor = &colors;
+        }
+
+        // the first phase clusters a sample of the edges, and the 
+        // next level graph is built from all the edges
+        if (sampleFirstPhase && phase == 0) {
+            DistGraph *sg = sampleDistGraph(me, nprocs, *dg, sampleFraction);
+            const GraphWeight sampleMod = distLouvainMethod(me, nprocs, *sg, ssz, rsz, 
+                    ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, iters, 
+                    options);
+            delete sg;
+
+            currMod = distEvaluateModularity(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, 
+                    svdata, rvdata, cvect);
+
+            if (me == 0) 
 #if defined(DONT_CREATE_DIAG_FILES)
-            std::cout<< "Coloring Time: "<<t0-t1<<std::endl;
+                std::cout << "Modularity of the sampled phase on the sample: " << sampleMod 
+                    << ", on the graph: " << currMod << std::endl;
 #else
-            ofs<< "Coloring Time: "<<t0-t1<<std::endl;
+                ofs << "Modularity of the sampled phase on the sample: " << sampleMod 
+                    << ", on the graph: " << currMod << std::endl;
 #endif
-        if (earlyTerm && ETType == 1) {
-            currMod = distLouvainMethodVertexOrder(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters, true);
-        }
-        else if (earlyTerm && ETType == 2) {
-            currMod = distLouvainMethodVertexOrder(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters, ETDelta, true);
-        }
-        else if (earlyTerm && ETType == 3) {
-            currMod = distLouvainMethodVertexOrder(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters, false);
-        }
-        else if (earlyTerm && ETType == 4) {
-            currMod = distLouvainMethodVertexOrder(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters, ETDelta, false);
-        }
-        else {
-            currMod = distLouvainMethodVertexOrder(me, nprocs, *dg, numColors+1, colors, 
-                    ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, currMod, threshold, 
-                    iters);
-        }
-    }
-    else {
-        if (earlyTerm && ETType == 1) {
-            currMod = distLouvainMethod(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, 
-                    svdata, rvdata, cvect, currMod, threshold, iters, true);
         }
-        else if (earlyTerm && ETType == 2) {
+        else
             currMod = distLouvainMethod(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, 
-                    svdata, rvdata, cvect, currMod, threshold, iters, ETDelta, true);
-        }
-        else if (earlyTerm && ETType == 3) {
-            currMod = distLouvainMethod(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, 
-                    svdata, rvdata, cvect, currMod, threshold, iters, false);
-        }
-        else if (earlyTerm && ETType == 4) {
-            currMod = distLouvainMethod(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, 
-                    svdata, rvdata, cvect, currMod, threshold, iters, ETDelta, false);
-        }
-        else {
-            currMod = distLouvainMethod(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, 
-                    svdata, rvdata, cvect, currMod, threshold, iters);
-        }
+                    svdata, rvdata, cvect, currMod, threshold, iters, options);
     }
     t0 = MPI_Wtime();
 
@@ -377,60 +555,23 @@ int main(int argc, char *argv[])
     if((currMod - prevMod) > threshold) {
                
         /// Store communities in every phase
-        if (outputFiles || compareCommunities) { 
-
-            // gather cvect into root
-            gatherAllComm(0 /*root*/, me, nprocs, cvectAll, cvect);
-
-            // update community info
-            if (me == 0) {
-#ifdef DEBUG_PRINTF    
-                std::cout << "Updated community list per level into global array at root..." << std::endl;
-#endif
-                // ensure clusters are contiguous
-                const GraphElem Nc = cvectAll.size();
-                std::vector<GraphElem> cvectRen(Nc, 0);
-                std::map<GraphElem, GraphElem> kval;
-                GraphElem nidx = 0;
-
-                std::copy(cvectAll.begin(), cvectAll.end(), cvectRen.begin());
-                std::sort(cvectRen.begin(), cvectRen.end()); // default < cmp
-
-                // create a dictionary and map to new indices
-                for (GraphElem n = 0; n < Nc; n++)
-                {     
-                    if (kval.find(cvectRen[n]) == kval.end())
-                    {
-                        kval.insert(std::pair<GraphElem,GraphElem>(cvectRen[n], nidx));
-                        nidx++;
-                    }
-                }
-
-                // update cvectAll
-                for (GraphElem c = 0; c < Nc; c++)
-                    cvectAll[c] = kval[cvectAll[c]];
-
-                cvectRen.clear();
-                kval.clear();
-                if (phase == 0) 
-                    std::copy(cvectAll.begin(), cvectAll.end(), commAll.begin());
-                else {
-                    for (GraphElem p = 0; p < commAll.size(); p++)
-                        commAll[p] = cvectAll[commAll[p]];
-                }
-            }
-            
-            MPI_Barrier(MPI_COMM_WORLD);
-        }
+        if (trackMembership)
+            updateMembership(me, nprocs, *dg, cvect, membership, (phase == 0) && !resuming);
         
         /// Create new graph and rebuild 
-        if (!runOnePhase) {
+        if (!runOnePhase && !finishSharedMemory) {
+            memoryUsage(memCurrent, memPeaks[0]);
+            resetPeakMemory();
             t3 = MPI_Wtime();
 
             distbuildNextLevelGraph(nprocs, me, dg, ssz, rsz, 
-                    ssizes, rsizes, svdata, rvdata, cvect);
+                    ssizes, rsizes, svdata, rvdata, cvect, 
+                    rebalancePhases, minEdgesPerProcess, 
+                    ((coloring || vertexOrdering) && projectColoring) ? &colors : NULL,
+                    rebuildBatchEdges);
 
             t2 = MPI_Wtime();
+            memoryUsage(memCurrent, memPeaks[1]);
 
             if(me == 0) { 
 #if defined(DONT_CREATE_DIAG_FILES)
@@ -451,6 +592,7 @@ int main(int argc, char *argv[])
         // ONCE with 1E-6 as threshold before exiting
         GraphWeight tex_1 = 0.0, tex_2 = 0.0;
         if (thresholdScaling && !runOnePhase && phase < 10) {
+            profiler.beginPhase(phase);
             tex_1 = MPI_Wtime();
             currMod = distLouvainMethod(me, nprocs, *dg, ssz, rsz, ssizes, rsizes, 
                     svdata, rvdata, cvect, currMod, 1.0E-6, iters);
@@ -461,6 +603,12 @@ int main(int argc, char *argv[])
         break;
     }
 
+    // (the peak since the last reset, when there is no rebuild)
+    if (memPeaks[1] == 0.0)
+        memoryUsage(memCurrent, memPeaks[0]);
+    memPeaks[0] = std::max(memPeaks[0], memPeaks[1]);
+    MPI_Reduce(me == 0 ? MPI_IN_PLACE : memPeaks, memPeaks, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
     if(me == 0 ) {
         teps += dg->getTotalNumEdges() * tot_iters;
 #if defined(DONT_CREATE_DIAG_FILES)
@@ -469,6 +617,13 @@ int main(int argc, char *argv[])
 #else
         ofs << "Level "<< phase << ", Modularity: " << currMod <<", Clustering time: "<<t0-t1<< ", Iterations: " 
             << tot_iters << std::endl;
+#endif
+#if defined(DONT_CREATE_DIAG_FILES)
+        std::cout << "Peak memory (max over processes, MB): " << memPeaks[0] 
+            << ", of the rebuild: " << memPeaks[1] << std::endl;
+#else
+        ofs << "Peak memory (max over processes, MB): " << memPeaks[0] 
+            << ", of the rebuild: " << memPeaks[1] << std::endl;
 #endif
     }
 
@@ -489,6 +644,13 @@ int main(int argc, char *argv[])
     total += ptotal;
     phase++;
 
+    // Exit if the shared-memory method has run all phases
+    if (finishSharedMemory) {
+        if (me == 0)
+            std::cout << "Finished the remaining phases on the root process." << std::endl;
+        break;
+    }
+
     // Exit if only running for a single phase
     if (runOnePhase) {
         if (me == 0)
@@ -509,6 +671,42 @@ int main(int argc, char *argv[])
         }
         break;
     }
+
+    // save the graph of the next phase and the communities
+    if (!checkpointPrefix.empty() && (phase % checkpointPhases) == 0) {
+        CheckpointState state;
+        double times[2] = {total, ctime};
+
+        MPI_Allreduce(MPI_IN_PLACE, times, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+        state.nv = nv;
+        state.coarseNv = dg->getTotalNumVertices();
+        state.phase = phase;
+        state.shortPhase = short_phase;
+        state.totIters = tot_iters;
+        state.modularity = prevMod;
+        state.numColors = numColors;
+        state.teps = teps;
+        state.total = times[0] / nprocs;
+        state.ctime = times[1] / nprocs;
+
+        t1 = MPI_Wtime();
+        if (reorderPerm.empty())
+            writeCheckpoint(me, nprocs, checkpointPrefix, dg, membership, membershipBase, state);
+        else {
+            std::vector<GraphElem> inputMembership(membership);
+            restoreInputOrder(reorderPerm, inputMembership);
+            writeCheckpoint(me, nprocs, checkpointPrefix, dg, inputMembership, membershipBase, state);
+        }
+        t0 = MPI_Wtime();
+
+        if (me == 0)
+#if defined(DONT_CREATE_DIAG_FILES)
+            std::cout << "Checkpoint time: " << (t0 - t1) << std::endl;
+#else
+            ofs << "Checkpoint time: " << (t0 - t1) << std::endl;
+#endif
+    }
   } // end of phases
   
   MPI_Barrier(MPI_COMM_WORLD);
@@ -534,52 +732,54 @@ int main(int argc, char *argv[])
 #endif
   }
 
+  // back to the vertices of the input graph
+  if (!reorderPerm.empty() && (outputFiles || compareCommunities))
+      restoreInputOrder(reorderPerm, membership);
+
   // dump community information in a file    
   if (outputFiles) {
-      
-      if(me == 0) {
-          std::string outFileName = inputFileName;
-          outFileName += ".communities";
+      std::string outFileName = (resuming && inputFileName.empty()) ? resumePrefix : inputFileName;
+      outFileName += ".communities";
 
-          std::ofstream ofs;
-          ofs.open(outFileName.c_str(), std::ios::out);
-
-          if (!ofs) {
-              std::cerr << "Error creating community file: " << outFileName << std::endl;
-              exit(EXIT_FAILURE);
-          }
-
-          // write the data
-          for (GraphElem i = 0; i < nv; i++) {
-              ofs << commAll[i] << "\n";
-          }
-
-          ofs.close();
+      t0 = MPI_Wtime();
+      writeCommunities(me, nprocs, outFileName, membership, membershipBase, nv, 
+              textCommunities);
+      t1 = MPI_Wtime();
 
+      if (me == 0) {
           std::cout << std::endl;
           std::cout << "-----------------------------------------------------" << std::endl;
-          std::cout << "Saved community information (" << commAll.size() 
-              << " vertices)  on file: " << outFileName << std::endl;
+          std::cout << "Saved community information (" << nv << " vertices, " 
+              << (textCommunities ? "text" : "binary") << ") on file: " << outFileName 
+              << " in " << (t1 - t0) << " secs." << std::endl;
           std::cout << "-----------------------------------------------------" << std::endl;
       }
-      
-      MPI_Barrier(MPI_COMM_WORLD);
+  }
+
+  if (!profileFileName.empty()) {
+      profiler.write(profileFileName);
+
+      if (me == 0)
+          std::cout << "Saved the per-iteration profile on file: " << profileFileName << std::endl;
   }
 
   // compare computed communities with ground truth
   if(compareCommunities) {
-      if(me == 0)
-          compare_communities(commGroundTruth, commAll);
+      t0 = MPI_Wtime();
+      compare_communities_dist(me, nprocs, commGroundTruth, membership);
+      t1 = MPI_Wtime();
 
-      // rest of the processes wait on barrier    
-      MPI_Barrier(MPI_COMM_WORLD);
+      if (me == 0)
+          std::cout << "Time to compare the communities (in secs): " << (t1 - t0) << std::endl;
   }
 
-  commAll.clear();
-  cvectAll.clear();
+  membership.clear();
   commGroundTruth.clear();
 
   destroyCommunityMPIType();
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+  destroyGhostNeighborhood();
+#endif
   destroyEdgeMPIType();
 
   colors.clear();
@@ -606,7 +806,7 @@ void parseCommandLine(const int argc, char * const argv[])
   int ret;
   char *temp; // check empty values
 
-  while ((ret = getopt(argc, argv, "f:bc:od:r:t:a:ig:zpn:e:s:j")) != -1) {
+  while ((ret = getopt(argc, argv, "f:bc:od:r:t:a:ig:zpn:e:s:jlv:m:k:x:wyu:h:q:RGPT:C:S:I:A:M:")) != -1) {
     switch (ret) {
     case 'f':
       inputFileName.assign(optarg);
@@ -637,6 +837,10 @@ void parseCommandLine(const int argc, char * const argv[])
     case 'o':
       outputFiles = true;
       break;
+    case 'y':
+      outputFiles = true;
+      textCommunities = true;
+      break;
     case 'd':
       {
           colorArgs.assign(optarg);
@@ -693,6 +897,97 @@ void parseCommandLine(const int argc, char * const argv[])
     case 'j':
       justProcessGraph = true;
       break;
+    case 'l':
+      overlapComm = true;
+      break;
+    case 'v':
+      balanceVertexCost = atof(optarg);
+      break;
+    case 'm':
+      rebalancePhases = true;
+      minEdgesPerProcess = atol(optarg);
+      break;
+    case 'M':
+      rebuildBatchEdges = atol(optarg);
+      break;
+    case 'k':
+      sharedMemoryThreshold = atol(optarg);
+      break;
+    case 'x':
+      mapInputFile = true;
+      mapAdvice = atoi(optarg);
+      break;
+    case 'w':
+      compressOutputFile = true;
+      break;
+    case 'u':
+      profileFileName.assign(optarg);
+      break;
+    case 'h':
+      hubDegree = atol(optarg);
+      break;
+    case 'q':
+      reorderType = atoi(optarg);
+      break;
+    case 'R':
+      privateUpdates = true;
+      break;
+    case 'G':
+      deviceIteration = true;
+      break;
+    case 'P':
+      projectColoring = true;
+      break;
+    case 'C':
+      {
+          std::stringstream ss(optarg);
+          ss >> checkpointPrefix;
+          if (!(ss >> checkpointPhases) || checkpointPhases < 1)
+              checkpointPhases = 1;
+      }
+      break;
+    case 'S':
+      resumePrefix.assign(optarg);
+      break;
+    case 'I':
+      {
+          std::stringstream ss(optarg);
+          ss >> warmStartFileName >> changedEdgesFileName;
+      }
+      break;
+    case 'A':
+      sampleFraction = atof(optarg);
+      if (sampleFraction <= 0.0 || sampleFraction > 1.0) {
+          if (me == 0)
+              std::cerr << "The sampled fraction of the edges (-A) must be in (0, 1]." << std::endl;
+          MPI_Abort(MPI_COMM_WORLD, -99);
+      }
+      break;
+    case 'T':
+      {
+          genArgsStr.assign(optarg);
+          std::stringstream ss(genArgsStr);
+          std::string s;
+          std::vector<std::string> args;
+          while (std::getline(ss, s, ' ')) {
+              if (!s.empty())
+                  args.push_back(s);
+          }
+          if (args.size() > 0) {
+              std::transform(args[0].begin(), args[0].end(), args[0].begin(), ::tolower);
+              if (args[0] == "rmat")
+                  genType = RMAT_GENERATOR;
+              else if (args[0] == "planted" || args[0] == "lfr")
+                  genType = PLANTED_GENERATOR;
+              else if (args[0] == "rgg")
+                  genType = RGG_GENERATOR;
+              else
+                  genType = -1;
+              for (size_t i = 1; i < args.size(); i++)
+                  genArgs.push_back(std::stod(args[i]));
+          }
+      }
+      break;
     default:
       assert(0 && "Should not reach here!!");
       break;
@@ -703,8 +998,13 @@ void parseCommandLine(const int argc, char * const argv[])
       std::cout << "Passing an output file has no effect for real-world graphs." << std::endl;
   }
 
-  if (me == 0 && earlyTerm && (ETType < 1 || ETType > 4)) {
-      std::cerr << "early-term-type parameter is between 1-4 : -t 1 OR -t 2 OR -t 3 OR -t 4" << std::endl;
+  if (me == 0 && earlyTerm && (ETType < 1 || ETType > 5)) {
+      std::cerr << "early-term-type parameter is between 1-5 : -t 1 OR -t 2 OR -t 3 OR -t 4 OR -t 5" << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, -99);
+  }
+
+  if (me == 0 && (reorderType < NO_REORDER || reorderType > COMMUNITY_REORDER)) {
+      std::cerr << "reorder-type parameter is between 1-3 : -q 1 (degree) OR -q 2 (RCM) OR -q 3 (community)" << std::endl;
       MPI_Abort(MPI_COMM_WORLD, -99);
   }
 
@@ -713,7 +1013,7 @@ void parseCommandLine(const int argc, char * const argv[])
       MPI_Abort(MPI_COMM_WORLD, -99);
   }
    
-  if (me == 0 && !generateGraph && inputFileName.empty()) {
+  if (me == 0 && !generateGraph && inputFileName.empty() && resumePrefix.empty()) {
       std::cerr << "Must specify a binary file name with -f" << std::endl;
       MPI_Abort(MPI_COMM_WORLD, -99);
   }
@@ -733,30 +1033,94 @@ void parseCommandLine(const int argc, char * const argv[])
       MPI_Abort(MPI_COMM_WORLD, -99);
   }
   
+  if (me == 0 && !readBalanced && (balanceVertexCost > 0.0)) {
+      std::cout << "Passing a vertex cost (-v) has no effect without edge balancing (-b)." << std::endl;
+  }
+  
+  if (me == 0 && overlapComm && (coloring || vertexOrdering)) {
+      std::cout << "Overlapping communication (-l) has no effect on the phases with coloring or vertex ordering." << std::endl;
+  }
+
+  if (me == 0 && projectColoring && !(coloring || vertexOrdering)) {
+      std::cout << "Projecting the coloring (-P) has no effect without coloring (-c) or vertex ordering (-d)." << std::endl;
+  }
+
+  if (me == 0 && overlapComm && (hubDegree > 0)) {
+      std::cout << "Overlapping communication (-l) has no effect with hub scheduling (-h)." << std::endl;
+  }
+
+#if defined(OMP_TARGET_OFFLOAD)
+  if (me == 0 && deviceIteration && (earlyTerm || hubDegree > 0 || overlapComm || privateUpdates)) {
+      std::cout << "Early termination (-t), hub scheduling (-h), overlapping communication (-l) and private updates (-R) have no effect with the device iteration (-G)." << std::endl;
+  }
+#else
+  if (me == 0 && deviceIteration) {
+      std::cout << "The device iteration (-G) has no effect unless built with -DOMP_TARGET_OFFLOAD." << std::endl;
+  }
+#endif
+
+#if defined(USE_NUMA_FIRST_TOUCH)
+  if (me == 0 && (omp_get_proc_bind() == omp_proc_bind_false)) {
+      std::cout << "The threads are not bound (set OMP_PROC_BIND/OMP_PLACES), so the first-touch placement may not hold." << std::endl;
+  }
+#endif
+
+  if (me == 0 && (genType < RGG_GENERATOR || genType > PLANTED_GENERATOR)) {
+      std::cerr << "The generator type (-T) must be one of rgg, rmat or planted: -T \"planted 16 0.3\"" << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, -99);
+  }
+
+  if (me == 0 && !resumePrefix.empty() && (generateGraph || !inputFileName.empty() || reorderType != NO_REORDER)) {
+      std::cout << "Resuming from a checkpoint (-S) does not read or generate the input graph (-f, -n), nor reorder it (-q)." << std::endl;
+  }
+
+  if (me == 0 && !resumePrefix.empty() && !warmStartFileName.empty()) {
+      std::cout << "Starting from previous communities (-I) has no effect when resuming from a checkpoint (-S)." << std::endl;
+  }
+
+  if (me == 0 && (sampleFraction < 1.0) && (!warmStartFileName.empty() || !resumePrefix.empty())) {
+      std::cout << "Sampling the first phase (-A) has no effect when starting from previous communities (-I) or resuming from a checkpoint (-S)." << std::endl;
+  }
+
+  if (me == 0 && !generateGraph && (genType != RGG_GENERATOR)) {
+      std::cout << "The generator type (-T) has no effect without graph generation (-n)." << std::endl;
+  }
+
+  if (me == 0 && (genType != RGG_GENERATOR) && (randomEdgePercent > 0.0)) {
+      std::cout << "Adding random edges (-e) has no effect with the R-MAT or planted generators (-T)." << std::endl;
+  }
+
   if (me == 0 && !generateGraph && (randomEdgePercent > 0.0)) {
       std::cerr << "Must specify -n <...> for graph generation first and then -p <...> to add random edges to it." << std::endl;
       MPI_Abort(MPI_COMM_WORLD, -99);
   }
-  
-  if (generateGraph) {
-      // check if number of nodes is divisible by #processes
-      if ((numVerticesGenGraph % nprocs) != 0) {
-          if (me == 0) {
-              std::cout << "[ERROR] For in-memory graph generation, number of vertices must be perfectly divisible by number of processes." << std::endl;
-              std::cout << "Exiting..." << std::endl;
-          }
-          MPI_Abort(MPI_COMM_WORLD, -99);
-      }
+} // parseCommandLine
 
-      // check if processes are power of 2
-      if (((nprocs != 0) && !(nprocs & (nprocs - 1)))) {
-      }
-      else {
-          if (me == 0) {
-              std::cout << "[ERROR] For in-memory graph generation, number of processes must be a power of 2." << std::endl;
-              std::cout << "Exiting..." << std::endl;
-          }
-          MPI_Abort(MPI_COMM_WORLD, -99);
+void loadChangedVertices(const std::string &fileName, bool zeroBased, 
+        GraphElem base, GraphElem count, std::vector<GraphElem> &changed)
+{
+  std::ifstream ifs(fileName.c_str());
+
+  if (!ifs) {
+      std::cerr << "Error opening changed edges file: " << fileName << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, -99);
+  }
+
+  std::string line;
+  while (std::getline(ifs, line)) {
+      std::istringstream is(line);
+      GraphElem u, v;
+
+      if (!(is >> u >> v))
+          continue;
+      if (!zeroBased) {
+          u--;
+          v--;
       }
+
+      if (u >= base && u < (base + count))
+          changed.push_back(u - base);
+      if (v >= base && v < (base + count))
+          changed.push_back(v - base);
   }
-} // parseCommandLine
+} // loadChangedVertices
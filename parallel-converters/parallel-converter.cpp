@@ -64,11 +64,17 @@
 #include "../utils.hpp"
 
 #include "parallel-shards.hpp"
+#include "parallel-edgelist.hpp"
 
 static std::string inputFileName, outputFileName, shardedFileArgs;
 static bool indexOneBased = false;
 static int nAggrPEs = 1;
 
+// format of a single input file (when the 
+// shards are not passed with -x)
+static bool edgeListFormat = false;
+static EdgeFile_t inputFormat = SIMPLE_FORMAT;
+
 // this option will override whatever 
 // weights there are in the file, and 
 // make weights 1.0 for ALL edges
@@ -89,6 +95,36 @@ int main(int argc, char *argv[])
   
   parseCommandLine(argc, argv);
 
+  Weight_t wtype = ABS_WEIGHT;
+  if (randomEdgeWeight)
+      wtype = RND_WEIGHT;
+  else if (makeWeightsOne)
+      wtype = ONE_WEIGHT;
+  else if (origEdgeWeight)
+      wtype = ORG_WEIGHT;
+
+  double t0, t1, t2, rt;
+
+  // a single file, every process parses a part of it
+  if (edgeListFormat) {
+      t0 = mytimer();
+
+      loadParallelEdgeList(me, size, nAggrPEs, inputFileName, outputFileName, 
+              inputFormat, indexOneBased, wtype);
+
+      t1 = mytimer();
+      t2 = t1 - t0;
+      MPI_Reduce(&t2, &rt, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+      if (me == 0) {
+          std::cout << "Time converting " << inputFileName << " to binary with " << size 
+              << " processes (in secs): " << rt << std::endl;
+      }
+
+      MPI_Finalize();
+      return 0;
+  }
+
   // fetch shard specific arguments, expecting four
   std::stringstream ss(shardedFileArgs);
   std::string s;
@@ -111,25 +147,14 @@ int main(int argc, char *argv[])
 
   args.clear();
  
-  double t0, t1, t2, rt;
   t0 = mytimer();
   
   if (me == 0) {
       std::cout << "Start reading " << numFiles << " files." << std::endl;  
   }
 
-  if (randomEdgeWeight)
-      loadParallelFileShards(me, size, nAggrPEs, inputFileName, outputFileName, 
-              startChunk, endChunk, indexOneBased, RND_WEIGHT, shardCount);
-  else if (makeWeightsOne)
-      loadParallelFileShards(me, size, nAggrPEs, inputFileName, outputFileName, 
-              startChunk, endChunk, indexOneBased, ONE_WEIGHT, shardCount);
-  else if (origEdgeWeight) 
-      loadParallelFileShards(me, size, nAggrPEs, inputFileName, outputFileName, 
-              startChunk, endChunk, indexOneBased, ORG_WEIGHT, shardCount);
-  else
-      loadParallelFileShards(me, size, nAggrPEs, inputFileName, outputFileName, 
-              startChunk, endChunk, indexOneBased, ABS_WEIGHT, shardCount);
+  loadParallelFileShards(me, size, nAggrPEs, inputFileName, outputFileName, 
+          startChunk, endChunk, indexOneBased, wtype, shardCount);
 
   t1 = mytimer();
   t2 = t1 - t0;
@@ -139,6 +164,7 @@ int main(int argc, char *argv[])
       std::cout << "Average time reading " << numFiles << " sharded files and writing binary file (in secs): " << rt / size << std::endl;
   }
 
+  MPI_Finalize();
   return 0;
 } // main
 
@@ -146,7 +172,7 @@ void parseCommandLine(const int argc, char * const argv[])
 {
   int ret;
 
-  while ((ret = getopt(argc, argv, "f:o:n:x:zw")) != -1) {
+  while ((ret = getopt(argc, argv, "f:o:n:x:zwrisuam")) != -1) {
     switch (ret) {
     case 'f':
       inputFileName.assign(optarg);
@@ -166,6 +192,28 @@ void parseCommandLine(const int argc, char * const argv[])
     case 'w':
       makeWeightsOne = true;
       break;
+    case 'r':
+      randomEdgeWeight = true;
+      break;
+    case 'i':
+      origEdgeWeight = true;
+      break;
+    case 's':
+      edgeListFormat = true;
+      inputFormat = SIMPLE_FORMAT;
+      break;
+    case 'u':
+      edgeListFormat = true;
+      inputFormat = SIMPLE_UNDIRECTED;
+      break;
+    case 'a':
+      edgeListFormat = true;
+      inputFormat = SNAP_FORMAT;
+      break;
+    case 'm':
+      edgeListFormat = true;
+      inputFormat = MATRIX_MARKET_FORMAT;
+      break;
     default:
       assert(0 && "Should not reach here!!");
       break;
@@ -181,4 +229,10 @@ void parseCommandLine(const int argc, char * const argv[])
     std::cerr << "Must specify an output file name with -o" << std::endl;
     exit(EXIT_FAILURE);
   }
+
+  if (edgeListFormat == !shardedFileArgs.empty()) {
+    std::cerr << "Must specify either the format of the input file (-s, -u, -a or -m), "
+      "or the shards with -x" << std::endl;
+    exit(EXIT_FAILURE);
+  }
 } // parseCommandLine
@@ -0,0 +1,531 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "parallel-edgelist.hpp"
+
+#include "../converters/parse.hpp"
+#include "../converters/matrix-market.hpp"
+#include "../converters/snap.hpp"
+
+// MPI datatype of the exchanged tuples (edges, or {id, value} pairs)
+static MPI_Datatype createTupleType()
+{
+  GraphElemTuple et;
+  MPI_Datatype ettype;
+  MPI_Aint displ[3], base;
+  int blens[] = { 1, 1, 1 };
+  MPI_Datatype types[] = { MPI_GRAPH_TYPE, MPI_GRAPH_TYPE, MPI_WEIGHT_TYPE };
+
+  MPI_Get_address(&et, displ);
+  MPI_Get_address(&et.j_, displ+1);
+  MPI_Get_address(&et.w_, displ+2);
+  base = displ[0];
+
+  for (int i = 0; i < 3; i++)
+      displ[i] = MPI_Aint_diff(displ[i], base);
+
+  MPI_Type_create_struct(3, blens, displ, types, &ettype);
+  MPI_Type_commit(&ettype);
+
+  return ettype;
+} // createTupleType
+
+// collective transfer of bytes at offset, in rounds of at most 
+// INT_MAX bytes (every process takes part in all the rounds)
+template<typename Transfer>
+static void transferAtAll(char *buf, const size_t bytes, const MPI_Offset offset, 
+        Transfer transfer)
+{
+  const uint64_t rounds = (bytes + INT_MAX - 1) / INT_MAX;
+  uint64_t maxRounds = 0;
+
+  MPI_Allreduce(&rounds, &maxRounds, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+
+  for (uint64_t r = 0; r < maxRounds; r++) {
+      const size_t done = std::min<size_t>(bytes, r * INT_MAX);
+      const int count = std::min<size_t>(bytes - done, INT_MAX);
+
+      if (transfer(offset + done, buf + done, count) != MPI_SUCCESS) {
+          std::cout << "Error in transferring " << count << " bytes from/to offset: " 
+              << (offset + done) << std::endl;
+          MPI_Abort(MPI_COMM_WORLD, -99);
+      }
+  }
+} // transferAtAll
+
+// read the lines that start in the share of the process of 
+// [dataBegin, file size): the range is extended to the newline 
+// ending its last line, and begins with the byte before it (to 
+// tell whether a line starts at its first byte); the lines of the 
+// process are [begin, size) of the returned buffer
+static char *readLines(MPI_File fh, const int rank, const int nprocs, 
+        const MPI_Offset dataBegin, size_t &begin, size_t &size)
+{
+  MPI_Offset fileSize;
+  MPI_File_get_size(fh, &fileSize);
+
+  const MPI_Offset length = std::max<MPI_Offset>(fileSize - dataBegin, 0);
+  const MPI_Offset lo = dataBegin + (length * rank) / nprocs;
+  const MPI_Offset hi = dataBegin + (length * (rank + 1)) / nprocs;
+  const MPI_Offset first = (lo > dataBegin) ? (lo - 1) : lo;
+  MPI_Offset last = hi;
+
+  // the last line ends at the first newline from hi - 1
+  if (hi > lo) {
+      std::vector<char> block(1 << 16);
+      MPI_Offset pos = hi - 1;
+
+      last = fileSize;
+      while (pos < fileSize) {
+          const int count = std::min<MPI_Offset>(block.size(), fileSize - pos);
+          MPI_File_read_at(fh, pos, block.data(), count, MPI_BYTE, MPI_STATUS_IGNORE);
+
+          const char *eol = static_cast<const char*>(std::memchr(block.data(), '\n', count));
+          if (eol) {
+              last = pos + (eol - block.data()) + 1;
+              break;
+          }
+          pos += count;
+      }
+  }
+
+  size = last - first;
+  char *buffer = new char[size];
+
+  transferAtAll(buffer, size, first, [&] (MPI_Offset offset, char *buf, int count) 
+          { return MPI_File_read_at_all(fh, offset, buf, count, MPI_BYTE, MPI_STATUS_IGNORE); });
+
+  // a line starts at lo if the byte before it is a newline
+  if (hi == lo)
+      begin = size;
+  else if (first == lo)
+      begin = 0;
+  else {
+      const char *eol = static_cast<const char*>(std::memchr(buffer, '\n', hi - first - 1));
+      begin = eol ? (eol - buffer + 1) : size;
+  }
+
+  return buffer;
+} // readLines
+
+static void exchangeTuples(const EdgeTupleList &sendTuples, const std::vector<int> &scounts, 
+        EdgeTupleList &recvTuples, const std::vector<int> &rcounts, MPI_Datatype ettype)
+{
+  const int nprocs = scounts.size();
+  std::vector<int> sdispls(nprocs, 0), rdispls(nprocs, 0);
+
+  for (int p = 1; p < nprocs; p++) {
+      sdispls[p] = sdispls[p-1] + scounts[p-1];
+      rdispls[p] = rdispls[p-1] + rcounts[p-1];
+  }
+
+  recvTuples.resize(rdispls[nprocs-1] + rcounts[nprocs-1]);
+
+  MPI_Alltoallv(sendTuples.data(), scounts.data(), sdispls.data(), ettype, 
+          recvTuples.data(), rcounts.data(), rdispls.data(), ettype, MPI_COMM_WORLD);
+} // exchangeTuples
+
+// bucket p goes to process p, the received tuples are ordered by 
+// source process (assuming the counts are within INT bounds)
+static void exchangeBuckets(std::vector<EdgeTupleList> &buckets, EdgeTupleList &recvTuples, 
+        std::vector<int> &scounts, std::vector<int> &rcounts, MPI_Datatype ettype)
+{
+  const int nprocs = buckets.size();
+  EdgeTupleList sendTuples;
+
+  scounts.resize(nprocs);
+  rcounts.resize(nprocs);
+
+  for (int p = 0; p < nprocs; p++) {
+      scounts[p] = buckets[p].size();
+      sendTuples.insert(sendTuples.end(), buckets[p].begin(), buckets[p].end());
+      EdgeTupleList().swap(buckets[p]);
+  }
+
+  MPI_Alltoall(scounts.data(), 1, MPI_INT, rcounts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+  exchangeTuples(sendTuples, scounts, recvTuples, rcounts, ettype);
+} // exchangeBuckets
+
+// renumber the ids of a SNAP file contiguously from zero in the order 
+// of their first appearance (as fileConvert): the owner of an id (by 
+// hash) finds the first position of the id in the file, the process 
+// holding that position numbers it, and the owner forwards the number 
+// to the other processes with the id; returns the number of ids
+static GraphElem renumberByFirstAppearance(const int rank, const int nprocs, 
+        EdgeTupleList &edges, MPI_Datatype ettype)
+{
+  const GraphElem ntuples = edges.size();
+  GraphElem tupleOffset = 0;
+
+  MPI_Exscan(&ntuples, &tupleOffset, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+  if (rank == 0)
+      tupleOffset = 0;
+
+  auto ownerOf = [nprocs] (const GraphElem id) 
+  { return static_cast<int>(static_cast<uint64_t>(id) % nprocs); };
+
+  // first position of the local ids (2*tuple + 1 for the tails), 
+  // later replaced by their number
+  std::unordered_map<GraphElem, GraphElem> idMap;
+  std::vector<EdgeTupleList> buckets(nprocs);
+
+  for (GraphElem e = 0; e < ntuples; e++) {
+      if (idMap.emplace(edges[e].i_, 2*(tupleOffset + e)).second)
+          buckets[ownerOf(edges[e].i_)].emplace_back(edges[e].i_, 2*(tupleOffset + e));
+      if (idMap.emplace(edges[e].j_, 2*(tupleOffset + e) + 1).second)
+          buckets[ownerOf(edges[e].j_)].emplace_back(edges[e].j_, 2*(tupleOffset + e) + 1);
+  }
+
+  EdgeTupleList queries, replies, answers;
+  std::vector<int> scounts, rcounts;
+
+  exchangeBuckets(buckets, queries, scounts, rcounts, ettype);
+
+  // the owner finds the first position of its ids
+  std::unordered_map<GraphElem, GraphElem> ownedIds;
+
+  for (const GraphElemTuple &q : queries) {
+      auto stored = ownedIds.emplace(q.i_, q.j_);
+      if (!stored.second)
+          stored.first->second = std::min(stored.first->second, q.j_);
+  }
+
+  replies.resize(queries.size());
+  for (size_t k = 0; k < queries.size(); k++)
+      replies[k] = GraphElemTuple(queries[k].i_, ownedIds[queries[k].i_]);
+
+  exchangeTuples(replies, rcounts, answers, scounts, ettype);
+
+  // number the ids that appear first in my share of the file
+  std::vector<std::pair<GraphElem, GraphElem>> firstIds;
+
+  for (const GraphElemTuple &a : answers) {
+      if (idMap[a.i_] == a.j_)
+          firstIds.emplace_back(a.j_, a.i_);
+  }
+
+  std::sort(firstIds.begin(), firstIds.end());
+
+  const GraphElem nfirst = firstIds.size();
+  GraphElem idOffset = 0, numIds = 0;
+
+  MPI_Exscan(&nfirst, &idOffset, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(&nfirst, &numIds, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+  if (rank == 0)
+      idOffset = 0;
+
+  for (GraphElem k = 0; k < nfirst; k++)
+      buckets[ownerOf(firstIds[k].second)].emplace_back(firstIds[k].second, idOffset + k);
+
+  EdgeTupleList numbered;
+  std::vector<int> ncounts, nrcounts;
+
+  exchangeBuckets(buckets, numbered, ncounts, nrcounts, ettype);
+
+  for (const GraphElemTuple &n : numbered)
+      ownedIds[n.i_] = n.j_;
+
+  for (size_t k = 0; k < queries.size(); k++)
+      replies[k].j_ = ownedIds[queries[k].i_];
+  
+  exchangeTuples(replies, rcounts, answers, scounts, ettype);
+
+  for (const GraphElemTuple &a : answers)
+      idMap[a.i_] = a.j_;
+
+#pragma omp parallel for schedule(static)
+  for (GraphElem e = 0; e < ntuples; e++) {
+      edges[e].i_ = idMap.find(edges[e].i_)->second;
+      edges[e].j_ = idMap.find(edges[e].j_)->second;
+  }
+
+  return numIds;
+} // renumberByFirstAppearance
+
+// a stream of random weights per process (seeded by the rank, so 
+// that a single process draws the weights of fileConvert)
+static void setProcessRandomWeights(const int rank, EdgeTupleList &edges)
+{
+  std::default_random_engine re(rank + 1);
+  std::uniform_real_distribution<GraphWeight> uid(RANDOM_MIN_WEIGHT, RANDOM_MAX_WEIGHT);
+
+  for (size_t e = 0; e < edges.size(); e++)
+      edges[e].w_ = uid(re);
+} // setProcessRandomWeights
+
+void loadParallelEdgeList(int rank, int nprocs, int naggr, 
+        const std::string &fileInPath, const std::string &fileOutPath, 
+        EdgeFile_t format, bool indexOneBased, Weight_t wtype)
+{
+  double t0, t1, t2;
+
+  t0 = mytimer();
+
+  MPI_Info info = MPI_INFO_NULL;
+  if (naggr > 0) {
+      MPI_Info_create(&info);
+      MPI_Info_set(info, "cb_nodes", std::to_string(naggr).c_str());
+  }
+
+  // process 0 parses the header: {data offset, #vertices, 
+  // #edges, pattern, symmetric}
+  GraphElem header[5] = { 0, -1, 0, 0, 0 };
+
+  if (rank == 0) {
+      if (format == MATRIX_MARKET_FORMAT) {
+          MatrixMarketHeader mmHeader;
+          readMatrixMarketHeader(fileInPath, mmHeader);
+
+          header[0] = mmHeader.dataBegin;
+          header[1] = mmHeader.numVertices;
+          header[2] = mmHeader.numEdges;
+          header[3] = mmHeader.isPattern;
+          header[4] = mmHeader.isSymmetric;
+      }
+      else if (format == SNAP_FORMAT)
+          header[0] = readSNAPHeader(fileInPath, header[1], header[2]);
+  }
+
+  MPI_Bcast(header, 5, MPI_GRAPH_TYPE, 0, MPI_COMM_WORLD);
+
+  const bool isPattern = header[3], isMMSymmetric = header[4];
+
+  /// Part 1: Parse the byte range of the process
+  MPI_File fh;
+
+  if (MPI_File_open(MPI_COMM_WORLD, fileInPath.c_str(), MPI_MODE_RDONLY, info, &fh) 
+          != MPI_SUCCESS) {
+      std::cout << " Error opening input file: " << fileInPath << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, -99);
+  }
+
+  size_t begin, size;
+  char *buffer = readLines(fh, rank, nprocs, header[0], begin, size);
+
+  MPI_File_close(&fh);
+
+  EdgeTupleList edges;
+  {
+      const TextFile text(buffer, size);
+      const bool readWeights = (format != SNAP_FORMAT) && !isPattern 
+          && (wtype == ORG_WEIGHT || wtype == ABS_WEIGHT);
+      const GraphElem shift = ((format == MATRIX_MARKET_FORMAT) 
+              || (indexOneBased && (format != SNAP_FORMAT))) ? 1 : 0;
+
+      parseEdgeLines(text, begin, shift, readWeights, (wtype == ABS_WEIGHT), edges);
+  }
+
+  GraphElem numTuples = 0, numVertices = header[1];
+  const GraphElem localTuples = edges.size();
+  MPI_Allreduce(&localTuples, &numTuples, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+
+  MPI_Datatype ettype = createTupleType();
+
+  if (format == SNAP_FORMAT) {
+      const GraphElem numIds = renumberByFirstAppearance(rank, nprocs, edges, ettype);
+      
+      if (numVertices < numIds) {
+          if (rank == 0 && numVertices >= 0)
+              std::cout << "Found " << numIds << " vertices instead." << std::endl;
+          numVertices = numIds;
+      }
+  }
+  else if (format != MATRIX_MARKET_FORMAT) {
+      const GraphElem maxVertex = maxVertexOfTuples(edges);
+      MPI_Allreduce(&maxVertex, &numVertices, 1, MPI_GRAPH_TYPE, MPI_MAX, MPI_COMM_WORLD);
+      numVertices++;
+  }
+
+  if (rank == 0) {
+      if ((format == MATRIX_MARKET_FORMAT || format == SNAP_FORMAT) && (numTuples != header[2]))
+          std::cout << "Found " << numTuples << " entries instead." << std::endl;
+      std::cout << "Parsed " << numTuples << " entries with " << nprocs 
+          << " processes, numvertices: " << numVertices << std::endl;
+  }
+
+  if (wtype == RND_WEIGHT)
+      setProcessRandomWeights(rank, edges);
+
+  GraphElem badTuples = 0, totBadTuples = 0;
+
+#pragma omp parallel for reduction(+: badTuples) schedule(static)
+  for (GraphElem e = 0; e < localTuples; e++) {
+      if (edges[e].i_ < 0 || edges[e].i_ >= numVertices || edges[e].j_ < 0 
+              || edges[e].j_ >= numVertices)
+          badTuples++;
+  }
+
+  MPI_Allreduce(&badTuples, &totBadTuples, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+
+  if (totBadTuples > 0) {
+      if (rank == 0)
+          std::cout << "Error: " << totBadTuples << " entries have vertex ids out of [0, " 
+              << numVertices << ")" << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, -99);
+  }
+
+  /// Part 2: Send the edges (and their mirrors) to the owners of their 
+  /// sources, the processes receive them in the order of the file
+  std::vector<GraphElem> parts(nprocs+1);
+  for (int p = 0; p < nprocs+1; p++)
+      parts[p] = (numVertices * p) / nprocs;
+
+  auto ownerOf = [&parts] (const GraphElem v) 
+  { return static_cast<int>(std::upper_bound(parts.begin(), parts.end(), v) - parts.begin() - 1); };
+
+  // a symmetric Matrix Market file stores the lower (or upper) triangle
+  const bool symmetric = (format == SIMPLE_FORMAT || format == SNAP_FORMAT 
+          || (format == MATRIX_MARKET_FORMAT && isMMSymmetric));
+  const bool selfLoopsOnce = (format == MATRIX_MARKET_FORMAT);
+
+  std::vector<EdgeTupleList> buckets(nprocs);
+
+  for (GraphElem e = 0; e < localTuples; e++) {
+      const GraphElemTuple &t = edges[e];
+
+      buckets[ownerOf(t.i_)].emplace_back(t.i_, t.j_, t.w_);
+      if (symmetric && !(selfLoopsOnce && (t.i_ == t.j_)))
+          buckets[ownerOf(t.j_)].emplace_back(t.j_, t.i_, t.w_);
+  }
+
+  EdgeTupleList().swap(edges);
+
+  EdgeTupleList localEdges;
+  std::vector<int> scounts, rcounts;
+
+  exchangeBuckets(buckets, localEdges, scounts, rcounts, ettype);
+  MPI_Type_free(&ettype);
+
+  // the edges of a vertex are sorted by tail, and by their 
+  // order in the file for equal tails (as fileConvert)
+  std::stable_sort(localEdges.begin(), localEdges.end(), 
+          [] (const GraphElemTuple &e0, const GraphElemTuple &e1) 
+          { return (e0.i_ < e1.i_) || ((e0.i_ == e1.i_) && (e0.j_ < e1.j_)); });
+
+  const GraphElem localNumVertices = parts[rank+1] - parts[rank];
+  const GraphElem localNumEdges = localEdges.size();
+  GraphElem edgeOffset = 0, numEdges = 0;
+
+  MPI_Exscan(&localNumEdges, &edgeOffset, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(&localNumEdges, &numEdges, 1, MPI_GRAPH_TYPE, MPI_SUM, MPI_COMM_WORLD);
+  if (rank == 0)
+      edgeOffset = 0;
+
+  // offsets of my vertices (and of the end, for the last process)
+  std::vector<GraphElem> edgeIndexes(localNumVertices+1, 0);
+  std::vector<Edge> csrEdges(localNumEdges);
+
+  for (GraphElem e = 0; e < localNumEdges; e++)
+      edgeIndexes[localEdges[e].i_ - parts[rank] + 1]++;
+  
+  edgeIndexes[0] = edgeOffset;
+  std::partial_sum(edgeIndexes.begin(), edgeIndexes.end(), edgeIndexes.begin());
+
+#pragma omp parallel for schedule(static)
+  for (GraphElem e = 0; e < localNumEdges; e++)
+      csrEdges[e] = Edge(localEdges[e].j_, localEdges[e].w_);
+
+  EdgeTupleList().swap(localEdges);
+
+  t1 = mytimer();
+
+  if (rank == 0)
+      std::cout << "Redistributed edges (total: " << numEdges << "), about to write the binary file." 
+          << std::endl;
+
+  /// Part 3: Write the binary file with collective MPI-IO
+  if (MPI_File_open(MPI_COMM_WORLD, fileOutPath.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, 
+              info, &fh) != MPI_SUCCESS) {
+      std::cout << " Error opening output file! " << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, -99);
+  }
+
+  const MPI_Offset indexesBegin = 2*sizeof(GraphElem);
+  const MPI_Offset edgesBegin = indexesBegin + (numVertices+1)*sizeof(GraphElem);
+  
+  MPI_File_set_size(fh, edgesBegin + numEdges*sizeof(Edge));
+
+  if (rank == 0) {
+      MPI_File_write_at(fh, 0, &numVertices, sizeof(GraphElem), MPI_BYTE, MPI_STATUS_IGNORE);
+      MPI_File_write_at(fh, sizeof(GraphElem), &numEdges, sizeof(GraphElem), MPI_BYTE, MPI_STATUS_IGNORE);
+  }
+
+  auto writeAtAll = [&] (MPI_Offset offset, char *buf, int count) 
+  { return MPI_File_write_at_all(fh, offset, buf, count, MPI_BYTE, MPI_STATUS_IGNORE); };
+
+  transferAtAll(reinterpret_cast<char*>(edgeIndexes.data()), 
+          (localNumVertices + ((rank == nprocs - 1) ? 1 : 0))*sizeof(GraphElem), 
+          indexesBegin + parts[rank]*sizeof(GraphElem), writeAtAll);
+  transferAtAll(reinterpret_cast<char*>(csrEdges.data()), localNumEdges*sizeof(Edge), 
+          edgesBegin + edgeOffset*sizeof(Edge), writeAtAll);
+
+  MPI_File_close(&fh);
+
+  if (info != MPI_INFO_NULL)
+      MPI_Info_free(&info);
+
+  t2 = mytimer();
+
+  if (rank == 0) {
+      std::cout << "Time to parse and redistribute the edges (in secs): " << (t1 - t0) << std::endl;
+      std::cout << "Time to write the binary file (in secs): " << (t2 - t1) << std::endl;
+  }
+} // loadParallelEdgeList
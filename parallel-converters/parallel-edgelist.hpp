@@ -48,32 +48,30 @@
 //
 // ************************************************************************
 
-#ifndef __LOCKS_H
-#define __LOCKS_H
+#ifndef __LOAD_PARALLEL_EDGELIST_H
+#define __LOAD_PARALLEL_EDGELIST_H
 
-#ifdef USE_OPENMP_LOCK
-#else
-#ifdef USE_SPINLOCK 
-#include <atomic>
-std::atomic_flag lkd_ = ATOMIC_FLAG_INIT;
-#else
-#include <mutex>
-std::mutex mtx_;
-#endif
-void lock() {
-#ifdef USE_SPINLOCK 
-    while (lkd_.test_and_set(std::memory_order_acquire)) { ; } 
-#else
-    mtx_.lock();
-#endif
-}
-void unlock() { 
-#ifdef USE_SPINLOCK 
-    lkd_.clear(std::memory_order_release); 
-#else
-    mtx_.unlock();
-#endif
-}
-#endif
+#include <string>
 
-#endif // __LOCKS_H
+#include "../utils.hpp"
+#include "../graph.hpp"
+
+// text formats of a single input file, as read by fileConvert
+typedef enum
+{
+    SIMPLE_FORMAT,        // directed edge list, stored in both directions (-s)
+    SIMPLE_UNDIRECTED,    // edge list with both directions of the edges (-u)
+    SNAP_FORMAT,          // SNAP, renumbered by first appearance (-n)
+    MATRIX_MARKET_FORMAT  // coordinate Matrix Market (-m)
+} EdgeFile_t;
+
+/// Every process parses a byte range of the file (read with MPI-IO), 
+/// the edges are sent to the owners of their source vertices (block 
+/// distribution of the vertices), and the binary file is written with 
+/// collective MPI-IO; naggr is the number of I/O aggregators (0 to 
+/// leave it to MPI-IO). The output matches that of fileConvert.
+void loadParallelEdgeList(int rank, int nprocs, int naggr, 
+        const std::string &fileInPath, const std::string &fileOutPath, 
+        EdgeFile_t format, bool indexOneBased, Weight_t wtype = ABS_WEIGHT);
+
+#endif // __LOAD_PARALLEL_EDGELIST_H
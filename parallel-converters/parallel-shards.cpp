@@ -537,7 +537,8 @@ void loadParallelFileShards(int rank, int nprocs, int naggr,
 
   // write the edge list next, prepare CSR format
   tot_bytes = numEdges * sizeof(Edge);
-  std::vector<Edge> csrCols(numEdges);
+  std::vector<Edge> csrCols;
+  csrCols.reserve(numEdges);
 
   for (GraphElem i = 0; i < numEdges; i++) {
       csrCols.emplace_back(edgeList[i].j_, edgeList[i].w_);
@@ -0,0 +1,218 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "profile.hpp"
+
+#ifdef DEBUG_PRINTF
+extern std::ofstream ofs;
+#endif
+
+Profiler profiler;
+
+static const char *valueNames[] = 
+{ 
+    "setup", "exchange", "compute", "update", "modularity", "local_update", 
+    "bytes_sent", "ghosts", "moved", "probes" 
+};
+
+void Profiler::enable(MPI_Comm comm)
+{
+  comm_ = comm;
+  MPI_Comm_rank(comm_, &me_);
+  MPI_Comm_size(comm_, &nprocs_);
+
+  std::fill(values_, values_ + NUM_VALUES, 0.0);
+  last_ = MPI_Wtime();
+  enabled_ = true;
+} // enable
+
+void Profiler::beginPhase(const int phase)
+{
+  if (!enabled_)
+      return;
+
+  // a phase that is resumed (e.g., rerun with 
+  // another threshold) continues its numbering
+  if (phase != phase_) {
+      phase_ = phase;
+      iteration_ = 0;
+  }
+
+  std::fill(values_, values_ + NUM_VALUES, 0.0);
+  last_ = MPI_Wtime();
+} // beginPhase
+
+void Profiler::endIteration()
+{
+  if (!enabled_)
+      return;
+
+  Record rec;
+
+  iteration_++;
+  rec.phase = phase_;
+  rec.iteration = iteration_;
+
+#ifdef DEBUG_PRINTF  
+  ofs << "Phase " << phase_ << ", iteration " << iteration_ << ":";
+  for (int k = 0; k < NUM_VALUES; k++)
+      ofs << " " << valueNames[k] << " " << values_[k];
+  ofs << std::endl;
+#endif
+
+  MPI_Reduce(values_, rec.min, NUM_VALUES, MPI_DOUBLE, MPI_MIN, 0, comm_);
+  MPI_Reduce(values_, rec.max, NUM_VALUES, MPI_DOUBLE, MPI_MAX, 0, comm_);
+  MPI_Reduce(values_, rec.avg, NUM_VALUES, MPI_DOUBLE, MPI_SUM, 0, comm_);
+
+  if (me_ == 0) {
+      for (int k = 0; k < NUM_VALUES; k++)
+          rec.avg[k] /= nprocs_;
+
+      records_.push_back(rec);
+  }
+
+  std::fill(values_, values_ + NUM_VALUES, 0.0);
+  last_ = MPI_Wtime();
+} // endIteration
+
+void Profiler::write(const std::string &fileName) const
+{
+  if (!enabled_ || (me_ != 0))
+      return;
+
+  std::ofstream out(fileName.c_str());
+
+  if (!out) {
+      std::cerr << "Error opening the profile output file: " << fileName << std::endl;
+      return;
+  }
+
+  const bool json = (fileName.size() >= 5) 
+      && (fileName.compare(fileName.size() - 5, 5, ".json") == 0);
+
+  out << std::setprecision(9);
+
+  if (json) {
+      out << "{\n  \"processes\": " << nprocs_ << ",\n  \"iterations\": [";
+
+      for (size_t r = 0; r < records_.size(); r++) {
+          const Record &rec = records_[r];
+
+          out << ((r == 0) ? "\n" : ",\n") << "    {\"phase\": " << rec.phase 
+              << ", \"iteration\": " << rec.iteration;
+          for (int k = 0; k < NUM_VALUES; k++)
+              out << ", \"" << valueNames[k] << "\": {\"min\": " << rec.min[k] 
+                  << ", \"max\": " << rec.max[k] << ", \"avg\": " << rec.avg[k] << "}";
+          out << "}";
+      }
+
+      out << "\n  ]\n}" << std::endl;
+  }
+  else {
+      out << "phase,iteration";
+      for (int k = 0; k < NUM_VALUES; k++)
+          out << "," << valueNames[k] << "_min," << valueNames[k] << "_max," 
+              << valueNames[k] << "_avg";
+      out << std::endl;
+
+      for (size_t r = 0; r < records_.size(); r++) {
+          const Record &rec = records_[r];
+
+          out << rec.phase << "," << rec.iteration;
+          for (int k = 0; k < NUM_VALUES; k++)
+              out << "," << rec.min[k] << "," << rec.max[k] << "," << rec.avg[k];
+          out << std::endl;
+      }
+  }
+} // write
+
+// VmRSS and VmHWM of /proc/self/status (in kB), with the 
+// lifetime peak of getrusage if they are not available
+void memoryUsage(double &current, double &peak)
+{
+  current = peak = -1.0;
+
+  std::ifstream ifs("/proc/self/status");
+  std::string line;
+
+  while (std::getline(ifs, line)) {
+      if (line.compare(0, 6, "VmRSS:") == 0)
+          current = std::atof(line.c_str() + 6) / 1024.0;
+      else if (line.compare(0, 6, "VmHWM:") == 0)
+          peak = std::atof(line.c_str() + 6) / 1024.0;
+  }
+
+  if (peak < 0.0) {
+      rusage rus;
+      getrusage(RUSAGE_SELF, &rus);
+      peak = (static_cast<double>(rus.ru_maxrss) * 1024.0) / 1048576.0;
+  }
+
+  if (current < 0.0)
+      current = peak;
+} // memoryUsage
+
+bool resetPeakMemory()
+{
+  // resets VmHWM to the current VmRSS (see proc(5))
+  std::ofstream refs("/proc/self/clear_refs");
+  refs << "5";
+  refs.close();
+
+  return !refs.fail();
+} // resetPeakMemory
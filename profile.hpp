@@ -0,0 +1,153 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#include <mpi.h>
+
+#include <string>
+#include <vector>
+
+// sections of a Louvain iteration, the setup (ghost vertex
+// exchange) of a phase is accounted to its first iteration
+enum ProfileSection
+{
+    PROFILE_SETUP,
+    PROFILE_EXCHANGE,
+    PROFILE_COMPUTE,
+    PROFILE_UPDATE,
+    PROFILE_MODULARITY,
+    PROFILE_LOCAL_UPDATE,
+    PROFILE_NUM_SECTIONS
+};
+
+enum ProfileCounter
+{
+    PROFILE_BYTES_SENT,
+    PROFILE_GHOSTS,
+    PROFILE_MOVED,
+    PROFILE_PROBES,
+    PROFILE_NUM_COUNTERS
+};
+
+// Per-phase, per-iteration timers and counters of the Louvain
+// methods. The time between two calls of lap() is accounted to
+// the section of the second call, so the methods only mark the
+// end of each section. endIteration() is collective, it reduces
+// the min/max/sum of every timer and counter across the processes
+// on the root, which keeps one record per iteration for write().
+// Everything is a no-op until enable() is called (the methods call
+// the profiler unconditionally, there is no build option).
+class Profiler
+{
+    public:
+        Profiler(): enabled_(false), phase_(-1), iteration_(0), last_(0.0)
+        {}
+
+        void enable(MPI_Comm comm = MPI_COMM_WORLD);
+        bool enabled() const { return enabled_; }
+
+        // reset the clock and the accumulators, the iterations
+        // are numbered from 1 in every phase
+        void beginPhase(const int phase);
+
+        void lap(const ProfileSection section)
+        {
+            if (!enabled_)
+                return;
+
+            const double t = MPI_Wtime();
+
+            values_[section] += (t - last_);
+            last_ = t;
+        }
+
+        void count(const ProfileCounter counter, const double value)
+        {
+            if (enabled_)
+                values_[PROFILE_NUM_SECTIONS + counter] += value;
+        }
+
+        void endIteration();
+
+        // written by the root, as JSON if the file
+        // name ends with .json, as CSV otherwise
+        void write(const std::string &fileName) const;
+
+    private:
+        static const int NUM_VALUES = PROFILE_NUM_SECTIONS + PROFILE_NUM_COUNTERS;
+
+        struct Record
+        {
+            int phase, iteration;
+            double min[NUM_VALUES], max[NUM_VALUES], avg[NUM_VALUES];
+        };
+
+        bool enabled_;
+        MPI_Comm comm_;
+        int me_, nprocs_;
+        int phase_, iteration_;
+        double last_;
+        double values_[NUM_VALUES];
+        std::vector<Record> records_;
+};
+
+extern Profiler profiler;
+
+// the resident memory of the process in MB, current and peak (since
+// the start, or since the last resetPeakMemory where supported)
+void memoryUsage(double &current, double &peak);
+
+// restart the peak of memoryUsage (Linux), returns false if it is
+// not supported, then the peak is the one since the start
+bool resetPeakMemory();
+
+#endif // __PROFILE_H
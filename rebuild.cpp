@@ -49,11 +49,18 @@
 // ************************************************************************
 
 #include "rebuild.hpp"
+#include "utils.hpp"
 
 extern std::ofstream ofs;
 
+// as the community types (see louvain.cpp)
+static int edgeTypeRefs = 0;
+
 void createEdgeMPIType()
 {
+  if (edgeTypeRefs++ > 0)
+      return;
+
   EdgeInfo einfo;
 
   MPI_Aint begin, s, t, w;
@@ -72,15 +79,21 @@ void createEdgeMPIType()
 } // createEdgeMPIType
 
 void destroyEdgeMPIType()
-{ MPI_Type_free(&edgeType); }
+{ 
+  if (--edgeTypeRefs > 0)
+      return;
 
-GraphElem distReNumber(int nprocs, ClusterLocalMap& lookUp, int me, DistGraph &dg, 
+  MPI_Type_free(&edgeType); 
+}
+
+GraphElem distReNumber(int nprocs, int me, DistGraph &dg, 
         const size_t &ssz, const size_t &rsz, const std::vector<GraphElem> &ssizes, 
         const std::vector<GraphElem> &rsizes, const std::vector<GraphElem> &svdata, 
         const std::vector<GraphElem> &rvdata, CommunityVector &cvect, 
-        VertexCommMap &remoteComm) {
+        std::vector<GraphElem> &localNewComm, std::vector<GraphElem> &ghostNewComm,
+        std::vector<GraphElem> &newOwnedComm) {
 
-  const GraphElem base = dg.getBase(me);
+  const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
   const Graph &g = dg.getLocalGraph();
   const GraphElem nv = g.getNumVertices();
   
@@ -88,12 +101,11 @@ GraphElem distReNumber(int nprocs, ClusterLocalMap& lookUp, int me, DistGraph &d
   GraphElem gnc=0; //globalNumClusters
   GraphElem offset=0;
   
-  PartArray parray(nprocs);  
-
   std::vector<GraphElem> sOldCghostData(ssz), rOldCghostData(rsz);
   std::vector<MPI_Request> screqs(nprocs), rcreqs(nprocs);
   
   // identifies communities of Vertices shared with other nodes - Ghost nodes setup in previous phase
+#pragma omp parallel for
   for (GraphElem i = 0; i < ssz; i++)
 	sOldCghostData[i] = cvect[svdata[i]-base]; 
 
@@ -102,7 +114,7 @@ GraphElem distReNumber(int nprocs, ClusterLocalMap& lookUp, int me, DistGraph &d
   // Recieve the vertex's communities
   for(int i =0; i<nprocs;i++){
     if(i != me && rsizes[i]!= 0)
-      MPI_Irecv(rOldCghostData.data()+rpos, rsizes[i], MPI_GRAPH_TYPE,i,3,MPI_COMM_WORLD,&rcreqs[i]);
+      MPI_Irecv(rOldCghostData.data()+rpos, rsizes[i], MPI_GRAPH_TYPE,i,3,dg.getComm(),&rcreqs[i]);
     else
       rcreqs[i] = MPI_REQUEST_NULL;
     rpos+= rsizes[i];
@@ -110,27 +122,21 @@ GraphElem distReNumber(int nprocs, ClusterLocalMap& lookUp, int me, DistGraph &d
   // Send the vertex's communties
   for(int i = 0; i <nprocs;i++){
     if(i!=me && ssizes[i]!=0)
-      MPI_Isend(sOldCghostData.data()+spos, ssizes[i], MPI_GRAPH_TYPE,i,3,MPI_COMM_WORLD,&screqs[i]);
+      MPI_Isend(sOldCghostData.data()+spos, ssizes[i], MPI_GRAPH_TYPE,i,3,dg.getComm(),&screqs[i]);
     else
       screqs[i] = MPI_REQUEST_NULL;
     spos+=ssizes[i];
   }
  
- 
- // While waiting: add remote communities of local nodes to request array and build local lookup
-  ClusterLocalMap::const_iterator stored;
+  // While waiting: mark the owned communities of local nodes as alive
+  std::vector<char> alive(nv, 0);
+  
+#pragma omp parallel for
   for(GraphElem i=0; i<nv;i++){
-    GraphElem comm = cvect[i];
-    int t = dg.getOwner(comm);
-    if(t != me){
-      parray[t].insert(comm);
-    }
-    else{
-      stored = lookUp.find(comm);
-      if(stored == lookUp.end()){
-        lookUp.insert(std::make_pair(comm, lnc));
-        lnc++;
-      }
+    const GraphElem comm = cvect[i];
+    if(comm >= base && comm < bound){
+#pragma omp atomic write
+      alive[comm-base] = 1;
     }
   }
  
@@ -141,70 +147,61 @@ GraphElem distReNumber(int nprocs, ClusterLocalMap& lookUp, int me, DistGraph &d
   ofs << "Received Sizes for dist Renumber"  << std::endl;
 #endif
 
-  std::vector<GraphElem> rOldCsizes(nprocs), sOldCsizes(nprocs);
-  std::vector<MPI_Request> rOldCszreqs(nprocs), sOldCszreqs(nprocs);
-  std::vector<GraphElem> rOldCdata, sOldCdata;  
+  // remote communities of local and ghost nodes, sorted by
+  // id and hence grouped by owner (owned ones are flagged -1)
+  std::vector<GraphElem> sOldCdata(nv + rsz);
+
+#pragma omp parallel for
+  for(GraphElem i=0; i<(nv + rsz);i++){
+    const GraphElem comm = (i < nv) ? cvect[i] : rOldCghostData[i-nv];
+    sOldCdata[i] = (comm >= base && comm < bound) ? -1 : comm;
+  }
+
+  std::sort(sOldCdata.begin(), sOldCdata.end());
+  sOldCdata.erase(std::unique(sOldCdata.begin(), sOldCdata.end()), sOldCdata.end());
+  if (!sOldCdata.empty() && sOldCdata.front() == -1)
+    sOldCdata.erase(sOldCdata.begin());
+
+  std::vector<GraphElem> rOldCsizes(nprocs), sOldCsizes(nprocs), sOldCdisp(nprocs+1);
+  std::vector<GraphElem> rOldCdata;  
   std::vector<MPI_Request> sOldCreqs(nprocs), rOldCreqs(nprocs);
 
-  remoteComm.clear();
-  
-  // Then, add also remote communities of ghost vertices to the request array
-  for ( GraphElem i=0; i<rpos; i++){
-	const GraphElem comm = rOldCghostData[i];
-        remoteComm.insert(std::make_pair(rvdata[i], comm));
-        const int t = dg.getOwner(comm);
-        if (t != me) {
-	   parray[t].insert(comm);
-      }
-   }  
+  for(int i = 0; i < nprocs; i++)
+    sOldCdisp[i] = std::lower_bound(sOldCdata.begin(), sOldCdata.end(), 
+            dg.getBase(i)) - sOldCdata.begin();
+  sOldCdisp[nprocs] = sOldCdata.size();
 
-  GraphElem stcsz=0,rtcsz=0;
+  for(int i = 0; i < nprocs; i++)
+    sOldCsizes[i] = sOldCdisp[i+1] - sOldCdisp[i];
   
   // Receive and send the request sizes
-  for(int i = 0; i < nprocs; i++){
-    sOldCsizes[i] = parray[i].size();
-    if(i != me){
-      MPI_Irecv(&rOldCsizes[i],1,MPI_GRAPH_TYPE,i,4,MPI_COMM_WORLD,&rOldCszreqs[i]);
-      MPI_Isend(&sOldCsizes[i],1,MPI_GRAPH_TYPE,i,4,MPI_COMM_WORLD,&sOldCszreqs[i]);
-    }
-    else{
-      rOldCszreqs[i] = MPI_REQUEST_NULL;
-      sOldCszreqs[i] = MPI_REQUEST_NULL;
-    }
-  }
-  MPI_Waitall(nprocs,sOldCszreqs.data(),MPI_STATUSES_IGNORE);
-  MPI_Waitall(nprocs,rOldCszreqs.data(),MPI_STATUSES_IGNORE);
+  MPI_Alltoall(sOldCsizes.data(), 1, MPI_GRAPH_TYPE, rOldCsizes.data(), 
+          1, MPI_GRAPH_TYPE, dg.getComm());
 
 #ifdef DEBUG_PRINTF  
   ofs << "Received Sizes of old communities" << std::endl;
 #endif   
 
   // Aggregate size
-  for(int i = 0; i < nprocs; i++){
-    stcsz+= sOldCsizes[i];
+  GraphElem rtcsz=0;
+  for(int i = 0; i < nprocs; i++)
     rtcsz+= rOldCsizes[i];
-  }
   
   rOldCdata.resize(rtcsz);
-  sOldCdata.resize(stcsz);
-  rpos = spos = 0;
+  rpos = 0;
 
-  // Copy full arrays of requested remote communities in buffers and send (one per node)
+  // Send the sorted arrays of requested remote communities (one per node)
   for(int i = 0; i < nprocs; i++){
-   
-  if( i != me && rOldCsizes[i] != 0 )
-      MPI_Irecv(rOldCdata.data()+rpos,rOldCsizes[i],MPI_GRAPH_TYPE,i,3,MPI_COMM_WORLD,&rOldCreqs[i]);
+    if( i != me && rOldCsizes[i] != 0 )
+      MPI_Irecv(rOldCdata.data()+rpos,rOldCsizes[i],MPI_GRAPH_TYPE,i,3,dg.getComm(),&rOldCreqs[i]);
     else
       rOldCreqs[i] = MPI_REQUEST_NULL;
 
-    if(i!=me && sOldCsizes[i] !=0){
-      std::copy(parray[i].begin(),parray[i].end(),sOldCdata.data()+spos);
-      MPI_Isend(sOldCdata.data()+spos,sOldCsizes[i],MPI_GRAPH_TYPE,i,3,MPI_COMM_WORLD,&sOldCreqs[i]);
-    }
+    if(i!=me && sOldCsizes[i] !=0)
+      MPI_Isend(sOldCdata.data()+sOldCdisp[i],sOldCsizes[i],MPI_GRAPH_TYPE,i,3,dg.getComm(),&sOldCreqs[i]);
     else
       sOldCreqs[i] = MPI_REQUEST_NULL;
 
-    spos+=sOldCsizes[i];
     rpos+=rOldCsizes[i];
   }
   MPI_Waitall(nprocs, sOldCreqs.data(),MPI_STATUSES_IGNORE);
@@ -214,76 +211,95 @@ GraphElem distReNumber(int nprocs, ClusterLocalMap& lookUp, int me, DistGraph &d
    ofs << "Received old C data " << std::endl;
 #endif
 
-  std::vector<GraphElem> lncs(nprocs);
-  
-  // check if locally owned communities request coming from other  nodes where already accounted locally, if not add
+  // locally owned communities requested by other nodes are alive too
+#pragma omp parallel for
   for(GraphElem i =0; i < rtcsz; i++){
-    GraphElem comm = rOldCdata[i];
-    stored = lookUp.find(comm);
-    assert(me == dg.getOwner(comm));
-    if(stored == lookUp.end()){
-      lookUp.insert(std::make_pair(comm, lnc));
-      lnc++;
-    }
+    assert(me == dg.getOwner(rOldCdata[i]));
+#pragma omp atomic write
+    alive[rOldCdata[i]-base] = 1;
   }
 
-  // distribute size of each local number of unique clusters to all the nodes 
-  MPI_Allgather(&lnc, 1, MPI_GRAPH_TYPE, lncs.data(), 1, MPI_GRAPH_TYPE,MPI_COMM_WORLD);
+  // renumber the alive communities densely: exclusive prefix
+  // sum of the alive flags, over the threads and then the nodes
+  newOwnedComm.resize(nv);
+  const int nchunks = omp_get_max_threads();
+  std::vector<GraphElem> ccounts(nchunks + 1, 0);
 
-   for(int i = 0; i <nprocs; i++){
-    gnc+= lncs[i];
+#pragma omp parallel for schedule(static, 1)
+  for(int c = 0; c < nchunks; c++){
+    const GraphElem lo = (nv * c) / nchunks, hi = (nv * (c + 1)) / nchunks;
+    GraphElem count = 0;
+    for(GraphElem i = lo; i < hi; i++)
+      count += alive[i];
+    ccounts[c + 1] = count;
   }
-  for(int i = 0; i< me; i++){
-    offset+= lncs[i];
-  } 
+
+  for(int c = 0; c < nchunks; c++)
+    ccounts[c + 1] += ccounts[c];
+  lnc = ccounts[nchunks];
+
+  MPI_Exscan(&lnc, &offset, 1, MPI_GRAPH_TYPE, MPI_SUM, dg.getComm());
+  if (me == 0)
+    offset = 0;
+
+#pragma omp parallel for schedule(static, 1)
+  for(int c = 0; c < nchunks; c++){
+    const GraphElem lo = (nv * c) / nchunks, hi = (nv * (c + 1)) / nchunks;
+    GraphElem pos = offset + ccounts[c];
+    for(GraphElem i = lo; i < hi; i++){
+      newOwnedComm[i] = alive[i] ? pos : -1;
+      pos += alive[i];
+    }
+  }
+
+  MPI_Allreduce(&lnc, &gnc, 1, MPI_GRAPH_TYPE, MPI_SUM, dg.getComm());
 
 #ifdef DEBUG_PRINTF    
- ofs << " After all_gather" << std::endl;
+ ofs << " After exscan" << std::endl;
 #endif
 
-  // add offsets to local remapping
-  for( ClusterLocalMap::iterator it = lookUp.begin(); it != lookUp.end(); it++){
-   it->second += offset;
-  }
- 
   // Now each node knows all communities it owns and has renumbered them, adding n. of communities of previous node as offset
  
   spos = rpos= 0;
   
-  std::vector<GraphElem> rNewCdata(stcsz), sNewCdata(rtcsz);
+  std::vector<GraphElem> rNewCdata(sOldCdata.size()), sNewCdata(rtcsz);
   std::vector<MPI_Request> rNewCreqs(nprocs), sNewCreqs(nprocs);
   
- // prepare the buffer of new community ids, by searching in the local map the ids of the old communities
-  #pragma omp parallel for
+ // prepare the buffer of new community ids of the old communities
+#pragma omp parallel for
   for(GraphElem i = 0; i < rtcsz; i++){
-   sNewCdata[i]  = lookUp.find(rOldCdata[i])->second;
+   sNewCdata[i] = newOwnedComm[rOldCdata[i]-base];
   }
 
 // send the buffer with new communities (new communities have the same position of the old communities in the two buffers)
   for(int i = 0; i<nprocs;i++){
     if(i!= me && sOldCsizes[i]!=0)
-      MPI_Irecv(rNewCdata.data()+rpos,sOldCsizes[i],MPI_GRAPH_TYPE,i,3,MPI_COMM_WORLD,&rNewCreqs[i]);
+      MPI_Irecv(rNewCdata.data()+sOldCdisp[i],sOldCsizes[i],MPI_GRAPH_TYPE,i,3,dg.getComm(),&rNewCreqs[i]);
     else
       rNewCreqs[i]=MPI_REQUEST_NULL;
     if(i!= me && rOldCsizes[i]!=0)
-      MPI_Isend(sNewCdata.data()+spos,rOldCsizes[i],MPI_GRAPH_TYPE,i,3,MPI_COMM_WORLD,&sNewCreqs[i]);
+      MPI_Isend(sNewCdata.data()+spos,rOldCsizes[i],MPI_GRAPH_TYPE,i,3,dg.getComm(),&sNewCreqs[i]);
     else
       sNewCreqs[i]=MPI_REQUEST_NULL;
 
-    rpos+=sOldCsizes[i];
     spos+=rOldCsizes[i];
   }
   MPI_Waitall(nprocs, sNewCreqs.data(),MPI_STATUSES_IGNORE);
   MPI_Waitall(nprocs, rNewCreqs.data(),MPI_STATUSES_IGNORE);
 
-  // finally, add also the renumbered remote communities to the local map to rebuild the graph
+  // finally, map the local and ghost nodes to their new communities
+  localNewComm.resize(nv);
+  ghostNewComm.resize(rsz);
 
-  for(GraphElem i = 0; i<stcsz; i++){
-    GraphElem oldRemComm = sOldCdata[i];
-    GraphElem newRemComm = rNewCdata[i];
-    stored = lookUp.find(oldRemComm);
-    if(stored == lookUp.end())
-      lookUp.insert(std::make_pair(oldRemComm,newRemComm));
+#pragma omp parallel for
+  for(GraphElem i = 0; i < (nv + rsz); i++){
+    const GraphElem comm = (i < nv) ? cvect[i] : rOldCghostData[i-nv];
+    const GraphElem newComm = (comm >= base && comm < bound) ? newOwnedComm[comm-base] :
+        rNewCdata[std::lower_bound(sOldCdata.begin(), sOldCdata.end(), comm) - sOldCdata.begin()];
+    if (i < nv)
+      localNewComm[i] = newComm;
+    else
+      ghostNewComm[i-nv] = newComm;
   }
 
   // return new global number of vertices
@@ -291,166 +307,398 @@ GraphElem distReNumber(int nprocs, ClusterLocalMap& lookUp, int me, DistGraph &d
   return gnc;
 }
 
-void fill_newEdgesMap(int me, NewEdgesMap &newEdgesMap, DistGraph& dg, CommunityVector &cvect, VertexCommMap &remoteComm, ClusterLocalMap &lookUp)
+static inline bool edgeInfoLess(const EdgeInfo &a, const EdgeInfo &b)
+{ return (a.s < b.s) || ((a.s == b.s) && (a.t < b.t)); }
+
+// sort a triple array by (s, t): every thread sorts a chunk,
+// then sorted chunks are merged pairwise with doubling strides
+static void sortNewEdges(EdgeVector &edges)
 {
-  const GraphElem base = dg.getBase(me);
-  const GraphElem bound = dg.getBound(me);
-  const Graph &g = dg.getLocalGraph();
-  const GraphElem nv = g.getNumVertices();
+  const GraphElem ne = edges.size();
+  const int nchunks = std::max(1, std::min(omp_get_max_threads(), (int)((ne + 1023) / 1024)));
+  std::vector<GraphElem> bounds(nchunks + 1);
 
-  // Could parallelize here, but not do it yet
+  for (int c = 0; c <= nchunks; c++)
+      bounds[c] = (ne * c) / nchunks;
 
-  for(GraphElem i = 0; i < nv; i++){
-    GraphElem e0, e1;
-    g.getEdgeRangeForVertex(i,e0,e1);
+#pragma omp parallel for schedule(static, 1)
+  for (int c = 0; c < nchunks; c++)
+      std::sort(edges.begin() + bounds[c], edges.begin() + bounds[c+1], edgeInfoLess);
 
-    if( newEdgesMap.end() == newEdgesMap.find(lookUp[cvect[i]]) )
-      newEdgesMap.insert(std::make_pair( lookUp[cvect[i]], NewEdge()));
-    
-    NewEdge& toInsert = newEdgesMap[lookUp[cvect[i]]];
-
-    NewEdge::iterator it;
-    for(GraphElem j = e0; j<e1; j++){
-      GraphElem com2;
-      const Edge &edge = g.getEdge(j);
-      if( edge.tail < base || edge.tail >= bound)
-        com2 = lookUp[remoteComm[edge.tail]];
-      else
-        com2 = lookUp[cvect[edge.tail-base]];
-      it = toInsert.find(com2);
-      if(it != toInsert.end())
-        it->second += edge.weight;
-      else{
-        toInsert.insert(std::make_pair(com2,edge.weight));
+  for (int stride = 1; stride < nchunks; stride *= 2) {
+#pragma omp parallel for schedule(static, 1)
+      for (int c = 0; c < nchunks; c += 2*stride) {
+          if ((c + stride) < nchunks)
+              std::inplace_merge(edges.begin() + bounds[c], edges.begin() + bounds[c+stride],
+                      edges.begin() + bounds[std::min(c + 2*stride, nchunks)], edgeInfoLess);
       }
+  }
+} // sortNewEdges
 
-    }
+// combine consecutive triples with the same (s, t) in a sorted
+// range, returns the new end of the range
+static EdgeVector::iterator reduceNewEdges(EdgeVector::iterator first, EdgeVector::iterator last)
+{
+  if (first == last)
+      return last;
+
+  EdgeVector::iterator out = first;
+  for (EdgeVector::iterator it = first + 1; it != last; it++) {
+      if (it->s == out->s && it->t == out->t)
+          out->w += it->w;
+      else
+          *(++out) = *it;
   }
-}
 
-void send_newEdges(int me, int nprocs, DistGraph* &dg, 
-	GraphElem newGlobalNumVertices, NewEdgesMap& newEdgesMap )
+  return (out + 1);
+} // reduceNewEdges
+
+// the new edges of the local vertices [first, last), see fill_newEdges
+static void fillNewEdgeRows(int me, int nprocs, const DistGraph& dg, 
+        const std::vector<GraphElem> &rvdata, const std::vector<GraphElem> &localNewComm, 
+        const std::vector<GraphElem> &ghostNewComm, const PartRanges &parts, 
+        const GraphElem first, const GraphElem last, EdgeVector &sNewEdges, 
+        std::vector<GraphElem> &sNewSize)
 {
-  delete dg;
+  const GraphElem base = dg.getBase(me);
+  const GraphElem bound = dg.getBound(me);
+  const Graph &g = dg.getLocalGraph();
+  const int nthreads = omp_get_max_threads();
 
-  GraphElem newLocalNumVertices = ((newGlobalNumVertices * (me + 1)) / nprocs) - ((newGlobalNumVertices * me) / nprocs); 
-#ifdef DEBUG_PRINTF    
-  ofs << "newLocalNumvertices: " << newLocalNumVertices << " newGlobalNumVertices " << newGlobalNumVertices << std::endl;
-#endif  
-  PartRanges parts(nprocs+1);
+  // per-thread triples, and per-(thread, owner) offsets into them
+  std::vector<EdgeVector> tedges(nthreads);
+  std::vector<GraphElem> toffs(nthreads*(nprocs + 1));
 
-  parts[0]=0;
+#pragma omp parallel
+  {
+      const int tid = omp_get_thread_num();
+      EdgeVector &myEdges = tedges[tid];
 
-  for (int i=1; i<nprocs +1; i++)
-	parts[i]=((newGlobalNumVertices * i) / nprocs);
+      // ghosts are indexed by their position in the sorted rvdata
+#pragma omp for schedule(static)
+      for (GraphElem i = first; i < last; i++) {
+          GraphElem e0, e1;
+          g.getEdgeRangeForVertex(i, e0, e1);
 
-  // set to zero initially
-  GraphElem newGlobalNumEdges = 0;
-  GraphElem newLocalNumEdges = 0;
+          const GraphElem com1 = localNewComm[i];
 
-  dg = new DistGraph(newGlobalNumVertices, newGlobalNumEdges);
-  dg->createLocalGraph(newLocalNumVertices,newLocalNumEdges,&parts);
-  Graph &g = dg->getLocalGraph();
-  
-  /****** Create Sendbuf ********/
-  std::vector<EdgeVector> parray(nprocs);
-  std::vector<NewEdge> localGraph(newLocalNumVertices);
+          for (GraphElem j = e0; j < e1; j++) {
+              const GraphElem tail = g.getEdgeTail(j);
 
-  std::unordered_map<GraphElem, NewEdge>::iterator it;
+              EdgeInfo x;
+              x.s = com1;
+              x.t = (tail < base || tail >= bound) ? ghostNewComm[std::lower_bound(rvdata.begin(), 
+                          rvdata.end(), tail) - rvdata.begin()] : localNewComm[tail - base];
+              x.w = g.getEdgeWeight(j);
+              myEdges.push_back(x);
+          }
+      }
 
-  for(it = newEdgesMap.begin(); it != newEdgesMap.end(); it++){
-    int belongProc = dg->getOwner((it->first));
+      std::sort(myEdges.begin(), myEdges.end(), edgeInfoLess);
+      myEdges.erase(reduceNewEdges(myEdges.begin(), myEdges.end()), myEdges.end());
 
-#ifdef DEBUG_PRINTF    
-    ofs << "Proc : " << me << " Vertex: " << it->first << " Belongs to: " << belongProc << std::endl;
-#endif
+      // sources are sorted, so each owner is a contiguous segment
+      GraphElem *myOffs = &toffs[tid*(nprocs + 1)];
+      EdgeInfo key;
+      key.t = 0;
+      for (int p = 0; p <= nprocs; p++) {
+          key.s = parts[p];
+          myOffs[p] = std::lower_bound(myEdges.begin(), myEdges.end(), key, edgeInfoLess) 
+              - myEdges.begin();
+      }
+  }
 
-    if(belongProc != me){ // Put not owned into send list
-        EdgeVector& sendTo = parray[belongProc];
-        NewEdge::iterator innerIt;
-        for(innerIt = it->second.begin();innerIt != it->second.end(); innerIt++){
-            EdgeInfo x;
-            x.s = it->first;
-            x.t = innerIt->first;
-            x.w = innerIt->second;
-            sendTo.push_back(x);
-        }
+  // owner-bucketed contiguous send buffer, thread segments in order
+  std::vector<GraphElem> tdisp(nthreads*nprocs);
+  GraphElem pos = 0;
+
+  for (int p = 0; p < nprocs; p++) {
+      sNewSize[p] = 0;
+      for (int t = 0; t < nthreads; t++) {
+          const GraphElem *offs = &toffs[t*(nprocs + 1)];
+          tdisp[t*nprocs + p] = pos;
+          pos += offs[p+1] - offs[p];
+          sNewSize[p] += offs[p+1] - offs[p];
+      }
+  }
+
+  sNewEdges.resize(pos);
+
+#pragma omp parallel for schedule(static, 1)
+  for (int t = 0; t < nthreads; t++) {
+      const GraphElem *offs = &toffs[t*(nprocs + 1)];
+      for (int p = 0; p < nprocs; p++)
+          std::copy(tedges[t].begin() + offs[p], tedges[t].begin() + offs[p+1], 
+                  sNewEdges.begin() + tdisp[t*nprocs + p]);
+      EdgeVector().swap(tedges[t]);
+  }
+} // fillNewEdgeRows
+
+void fill_newEdges(int me, int nprocs, DistGraph& dg, const std::vector<GraphElem> &rvdata, 
+        const std::vector<GraphElem> &localNewComm, const std::vector<GraphElem> &ghostNewComm, 
+        const PartRanges &parts, EdgeVector &sNewEdges, std::vector<GraphElem> &sNewSize)
+{
+  fillNewEdgeRows(me, nprocs, dg, rvdata, localNewComm, ghostNewComm, parts, 0, 
+          dg.getLocalGraph().getNumVertices(), sNewEdges, sNewSize);
+} // fill_newEdges
+
+// build the new edges in batches of rows of at most batchEdges edges 
+// (or a single row), which are sent to their owners as they are 
+// produced and appended to rNewEdges, and release the edges of dg 
+// of every batch; rNewEdges is sorted and reduced whenever it has 
+// doubled, so it stays about the size of the reduced new edges
+static void streamNewEdges(int me, int nprocs, DistGraph& dg, 
+        const std::vector<GraphElem> &rvdata, const std::vector<GraphElem> &localNewComm, 
+        const std::vector<GraphElem> &ghostNewComm, const PartRanges &parts, 
+        const GraphElem batchEdges, EdgeVector &rNewEdges)
+{
+  Graph &g = dg.getLocalGraph();
+  const GraphElem nv = g.getNumVertices();
+
+  // the first row of every batch
+  std::vector<GraphElem> batches(1, 0);
+  for (GraphElem i = 0; i < nv; ) {
+    GraphElem e0, e1, b0, b1;
+    g.getEdgeRangeForVertex(i, b0, b1);
+    for (i++; i < nv; i++) {
+      g.getEdgeRangeForVertex(i, e0, e1);
+      if ((e1 - b0) > batchEdges)
+        break;
     }
-    else  // Put owned into localGraph
-        localGraph[it->first - parts[me]] = it->second;
+    batches.push_back(i);
   }
 
-  /*******  Send and receive *****/
-  std::vector<GraphElem> sNewSize(nprocs), rNewSize(nprocs);
-  std::vector<MPI_Request> ssreqs(nprocs),rsreqs(nprocs);
-  std::vector<MPI_Request> sreqs(nprocs),rreqs(nprocs);
-  EdgeVector rNewEdges;
-  // Send size 
-  for(int i = 0; i<nprocs;i++){
-    if(i!= me){
-      sNewSize[i] = parray[i].size();
-      MPI_Irecv(&rNewSize[i],1, MPI_GRAPH_TYPE,i,3,MPI_COMM_WORLD,&rsreqs[i]);
-      MPI_Isend(&sNewSize[i],1, MPI_GRAPH_TYPE,i,3,MPI_COMM_WORLD,&ssreqs[i]);
+  // the exchanges are collective, so every process takes 
+  // part in as many as the process with the most batches
+  GraphElem nbatches = batches.size() - 1;
+  MPI_Allreduce(MPI_IN_PLACE, &nbatches, 1, MPI_GRAPH_TYPE, MPI_MAX, dg.getComm());
+  batches.resize(nbatches + 1, nv);
+
+  EdgeVector sNewEdges, batch;
+  std::vector<GraphElem> sNewSize(nprocs);
+  GraphElem reduced = 0;
+
+  for (GraphElem b = 0; b < nbatches; b++) {
+    fillNewEdgeRows(me, nprocs, dg, rvdata, localNewComm, ghostNewComm, parts, 
+            batches[b], batches[b+1], sNewEdges, sNewSize);
+
+    if (batches[b+1] > batches[b]) {
+      GraphElem e0, e1, f0, f1;
+      g.getEdgeRangeForVertex(batches[b], e0, e1);
+      g.getEdgeRangeForVertex(batches[b+1] - 1, f0, f1);
+      g.releaseEdges(e0, f1);
     }
-    else{
-      ssreqs[i] = MPI_REQUEST_NULL;
-      rsreqs[i] = MPI_REQUEST_NULL;
+
+    exchangeNewEdges(me, nprocs, dg.getComm(), sNewEdges, sNewSize, batch);
+    rNewEdges.insert(rNewEdges.end(), batch.begin(), batch.end());
+
+    if (rNewEdges.size() > (size_t)std::max(2*reduced, batchEdges)) {
+      sortNewEdges(rNewEdges);
+      rNewEdges.erase(reduceNewEdges(rNewEdges.begin(), rNewEdges.end()), rNewEdges.end());
+      reduced = rNewEdges.size();
     }
   }
-  MPI_Waitall(nprocs,ssreqs.data(),MPI_STATUS_IGNORE);
-  MPI_Waitall(nprocs,rsreqs.data(),MPI_STATUS_IGNORE);
+} // streamNewEdges
+
+// send the owner-bucketed triples (the own bucket is copied), 
+// the received triples are grouped by the source process
+static void exchangeNewEdges(int me, int nprocs, MPI_Comm comm, const EdgeVector &sNewEdges, 
+        const std::vector<GraphElem> &sNewSize, EdgeVector &rNewEdges)
+{
+  std::vector<GraphElem> rNewSize(nprocs), sdisp(nprocs), rdisp(nprocs);
+  std::vector<MPI_Request> sreqs(nprocs),rreqs(nprocs);
+
+  MPI_Alltoall(sNewSize.data(), 1, MPI_GRAPH_TYPE, rNewSize.data(), 1, MPI_GRAPH_TYPE, comm);
 
   // Aggregate total recv 
-  GraphElem comingSize=0;
-  GraphElem rpos=0;
+  GraphElem comingSize=0, spos=0;
   for(int i =0 ; i<nprocs;i++){
+    sdisp[i] = spos;
+    rdisp[i] = comingSize;
+    spos += sNewSize[i];
     comingSize+= rNewSize[i];
   }
   rNewEdges.resize(comingSize);
 
   // Send and recieve data
   for(int i = 0; i<nprocs;i++){
-    
     if(i!= me && rNewSize[i]!= 0)
-      MPI_Irecv(rNewEdges.data()+rpos,rNewSize[i],edgeType,i,3,MPI_COMM_WORLD,&rreqs[i]);
+      MPI_Irecv(rNewEdges.data()+rdisp[i],rNewSize[i],edgeType,i,3,comm,&rreqs[i]);
     else
       rreqs[i] = MPI_REQUEST_NULL;
     if(i!=me && sNewSize[i]!=0)
-      MPI_Isend(parray[i].data(),sNewSize[i],edgeType,i,3,MPI_COMM_WORLD,&sreqs[i]);
+      MPI_Isend(sNewEdges.data()+sdisp[i],sNewSize[i],edgeType,i,3,comm,&sreqs[i]);
     else
       sreqs[i]=MPI_REQUEST_NULL; 
-    
-    rpos+=rNewSize[i];
   }
 
+  std::copy(sNewEdges.begin() + sdisp[me], sNewEdges.begin() + sdisp[me] + sNewSize[me],
+          rNewEdges.begin() + rdisp[me]);
+
   MPI_Waitall(nprocs,sreqs.data(),MPI_STATUS_IGNORE);
   MPI_Waitall(nprocs,rreqs.data(),MPI_STATUS_IGNORE);
+} // exchangeNewEdges
+
+// row boundaries of the sources [first, first + nrows) in sorted triples
+static void findNewRows(const EdgeVector &edges, const GraphElem first, 
+        const GraphElem nrows, std::vector<GraphElem> &rowStart)
+{
+  rowStart.resize(nrows + 1);
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < nrows + 1; i++){
+    EdgeInfo key;
+    key.s = first + i;
+    key.t = 0;
+    rowStart[i] = std::lower_bound(edges.begin(), edges.end(), key, edgeInfoLess) 
+        - edges.begin();
+  }
+} // findNewRows
+
+// move the reduced rows to an edge-balanced partition, where a
+// vertex costs its #edges + 1; if minEdgesPerProcess > 0, only the 
+// first max(1, #edges/minEdgesPerProcess) processes own vertices
+// and the rest stay idle for the phase
+void repartitionNewEdges(int me, int nprocs, MPI_Comm comm, GraphElem newGlobalNumVertices, 
+        GraphElem minEdgesPerProcess, PartRanges &parts, EdgeVector &rNewEdges, 
+        std::vector<GraphElem> &rowStart, std::vector<GraphElem> &rowSize)
+{
+  const GraphElem base = parts[me], nrows = parts[me+1] - parts[me];
+  std::vector<GraphElem> rowOffset(nrows + 1);
+  
+  rowOffset[0] = 0;
+  for(GraphElem i = 0; i < nrows; i++)
+    rowOffset[i+1] = rowOffset[i] + rowSize[i];
+
+  GraphElem localCost = rowOffset[nrows] + nrows, costBase = 0;
+  GraphElem localEdges = rowOffset[nrows], globalEdges = 0;
+
+  MPI_Exscan(&localCost, &costBase, 1, MPI_GRAPH_TYPE, MPI_SUM, comm);
+  if (me == 0)
+    costBase = 0;
+  MPI_Allreduce(&localEdges, &globalEdges, 1, MPI_GRAPH_TYPE, MPI_SUM, comm);
+
+  const GraphElem totalCost = globalEdges + newGlobalNumVertices;
+  int nactive = nprocs;
+  if (minEdgesPerProcess > 0)
+    nactive = std::max(1, (int)std::min<GraphElem>(nprocs, globalEdges / minEdgesPerProcess));
+
+  // bin k starts at the first vertex whose cost prefix 
+  // reaches k*(totalCost/nactive), which is searched in the
+  // rows of its (vertex-block) owner
+  std::vector<GraphElem> lparts(nprocs+1, newGlobalNumVertices), newParts(nprocs+1);
+
+#pragma omp parallel for schedule(static)
+  for(int k = 1; k < nactive; k++){
+    const GraphElem target = (totalCost * k) / nactive;
+    GraphElem l = 0, h = nrows;
+
+    while (l < h) {
+      const GraphElem mid = l + (h - l) / 2;
+      if ((costBase + rowOffset[mid] + mid) < target)
+        l = mid + 1;
+      else
+        h = mid;
+    }
     
-  /******  Reconstruction *******/
-  GraphElem s;
-  GraphElem t;
-  GraphWeight w;
-  // Fill in the graph
-  for(GraphElem i = 0; i < comingSize; i++){
-    s = rNewEdges[i].s - parts[me];
-    t = rNewEdges[i].t;
-    w = rNewEdges[i].w;
-    if( localGraph[s].find(t) == localGraph[s].end())
-      localGraph[s].insert(std::make_pair(t,w));
-    else
-      localGraph[s][t] += w;
+    if (l < nrows || (me == (nprocs - 1)))
+      lparts[k] = base + l;
   }
-  // Calculate the total number of edges
+
+  MPI_Allreduce(lparts.data(), newParts.data(), nprocs+1, MPI_GRAPH_TYPE, 
+          MPI_MIN, comm);
+  newParts[0] = 0;
+  newParts[nprocs] = newGlobalNumVertices;
+
+  if (newParts == parts)
+    return;
+
+  // compact the reduced rows, which are then 
+  // bucketed by the new owners
+  EdgeVector sNewEdges(rowOffset[nrows]);
+  std::vector<GraphElem> sNewSize(nprocs);
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < nrows; i++)
+    std::copy(rNewEdges.begin() + rowStart[i], rNewEdges.begin() + rowStart[i] + rowSize[i], 
+            sNewEdges.begin() + rowOffset[i]);
+
+  EdgeVector().swap(rNewEdges);
+
+  for(int p = 0; p < nprocs; p++){
+    const GraphElem lo = std::min(std::max(newParts[p], base), base + nrows) - base;
+    const GraphElem hi = std::min(std::max(newParts[p+1], base), base + nrows) - base;
+    sNewSize[p] = rowOffset[hi] - rowOffset[lo];
+  }
+
+  exchangeNewEdges(me, nprocs, comm, sNewEdges, sNewSize, rNewEdges);
+  
+  // received rows come from the processes in order, 
+  // so they are still sorted and reduced
+  const GraphElem newRows = newParts[me+1] - newParts[me];
+  findNewRows(rNewEdges, newParts[me], newRows, rowStart);
+  rowSize.resize(newRows);
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < newRows; i++)
+    rowSize[i] = rowStart[i+1] - rowStart[i];
+
+  parts.swap(newParts);
+
+#ifdef DEBUG_PRINTF    
+  ofs << "Repartitioned next level graph over " << nactive << " processes, #vertices: " 
+      << newRows << ", #edges: " << rNewEdges.size() << std::endl;
+#endif
+} // repartitionNewEdges
+
+// the next-level graph dg (on comm) of the received new edges, 
+// which are released once it is written
+static void buildNewGraph(int me, int nprocs, MPI_Comm comm, DistGraph* &dg, 
+        GraphElem newGlobalNumVertices, PartRanges &parts, EdgeVector &rNewEdges, 
+        bool rebalance, GraphElem minEdgesPerProcess)
+{
+  sortNewEdges(rNewEdges);
+
+  // row boundaries in the sorted triples
+  std::vector<GraphElem> rowStart;
+  findNewRows(rNewEdges, parts[me], parts[me+1] - parts[me], rowStart);
+
+  // reduce every row in place and count its unique tails
+  std::vector<GraphElem> rowSize(parts[me+1] - parts[me]);
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < (parts[me+1] - parts[me]); i++){
+    EdgeVector::iterator first = rNewEdges.begin() + rowStart[i];
+    rowSize[i] = reduceNewEdges(first, rNewEdges.begin() + rowStart[i+1]) - first;
+  }
+
+  if (rebalance)
+    repartitionNewEdges(me, nprocs, comm, newGlobalNumVertices, minEdgesPerProcess, 
+            parts, rNewEdges, rowStart, rowSize);
   
+  GraphElem newLocalNumVertices = parts[me+1] - parts[me]; 
+#ifdef DEBUG_PRINTF    
+  ofs << "newLocalNumvertices: " << newLocalNumVertices << " newGlobalNumVertices " << newGlobalNumVertices << std::endl;
+#endif  
+
+  // set to zero initially
+  GraphElem newGlobalNumEdges = 0;
+  GraphElem newLocalNumEdges = 0;
+
+  dg = new DistGraph(newGlobalNumVertices, newGlobalNumEdges, comm);
+  dg->createLocalGraph(newLocalNumVertices,newLocalNumEdges,&parts);
+  Graph &g = dg->getLocalGraph();
+
+  // Calculate the total number of edges
   for(GraphElem i =0; i<newLocalNumVertices; i++){
-    newLocalNumEdges += localGraph[i].size();
+    newLocalNumEdges += rowSize[i];
   }
   
 #ifdef DEBUG_PRINTF    
   ofs << " New Local NumEdges after graph reconstruction " << newLocalNumEdges << std::endl;
 #endif
 
-  MPI_Allreduce(&newLocalNumEdges,&newGlobalNumEdges,1,MPI_GRAPH_TYPE,MPI_SUM,MPI_COMM_WORLD);
+  MPI_Allreduce(&newLocalNumEdges,&newGlobalNumEdges,1,MPI_GRAPH_TYPE,MPI_SUM,comm);
 
 #ifdef DEBUG_PRINTF    
   ofs << "Local New Edges:  " <<  newLocalNumEdges << " Global new Edges: " << newGlobalNumEdges << std::endl; 
@@ -462,43 +710,377 @@ void send_newEdges(int me, int nprocs, DistGraph* &dg,
   // Write Vptr
   g.edgeListIndexes[0] = 0;
   for(GraphElem i =1; i <newLocalNumVertices+1 ;i++){
-    g.edgeListIndexes[i] = g.edgeListIndexes[i-1] + localGraph[i-1].size();
+    g.edgeListIndexes[i] = g.edgeListIndexes[i-1] + rowSize[i-1];
   }
+  
   // Write Edges
-  GraphElem offset = 0;
+#pragma omp parallel for
   for(GraphElem i =0 ; i<newLocalNumVertices; i++){
-    for(NewEdge::iterator it = localGraph[i].begin(); it!= localGraph[i].end(); it++){
-      g.edgeList[offset].tail = it->first;
-      g.edgeList[offset].weight = it->second;
-      offset++;
-          
+    const GraphElem offset = g.edgeListIndexes[i];
+    for(GraphElem j = 0; j < rowSize[i]; j++){
+      const EdgeInfo &x = rNewEdges[rowStart[i] + j];
+      g.setEdge(offset + j, x.t, x.w);
     }
   }
-  assert(offset == newLocalNumEdges);
-}
+
+  EdgeVector().swap(rNewEdges);
+} // buildNewGraph
+
+void send_newEdges(int me, int nprocs, DistGraph* &dg, GraphElem newGlobalNumVertices, 
+        PartRanges &parts, EdgeVector &sNewEdges, std::vector<GraphElem> &sNewSize,
+        bool rebalance, GraphElem minEdgesPerProcess)
+{
+  // the next-level graph is on the same processes
+  MPI_Comm comm = dg->getComm();
+  delete dg;
+
+  /*******  Send and receive *****/
+  EdgeVector rNewEdges;
+
+  exchangeNewEdges(me, nprocs, comm, sNewEdges, sNewSize, rNewEdges);
+  EdgeVector().swap(sNewEdges);
+    
+  /******  Reconstruction *******/
+  buildNewGraph(me, nprocs, comm, dg, newGlobalNumVertices, parts, rNewEdges, 
+          rebalance, minEdgesPerProcess);
+} // send_newEdges
+
+// the owned coarse vertices [first, first + ownedColors.size()) of
+// every process (in process order) get their colors, which are moved
+// to the owners of the next level graph in parts
+static void projectNewColors(int me, int nprocs, MPI_Comm comm, const ColorVector &ownedColors, 
+        const PartRanges &parts, ColorVector &colors)
+{
+  const GraphElem lnc = ownedColors.size();
+  std::vector<GraphElem> counts(nprocs), first(nprocs + 1, 0);
+
+  MPI_Allgather(&lnc, 1, MPI_GRAPH_TYPE, counts.data(), 1, MPI_GRAPH_TYPE, comm);
+
+  for (int p = 0; p < nprocs; p++)
+    first[p+1] = first[p] + counts[p];
+
+  colors.assign(parts[me+1] - parts[me], -1);
+
+  std::vector<MPI_Request> sreqs(nprocs), rreqs(nprocs);
+
+  // the overlaps of the owned ranges with the parts
+  for (int p = 0; p < nprocs; p++) {
+    const GraphElem slo = std::max(first[me], parts[p]), shi = std::min(first[me+1], parts[p+1]);
+    const GraphElem rlo = std::max(first[p], parts[me]), rhi = std::min(first[p+1], parts[me+1]);
+
+    if (p != me && rhi > rlo)
+      MPI_Irecv(colors.data() + (rlo - parts[me]), rhi - rlo, MPI_GRAPH_TYPE, p, 
+              ColoringDataTag, comm, &rreqs[p]);
+    else
+      rreqs[p] = MPI_REQUEST_NULL;
+
+    if (p != me && shi > slo)
+      MPI_Isend(ownedColors.data() + (slo - first[me]), shi - slo, MPI_GRAPH_TYPE, p, 
+              ColoringDataTag, comm, &sreqs[p]);
+    else
+      sreqs[p] = MPI_REQUEST_NULL;
+
+    if (p == me && shi > slo)
+      std::copy(ownedColors.begin() + (slo - first[me]), ownedColors.begin() + (shi - first[me]),
+              colors.begin() + (slo - parts[me]));
+  }
+
+  MPI_Waitall(nprocs, sreqs.data(), MPI_STATUSES_IGNORE);
+  MPI_Waitall(nprocs, rreqs.data(), MPI_STATUSES_IGNORE);
+} // projectNewColors
 
 void distbuildNextLevelGraph(int nprocs, int me, DistGraph*& dg, 
         const size_t &ssz, const size_t &rsz, const std::vector<GraphElem> &ssizes, 
         const std::vector<GraphElem> &rsizes, const std::vector<GraphElem> &svdata, 
-        const std::vector<GraphElem> &rvdata, CommunityVector &cvect) {
-
-  ClusterLocalMap lookUp;
+        const std::vector<GraphElem> &rvdata, CommunityVector &cvect,
+        bool rebalance, GraphElem minEdgesPerProcess, ColorVector *colors,
+        GraphElem batchEdges) {
 
   GraphElem newGlobalNumVertices;
-  VertexCommMap remoteComm;  
-  NewEdgesMap newEdgesMap;
+  std::vector<GraphElem> localNewComm, ghostNewComm, newOwnedComm;
+  ColorVector ownedColors;
+  EdgeVector sNewEdges;
+  std::vector<GraphElem> sNewSize(nprocs);
   double t0, t1;
   t0 = MPI_Wtime();
 
   // Step 1 aggregate the alive communities
-  newGlobalNumVertices = distReNumber(nprocs, lookUp, me, *dg, 
-          ssz, rsz, ssizes, rsizes, svdata, rvdata, cvect, remoteComm);
+  newGlobalNumVertices = distReNumber(nprocs, me, *dg, ssz, rsz, ssizes, rsizes, 
+          svdata, rvdata, cvect, localNewComm, ghostNewComm, newOwnedComm);
 
-  // Step 2 build Local Mapper for redistribution
-  fill_newEdgesMap(me, newEdgesMap, *dg, cvect, remoteComm, lookUp);
-  
-  // Step 3 set up the divider and send the data for new graph
-  send_newEdges(me, nprocs, dg, newGlobalNumVertices, newEdgesMap);
+  // a coarse vertex has the color of the vertex that names its
+  // community, the owned ones are numbered in the order of the vertices
+  if (colors) {
+    for (size_t i = 0; i < newOwnedComm.size(); i++)
+      if (newOwnedComm[i] != -1)
+        ownedColors.push_back((*colors)[i]);
+  }
+
+  // Step 2 set up the divider and bucket the new edges by owner
+  PartRanges parts(nprocs+1);
+
+  parts[0]=0;
+
+  for (int i=1; i<nprocs +1; i++)
+	parts[i]=((newGlobalNumVertices * i) / nprocs);
+
+  if (batchEdges > 0) {
+    // Steps 2 and 3 in batches, the graph is released as it is 
+    // streamed, and deleted before the next one is built
+    MPI_Comm comm = dg->getComm();
+    EdgeVector rNewEdges;
+
+    streamNewEdges(me, nprocs, *dg, rvdata, localNewComm, ghostNewComm, parts, 
+            batchEdges, rNewEdges);
+
+    std::vector<GraphElem>().swap(localNewComm);
+    std::vector<GraphElem>().swap(ghostNewComm);
+    delete dg;
+
+    buildNewGraph(me, nprocs, comm, dg, newGlobalNumVertices, parts, rNewEdges, 
+            rebalance, minEdgesPerProcess);
+  }
+  else {
+    fill_newEdges(me, nprocs, *dg, rvdata, localNewComm, ghostNewComm, parts, 
+            sNewEdges, sNewSize);
+
+    // Step 3 send the data for new graph
+    send_newEdges(me, nprocs, dg, newGlobalNumVertices, parts, sNewEdges, sNewSize,
+            rebalance, minEdgesPerProcess);
+  }
+
+  if (colors)
+    projectNewColors(me, nprocs, dg->getComm(), ownedColors, parts, *colors);
 
   t1 = MPI_Wtime();
 }
+
+// gather the distributed graph into a graph wholly owned 
+// by the root (returns NULL on the other processes)
+DistGraph* gatherDistGraph(int root, int me, int nprocs, const DistGraph &dg)
+{
+  const Graph &g = dg.getLocalGraph();
+  const GraphElem base = dg.getBase(me);
+  const GraphElem nv = g.getNumVertices();
+  const GraphElem tnv = dg.getTotalNumVertices();
+
+  if (!canGatherDistGraph(dg)) {
+    if (me == root)
+      std::cerr << "Gathering " << dg.getTotalNumEdges() << " edges exceeds the " 
+        << std::numeric_limits<int>::max() << " edges of a gather." << std::endl;
+    MPI_Abort(dg.getComm(), -99);
+  }
+  
+  EdgeVector sedges(g.getNumEdges());
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < nv; i++){
+    GraphElem e0, e1;
+    g.getEdgeRangeForVertex(i, e0, e1);
+    for(GraphElem j = e0; j < e1; j++){
+      sedges[j].s = base + i;
+      sedges[j].t = g.getEdgeTail(j);
+      sedges[j].w = g.getEdgeWeight(j);
+    }
+  }
+
+  const int lne = sedges.size();
+  std::vector<int> rcounts, rdispls;
+  EdgeVector redges;
+
+  if (me == root) {
+    rcounts.resize(nprocs);
+    rdispls.resize(nprocs);
+  }
+
+  MPI_Gather(&lne, 1, MPI_INT, rcounts.data(), 1, MPI_INT, root, dg.getComm());
+
+  if (me == root) {
+    GraphElem index = 0;
+    for(int p = 0; p < nprocs; p++){
+      rdispls[p] = index;
+      index += rcounts[p];
+    }
+    redges.resize(index);
+  }
+
+  MPI_Gatherv(sedges.data(), lne, edgeType, redges.data(), rcounts.data(), 
+          rdispls.data(), edgeType, root, dg.getComm());
+  
+  if (me != root)
+    return NULL;
+
+  const GraphElem tne = redges.size();
+
+#if defined(USE_32_BIT_LOCAL_INDEX)
+  if (tne > std::numeric_limits<LocalElem>::max()) {
+    std::cout << "Gathering " << tne << " edges exceeds the range of 32-bit local indices." << std::endl;
+    MPI_Abort(dg.getComm(), -99);
+  }
+#endif
+
+  // edges arrive ordered by source, as the owners are
+  PartRanges parts(2);
+  parts[0] = 0;
+  parts[1] = tnv;
+
+  DistGraph *sdg = new DistGraph(tnv, tne, MPI_COMM_SELF);
+  sdg->createLocalGraph(tnv, tne, &parts);
+  Graph &sg = sdg->getLocalGraph();
+  
+  std::vector<GraphElem> rowStart;
+  findNewRows(redges, 0, tnv, rowStart);
+
+  for(GraphElem i = 0; i < tnv + 1; i++)
+    sg.edgeListIndexes[i] = rowStart[i];
+
+#pragma omp parallel for
+  for(GraphElem j = 0; j < tne; j++)
+    sg.setEdge(j, redges[j].t, redges[j].w);
+
+  return sdg;
+} // gatherDistGraph
+
+// aggregate a graph wholly owned by the caller by its 
+// communities, cvect is renumbered to the new vertices
+void buildNextLevelGraphSharedMemory(DistGraph* &dg, CommunityVector &cvect)
+{
+  const Graph &g = dg->getLocalGraph();
+  const GraphElem nv = g.getNumVertices();
+  
+  // dense renumbering of the alive communities
+  std::vector<GraphElem> newComm(nv, 0);
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < nv; i++){
+#pragma omp atomic write
+    newComm[cvect[i]] = 1;
+  }
+
+  GraphElem nc = 0;
+  for(GraphElem c = 0; c < nv; c++){
+    const GraphElem isAlive = newComm[c];
+    newComm[c] = nc;
+    nc += isAlive;
+  }
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < nv; i++)
+    cvect[i] = newComm[cvect[i]];
+
+  EdgeVector edges(g.getNumEdges());
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < nv; i++){
+    GraphElem e0, e1;
+    g.getEdgeRangeForVertex(i, e0, e1);
+    for(GraphElem j = e0; j < e1; j++){
+      edges[j].s = cvect[i];
+      edges[j].t = cvect[g.getEdgeTail(j)];
+      edges[j].w = g.getEdgeWeight(j);
+    }
+  }
+  
+  MPI_Comm comm = dg->getComm();
+  delete dg;
+
+  sortNewEdges(edges);
+
+  std::vector<GraphElem> rowStart, rowSize(nc);
+  findNewRows(edges, 0, nc, rowStart);
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < nc; i++){
+    EdgeVector::iterator first = edges.begin() + rowStart[i];
+    rowSize[i] = reduceNewEdges(first, edges.begin() + rowStart[i+1]) - first;
+  }
+
+  PartRanges parts(2);
+  parts[0] = 0;
+  parts[1] = nc;
+
+  GraphElem ne = 0;
+  for(GraphElem i = 0; i < nc; i++)
+    ne += rowSize[i];
+
+  dg = new DistGraph(nc, ne, comm);
+  dg->createLocalGraph(nc, ne, &parts);
+  Graph &ng = dg->getLocalGraph();
+  
+  ng.edgeListIndexes[0] = 0;
+  for(GraphElem i = 1; i < nc + 1; i++)
+    ng.edgeListIndexes[i] = ng.edgeListIndexes[i-1] + rowSize[i-1];
+
+#pragma omp parallel for
+  for(GraphElem i = 0; i < nc; i++){
+    const GraphElem offset = ng.edgeListIndexes[i];
+    for(GraphElem j = 0; j < rowSize[i]; j++){
+      const EdgeInfo &x = edges[rowStart[i] + j];
+      ng.setEdge(offset + j, x.t, x.w);
+    }
+  }
+} // buildNextLevelGraphSharedMemory
+
+GraphWeight distLouvainMethodSharedMemory(int me, int nprocs, const DistGraph &dg, 
+        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
+        int& iters)
+{
+  DistGraph *sdg = gatherDistGraph(0, me, nprocs, dg);
+  std::vector<GraphElem> membership;
+  GraphWeight mods[2] = {lower, 0.0}; // modularity, #iterations
+
+  if (me == 0) {
+    const GraphElem tnv = sdg->getTotalNumVertices();
+    membership.resize(tnv);
+    std::iota(membership.begin(), membership.end(), 0);
+
+    // phases as in the distributed method, a phase is 
+    // only kept if it improves the modularity
+    GraphWeight prevMod = lower;
+    for (int level = 0; level < TERMINATION_PHASE_COUNT; level++) {
+      CommunityVector ccomm;
+      int levelIters = 0;
+      
+      const GraphWeight currMod = louvainMethodSharedMemory(*sdg, ccomm, lower, 
+              thresh, levelIters);
+      mods[1] += levelIters;
+
+      if ((currMod - prevMod) <= thresh)
+        break;
+      
+      buildNextLevelGraphSharedMemory(sdg, ccomm);
+
+#pragma omp parallel for
+      for (GraphElem v = 0; v < tnv; v++)
+        membership[v] = ccomm[membership[v]];
+
+      prevMod = currMod;
+    }
+
+    mods[0] = prevMod;
+    delete sdg;
+  }
+
+  MPI_Bcast(mods, 2, MPI_WEIGHT_TYPE, 0, dg.getComm());
+
+  // scatter the communities to the owners
+  const int lnv = dg.getLocalGraph().getNumVertices();
+  std::vector<int> scounts, sdispls;
+
+  if (me == 0) {
+    scounts.resize(nprocs);
+    sdispls.resize(nprocs);
+    for (int p = 0; p < nprocs; p++) {
+      sdispls[p] = dg.getBase(p);
+      scounts[p] = dg.getBound(p) - dg.getBase(p);
+    }
+  }
+
+  cvect.resize(lnv);
+  MPI_Scatterv(membership.data(), scounts.data(), sdispls.data(), MPI_GRAPH_TYPE, 
+          cvect.data(), lnv, MPI_GRAPH_TYPE, 0, dg.getComm());
+
+  iters = mods[1];
+
+  return mods[0];
+} // distLouvainMethodSharedMemory
@@ -58,7 +58,9 @@
 #include <string>
 
 #include <iostream>
+#include <limits>
 #include <numeric>
+#include <algorithm>
 
 #include <omp.h>
 
@@ -73,41 +75,76 @@ typedef struct edgeInfo{
 
 static MPI_Datatype edgeType;
 
-#if defined(__CRAY_MIC_KNL) && defined(USE_AUTOHBW_MEMALLOC)
-typedef std::vector<EdgeInfo, hbw::allocator<EdgeInfo> > EdgeVector;
-typedef std::unordered_set<GraphElem, std::hash<GraphElem>, std::equal_to<GraphElem>, 
-	hbw::allocator<GraphElem> > RemoteCommList;
-typedef std::vector<RemoteCommList, hbw::allocator<RemoteCommList>> PartArray;
-typedef std::map<GraphElem, GraphWeight, std::less<GraphElem>, 
-	hbw::allocator< std::pair< const GraphElem, GraphWeight > > > NewEdge;
-typedef std::unordered_map<GraphElem, NewEdge, std::hash<GraphElem>, std::equal_to<GraphElem>, 
-	hbw::allocator< std::pair< const GraphElem, NewEdge > > > NewEdgesMap;
-#else
-typedef std::vector<EdgeInfo> EdgeVector;
-typedef std::unordered_set<GraphElem> RemoteCommList;
-typedef std::vector<RemoteCommList> PartArray;
-typedef std::map<GraphElem, GraphWeight> NewEdge;
-typedef std::unordered_map<GraphElem,NewEdge> NewEdgesMap;
-#endif
+typedef std::vector<EdgeInfo, DataAllocator<EdgeInfo> > EdgeVector;
 
 void createEdgeMPIType();
 void destroyEdgeMPIType();
 
-static GraphElem distReNumber(int nprocs, ClusterLocalMap& lookUp, int me, 
-        DistGraph &dg, const size_t &ssz, const size_t &rsz, 
+static GraphElem distReNumber(int nprocs, int me, DistGraph &dg, 
+        const size_t &ssz, const size_t &rsz, 
         const std::vector<GraphElem> &ssizes, const std::vector<GraphElem> &rsizes, 
         const std::vector<GraphElem> &svdata, const std::vector<GraphElem> &rvdata,
-        CommunityVector &cvect, VertexCommMap &remoteComm);
+        CommunityVector &cvect, std::vector<GraphElem> &localNewComm, 
+        std::vector<GraphElem> &ghostNewComm, std::vector<GraphElem> &newOwnedComm);
+
+static void sortNewEdges(EdgeVector &edges);
+static EdgeVector::iterator reduceNewEdges(EdgeVector::iterator first, 
+        EdgeVector::iterator last);
+
+static void fillNewEdgeRows(int me, int nprocs, const DistGraph& dg, 
+        const std::vector<GraphElem> &rvdata, const std::vector<GraphElem> &localNewComm, 
+        const std::vector<GraphElem> &ghostNewComm, const PartRanges &parts, 
+        const GraphElem first, const GraphElem last, EdgeVector &sNewEdges, 
+        std::vector<GraphElem> &sNewSize);
+void fill_newEdges(int me, int nprocs, DistGraph& dg, const std::vector<GraphElem> &rvdata, 
+        const std::vector<GraphElem> &localNewComm, const std::vector<GraphElem> &ghostNewComm, 
+        const PartRanges &parts, EdgeVector &sNewEdges, std::vector<GraphElem> &sNewSize);
+
+static void exchangeNewEdges(int me, int nprocs, MPI_Comm comm, const EdgeVector &sNewEdges, 
+        const std::vector<GraphElem> &sNewSize, EdgeVector &rNewEdges);
+static void streamNewEdges(int me, int nprocs, DistGraph& dg, 
+        const std::vector<GraphElem> &rvdata, const std::vector<GraphElem> &localNewComm, 
+        const std::vector<GraphElem> &ghostNewComm, const PartRanges &parts, 
+        const GraphElem batchEdges, EdgeVector &rNewEdges);
+static void findNewRows(const EdgeVector &edges, const GraphElem first, 
+        const GraphElem nrows, std::vector<GraphElem> &rowStart);
 
-void fill_newEdgesMap(int me, NewEdgesMap &newEdgesMap, 
-        DistGraph& dg, CommunityVector &cvect, VertexCommMap &remoteComm, 
-        ClusterLocalMap &lookUp);
+void repartitionNewEdges(int me, int nprocs, MPI_Comm comm, GraphElem newGlobalNumVertices, 
+        GraphElem minEdgesPerProcess, PartRanges &parts, EdgeVector &rNewEdges, 
+        std::vector<GraphElem> &rowStart, std::vector<GraphElem> &rowSize);
 
-void send_newEdges(int me, int nprocs, DistGraph* &dg, GraphElem newGlobalNumVertices,
-  NewEdgesMap& newEdgesMap);
+static void projectNewColors(int me, int nprocs, MPI_Comm comm, const ColorVector &ownedColors, 
+        const PartRanges &parts, ColorVector &colors);
 
+static void buildNewGraph(int me, int nprocs, MPI_Comm comm, DistGraph* &dg, 
+        GraphElem newGlobalNumVertices, PartRanges &parts, EdgeVector &rNewEdges, 
+        bool rebalance, GraphElem minEdgesPerProcess);
+void send_newEdges(int me, int nprocs, DistGraph* &dg, GraphElem newGlobalNumVertices, 
+        PartRanges &parts, EdgeVector &sNewEdges, std::vector<GraphElem> &sNewSize,
+        bool rebalance = false, GraphElem minEdgesPerProcess = 0);
+
+// with batchEdges > 0, the new edges are built and sent in batches of 
+// rows of about batchEdges edges, releasing the graph as it is read, 
+// which bounds the memory of the rebuild (see streamNewEdges)
 void distbuildNextLevelGraph(int nprocs, int me, DistGraph*& dg, 
         const size_t &ssz, const size_t &rsz, const std::vector<GraphElem> &ssizes, 
         const std::vector<GraphElem> &rsizes, const std::vector<GraphElem> &svdata, 
-        const std::vector<GraphElem> &rvdata, CommunityVector &cvect);
+        const std::vector<GraphElem> &rvdata, CommunityVector &cvect,
+        bool rebalance = false, GraphElem minEdgesPerProcess = 0, 
+        ColorVector *colors = NULL, GraphElem batchEdges = 0);
+
+// the edges are gathered with int counts and displacements, so the
+// graph must have at most INT_MAX edges (see canGatherDistGraph)
+DistGraph* gatherDistGraph(int root, int me, int nprocs, const DistGraph &dg);
+inline bool canGatherDistGraph(const DistGraph &dg)
+{ return dg.getTotalNumEdges() <= std::numeric_limits<int>::max(); }
+
+void buildNextLevelGraphSharedMemory(DistGraph* &dg, CommunityVector &cvect);
+
+// gather the graph to the root, which runs (shared-memory) phases
+// of Louvain until the modularity does not improve, and scatter 
+// the resulting communities, returns the final modularity
+GraphWeight distLouvainMethodSharedMemory(int me, int nprocs, const DistGraph &dg, 
+        CommunityVector &cvect, const GraphWeight lower, const GraphWeight thresh, 
+        int& iters);
 #endif
@@ -0,0 +1,234 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#include <algorithm>
+#include <numeric>
+
+#include "reorder.hpp"
+
+// number of edges of a local vertex to local vertices
+static inline GraphElem localDegree(const Graph &g, const GraphElem base, const GraphElem v)
+{
+    const GraphElem nv = g.getNumVertices();
+    GraphElem e0, e1, degree = 0;
+
+    g.getEdgeRangeForVertex(v, e0, e1);
+    for (GraphElem e = e0; e < e1; e++) {
+        const GraphElem t = g.getEdgeTail(e) - base;
+        if (t >= 0 && t < nv && t != v)
+            degree++;
+    }
+
+    return degree;
+} // localDegree
+
+static void rcmOrder(const Graph &g, const GraphElem base, std::vector<GraphElem> &order)
+{
+    const GraphElem nv = g.getNumVertices();
+    std::vector<GraphElem> degree(nv), byDegree(nv), neighbors;
+    std::vector<char> visited(nv, 0);
+
+#pragma omp parallel for
+    for (GraphElem v = 0; v < nv; v++)
+        degree[v] = localDegree(g, base, v);
+
+    // the roots of the components are taken by increasing degree
+    std::iota(byDegree.begin(), byDegree.end(), 0);
+    std::stable_sort(byDegree.begin(), byDegree.end(), 
+            [&] (const GraphElem a, const GraphElem b) { return degree[a] < degree[b]; });
+
+    order.clear();
+    order.reserve(nv);
+
+    for (const GraphElem root : byDegree) {
+        if (visited[root])
+            continue;
+
+        GraphElem head = order.size();
+
+        visited[root] = 1;
+        order.push_back(root);
+
+        while (head < (GraphElem)order.size()) {
+            const GraphElem v = order[head++];
+            GraphElem e0, e1;
+
+            neighbors.clear();
+            g.getEdgeRangeForVertex(v, e0, e1);
+            for (GraphElem e = e0; e < e1; e++) {
+                const GraphElem t = g.getEdgeTail(e) - base;
+                if (t >= 0 && t < nv && !visited[t]) {
+                    visited[t] = 1;
+                    neighbors.push_back(t);
+                }
+            }
+
+            std::stable_sort(neighbors.begin(), neighbors.end(), 
+                    [&] (const GraphElem a, const GraphElem b) { return degree[a] < degree[b]; });
+            order.insert(order.end(), neighbors.begin(), neighbors.end());
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+} // rcmOrder
+
+void computeVertexOrder(const Graph &g, const GraphElem base, const ReorderType type, 
+        const std::vector<GraphElem> *comm, std::vector<GraphElem> &order)
+{
+    const GraphElem nv = g.getNumVertices();
+
+    order.resize(nv);
+    std::iota(order.begin(), order.end(), 0);
+
+    switch (type) {
+        case DEGREE_REORDER:
+            {
+                std::vector<GraphElem> degree(nv);
+
+#pragma omp parallel for
+                for (GraphElem v = 0; v < nv; v++) {
+                    GraphElem e0, e1;
+                    g.getEdgeRangeForVertex(v, e0, e1);
+                    degree[v] = e1 - e0;
+                }
+
+                std::stable_sort(order.begin(), order.end(), 
+                        [&] (const GraphElem a, const GraphElem b) { return degree[a] > degree[b]; });
+            }
+            break;
+        case RCM_REORDER:
+            rcmOrder(g, base, order);
+            break;
+        case COMMUNITY_REORDER:
+            assert(comm);
+            std::stable_sort(order.begin(), order.end(), 
+                    [&] (const GraphElem a, const GraphElem b) { return (*comm)[a] < (*comm)[b]; });
+            break;
+        default:
+            break;
+    }
+} // computeVertexOrder
+
+// perm is the inverse of order
+static void invertOrder(const std::vector<GraphElem> &order, std::vector<GraphElem> &perm)
+{
+    const GraphElem nv = order.size();
+
+    perm.resize(nv);
+#pragma omp parallel for
+    for (GraphElem i = 0; i < nv; i++)
+        perm[order[i]] = i;
+} // invertOrder
+
+void reorderGraph(Graph &g, const ReorderType type, std::vector<GraphElem> &perm)
+{
+    const GraphElem ne = g.getNumEdges();
+    std::vector<GraphElem> order, tails(ne);
+
+    computeVertexOrder(g, 0, type, NULL, order);
+    invertOrder(order, perm);
+
+#pragma omp parallel for
+    for (GraphElem e = 0; e < ne; e++)
+        tails[e] = perm[g.getEdgeTail(e)];
+
+    g.permute(order, tails);
+} // reorderGraph
+
+void distReorderGraph(int me, int nprocs, DistGraph &dg, const ReorderType type, 
+        const std::vector<GraphElem> *comm, std::vector<GraphElem> &perm)
+{
+    Graph &g = dg.getLocalGraph();
+    const GraphElem nv = g.getNumVertices(), ne = g.getNumEdges();
+    const GraphElem base = dg.getBase(me), bound = dg.getBound(me);
+    std::vector<GraphElem> order, ghosts, newGhosts, tails(ne);
+
+    computeVertexOrder(g, base, type, comm, order);
+    invertOrder(order, perm);
+
+    // new labels of the ghosts, from their owners
+    for (GraphElem e = 0; e < ne; e++) {
+        const GraphElem t = g.getEdgeTail(e);
+        if (t < base || t >= bound)
+            ghosts.push_back(t);
+    }
+
+    std::sort(ghosts.begin(), ghosts.end());
+    ghosts.erase(std::unique(ghosts.begin(), ghosts.end()), ghosts.end());
+
+    queryOwners(me, nprocs, dg, ghosts, newGhosts, 
+            [] (const std::vector<GraphElem> &) {}, 
+            [&] (const GraphElem v) { return base + perm[v - base]; });
+
+#pragma omp parallel for
+    for (GraphElem e = 0; e < ne; e++) {
+        const GraphElem t = g.getEdgeTail(e);
+
+        if (t >= base && t < bound)
+            tails[e] = base + perm[t - base];
+        else
+            tails[e] = newGhosts[std::lower_bound(ghosts.begin(), ghosts.end(), t) 
+                - ghosts.begin()];
+    }
+
+    g.permute(order, tails);
+} // distReorderGraph
+
+void restoreInputOrder(const std::vector<GraphElem> &perm, std::vector<GraphElem> &values)
+{
+    const GraphElem nv = perm.size();
+    std::vector<GraphElem> restored(nv);
+
+#pragma omp parallel for
+    for (GraphElem v = 0; v < nv; v++)
+        restored[v] = values[perm[v]];
+
+    values.swap(restored);
+} // restoreInputOrder
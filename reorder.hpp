@@ -0,0 +1,95 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+#ifndef __REORDER_H
+#define __REORDER_H
+
+#include <vector>
+
+#include "distgraph.hpp"
+
+// Relabeling of the vertices of every process, so that vertices
+// which are accessed together are stored together. The ranges of
+// the processes stay the same, only the vertices within a range
+// are permuted:
+//   DEGREE_REORDER:    decreasing degree (hubs first)
+//   RCM_REORDER:       reverse Cuthill-McKee over the edges between
+//                      local vertices, every component is traversed
+//                      breadth-first from a vertex of minimum degree
+//   COMMUNITY_REORDER: the members of a community are contiguous
+// perm[v] is the new (local) label of the local vertex v, that
+// is kept to map the results back to the input vertices.
+enum ReorderType
+{
+    NO_REORDER,
+    DEGREE_REORDER,
+    RCM_REORDER,
+    COMMUNITY_REORDER
+};
+
+// vertex order[i] of g becomes vertex i, the local vertices
+// are [base, base + #vertices); comm holds the community of
+// every vertex for COMMUNITY_REORDER (NULL otherwise)
+void computeVertexOrder(const Graph &g, const GraphElem base, const ReorderType type, 
+        const std::vector<GraphElem> *comm, std::vector<GraphElem> &order);
+
+// relabel a (whole) graph
+void reorderGraph(Graph &g, const ReorderType type, std::vector<GraphElem> &perm);
+
+// relabel the vertices of every process, the owners 
+// are queried for the new labels of the ghosts
+void distReorderGraph(int me, int nprocs, DistGraph &dg, const ReorderType type, 
+        const std::vector<GraphElem> *comm, std::vector<GraphElem> &perm);
+
+// values[v] = values[perm[v]], the values of the
+// relabeled vertices in the order of the input
+void restoreInputOrder(const std::vector<GraphElem> &perm, std::vector<GraphElem> &values);
+
+#endif // __REORDER_H
@@ -129,12 +129,9 @@ void processGraphData(Graph &g, std::vector<GraphElem> &edgeCount,
 			  ")" << std::endl;
 
 	  for (GraphElem j = e0; j < e1; j++) {
-		  Edge &edge = g.getEdge(j);
-
 		  assert(ePos == j);
 		  assert(i == edgeList[ePos].i_);
-		  edge.tail = edgeList[ePos].j_;
-		  edge.weight = edgeList[ePos].w_;
+		  g.setEdge(j, edgeList[ePos].j_, edgeList[ePos].w_);
 
 		  ePos++;
 	  }
@@ -0,0 +1,189 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+
+#include <iostream>
+#include <numeric>
+
+#include <mpi.h>
+
+#include "arena.hpp"
+#include "rebuild.hpp"
+#include "utils.hpp"
+#include "vite.hpp"
+
+// the threshold of a phase, with threshold scaling the thresholds
+// cycle from 1.0E-3 to 1.0E-6 (as in bin/graphClustering)
+static GraphWeight phaseThreshold(const ClusterOptions &options, int &shortPhase)
+{
+  if (!options.thresholdScaling || options.onePhase)
+      return options.threshold;
+
+  if (shortPhase > 12)
+      shortPhase = 0;
+
+  if (shortPhase <= 2)
+      return 1.0E-3;
+  if (shortPhase <= 6)
+      return 1.0E-4;
+  if (shortPhase <= 9)
+      return 1.0E-5;
+  
+  return options.threshold;
+} // phaseThreshold
+
+GraphWeight cluster(const DistGraph &dg, MPI_Comm comm, const ClusterOptions &options,
+        std::vector<GraphElem> &membership, int *phases, int *iterations)
+{
+  int me, nprocs;
+  
+  MPI_Comm_rank(comm, &me);
+  MPI_Comm_size(comm, &nprocs);
+
+  if (static_cast<int>(dg.parts->size()) != nprocs + 1) {
+      std::cerr << "The graph is not distributed over the processes of the communicator." 
+          << std::endl;
+      MPI_Abort(comm, -99);
+  }
+  if (options.louvain.order != NATURAL_ORDER) {
+      std::cerr << "The coloring orders cannot be used by cluster." << std::endl;
+      MPI_Abort(comm, -99);
+  }
+
+  // the messages of the job are on a communicator of its own
+  MPI_Comm jobComm;
+  MPI_Comm_dup(comm, &jobComm);
+
+  createCommunityMPIType();
+  createEdgeMPIType();
+
+  DistGraph *cg = new DistGraph(dg);
+  cg->setComm(jobComm);
+
+  const GraphElem lnv = dg.getLocalGraph().getNumVertices();
+  membership.resize(lnv);
+  std::iota(membership.begin(), membership.end(), dg.getBase(me));
+
+  std::vector<GraphElem> ssizes, rsizes, svdata, rvdata;
+  size_t ssz = 0, rsz = 0;
+  CommunityVector cvect;
+  GraphWeight currMod = -1.0, prevMod = -1.0;
+  int phase = 0, shortPhase = 0, iters = 0, totIters = 0;
+
+  while (true) {
+      const GraphWeight threshold = phaseThreshold(options, shortPhase);
+      const bool finishSharedMemory = !options.onePhase && (options.sharedMemoryThreshold > 0) 
+          && (cg->getTotalNumVertices() <= options.sharedMemoryThreshold) 
+          && canGatherDistGraph(*cg);
+
+      phaseArena.reset();
+
+      if (finishSharedMemory)
+          currMod = distLouvainMethodSharedMemory(me, nprocs, *cg, cvect, currMod, 
+                  threshold, iters);
+      else {
+          LouvainOptions louvain(options.louvain);
+
+          if (phase > 0) {
+              louvain.initialComm = NULL;
+              louvain.initialFrontier = NULL;
+          }
+
+          currMod = distLouvainMethod(me, nprocs, *cg, ssz, rsz, ssizes, rsizes, 
+                  svdata, rvdata, cvect, currMod, threshold, iters, louvain);
+      }
+      totIters += iters;
+
+      if ((currMod - prevMod) <= threshold) {
+          // at least one phase with the final threshold
+          if (options.thresholdScaling && !options.onePhase && phase < 10) {
+              currMod = distLouvainMethod(me, nprocs, *cg, ssz, rsz, ssizes, rsizes, 
+                      svdata, rvdata, cvect, currMod, options.threshold, iters);
+              totIters += iters;
+          }
+          break;
+      }
+
+      updateMembership(me, nprocs, *cg, cvect, membership, phase == 0);
+      
+      prevMod = currMod;
+      currMod = -1.0;
+      phase++;
+
+      if (finishSharedMemory || options.onePhase || phase == TERMINATION_PHASE_COUNT 
+              || totIters > 10000)
+          break;
+
+      distbuildNextLevelGraph(nprocs, me, cg, ssz, rsz, ssizes, rsizes, svdata, rvdata, 
+              cvect, options.rebalancePhases, options.minEdgesPerProcess, NULL, 
+              options.rebuildBatchEdges);
+
+      if (options.thresholdScaling && !options.onePhase)
+          shortPhase++;
+  }
+
+  delete cg;
+
+  destroyCommunityMPIType();
+  destroyEdgeMPIType();
+
+#if defined(USE_MPI_NEIGHBORHOOD_COLLECTIVES)
+  destroyGhostNeighborhood();
+#endif
+
+  MPI_Comm_free(&jobComm);
+
+  if (phases)
+      *phases = phase;
+  if (iterations)
+      *iterations = totIters;
+
+  return prevMod;
+} // cluster
@@ -0,0 +1,97 @@
+// ***********************************************************************
+//
+//            Vite: A C++ library for distributed-memory graph clustering 
+//                  using MPI+OpenMP
+// 
+//               Daniel Chavarria (daniel.chavarria@pnnl.gov)
+//               Antonino Tumeo (antonino.tumeo@pnnl.gov)
+//               Mahantesh Halappanavar (hala@pnnl.gov)
+//               Pacific Northwest National Laboratory	
+//
+//               Hao Lu (luhowardmark@wsu.edu)
+//               Sayan Ghosh (sayan.ghosh@wsu.edu)
+//               Ananth Kalyanaraman (ananth@eecs.wsu.edu)
+//               Washington State University
+//
+// ***********************************************************************
+//
+//       Copyright (2017) Battelle Memorial Institute
+//                      All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+// 1. Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// ************************************************************************
+
+
+#ifndef __VITE_H
+#define __VITE_H
+
+#include <vector>
+
+#include <mpi.h>
+
+#include "distgraph.hpp"
+#include "louvain.hpp"
+
+// Library entry point (bin/libvite.a, the objects of bin/graphClustering 
+// without main.cpp): every call clusters a distributed graph on its own
+// communicator, so that jobs can run side by side on disjoint groups of
+// processes, one job at a time per process (the profiler, the phase
+// arena and the exchange state of the build options are per process)
+
+// the phases of a clustering (as the options of bin/graphClustering)
+struct ClusterOptions
+{
+    // of every phase, the coloring orders are not supported and the 
+    // initial communities and frontier only apply to the first phase
+    LouvainOptions louvain;
+
+    GraphWeight threshold;          // of the modularity gain of a phase
+    bool thresholdScaling;          // coarser thresholds first (-i)
+    bool onePhase;                  // (-p)
+    bool rebalancePhases;           // rebalance the coarse graphs (-m)
+    GraphElem minEdgesPerProcess;
+    GraphElem sharedMemoryThreshold;// finish on the root (-k)
+    GraphElem rebuildBatchEdges;    // rebuild in batches (-M)
+
+    ClusterOptions(): threshold(1.0E-6), thresholdScaling(false), onePhase(false),
+        rebalancePhases(false), minEdgesPerProcess(0), sharedMemoryThreshold(0), 
+        rebuildBatchEdges(0) {}
+};
+
+// cluster dg, distributed over the processes of comm (the ranks of comm
+// index its parts, its communicator is ignored, and it is not modified),
+// collective over comm; membership[v] is the community of the vertex 
+// base + v (base is the first vertex of the process), the communities 
+// are numbered densely from 0; returns the modularity, and the numbers
+// of phases and iterations if requested
+GraphWeight cluster(const DistGraph &dg, MPI_Comm comm, const ClusterOptions &options,
+        std::vector<GraphElem> &membership, int *phases = NULL, int *iterations = NULL);
+
+#endif // __VITE_H